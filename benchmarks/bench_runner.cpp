@@ -1,66 +1,6 @@
 #include "bench_runner.hpp"
-#include "../src/RenderGraphUtil.hpp"
 
-std::vector<std::string> chosen_resource;
-
-vuk::BenchRunner::BenchRunner() {
-	vkb::InstanceBuilder builder;
-	builder
-	    .set_debug_callback([](VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
-	                           VkDebugUtilsMessageTypeFlagsEXT messageType,
-	                           const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData,
-	                           void* pUserData) -> VkBool32 {
-		    auto ms = vkb::to_string_message_severity(messageSeverity);
-		    auto mt = vkb::to_string_message_type(messageType);
-		    printf("[%s: %s](user defined)\n%s\n", ms, mt, pCallbackData->pMessage);
-		    return VK_FALSE;
-	    })
-	    .set_app_name("vuk_bench")
-	    .set_engine_name("vuk")
-	    .require_api_version(1, 2, 0)
-	    .set_app_version(0, 1, 0);
-	auto inst_ret = builder.build();
-	if (!inst_ret.has_value()) {
-		// error
-	}
-	vkbinstance = inst_ret.value();
-	auto instance = vkbinstance.instance;
-	vkb::PhysicalDeviceSelector selector{ vkbinstance };
-	window = create_window_glfw("vuk-benchmarker", false);
-	surface = create_surface_glfw(vkbinstance.instance, window);
-	selector.set_surface(surface).set_minimum_version(1, 0).add_required_extension(VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME);
-	auto phys_ret = selector.select();
-	if (!phys_ret.has_value()) {
-		// error
-	}
-	vkb::PhysicalDevice vkbphysical_device = phys_ret.value();
-	physical_device = vkbphysical_device.physical_device;
-
-	vkb::DeviceBuilder device_builder{ vkbphysical_device };
-	VkPhysicalDeviceVulkan12Features vk12features{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES };
-	vk12features.timelineSemaphore = true;
-	vk12features.descriptorBindingPartiallyBound = true;
-	vk12features.descriptorBindingUpdateUnusedWhilePending = true;
-	vk12features.shaderSampledImageArrayNonUniformIndexing = true;
-	vk12features.runtimeDescriptorArray = true;
-	vk12features.descriptorBindingVariableDescriptorCount = true;
-	vk12features.hostQueryReset = true;
-	VkPhysicalDeviceSynchronization2FeaturesKHR sync_feat{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES_KHR, .synchronization2 = true };
-	auto dev_ret = device_builder.add_pNext(&vk12features).add_pNext(&sync_feat).build();
-	if (!dev_ret.has_value()) {
-		// error
-	}
-	vkbdevice = dev_ret.value();
-	graphics_queue = vkbdevice.get_queue(vkb::QueueType::graphics).value();
-	auto graphics_queue_family_index = vkbdevice.get_queue_index(vkb::QueueType::graphics).value();
-	device = vkbdevice.device;
-
-	runtime.emplace(RuntimeCreateParameters{ instance, device, physical_device, graphics_queue, graphics_queue_family_index });
-	const unsigned num_inflight_frames = 3;
-	xdev_rf_alloc.emplace(*runtime, num_inflight_frames);
-	global.emplace(*xdev_rf_alloc);
-	swapchain = runtime->add_swapchain(util::make_swapchain(vkbdevice, {}));
-}
+#include <cfloat>
 
 constexpr unsigned stage_wait = 0;
 constexpr unsigned stage_warmup = 1;
@@ -69,12 +9,11 @@ constexpr unsigned stage_live = 3;
 constexpr unsigned stage_complete = 4;
 
 void vuk::BenchRunner::render() {
-	Compiler compiler;
 	while (!glfwWindowShouldClose(window)) {
 		glfwPollEvents();
-		auto& xdev_frame_resource = xdev_rf_alloc->get_next_frame();
-		runtime->next_frame();
-		Allocator frame_allocator(xdev_frame_resource);
+		auto& frame_resource = app->superframe_resource->get_next_frame();
+		app->next_frame();
+		Allocator frame_allocator(frame_resource);
 		ImGui_ImplGlfw_NewFrame();
 		ImGui::NewFrame();
 
@@ -155,17 +94,15 @@ void vuk::BenchRunner::render() {
 
 		auto& bench_case = bench->get_case(current_case);
 		auto& subcase = bench_case.subcases[current_subcase];
-		auto rg = std::make_shared<vuk::RenderGraph>(subcase(*this, frame_allocator, start, end));
+		auto swapchain_image = acquire_next_image("swp_img", acquire_swapchain(*app->swapchain));
+		auto cleared = clear_image(std::move(swapchain_image), vuk::ClearColor{ 0.3f, 0.5f, 0.3f, 1.0f });
+		auto bench_result = subcase(*this, frame_allocator, start, end, std::move(cleared));
 		ImGui::Render();
 
-		vuk::Name attachment_name = "_final";
-		rg->attach_swapchain("_swp", swapchain);
-		rg->clear_image("_swp", attachment_name, vuk::ClearColor{ 0.3f, 0.5f, 0.3f, 1.0f });
-		auto fut = util::ImGui_ImplVuk_Render(frame_allocator, Future{ rg, "_final+" }, imgui_data, ImGui::GetDrawData(), sampled_images);
-		present(frame_allocator, compiler, swapchain, std::move(fut));
-		sampled_images.clear();
+		auto imgui = extra::ImGui_ImplVuk_Render(frame_allocator, std::move(bench_result), imgui_data);
+		enqueue_presentation(std::move(imgui)).submit(frame_allocator, compiler);
 
-		std::optional<double> duration = runtime->retrieve_duration(start, end);
+		std::optional<double> duration = app->runtime->retrieve_duration(start, end);
 		auto& bcase = bench->get_case(current_case);
 		if (!duration) {
 			continue;
@@ -237,6 +174,13 @@ void vuk::BenchRunner::render() {
 			variance *= 1.0 / (num_runs - 1);
 
 			bcase.last_stage_ran[current_subcase]++;
+			// results are also printed, so that runs can be compared without the gui
+			printf("%s / %s: mu=%f us, sigma=%f us2, runs: %u\n",
+			       bcase.label.data(),
+			       bcase.subcase_labels[current_subcase].data(),
+			       mean * 1e6,
+			       variance * 1e12,
+			       num_runs);
 
 			//TODO: https://en.wikipedia.org/wiki/Jarque%E2%80%93Bera_test
 
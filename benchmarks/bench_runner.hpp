@@ -1,15 +1,18 @@
 #pragma once
 
-#include "../examples/glfw.hpp"
 #include "../examples/utils.hpp"
-#include "vuk/runtime/vk/AllocatorHelpers.hpp"
-#include "vuk/runtime/CommandBuffer.hpp"
-#include "vuk/runtime/vk/VkRuntime.hpp"
 #include "vuk/RenderGraph.hpp"
-#include "vuk/SampledImage.hpp"
+#include "vuk/runtime/CommandBuffer.hpp"
+#include "vuk/runtime/vk/AllocatorHelpers.hpp"
 #include "vuk/runtime/vk/DeviceFrameResource.hpp"
-#include <VkBootstrap.h>
+#include "vuk/runtime/vk/VkRuntime.hpp"
+#include "vuk/vsl/Core.hpp"
+
+#include "vuk/extra/GlfwWindow.hpp"
+#include "vuk/extra/ImGuiIntegration.hpp"
+#include "vuk/extra/SimpleInit.hpp"
 #include <backends/imgui_impl_glfw.h>
+#include <memory>
 #include <functional>
 #include <optional>
 #include <stdio.h>
@@ -23,7 +26,8 @@ namespace vuk {
 	struct CaseBase {
 		std::string_view label;
 		std::vector<std::string_view> subcase_labels;
-		std::vector<std::function<RenderGraph(BenchRunner&, vuk::Allocator&, Query, Query)>> subcases;
+		// each subcase renders into the cleared swapchain image and returns it
+		std::vector<std::function<Value<ImageAttachment>(BenchRunner&, vuk::Allocator&, Query, Query, Value<ImageAttachment>)>> subcases;
 		std::vector<std::vector<double>> timings;
 		std::vector<std::vector<float>> binned;
 		std::vector<uint32_t> last_stage_ran;
@@ -37,7 +41,7 @@ namespace vuk {
 
 	struct BenchBase {
 		std::string_view name;
-		std::function<void(BenchRunner&, vuk::Allocator&)> setup;
+		std::function<void(BenchRunner&, vuk::Allocator&, vuk::Runtime&)> setup;
 		std::function<void(BenchRunner&, vuk::Allocator&)> gui;
 		std::function<void(BenchRunner&, vuk::Allocator&)> cleanup;
 		std::function<CaseBase&(unsigned)> get_case;
@@ -54,8 +58,8 @@ namespace vuk {
 			Case(std::string_view label, F&& subcase_template) : CaseBase{ label } {
 				std::apply(
 				    [this, subcase_template](auto&&... ts) {
-					    (subcases.emplace_back([=](BenchRunner& runner, vuk::Allocator& frame_allocator, Query start, Query end) {
-						    return subcase_template(runner, frame_allocator, start, end, ts);
+					    (subcases.emplace_back([=](BenchRunner& runner, vuk::Allocator& frame_allocator, Query start, Query end, Value<ImageAttachment> target) {
+						    return subcase_template(runner, frame_allocator, start, end, std::move(target), ts);
 					    }),
 					     ...);
 					    (subcase_labels.emplace_back(ts.description), ...);
@@ -80,19 +84,10 @@ namespace vuk {
 namespace vuk {
 
 	struct BenchRunner {
-		VkDevice device;
-		VkPhysicalDevice physical_device;
-		VkQueue graphics_queue;
-		std::optional<Runtime> runtime;
-		std::optional<DeviceSuperFrameResource> xdev_rf_alloc;
-		std::optional<Allocator> global;
-		vuk::SwapchainRef swapchain;
 		GLFWwindow* window;
-		VkSurfaceKHR surface;
-		vkb::Instance vkbinstance;
-		vkb::Device vkbdevice;
-		util::ImGuiData imgui_data;
-		plf::colony<vuk::SampledImage> sampled_images;
+		std::unique_ptr<extra::SimpleApp> app;
+		extra::ImGuiData imgui_data;
+		Compiler compiler;
 
 		Query start, end;
 		unsigned current_case = 0;
@@ -103,9 +98,26 @@ namespace vuk {
 
 		BenchBase* bench;
 
-		BenchRunner();
-
 		void setup() {
+			vkb::InstanceBuilder instance_builder =
+			    extra::make_instance_builder(1, 2, true).set_app_name("vuk_bench").set_engine_name("vuk").set_app_version(0, 1, 0);
+			auto inst_ret = instance_builder.build();
+			if (!inst_ret) {
+				auto err_msg = std::string("ERROR: couldn't initialise instance - ") + inst_ret.error().message();
+				printf("ERROR: %s\n", err_msg.c_str());
+				throw std::runtime_error(err_msg);
+			}
+			vkb::Instance instance = inst_ret.value();
+
+			glfwInit();
+			glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+			// fixed size, so that the timings of the cases are comparable between runs
+			glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+			window = glfwCreateWindow(1024, 1024, "vuk-benchmarker", NULL, NULL);
+			auto surface = create_surface_glfw(instance.instance, window);
+			auto physical_device = extra::select_physical_device(instance, surface);
+			app = extra::make_device_builder(physical_device).set_recommended_features().build_app(true, 3);
+
 			// Setup Dear ImGui runtime
 			IMGUI_CHECKVERSION();
 			ImGui::CreateContext();
@@ -114,31 +126,27 @@ namespace vuk {
 			// Setup Platform/Renderer bindings
 			ImGui_ImplGlfw_InitForVulkan(window, true);
 
-			start = runtime->create_timestamp_query();
-			end = runtime->create_timestamp_query();
-			{ imgui_data = util::ImGui_ImplVuk_Init(*global); }
-			bench->setup(*this, *global);
+			start = app->runtime->create_timestamp_query();
+			end = app->runtime->create_timestamp_query();
+			imgui_data = extra::ImGui_ImplVuk_Init(*app->superframe_allocator);
+			bench->setup(*this, *app->superframe_allocator, *app->runtime);
 		}
 
 		void render();
 
 		void cleanup() {
-			runtime->wait_idle();
+			app->runtime->wait_idle();
 			if (bench->cleanup) {
-				bench->cleanup(*this, *global);
+				bench->cleanup(*this, *app->superframe_allocator);
 			}
 		}
 
 		~BenchRunner() {
-			imgui_data.font_texture.view.reset();
-			imgui_data.font_texture.image.reset();
-			xdev_rf_alloc.reset();
-			runtime.reset();
-			auto vkDestroySurfaceKHR = (PFN_vkDestroySurfaceKHR)vkbinstance.fp_vkGetInstanceProcAddr(vkbinstance.instance, "vkDestroySurfaceKHR");
-			vkDestroySurfaceKHR(vkbinstance.instance, surface, nullptr);
-			destroy_window_glfw(window);
-			vkb::destroy_device(vkbdevice);
-			vkb::destroy_instance(vkbinstance);
+			imgui_data.font_image.reset();
+			imgui_data.font_image_view.reset();
+			app.reset();
+			glfwDestroyWindow(window);
+			glfwTerminate();
 		}
 
 		static BenchRunner& get_runner() {
@@ -0,0 +1,66 @@
+#include "vuk/runtime/Cache.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+// Measures Cache<T>::acquire throughput with many threads hitting a small set of hot keys, like recording threads hitting the pipeline caches.
+// The cached objects are fake, no Vulkan device is needed.
+
+namespace {
+	vuk::Sampler create_fake(void*, const vuk::SamplerCreateInfo& ci) {
+		vuk::Sampler s{};
+		s.id = (size_t)ci.maxAnisotropy;
+		return s;
+	}
+
+	void destroy_fake(void*, const vuk::Sampler&) {}
+
+	double run(unsigned thread_count, unsigned key_count, unsigned acquires_per_thread) {
+		vuk::Cache<vuk::Sampler> cache(nullptr, create_fake, destroy_fake);
+		std::vector<vuk::SamplerCreateInfo> keys(key_count);
+		for (unsigned i = 0; i < key_count; i++) {
+			keys[i].maxAnisotropy = (float)i;
+		}
+		// warm up, so that only hits are measured
+		for (auto& k : keys) {
+			cache.acquire(k, 0);
+		}
+
+		std::atomic<bool> go = false;
+		std::atomic<size_t> sink = 0;
+		std::vector<std::thread> threads;
+		for (unsigned t = 0; t < thread_count; t++) {
+			threads.emplace_back([&, t] {
+				while (!go.load(std::memory_order_acquire)) {
+				}
+				size_t acc = 0;
+				for (unsigned i = 0; i < acquires_per_thread; i++) {
+					acc += cache.acquire(keys[(i * 7 + t) % key_count], 1).id;
+				}
+				sink += acc;
+			});
+		}
+		auto start = std::chrono::steady_clock::now();
+		go.store(true, std::memory_order_release);
+		for (auto& t : threads) {
+			t.join();
+		}
+		auto end = std::chrono::steady_clock::now();
+		auto seconds = std::chrono::duration<double>(end - start).count();
+		return (double)thread_count * acquires_per_thread / seconds / 1e6;
+	}
+} // namespace
+
+int main() {
+	constexpr unsigned acquires_per_thread = 1'000'000;
+	printf("%8s %8s %16s\n", "threads", "keys", "Macquires/s");
+	for (unsigned key_count : { 16u, 1024u }) {
+		for (unsigned thread_count : { 1u, 2u, 4u, 8u, 16u, 32u }) {
+			printf("%8u %8u %16.2f\n", thread_count, key_count, run(thread_count, key_count, acquires_per_thread));
+		}
+	}
+	return 0;
+}
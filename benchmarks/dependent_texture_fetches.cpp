@@ -29,72 +29,94 @@ namespace {
 		std::string_view description = "100 tris";
 	};
 
+	struct Texture {
+		vuk::Unique<vuk::Image> image;
+		vuk::Unique<vuk::ImageView> view;
+		vuk::ImageAttachment ia;
+	};
+
+	// a render target that is sampled afterwards
+	Texture allocate_texture(vuk::Allocator& allocator, vuk::Extent3D extent) {
+		Texture tex;
+		tex.ia = vuk::ImageAttachment::from_preset(vuk::ImageAttachment::Preset::eRTT2DUnmipped, vuk::Format::eR8G8B8A8Srgb, extent, vuk::Samples::e1);
+		tex.image = *vuk::allocate_image(allocator, tex.ia);
+		tex.ia.image = *tex.image;
+		tex.view = *vuk::allocate_image_view(allocator, tex.ia);
+		tex.ia.image_view = *tex.view;
+		return tex;
+	}
+
+	vuk::CommandBuffer& bind_fullscreen_state(vuk::CommandBuffer& command_buffer) {
+		return command_buffer.set_viewport(0, vuk::Rect2D::framebuffer())
+		    .set_scissor(0, vuk::Rect2D::framebuffer())
+		    .set_rasterization({})
+		    .broadcast_color_blend({});
+	}
+
 	template<class T>
-	vuk::RenderGraph test_case(vuk::Allocator& allocator, bool dependent, vuk::Texture& src, vuk::Texture& dst, vuk::Query start, vuk::Query end, T parameters) {
-		vuk::RenderGraph rg;
-		rg.add_pass({ .resources = { "_dst"_image >> vuk::eColorWrite }, .execute = [start, end, parameters, &src, dependent](vuk::CommandBuffer& command_buffer) {
-			             command_buffer.set_viewport(0, vuk::Rect2D::framebuffer())
-			                 .set_scissor(0, vuk::Rect2D::framebuffer())
-			                 .set_rasterization({})
-			                 .broadcast_color_blend({})
-			                 .bind_image(0, 0, *src.view)
-			                 .bind_sampler(0, 0, vuk::SamplerCreateInfo{ .magFilter = vuk::Filter::eLinear, .minFilter = vuk::Filter::eLinear });
-			             if (dependent) {
-				             command_buffer.bind_graphics_pipeline("dependent");
-				             command_buffer.push_constants<unsigned>(vuk::ShaderStageFlagBits::eFragment, 0, 1.0f / (float)src.extent.width);
-			             } else {
-				             command_buffer.bind_graphics_pipeline("nondependent");
-			             }
-
-			             vuk::TimedScope _{ command_buffer, start, end };
-			             for (auto i = 0; i < parameters.n_draws; i++) {
-				             command_buffer.draw(3 * parameters.n_tris, 1, 0, 0);
-			             }
-		             } });
-		rg.add_pass(
-		    { .resources = { "_final"_image >> vuk::eColorWrite, "_dst+"_image >> vuk::eFragmentSampled }, .execute = [](vuk::CommandBuffer& command_buffer) {
-			     command_buffer.set_viewport(0, vuk::Rect2D::framebuffer())
-			         .set_scissor(0, vuk::Rect2D::framebuffer())
-			         .set_rasterization({})
-			         .broadcast_color_blend({})
-			         .bind_graphics_pipeline("blit")
-			         .bind_image(0, 0, "_dst")
-			         .bind_sampler(0, 0, vuk::SamplerCreateInfo{ .magFilter = vuk::Filter::eLinear, .minFilter = vuk::Filter::eLinear });
-			     command_buffer.draw(3, 1, 0, 0);
-		     } });
-		rg.attach_image("_dst", vuk::ImageAttachment::from_texture(dst), vuk::Access::eNone);
-		return rg;
+	vuk::Value<vuk::ImageAttachment> test_case(bool dependent,
+	                                           Texture& src,
+	                                           Texture& dst,
+	                                           vuk::Query start,
+	                                           vuk::Query end,
+	                                           vuk::Value<vuk::ImageAttachment> target,
+	                                           T parameters) {
+		auto fetch = vuk::make_pass(
+		    "fetch",
+		    [start, end, parameters, dependent, width = src.ia.extent.width](
+		        vuk::CommandBuffer& command_buffer, VUK_IA(vuk::eFragmentSampled) src, VUK_IA(vuk::eColorWrite) dst) {
+			    bind_fullscreen_state(command_buffer)
+			        .bind_image(0, 0, src)
+			        .bind_sampler(0, 0, vuk::SamplerCreateInfo{ .magFilter = vuk::Filter::eLinear, .minFilter = vuk::Filter::eLinear });
+			    if (dependent) {
+				    command_buffer.bind_graphics_pipeline("dependent");
+				    command_buffer.push_constants<float>(vuk::ShaderStageFlagBits::eFragment, 0, 1.0f / (float)width);
+			    } else {
+				    command_buffer.bind_graphics_pipeline("nondependent");
+			    }
+
+			    vuk::TimedScope _{ command_buffer, start, end };
+			    for (auto i = 0; i < parameters.n_draws; i++) {
+				    command_buffer.draw(3 * parameters.n_tris, 1, 0, 0);
+			    }
+			    return dst;
+		    });
+		auto blit_to_target = vuk::make_pass("blit", [](vuk::CommandBuffer& command_buffer, VUK_IA(vuk::eColorWrite) target, VUK_IA(vuk::eFragmentSampled) src) {
+			bind_fullscreen_state(command_buffer)
+			    .bind_graphics_pipeline("blit")
+			    .bind_image(0, 0, src)
+			    .bind_sampler(0, 0, vuk::SamplerCreateInfo{ .magFilter = vuk::Filter::eLinear, .minFilter = vuk::Filter::eLinear });
+			command_buffer.draw(3, 1, 0, 0);
+			return target;
+		});
+		// the sources stay in eFragmentSampled, the destinations are overwritten every frame
+		auto fetched = fetch(vuk::acquire_ia("src", src.ia, vuk::Access::eFragmentSampled), vuk::declare_ia("dst", dst.ia));
+		return blit_to_target(std::move(target), std::move(fetched));
 	}
 
-	void blit(vuk::Allocator& allocator, vuk::Texture& src, vuk::Texture& dst) {
-		std::shared_ptr<vuk::RenderGraph> rg = std::make_shared<vuk::RenderGraph>("blit");
-		rg->add_pass({ .resources = { "dst"_image >> vuk::eColorWrite }, .execute = [&src](vuk::CommandBuffer& command_buffer) {
-			              command_buffer.set_viewport(0, vuk::Rect2D::framebuffer())
-			                  .set_scissor(0, vuk::Rect2D::framebuffer())
-			                  .set_rasterization({})
-			                  .broadcast_color_blend({})
-			                  .bind_graphics_pipeline("blit")
-			                  .bind_image(0, 0, *src.view)
-			                  .bind_sampler(0, 0, { .magFilter = vuk::Filter::eLinear, .minFilter = vuk::Filter::eLinear });
-			              command_buffer.draw(3, 1, 0, 0);
-		              } });
-		rg->attach_image("dst", vuk::ImageAttachment::from_texture(dst), vuk::Access::eNone);
-		rg->release("dst+", vuk::Access::eFragmentSampled);
+	void blit(vuk::Allocator& allocator, Texture& src, Texture& dst) {
+		auto pass = vuk::make_pass("blit", [](vuk::CommandBuffer& command_buffer, VUK_IA(vuk::eColorWrite) dst, VUK_IA(vuk::eFragmentSampled) src) {
+			bind_fullscreen_state(command_buffer)
+			    .bind_graphics_pipeline("blit")
+			    .bind_image(0, 0, src)
+			    .bind_sampler(0, 0, { .magFilter = vuk::Filter::eLinear, .minFilter = vuk::Filter::eLinear });
+			command_buffer.draw(3, 1, 0, 0);
+			return dst;
+		});
 		vuk::Compiler c;
-		auto erg = *c.link({ &rg, 1 }, {});
-		vuk::execute_submit_and_wait(allocator, std::move(erg));
+		auto blitted = pass(vuk::declare_ia("dst", dst.ia), vuk::acquire_ia("src", src.ia, vuk::Access::eFragmentSampled));
+		blitted.as_released(vuk::Access::eFragmentSampled, vuk::DomainFlagBits::eGraphicsQueue).wait(allocator, c);
 	}
 
-	std::optional<vuk::Texture> texture_of_doge, tex2k, tex4k, tex8k;
-	std::optional<vuk::Texture> dstsmall, dst2k, dst4k, dst8k;
+	Texture texture_of_doge, tex2k, tex4k, tex8k;
+	Texture dstsmall, dst2k, dst4k, dst8k;
 
 	vuk::Bench<V1, V2, V3, V4> x{
 		// The display name of this example
 		.base = {
 			.name = "Dependent vs. non-dependent texture fetch",
 			// Setup code, ran once in the beginning
-			.setup = [](vuk::BenchRunner& runner, vuk::Allocator& allocator) {
-			auto& ctx = allocator.get_context();
+			.setup = [](vuk::BenchRunner& runner, vuk::Allocator& allocator, vuk::Runtime& runtime) {
 			// Pipelines are created by filling out a vuk::PipelineCreateInfo
 			// In this case, we only need the shaders, we don't care about the rest of the state
 			{
@@ -123,60 +145,60 @@ namespace {
 
 			int x, y, chans;
 			auto doge_image = stbi_load(VUK_EX_PATH_TO_ROOT "examples/doge.png", &x, &y, &chans, 4);
-			auto [tex, tex_fut] = create_texture(allocator, vuk::Format::eR8G8B8A8Srgb, vuk::Extent3D{ (unsigned)x, (unsigned)y, 1u }, doge_image, false);
-			texture_of_doge = std::move(tex);
+			texture_of_doge.ia = vuk::ImageAttachment::from_preset(
+			    vuk::ImageAttachment::Preset::eMap2D, vuk::Format::eR8G8B8A8Srgb, vuk::Extent3D{ (unsigned)x, (unsigned)y, 1u }, vuk::Samples::e1);
+			texture_of_doge.ia.level_count = 1;
+			auto [image, view, doge] = vuk::create_image_and_view_with_data(allocator, vuk::DomainFlagBits::eTransferOnGraphics, texture_of_doge.ia, doge_image);
+			texture_of_doge.image = std::move(image);
+			texture_of_doge.view = std::move(view);
 			vuk::Compiler c;
-			tex_fut.wait(allocator, c);
+			doge.as_released(vuk::Access::eFragmentSampled, vuk::DomainFlagBits::eGraphicsQueue).wait(allocator, c);
 			stbi_image_free(doge_image);
-			tex2k = ctx.allocate_texture(allocator, vuk::ImageCreateInfo{.format = vuk::Format::eR8G8B8A8Srgb, .extent = {.width = 2048, .height = 2048, .depth = 1}, .usage = vuk::ImageUsageFlagBits::eColorAttachment | vuk::ImageUsageFlagBits::eSampled });
-			tex4k = ctx.allocate_texture(allocator, vuk::ImageCreateInfo{.format = vuk::Format::eR8G8B8A8Srgb, .extent = {.width = 4096, .height = 4096, .depth = 1}, .usage = vuk::ImageUsageFlagBits::eColorAttachment | vuk::ImageUsageFlagBits::eSampled });
-			tex8k = ctx.allocate_texture(allocator, vuk::ImageCreateInfo{.format = vuk::Format::eR8G8B8A8Srgb, .extent = {.width = 8192, .height = 8192, .depth = 1}, .usage = vuk::ImageUsageFlagBits::eColorAttachment | vuk::ImageUsageFlagBits::eSampled });
-			blit(allocator, *texture_of_doge, *tex2k);
-			blit(allocator, *texture_of_doge, *tex4k);
-			blit(allocator, *texture_of_doge, *tex8k);
-			dstsmall = ctx.allocate_texture(allocator, vuk::ImageCreateInfo{.format = vuk::Format::eR8G8B8A8Srgb, .extent = {.width = (unsigned)x, .height = (unsigned)y, .depth = 1}, .usage = vuk::ImageUsageFlagBits::eColorAttachment | vuk::ImageUsageFlagBits::eSampled });
-			dst2k = ctx.allocate_texture(allocator, vuk::ImageCreateInfo{.format = vuk::Format::eR8G8B8A8Srgb, .extent = {.width = 2048, .height = 2048, .depth = 1}, .usage = vuk::ImageUsageFlagBits::eColorAttachment | vuk::ImageUsageFlagBits::eSampled });
-			dst4k = ctx.allocate_texture(allocator, vuk::ImageCreateInfo{.format = vuk::Format::eR8G8B8A8Srgb, .extent = {.width = 4096, .height = 4096, .depth = 1}, .usage = vuk::ImageUsageFlagBits::eColorAttachment | vuk::ImageUsageFlagBits::eSampled });
-			dst8k = ctx.allocate_texture(allocator, vuk::ImageCreateInfo{.format = vuk::Format::eR8G8B8A8Srgb, .extent = {.width = 8192, .height = 8192, .depth = 1}, .usage = vuk::ImageUsageFlagBits::eColorAttachment | vuk::ImageUsageFlagBits::eSampled });
+			tex2k = allocate_texture(allocator, { 2048, 2048, 1 });
+			tex4k = allocate_texture(allocator, { 4096, 4096, 1 });
+			tex8k = allocate_texture(allocator, { 8192, 8192, 1 });
+			blit(allocator, texture_of_doge, tex2k);
+			blit(allocator, texture_of_doge, tex4k);
+			blit(allocator, texture_of_doge, tex8k);
+			dstsmall = allocate_texture(allocator, { (unsigned)x, (unsigned)y, 1 });
+			dst2k = allocate_texture(allocator, { 2048, 2048, 1 });
+			dst4k = allocate_texture(allocator, { 4096, 4096, 1 });
+			dst8k = allocate_texture(allocator, { 8192, 8192, 1 });
 			},
 			.gui = [](vuk::BenchRunner& runner, vuk::Allocator& allocator) {
 			},
 			.cleanup = [](vuk::BenchRunner& runner, vuk::Allocator& allocator) {
 				// We release the texture resources
-				texture_of_doge.reset();
-				tex2k.reset();
-				tex4k.reset();
-				tex8k.reset();
-				dstsmall.reset();
-				dst2k.reset();
-				dst4k.reset();
-				dst8k.reset();
+				for (auto* tex : { &texture_of_doge, &tex2k, &tex4k, &tex8k, &dstsmall, &dst2k, &dst4k, &dst8k }) {
+					tex->view.reset();
+					tex->image.reset();
+				}
 			}
 		},
 		.cases = {
-			{"Dependent 112x112", [](vuk::BenchRunner& runner, vuk::Allocator& allocator, vuk::Query start, vuk::Query end, auto&& parameters) {
-				return test_case(allocator, true, *texture_of_doge, *dstsmall, start, end, parameters);
+			{"Dependent 112x112", [](vuk::BenchRunner& runner, vuk::Allocator& allocator, vuk::Query start, vuk::Query end, auto target, auto&& parameters) {
+				return test_case(true, texture_of_doge, dstsmall, start, end, std::move(target), parameters);
 		}},
-			{"Non-dependent 112x112", [](vuk::BenchRunner& runner, vuk::Allocator& allocator, vuk::Query start, vuk::Query end, auto&& parameters) {
-				return test_case(allocator, false, *texture_of_doge, *dstsmall, start, end, parameters);
+			{"Non-dependent 112x112", [](vuk::BenchRunner& runner, vuk::Allocator& allocator, vuk::Query start, vuk::Query end, auto target, auto&& parameters) {
+				return test_case(false, texture_of_doge, dstsmall, start, end, std::move(target), parameters);
 		}},
-			{"Dependent 2K", [](vuk::BenchRunner& runner, vuk::Allocator& allocator, vuk::Query start, vuk::Query end, auto&& parameters) {
-				return test_case(allocator, true, *tex2k, *dst2k, start, end, parameters);
+			{"Dependent 2K", [](vuk::BenchRunner& runner, vuk::Allocator& allocator, vuk::Query start, vuk::Query end, auto target, auto&& parameters) {
+				return test_case(true, tex2k, dst2k, start, end, std::move(target), parameters);
 		}},
-			{"Non-dependent 2K", [](vuk::BenchRunner& runner, vuk::Allocator& allocator, vuk::Query start, vuk::Query end, auto&& parameters) {
-				return test_case(allocator, false, *tex2k, *dst2k, start, end, parameters);
+			{"Non-dependent 2K", [](vuk::BenchRunner& runner, vuk::Allocator& allocator, vuk::Query start, vuk::Query end, auto target, auto&& parameters) {
+				return test_case(false, tex2k, dst2k, start, end, std::move(target), parameters);
 		}},
-			{"Dependent 4K", [](vuk::BenchRunner& runner, vuk::Allocator& allocator, vuk::Query start, vuk::Query end, auto&& parameters) {
-				return test_case(allocator, true, *tex4k, *dst4k, start, end, parameters);
+			{"Dependent 4K", [](vuk::BenchRunner& runner, vuk::Allocator& allocator, vuk::Query start, vuk::Query end, auto target, auto&& parameters) {
+				return test_case(true, tex4k, dst4k, start, end, std::move(target), parameters);
 		}},
-			{"Non-dependent 4K", [](vuk::BenchRunner& runner, vuk::Allocator& allocator, vuk::Query start, vuk::Query end, auto&& parameters) {
-				return test_case(allocator, false, *tex4k, *dst4k, start, end, parameters);
+			{"Non-dependent 4K", [](vuk::BenchRunner& runner, vuk::Allocator& allocator, vuk::Query start, vuk::Query end, auto target, auto&& parameters) {
+				return test_case(false, tex4k, dst4k, start, end, std::move(target), parameters);
 		}},
-			/*{"Dependent 8K", [](vuk::BenchRunner& runner, vuk::Allocator& allocator, vuk::Query start, vuk::Query end, auto&& parameters) {
-				return test_case(allocator, true, *tex8k, *dst8k, start, end, parameters);
+			/*{"Dependent 8K", [](vuk::BenchRunner& runner, vuk::Allocator& allocator, vuk::Query start, vuk::Query end, auto target, auto&& parameters) {
+				return test_case(true, tex8k, dst8k, start, end, std::move(target), parameters);
 		}},
-			{"Non-dependent 8K", [](vuk::BenchRunner& runner, vuk::Allocator& allocator, vuk::Query start, vuk::Query end, auto&& parameters) {
-				return test_case(allocator, false, *tex8k, *dst8k, start, end, parameters);
+			{"Non-dependent 8K", [](vuk::BenchRunner& runner, vuk::Allocator& allocator, vuk::Query start, vuk::Query end, auto target, auto&& parameters) {
+				return test_case(false, tex8k, dst8k, start, end, std::move(target), parameters);
 		}},*/
 		}
 	};
@@ -1,71 +1,125 @@
 #include "bench_runner.hpp"
 
-/* 01_triangle
- * In this example we will draw a bufferless triangle, the "Hello world" of graphics programming
- * For this, we will need to define our pipeline, and then submit a draw.
- *
- * These examples are powered by the example framework, which hides some of the code required, as that would be repeated for each example.
- * Furthermore it allows launching individual examples and all examples with the example same code.
- * Check out the framework (example_runner_*) files if interested!
+#include <chrono>
+
+/* Draw overhead
+ * Measures the CPU cost of recording draws: once with no state changes between draws, and once with a specialization constant change before every draw,
+ * which forces the pipeline key to be rebuilt and looked up each time, and switches between two pipelines.
+ * The GPU timings are reported by the runner, the CPU ns/draw is shown in the gui and printed on exit.
  */
 
 namespace {
 	struct V1 {
-		std::string_view description = "1 iter";
-		static constexpr unsigned n_iters = 1;
+		std::string_view description = "100 draws";
+		static constexpr unsigned n_draws = 100;
 	};
 
 	struct V2 {
-		std::string_view description = "100 iters";
-		static constexpr unsigned n_iters = 100;
+		std::string_view description = "10000 draws";
+		static constexpr unsigned n_draws = 10000;
 	};
 
+	struct CpuTiming {
+		double total_ns = 0;
+		uint64_t draws = 0;
+
+		double ns_per_draw() const {
+			return draws > 0 ? total_ns / draws : 0.0;
+		}
+	};
+
+	// [0]: static state, [1]: pipeline rebind per draw
+	CpuTiming cpu_timings[2];
+
+	template<class F>
+	void timed_draws(CpuTiming& timing, unsigned n_draws, F&& record) {
+		auto start = std::chrono::steady_clock::now();
+		for (unsigned i = 0; i < n_draws; i++) {
+			record(i);
+		}
+		auto end = std::chrono::steady_clock::now();
+		timing.total_ns += std::chrono::duration<double, std::nano>(end - start).count();
+		timing.draws += n_draws;
+	}
+
 	vuk::Bench<V1, V2> x{
 		// The display name of this example
-		.base = { .name = "Dependent vs. non-dependent texture fetch",
+		.base = { .name = "Draw overhead",
 		          // Setup code, ran once in the beginning
 		          .setup =
-		              [](vuk::BenchRunner& runner, vuk::Allocator& frame_allocator) {
-		                // Pipelines are created by filling out a vuk::PipelineCreateInfo
-		                // In this case, we only need the shaders, we don't care about the rest of the state
+		              [](vuk::BenchRunner& runner, vuk::Allocator& allocator, vuk::Runtime& runtime) {
 		                vuk::PipelineBaseCreateInfo pci;
-		                pci.add_glsl(util::read_entire_file("../../examples/triangle.vert"), "triangle.vert");
-		                pci.add_glsl(util::read_entire_file("../../examples/triangle.frag"), "triangle.frag");
-		                // The pipeline is stored with a user give name for simplicity
+		                pci.add_glsl(util::read_entire_file(VUK_EX_PATH_TO_ROOT "examples/triangle.vert"), VUK_EX_PATH_TO_ROOT "examples/triangle.vert");
+		                pci.add_glsl(util::read_entire_file(VUK_EX_PATH_TO_ROOT "examples/triangle.frag"), VUK_EX_PATH_TO_ROOT "examples/triangle.frag");
 		                runtime.create_named_pipeline("triangle", pci);
+
+		                // the fragment shader declares constant 0, so that alternating it selects between two pipelines
+		                vuk::PipelineBaseCreateInfo variants;
+		                variants.add_glsl(util::read_entire_file(VUK_EX_PATH_TO_ROOT "examples/triangle.vert"), VUK_EX_PATH_TO_ROOT "examples/triangle.vert");
+		                variants.add_glsl(R"(#version 450
+#pragma shader_stage(fragment)
+layout(constant_id = 0) const uint variant = 0;
+layout(location = 0) in vec3 inColor;
+layout(location = 0) out vec4 outFragColor;
+
+void main() {
+	outFragColor = vec4(variant == 0 ? inColor : inColor.bgr, 1.0);
+}
+)",
+		                                  "draw_overhead_variants.frag");
+		                runtime.create_named_pipeline("triangle_variants", variants);
 		              },
 		          .gui =
-		              [](vuk::BenchRunner& runner, vuk::Allocator& frame_allocator) {
+		              [](vuk::BenchRunner& runner, vuk::Allocator& allocator) {
+		                ImGui::Text("CPU static state: %.1f ns/draw", cpu_timings[0].ns_per_draw());
+		                ImGui::Text("CPU pipeline rebind: %.1f ns/draw", cpu_timings[1].ns_per_draw());
+		              },
+		          .cleanup =
+		              [](vuk::BenchRunner& runner, vuk::Allocator& allocator) {
+		                printf("CPU static state: %.1f ns/draw\n", cpu_timings[0].ns_per_draw());
+		                printf("CPU pipeline rebind: %.1f ns/draw\n", cpu_timings[1].ns_per_draw());
 		              } },
-		.cases = { { "Dependent, small image",
-		             [](vuk::BenchRunner& runner, vuk::Allocator& frame_allocator, vuk::Query start, vuk::Query end, auto&& parameters) {
-		               auto ptc = ifc.begin();
-		               vuk::RenderGraph rg;
-		               rg.add_pass({ .resources = { "_final"_image(vuk::eColorWrite) }, .execute = [start, end, parameters](vuk::CommandBuffer& command_buffer) {
-			                            vuk::TimedScope _{ command_buffer, start, end };
-			                            command_buffer.set_viewport(0, vuk::Rect2D::framebuffer());
-			                            command_buffer
-			                                .set_scissor(0, vuk::Rect2D::framebuffer()) // Set the scissor area to cover the entire framebuffer
-			                                .bind_graphics_pipeline("triangle")         // Recall pipeline for "triangle" and bind
-			                                .draw(3 * parameters.n_iters, 1, 0, 0);     // Draw 3 vertices
-		                            } });
-		               return rg;
+		.cases = { { "Static state",
+		             [](vuk::BenchRunner& runner,
+		                vuk::Allocator& allocator,
+		                vuk::Query start,
+		                vuk::Query end,
+		                vuk::Value<vuk::ImageAttachment> target,
+		                auto&& parameters) {
+		               auto pass = vuk::make_pass("static state", [start, end, parameters](vuk::CommandBuffer& command_buffer, VUK_IA(vuk::eColorWrite) color) {
+			               vuk::TimedScope _{ command_buffer, start, end };
+			               command_buffer.set_viewport(0, vuk::Rect2D::framebuffer())
+			                   .set_scissor(0, vuk::Rect2D::framebuffer())
+			                   .set_rasterization({})
+			                   .broadcast_color_blend({})
+			                   .bind_graphics_pipeline("triangle");
+			               timed_draws(cpu_timings[0], parameters.n_draws, [&](unsigned) { command_buffer.draw(3, 1, 0, 0); });
+			               return color;
+		               });
+		               return pass(std::move(target));
 		             } },
-		           { "Non-dependent, small image",
-		             [](vuk::BenchRunner& runner, vuk::Allocator& frame_allocator, vuk::Query start, vuk::Query end, auto&& parameters) {
-		               auto ptc = ifc.begin();
-		               vuk::RenderGraph rg;
-		               rg.add_pass({ .resources = { "_final"_image(vuk::eColorWrite) }, .execute = [start, end, parameters](vuk::CommandBuffer& command_buffer) {
-			                            vuk::TimedScope _{ command_buffer, start, end };
-			                            command_buffer.set_viewport(0, vuk::Rect2D::framebuffer());
-			                            command_buffer.set_scissor(0, vuk::Rect2D::framebuffer()).bind_graphics_pipeline("triangle");
-			                            for (auto i = 0; i < parameters.n_iters; i++) {
-				                            command_buffer.draw(3, 1, 0, 0);
-			                            }
-		                            } });
-		               return rg;
+		           { "Pipeline rebind per draw",
+		             [](vuk::BenchRunner& runner,
+		                vuk::Allocator& allocator,
+		                vuk::Query start,
+		                vuk::Query end,
+		                vuk::Value<vuk::ImageAttachment> target,
+		                auto&& parameters) {
+		               auto pass = vuk::make_pass("pipeline rebind", [start, end, parameters](vuk::CommandBuffer& command_buffer, VUK_IA(vuk::eColorWrite) color) {
+			               vuk::TimedScope _{ command_buffer, start, end };
+			               command_buffer.set_viewport(0, vuk::Rect2D::framebuffer())
+			                   .set_scissor(0, vuk::Rect2D::framebuffer())
+			                   .set_rasterization({})
+			                   .broadcast_color_blend({});
+			               timed_draws(cpu_timings[1], parameters.n_draws, [&](unsigned i) {
+				               // rebinding forces the pipeline key to be rebuilt, alternating the constant switches between two pipelines
+				               command_buffer.bind_graphics_pipeline("triangle_variants").specialize_constants(0, i % 2).draw(3, 1, 0, 0);
+			               });
+			               return color;
+		               });
+		               return pass(std::move(target));
 		             } } }
 	};
 
 	REGISTER_BENCH(x);
-} // namespace
\ No newline at end of file
+} // namespace
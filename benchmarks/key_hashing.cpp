@@ -0,0 +1,131 @@
+#include "vuk/runtime/Cache.hpp"
+#include "vuk/runtime/vk/PipelineInstance.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <robin_hood.h>
+#include <vector>
+
+// Compares the previous field-by-field hash_combine hashes of the hot create info keys against the wyhash based ones,
+// and measures map lookups of pipeline keys with the precomputed hash.
+
+namespace {
+	// the hashes as they were before wyhash
+	size_t legacy_hash(const vuk::GraphicsPipelineInstanceCreateInfo& x) {
+		size_t h = 0;
+		auto ext_hash = x.is_inline() ? robin_hood::hash_bytes(x.inline_data, x.extended_size) : robin_hood::hash_bytes(x.extended_data, x.extended_size);
+		hash_combine(h, x.base, reinterpret_cast<uint64_t>((VkRenderPass)x.render_pass), (uint32_t)x.dynamic_state_flags, x.extended_size, ext_hash);
+		return h;
+	}
+
+	size_t legacy_hash(const vuk::CompressedImageViewCreateInfo& x) {
+		return robin_hood::hash_bytes((const char*)&x, sizeof(vuk::CompressedImageViewCreateInfo));
+	}
+
+	size_t legacy_hash(const vuk::SamplerCreateInfo& x) {
+		size_t h = 0;
+		hash_combine(h,
+		             x.flags,
+		             x.addressModeU,
+		             x.addressModeV,
+		             x.addressModeW,
+		             x.anisotropyEnable,
+		             x.borderColor,
+		             x.compareEnable,
+		             x.compareOp,
+		             x.magFilter,
+		             x.maxAnisotropy,
+		             x.maxLod,
+		             x.minFilter,
+		             x.minLod,
+		             x.mipLodBias,
+		             x.mipmapMode,
+		             x.unnormalizedCoordinates);
+		return h;
+	}
+
+	size_t legacy_hash(const vuk::DescriptorSetLayoutCreateInfo& x) {
+		size_t h = 0;
+		hash_combine(h, std::span(x.bindings));
+		return h;
+	}
+
+	template<class T, class F>
+	double ns_per_op(const std::vector<T>& keys, F&& f, unsigned iterations) {
+		size_t sink = 0;
+		auto start = std::chrono::steady_clock::now();
+		for (unsigned i = 0; i < iterations; i++) {
+			for (auto& k : keys) {
+				sink += f(k);
+			}
+		}
+		auto end = std::chrono::steady_clock::now();
+		static volatile size_t keep;
+		keep = sink;
+		return std::chrono::duration<double, std::nano>(end - start).count() / ((double)iterations * keys.size());
+	}
+
+	template<class T>
+	void compare(const char* name, const std::vector<T>& keys) {
+		constexpr unsigned iterations = 1000;
+		auto legacy = ns_per_op(keys, [](const T& k) { return legacy_hash(k); }, iterations);
+		auto current = ns_per_op(keys, [](const T& k) { return std::hash<T>{}(k); }, iterations);
+		printf("%-32s %12.2f %12.2f\n", name, legacy, current);
+	}
+
+	std::vector<vuk::GraphicsPipelineInstanceCreateInfo> make_pipeline_keys(size_t count, uint16_t extended_size) {
+		std::vector<vuk::GraphicsPipelineInstanceCreateInfo> keys(count);
+		for (size_t i = 0; i < count; i++) {
+			auto& k = keys[i];
+			k = {};
+			k.base = reinterpret_cast<vuk::PipelineBaseInfo*>((i % 64 + 1) * 256);
+			k.extended_size = extended_size;
+			for (size_t j = 0; j < extended_size; j++) {
+				k.inline_data[j] = (std::byte)(i * 31 + j);
+			}
+			k.compute_hash();
+		}
+		return keys;
+	}
+} // namespace
+
+int main() {
+	printf("%-32s %12s %12s\n", "key", "legacy (ns)", "wyhash (ns)");
+	compare("pipeline (16B extended)", make_pipeline_keys(1024, 16));
+	compare("pipeline (80B extended)", make_pipeline_keys(1024, 80));
+
+	std::vector<vuk::CompressedImageViewCreateInfo> ivcis;
+	for (unsigned i = 0; i < 1024; i++) {
+		vuk::ImageViewCreateInfo ivci{};
+		ivci.image = reinterpret_cast<VkImage>((uintptr_t)(i + 1) * 4096);
+		ivci.format = vuk::Format::eR8G8B8A8Srgb;
+		ivci.subresourceRange.baseMipLevel = i % 8;
+		ivcis.emplace_back(ivci);
+	}
+	compare("image view", ivcis);
+
+	std::vector<vuk::SamplerCreateInfo> scis(1024);
+	for (unsigned i = 0; i < 1024; i++) {
+		scis[i].maxAnisotropy = (float)(i % 16);
+		scis[i].maxLod = (float)i;
+	}
+	compare("sampler", scis);
+
+	std::vector<vuk::DescriptorSetLayoutCreateInfo> dslcis(256);
+	for (unsigned i = 0; i < 256; i++) {
+		for (unsigned b = 0; b < 1 + i % 8; b++) {
+			dslcis[i].bindings.push_back(VkDescriptorSetLayoutBinding{ b, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_ALL, nullptr });
+		}
+	}
+	compare("descriptor set layout", dslcis);
+
+	// lookups: the stored hash means a lookup costs a hash load and (on a hit) one compare
+	auto keys = make_pipeline_keys(16384, 64);
+	robin_hood::unordered_flat_map<vuk::GraphicsPipelineInstanceCreateInfo, uint32_t> map;
+	for (uint32_t i = 0; i < keys.size(); i++) {
+		map.emplace(keys[i], i);
+	}
+	auto lookup = ns_per_op(keys, [&](const vuk::GraphicsPipelineInstanceCreateInfo& k) { return (size_t)map.find(k)->second; }, 100);
+	printf("%-32s %12s %12.2f\n", "pipeline map lookup", "", lookup);
+	return 0;
+}
@@ -0,0 +1,70 @@
+#include "vuk/runtime/vk/BufferAllocator.hpp"
+#include "vuk/runtime/vk/DeviceNestedResource.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+// Measures BufferLinearAllocator::allocate_buffer throughput with many threads making small allocations, like recording threads allocating uniforms per
+// draw. The blocks are host memory handed out by a fake upstream, no Vulkan device is needed.
+
+namespace {
+	struct HostBuffers : vuk::DeviceNestedResource {
+		// only buffer allocations are made by the linear allocator, everything else would forward to itself
+		HostBuffers() : DeviceNestedResource(*this) {}
+
+		vuk::Result<void, vuk::AllocateException>
+		allocate_buffers(std::span<vuk::Buffer> dst, std::span<const vuk::BufferCreateInfo> cis, vuk::SourceLocationAtFrame loc) override {
+			for (size_t i = 0; i < dst.size(); i++) {
+				auto memory = new std::byte[cis[i].size];
+				dst[i] = vuk::Buffer{ .buffer = reinterpret_cast<VkBuffer>(memory), .size = cis[i].size, .mapped_ptr = memory };
+			}
+			return { vuk::expected_value };
+		}
+
+		void deallocate_buffers(std::span<const vuk::Buffer> src) override {
+			for (auto& b : src) {
+				delete[] b.mapped_ptr;
+			}
+		}
+	};
+
+	double run(HostBuffers& upstream, unsigned thread_count, unsigned allocations_per_thread) {
+		vuk::BufferLinearAllocator allocator(upstream, vuk::MemoryUsage::eCPUtoGPU, vuk::BufferUsageFlagBits::eUniformBuffer);
+		std::atomic<bool> go = false;
+		std::atomic<size_t> sink = 0;
+		std::vector<std::thread> threads;
+		for (unsigned t = 0; t < thread_count; t++) {
+			threads.emplace_back([&] {
+				while (!go.load(std::memory_order_acquire)) {
+				}
+				size_t acc = 0;
+				for (unsigned i = 0; i < allocations_per_thread; i++) {
+					auto res = allocator.allocate_buffer(64 + (i % 4) * 64, 256, VUK_HERE_AND_NOW());
+					acc += res->offset;
+				}
+				sink += acc;
+			});
+		}
+		auto start = std::chrono::steady_clock::now();
+		go.store(true, std::memory_order_release);
+		for (auto& t : threads) {
+			t.join();
+		}
+		auto end = std::chrono::steady_clock::now();
+		auto seconds = std::chrono::duration<double>(end - start).count();
+		return (double)thread_count * allocations_per_thread / seconds / 1e6;
+	}
+} // namespace
+
+int main() {
+	constexpr unsigned allocations_per_thread = 100'000;
+	HostBuffers upstream;
+	printf("%8s %16s\n", "threads", "Mallocs/s");
+	for (unsigned thread_count : { 1u, 2u, 4u, 8u, 16u, 32u }) {
+		printf("%8u %16.2f\n", thread_count, run(upstream, thread_count, allocations_per_thread));
+	}
+	return 0;
+}
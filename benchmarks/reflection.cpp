@@ -0,0 +1,103 @@
+#include "vuk/runtime/vk/Program.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <shaderc/shaderc.hpp>
+#include <sstream>
+
+// Compares the native SPIR-V reflection against spirv-cross on the example shaders.
+// Shaders are compiled up front, only reflection is timed.
+
+namespace {
+	struct Module {
+		std::string name;
+		std::vector<uint32_t> spirv;
+	};
+
+	std::optional<shaderc_shader_kind> kind_from_extension(const std::filesystem::path& path) {
+		auto ext = path.extension().string();
+		if (ext == ".vert")
+			return shaderc_vertex_shader;
+		if (ext == ".frag")
+			return shaderc_fragment_shader;
+		if (ext == ".comp")
+			return shaderc_compute_shader;
+		if (ext == ".tesc")
+			return shaderc_tess_control_shader;
+		if (ext == ".tese")
+			return shaderc_tess_evaluation_shader;
+		if (ext == ".mesh")
+			return shaderc_mesh_shader;
+		if (ext == ".task")
+			return shaderc_task_shader;
+		if (ext == ".rgen")
+			return shaderc_raygen_shader;
+		if (ext == ".rchit")
+			return shaderc_closesthit_shader;
+		if (ext == ".rmiss")
+			return shaderc_miss_shader;
+		return {};
+	}
+
+	std::vector<Module> compile_examples() {
+		std::vector<Module> modules;
+		shaderc::Compiler compiler;
+		shaderc::CompileOptions options;
+		options.SetTargetEnvironment(shaderc_target_env_vulkan, shaderc_env_version_vulkan_1_3);
+		options.SetTargetSpirv(shaderc_spirv_version_1_6);
+
+		auto root = std::filesystem::path(VUK_EX_PATH_TO_ROOT) / "examples";
+		for (auto& entry : std::filesystem::directory_iterator(root)) {
+			auto kind = kind_from_extension(entry.path());
+			if (!kind) {
+				continue;
+			}
+			std::ifstream file(entry.path());
+			std::stringstream buffer;
+			buffer << file.rdbuf();
+			auto source = buffer.str();
+			auto name = entry.path().filename().string();
+			auto result = compiler.CompileGlslToSpv(source, *kind, name.c_str(), options);
+			if (result.GetCompilationStatus() != shaderc_compilation_status_success) {
+				fprintf(stderr, "skipping %s: %s\n", name.c_str(), result.GetErrorMessage().c_str());
+				continue;
+			}
+			modules.push_back(Module{ name, std::vector<uint32_t>(result.cbegin(), result.cend()) });
+		}
+		return modules;
+	}
+
+	template<class F>
+	double time_us(F&& f, unsigned iterations) {
+		auto start = std::chrono::steady_clock::now();
+		for (unsigned i = 0; i < iterations; i++) {
+			f();
+		}
+		auto end = std::chrono::steady_clock::now();
+		return std::chrono::duration<double, std::micro>(end - start).count() / iterations;
+	}
+} // namespace
+
+int main() {
+	constexpr unsigned iterations = 200;
+	auto modules = compile_examples();
+
+	double total_native = 0, total_spirv_cross = 0;
+	printf("%-40s %12s %12s %8s\n", "shader", "native (us)", "spvc (us)", "speedup");
+	for (auto& m : modules) {
+		auto native = vuk::Program::introspect_native(m.spirv.data(), m.spirv.size());
+		if (!native) {
+			printf("%-40s %12s\n", m.name.c_str(), "unsupported");
+			continue;
+		}
+		auto t_native = time_us([&] { vuk::Program::introspect_native(m.spirv.data(), m.spirv.size()); }, iterations);
+		auto t_spirv_cross = time_us([&] { vuk::Program::introspect_spirv_cross(m.spirv.data(), m.spirv.size()); }, iterations);
+		total_native += t_native;
+		total_spirv_cross += t_spirv_cross;
+		printf("%-40s %12.2f %12.2f %7.1fx\n", m.name.c_str(), t_native, t_spirv_cross, t_spirv_cross / t_native);
+	}
+	printf("%-40s %12.2f %12.2f %7.1fx\n", "total", total_native, total_spirv_cross, total_native > 0 ? total_spirv_cross / total_native : 0.0);
+	return 0;
+}
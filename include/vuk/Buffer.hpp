@@ -1,6 +1,7 @@
 #pragma once
 
 #include "vuk/Types.hpp"
+#include "vuk/runtime/vk/VkTypes.hpp" // TODO: leaking vk
 #include <assert.h>
 
 namespace vuk {
@@ -55,6 +56,9 @@ namespace vuk {
 		VkDeviceSize size;
 		/// @brief Alignment of the allocated Buffer in bytes
 		VkDeviceSize alignment = 1;
+		/// @brief Usage of the Buffer, if empty the Buffer can be used in every way the device supports (see DeviceResource::get_all_buffer_usage_flags)
+		/// Only honored by resources that create a VkBuffer for each allocation
+		BufferUsageFlags usage = {};
 	};
 } // namespace vuk
 
@@ -43,6 +43,22 @@ namespace vuk {
 		}
 	};
 
+	struct FileIOException : Exception {
+		using Exception::Exception;
+
+		void throw_this() override {
+			throw *this;
+		}
+	};
+
+	struct FormatConversionException : Exception {
+		using Exception::Exception;
+
+		void throw_this() override {
+			throw *this;
+		}
+	};
+
 	struct VkException : Exception {
 		VkResult error_code;
 
@@ -1,7 +1,11 @@
 #pragma once
 
 #include <cstdint>
+#include <cstring>
 #include <functional>
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#endif
 
 // https://gist.github.com/filsinger/1255697/21762ea83a2d3c17561c8e6a29f44249a4626f9e
 
@@ -29,6 +33,92 @@ namespace hash {
 	};
 
 	using fnv1a = fnv1a_tpl<uint32_t>;
+
+	// wyhash final version 4 - https://github.com/wangyi-fudan/wyhash (public domain)
+	struct wyhash {
+		static inline void mum(uint64_t* a, uint64_t* b) noexcept {
+#if defined(__SIZEOF_INT128__)
+			__uint128_t r = *a;
+			r *= *b;
+			*a = (uint64_t)r;
+			*b = (uint64_t)(r >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+			*a = _umul128(*a, *b, b);
+#else
+			uint64_t ha = *a >> 32, hb = *b >> 32, la = (uint32_t)*a, lb = (uint32_t)*b;
+			uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb, t = rl + (rm0 << 32), c = t < rl;
+			uint64_t lo = t + (rm1 << 32);
+			c += lo < t;
+			*a = lo;
+			*b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+		}
+
+		static inline uint64_t mix(uint64_t a, uint64_t b) noexcept {
+			mum(&a, &b);
+			return a ^ b;
+		}
+
+		static inline uint64_t r8(const uint8_t* p) noexcept {
+			uint64_t v;
+			memcpy(&v, p, 8);
+			return v;
+		}
+
+		static inline uint64_t r4(const uint8_t* p) noexcept {
+			uint32_t v;
+			memcpy(&v, p, 4);
+			return v;
+		}
+
+		static inline uint64_t r3(const uint8_t* p, size_t k) noexcept {
+			return (((uint64_t)p[0]) << 16) | (((uint64_t)p[k >> 1]) << 8) | p[k - 1];
+		}
+
+		static constexpr uint64_t secret[4] = { 0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull, 0x4b33a62ed433d4a3ull, 0x4d5a2da51de1aa47ull };
+
+		/// @brief Hash a byte range into 64 bits
+		static inline uint64_t hash(const void* data, size_t size, uint64_t seed = 0) noexcept {
+			auto p = (const uint8_t*)data;
+			seed ^= mix(seed ^ secret[0], secret[1]);
+			uint64_t a, b;
+			if (size <= 16) {
+				if (size >= 4) {
+					a = (r4(p) << 32) | r4(p + ((size >> 3) << 2));
+					b = (r4(p + size - 4) << 32) | r4(p + size - 4 - ((size >> 3) << 2));
+				} else if (size > 0) {
+					a = r3(p, size);
+					b = 0;
+				} else {
+					a = b = 0;
+				}
+			} else {
+				size_t i = size;
+				if (i >= 48) {
+					uint64_t see1 = seed, see2 = seed;
+					do {
+						seed = mix(r8(p) ^ secret[1], r8(p + 8) ^ seed);
+						see1 = mix(r8(p + 16) ^ secret[2], r8(p + 24) ^ see1);
+						see2 = mix(r8(p + 32) ^ secret[3], r8(p + 40) ^ see2);
+						p += 48;
+						i -= 48;
+					} while (i >= 48);
+					seed ^= see1 ^ see2;
+				}
+				while (i > 16) {
+					seed = mix(r8(p) ^ secret[1], r8(p + 8) ^ seed);
+					i -= 16;
+					p += 16;
+				}
+				a = r8(p + i - 16);
+				b = r8(p + i - 8);
+			}
+			a ^= secret[1];
+			b ^= seed;
+			mum(&a, &b);
+			return mix(a ^ secret[0] ^ size, b ^ secret[1]);
+		}
+	};
 } // namespace hash
 
 inline constexpr uint32_t operator""_fnv1a(const char* aString, const size_t aStrlen) {
@@ -516,6 +516,14 @@ namespace vuk {
 	Format unorm_to_srgb(Format) noexcept;
 	// get the srgb equivalent of the unorm format (returns Format::Undefined if the format doesn't exist)
 	Format srgb_to_unorm(Format) noexcept;
+	// true if convert_texels can convert from the source format to the destination format
+	bool can_convert_format(Format src_format, Format dst_format) noexcept;
+	// convert tightly packed texels between uncompressed formats (reorder, add or drop channels, float to half, sRGB to linear), returns false if the
+	// conversion is not supported
+	// the conversion runs on the calling thread, see convert_texels_parallel for large conversions
+	bool convert_texels(Format src_format, const void* src, Format dst_format, void* dst, size_t texel_count) noexcept;
+	// convert_texels, splitting conversions of more than 256K texels into chunks converted on up to max_threads threads (the calling thread included)
+	bool convert_texels_parallel(Format src_format, const void* src, Format dst_format, void* dst, size_t texel_count, uint32_t max_threads = 8) noexcept;
 
 	enum class MemoryUsage {
 		eGPUonly = 1 /*VMA_MEMORY_USAGE_GPU_ONLY*/,
@@ -830,6 +838,7 @@ namespace vuk {
 		ePerLayout = 1 << 1,      // one DS pool per layout
 		eCommon = 1 << 2,         // common pool per layout
 		ePushDescriptor = 1 << 3, // use push descriptors
+		eDescriptorBuffer = 1 << 4, // write descriptors into a per-command buffer descriptor buffer (VK_EXT_descriptor_buffer)
 	};
 
 	using DescriptorSetStrategyFlags = Flags<DescriptorSetStrategyFlagBits>;
@@ -845,6 +854,11 @@ namespace vuk {
 		return DescriptorSetStrategyFlags(bit0) ^ bit1;
 	}
 
+	enum class GraphicsPipelineStrategy {
+		eMonolithic,      // every pipeline instance is compiled as a single monolithic pipeline
+		eLibraryFastLink, // pipeline instances are fast-linked from cached VK_EXT_graphics_pipeline_library parts
+	};
+
 	struct Node;
 	struct Type;
 	struct ChainLink;
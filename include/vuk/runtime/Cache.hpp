@@ -202,32 +202,22 @@ namespace std {
 	template<>
 	struct hash<vuk::CompressedImageViewCreateInfo> {
 		size_t operator()(vuk::CompressedImageViewCreateInfo const& x) const noexcept {
-			return robin_hood::hash_bytes((const char*)&x, sizeof(vuk::CompressedImageViewCreateInfo));
+			return ::hash::wyhash::hash(&x, sizeof(vuk::CompressedImageViewCreateInfo));
 		}
 	};
 
 	template<>
 	struct hash<vuk::SamplerCreateInfo> {
 		size_t operator()(vuk::SamplerCreateInfo const& x) const noexcept {
-			size_t h = 0;
-			hash_combine(h,
-			             x.flags,
-			             x.addressModeU,
-			             x.addressModeV,
-			             x.addressModeW,
-			             x.anisotropyEnable,
-			             x.borderColor,
-			             x.compareEnable,
-			             x.compareOp,
-			             x.magFilter,
-			             x.maxAnisotropy,
-			             x.maxLod,
-			             x.minFilter,
-			             x.minLod,
-			             x.mipLodBias,
-			             x.mipmapMode,
-			             x.unnormalizedCoordinates);
-			return h;
+			// operator== compares the floats by value, so -0.f and 0.f must hash the same
+			auto normalized = x;
+			for (float* f : { &normalized.mipLodBias, &normalized.maxAnisotropy, &normalized.minLod, &normalized.maxLod }) {
+				*f = *f == 0.f ? 0.f : *f;
+			}
+			// everything after pNext is 4 byte fields without padding
+			constexpr size_t offset = offsetof(vuk::SamplerCreateInfo, flags);
+			return ::hash::wyhash::hash(
+			    reinterpret_cast<const std::byte*>(&normalized) + offset, sizeof(vuk::SamplerCreateInfo) - offset, reinterpret_cast<uint64_t>(x.pNext));
 		}
 	};
 }; // namespace std
@@ -250,19 +240,31 @@ namespace vuk {
 
 		struct LRUEntry {
 			T* ptr;
-			size_t last_use_frame;
-			std::atomic<uint8_t> load_cnt;
-
-			LRUEntry(T* ptr, size_t last_use_frame) : ptr(ptr), last_use_frame(last_use_frame), load_cnt(0) {}
-			LRUEntry(const LRUEntry& other) : ptr(other.ptr), last_use_frame(other.last_use_frame), load_cnt(other.load_cnt.load()) {}
+			std::atomic<uint64_t> last_use_frame;
+			std::atomic<uint8_t> load_cnt; // 0 while the object is being created
+			uint64_t wheel_frame;          // frame of the eviction bucket this entry is filed under
+
+			LRUEntry(T* ptr, uint64_t last_use_frame) : ptr(ptr), last_use_frame(last_use_frame), load_cnt(0), wheel_frame(last_use_frame) {}
+			LRUEntry(const LRUEntry& other) :
+			    ptr(other.ptr),
+			    last_use_frame(other.last_use_frame.load()),
+			    load_cnt(other.load_cnt.load()),
+			    wheel_frame(other.wheel_frame) {}
 		};
 
 		std::optional<T> remove(const create_info_t<T>& ci);
 
 		void remove_ptr(const T* ptr);
 
+		/// @brief Acquire an object that is never collected, creating it if it does not exist
 		T& acquire(const create_info_t<T>& ci);
+		/// @brief Acquire an object, creating it if it does not exist, and mark it used in `current_frame`
+		/// Lookups are sharded and hot keys are served from a per-thread front cache without locking, skipping the map lookup.
+		/// Creation happens outside of the locks - concurrent acquires of the same key wait for the first one to finish creating.
+		/// If creation throws, the exception is propagated and the waiting acquires try creating the object themselves.
 		T& acquire(const create_info_t<T>& ci, uint64_t current_frame);
+		/// @brief Destroy the objects that have not been used for more than `threshold` frames
+		/// Only the entries filed under the expiring frames are visited, and objects are destroyed outside of the locks.
 		void collect(uint64_t current_frame, size_t threshold);
 		void clear();
 
@@ -224,6 +224,30 @@ namespace vuk {
 	static_assert(sizeof(ImageCopy) == sizeof(VkImageCopy), "struct and wrapper have different size!");
 	static_assert(std::is_standard_layout_v<ImageCopy>, "struct wrapper is not a standard layout!");
 
+	struct BufferCopy {
+		VkDeviceSize srcOffset = {};
+		VkDeviceSize dstOffset = {};
+		VkDeviceSize size = {};
+
+		operator VkBufferCopy const&() const noexcept {
+			return *reinterpret_cast<const VkBufferCopy*>(this);
+		}
+
+		operator VkBufferCopy&() noexcept {
+			return *reinterpret_cast<VkBufferCopy*>(this);
+		}
+
+		bool operator==(BufferCopy const& rhs) const noexcept {
+			return (srcOffset == rhs.srcOffset) && (dstOffset == rhs.dstOffset) && (size == rhs.size);
+		}
+
+		bool operator!=(BufferCopy const& rhs) const noexcept {
+			return !operator==(rhs);
+		}
+	};
+	static_assert(sizeof(BufferCopy) == sizeof(VkBufferCopy), "struct and wrapper have different size!");
+	static_assert(std::is_standard_layout_v<BufferCopy>, "struct wrapper is not a standard layout!");
+
 	struct BufferImageCopy {
 		VkDeviceSize bufferOffset = {};
 		uint32_t bufferRowLength = {};
@@ -283,6 +307,10 @@ namespace vuk {
 		// Pipeline state
 		// Enabled dynamic state
 		DynamicStateFlags dynamic_state_flags = {};
+		// Dynamic state that changed since it was last emitted
+		DynamicStateFlags dirty_dynamic_state = extended_dynamic_state_flags;
+		// Shader objects are bound instead of a graphics pipeline - all state is dynamic
+		bool shader_objects_bound = false;
 
 		// Current & next graphics & compute pipelines
 		PipelineBaseInfo* next_pipeline = nullptr;
@@ -301,10 +329,12 @@ namespace vuk {
 
 		// Specialization constant support
 		struct SpecEntry {
+			uint32_t constant_id;
 			bool is_double;
 			std::byte data[sizeof(double)];
 		};
-		std::unordered_map<uint32_t, SpecEntry> spec_map_entries; // constantID -> SpecEntry
+		fixed_vector<SpecEntry, VUK_MAX_SPECIALIZATIONCONSTANT_RANGES> spec_map_entries;
+		SpecEntry* find_spec_entry(uint32_t constant_id) noexcept;
 
 		// Individual pipeline states
 		std::optional<PipelineRasterizationStateCreateInfo> rasterization_state;
@@ -323,6 +353,9 @@ namespace vuk {
 		unsigned char push_constant_buffer[VUK_MAX_PUSHCONSTANT_SIZE];
 		fixed_vector<VkPushConstantRange, VUK_MAX_PUSHCONSTANT_RANGES> pcrs;
 
+		// Scratch space for the extended data of pipeline keys that don't fit inline, the cache copies it on a miss
+		std::byte pipeline_key_scratch[GraphicsPipelineInstanceCreateInfo::max_extended_size];
+
 		// Descriptor sets
 		DescriptorSetStrategyFlags ds_strategy_flags = {};
 		Bitset<VUK_MAX_SETS> sets_used = {};
@@ -332,6 +365,37 @@ namespace vuk {
 		Bitset<VUK_MAX_SETS> persistent_sets_to_bind = {};
 		std::pair<VkDescriptorSet, VkDescriptorSetLayout> persistent_sets[VUK_MAX_SETS] = {};
 
+		// Device addresses of the bound buffers, for writing them into descriptor buffers
+		uint64_t buffer_addresses[VUK_MAX_SETS][VUK_MAX_BINDINGS] = {};
+		// Sets with descriptor buffer layouts are written into the descriptor buffer memory of the frame
+		// Binding another descriptor buffer invalidates the set offsets of every pipe type, indexed by PipeType
+		bool descriptor_buffer_offsets_stale[3] = {};
+
+		// State last emitted into the Vulkan command buffer - calls that would not change it are skipped
+		struct EmittedState {
+			// indexed by PipeType
+			VkPipeline pipelines[3] = {};
+			VkPipelineLayout set_layouts[3] = {};
+			VkDescriptorSet sets[3][VUK_MAX_SETS] = {};
+
+			VkBuffer vertex_buffers[VUK_MAX_ATTRIBUTES] = {};
+			VkDeviceSize vertex_buffer_offsets[VUK_MAX_ATTRIBUTES] = {};
+			VkBuffer index_buffer = VK_NULL_HANDLE;
+			VkDeviceSize index_buffer_offset = 0;
+			VkIndexType index_type = VK_INDEX_TYPE_MAX_ENUM;
+
+			Bitset<VUK_MAX_VIEWPORTS> viewports_valid = {};
+			VkViewport viewports[VUK_MAX_VIEWPORTS];
+			Bitset<VUK_MAX_SCISSORS> scissors_valid = {};
+			VkRect2D scissors[VUK_MAX_SCISSORS];
+
+			VkPipelineLayout push_constant_layout = VK_NULL_HANDLE;
+			// stages that have the emitted value of each push constant word
+			VkShaderStageFlags push_constant_stages[VUK_MAX_PUSHCONSTANT_SIZE / 4] = {};
+			unsigned char push_constants[VUK_MAX_PUSHCONSTANT_SIZE];
+		} emitted;
+		uint64_t skipped_redundant_calls = 0;
+
 		CommandBuffer(Stream& stream, Runtime& ctx, Allocator& allocator, VkCommandBuffer cb, std::optional<RenderPassInfo> ongoing = {});
 
 	public:
@@ -346,6 +410,11 @@ namespace vuk {
 			return command_buffer;
 		}
 
+		/// @brief Number of Vulkan state setting calls that were skipped because the state was already set in the command buffer
+		uint64_t get_skipped_redundant_calls() const {
+			return skipped_redundant_calls;
+		}
+
 		/// @brief Retrieve information about the current renderpass
 		const RenderPassInfo& get_ongoing_render_pass() const;
 
@@ -371,6 +440,9 @@ namespace vuk {
 
 		/// @brief Set mask of dynamic state in CommandBuffer
 		/// @param dynamic_state_flags Mask of states (flag set = dynamic, flag clear = static)
+		///
+		/// The default mask is taken from the runtime when entering a new Pass.
+		/// State made dynamic is excluded from the pipeline instance key, so changing it does not create new pipelines.
 		CommandBuffer& set_dynamic_state(DynamicStateFlags dynamic_state_flags);
 
 		/// @brief Set the viewport transformation for the specified viewport index
@@ -724,6 +796,11 @@ namespace vuk {
 		/// @param dst the Name of the destination Resource
 		/// @param copy_params parameters of the copy
 		CommandBuffer& copy_buffer_to_image(const Buffer& src, const ImageAttachment& dst, BufferImageCopy copy_params);
+		/// @brief Copy a buffer resource into an image resource, with multiple regions in a single command
+		/// @param src the source Buffer
+		/// @param dst the destination ImageAttachment
+		/// @param regions parameters of the copies
+		CommandBuffer& copy_buffer_to_image(const Buffer& src, const ImageAttachment& dst, std::span<const BufferImageCopy> regions);
 		/// @brief Copy an image resource into a buffer resource
 		/// @param src the Name of the source Resource
 		/// @param dst the Name of the destination Resource
@@ -738,6 +815,11 @@ namespace vuk {
 		/// @param src the source Buffer
 		/// @param dst the destination Buffer
 		CommandBuffer& copy_buffer(const Buffer& src, const Buffer& dst);
+		/// @brief Copy regions between two Buffers in a single command
+		/// @param src the source Buffer
+		/// @param dst the destination Buffer
+		/// @param regions the regions to copy, with offsets relative to src and dst
+		CommandBuffer& copy_buffer(const Buffer& src, const Buffer& dst, std::span<const BufferCopy> regions);
 		/// @brief Fill a buffer with a fixed value
 		/// @param dst the destination Buffer
 		/// @param data the 4 byte value to fill with
@@ -780,7 +862,7 @@ namespace vuk {
 		[[nodiscard]] Result<void> result();
 
 		// explicit command buffer access
-
+		// commands recorded through the raw VkCommandBuffer are not tracked, so these reset the redundant state filter
 		/// @brief Bind all pending compute state and return a raw VkCommandBuffer for direct access
 		[[nodiscard]] VkCommandBuffer bind_compute_state();
 		/// @brief Bind all pending graphics state and return a raw VkCommandBuffer for direct access
@@ -795,6 +877,24 @@ namespace vuk {
 		[[nodiscard]] bool _bind_compute_pipeline_state();
 		[[nodiscard]] bool _bind_graphics_pipeline_state();
 		[[nodiscard]] bool _bind_ray_tracing_pipeline_state();
+		void _set_extended_dynamic_state();
+		void _bind_graphics_shader_objects();
+
+		// state emission through the redundant state filter
+		static VkPipelineBindPoint _bind_point(PipeType pipe_type);
+		void _bind_pipeline(PipeType pipe_type, VkPipeline pipeline);
+		void _bind_descriptor_set(PipeType pipe_type, VkPipelineLayout layout, uint32_t set_index, VkDescriptorSet set);
+		void _push_descriptor_set(PipeType pipe_type, VkPipelineLayout layout, uint32_t set_index, uint32_t write_count, const VkWriteDescriptorSet* writes);
+		void _push_descriptor_set(PipeType pipe_type, VkPipelineLayout layout, uint32_t set_index, VkDescriptorUpdateTemplate update_template, const void* data);
+		void _set_descriptor_buffer_offset(PipeType pipe_type, VkPipelineLayout layout, uint32_t set_index, VkDeviceSize offset);
+
+		// descriptor buffers
+		[[nodiscard]] bool _allocate_descriptor_buffer_memory(VkDeviceSize size, Buffer& dst);
+		void _write_descriptor_buffer_set(const DescriptorSetLayoutAllocInfo& layout_info, const SetBinding& sb, const uint64_t* addresses, std::byte* dst);
+		void _push_constants(VkPipelineLayout layout, const VkPushConstantRange& pcr);
+		void _bind_vertex_buffer(uint32_t binding, VkBuffer buffer, VkDeviceSize offset);
+		void _set_viewport(uint32_t index);
+		void _set_scissor(uint32_t index);
 
 		CommandBuffer& specialize_constants(uint32_t constant_id, void* data, size_t size);
 	};
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "vuk/Config.hpp"
+#include "vuk/Exception.hpp"
+#include "vuk/Result.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace vuk {
+	/// @brief A range of bytes in a file
+	struct FileRange {
+		uint64_t offset = 0;
+		uint64_t size = 0;
+	};
+
+	/// @brief Handle to a read issued to a FileReader
+	class FileRead {
+	public:
+		FileRead() = default;
+
+		/// @brief Check if the read has finished, never waits
+		bool ready() const;
+		/// @brief Wait for the read to finish
+		/// @return Error if the file could not be opened or read
+		Result<void> wait() const;
+
+		explicit operator bool() const noexcept {
+			return state != nullptr;
+		}
+
+	private:
+		std::shared_ptr<struct FileReadState> state;
+
+		friend class FileReader;
+	};
+
+	/// @brief Reads files on a background thread, straight into the destination memory (usually mapped staging memory)
+	///
+	/// Reads are performed in the order they were issued, with positional reads (pread on POSIX, overlapped ReadFile on Windows), so the data is copied
+	/// only once, from the OS into the destination.
+	class FileReader {
+	public:
+		FileReader();
+		~FileReader();
+
+		FileReader(const FileReader&) = delete;
+		FileReader& operator=(const FileReader&) = delete;
+
+		/// @brief Queue a read of ranges of a file, packed one after the other into dst
+		/// @param path path of the file
+		/// @param ranges ranges of the file to read
+		/// @param dst destination memory, must be at least as large as the ranges combined and stay valid until the read has finished
+		FileRead read(std::string path, std::span<const FileRange> ranges, std::byte* dst);
+
+	private:
+		struct FileReaderImpl* impl;
+	};
+} // namespace vuk
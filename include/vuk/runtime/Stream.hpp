@@ -10,6 +10,8 @@ namespace vuk {
 		std::vector<Node*> current_submit;
 		std::vector<Stream*> dependencies;
 		std::vector<Signal*> dependent_signals;
+		// base address of the descriptor buffer bound to the command buffer being recorded, 0 if none
+		uint64_t bound_descriptor_buffer = 0;
 
 		virtual void add_dependency(Stream* dep) = 0;
 		virtual void sync_deps() = 0;
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "vuk/Buffer.hpp"
 #include "vuk/Config.hpp"
 #include "vuk/Result.hpp"
 #include "vuk/runtime/vk/Address.hpp"
@@ -66,6 +67,11 @@ namespace vuk {
 		// gpu only
 		virtual Result<void, AllocateException> allocate_images(std::span<Image> dst, std::span<const ImageCreateInfo> cis, SourceLocationAtFrame loc) = 0;
 		virtual void deallocate_images(std::span<const Image> dst) = 0;
+		/// @brief Allocate images for attachments created by the render graph, which are only accessed through their ImageAttachment
+		/// Resources may return images with a larger extent than requested, to reuse them for similarly sized attachments
+		virtual Result<void, AllocateException> allocate_attachment_images(std::span<Image> dst, std::span<const ImageCreateInfo> cis, SourceLocationAtFrame loc) {
+			return allocate_images(dst, cis, loc);
+		}
 		virtual void set_image_allocation_name(Image& dst, Name name) = 0;
 
 		virtual Result<void, AllocateException>
@@ -82,6 +88,19 @@ namespace vuk {
 		virtual Result<void, AllocateException>
 		allocate_descriptor_sets(std::span<DescriptorSet> dst, std::span<const struct DescriptorSetLayoutAllocInfo> cis, SourceLocationAtFrame loc) = 0;
 		virtual void deallocate_descriptor_sets(std::span<const DescriptorSet> src) = 0;
+		/// @brief Find a descriptor set allocated from this resource that was written with the same bindings and is still alive
+		/// @return true if a set was found and placed into dst
+		virtual bool find_descriptor_set(DescriptorSet& dst, const SetBinding& value) {
+			return false;
+		}
+		/// @brief Record a descriptor set allocated from this resource and written with the given bindings, to be found by find_descriptor_set
+		virtual void record_descriptor_set(const DescriptorSet& ds, const SetBinding& value) {}
+		/// @brief Allocate host-visible memory to write descriptor buffer sets into, valid until the frame of this resource is recycled
+		/// The memory comes from buffers created only with the descriptor buffer usages, which are shared by all the allocations of the frame
+		/// @return Buffer with the device address of the allocation, or an error if this resource does not have frames
+		virtual Result<Buffer, AllocateException> allocate_descriptor_buffer_memory(size_t size, size_t alignment, SourceLocationAtFrame loc) {
+			return { expected_error, AllocateException{ VK_ERROR_FEATURE_NOT_PRESENT } };
+		}
 
 		virtual Result<void, AllocateException>
 		allocate_descriptor_pools(std::span<VkDescriptorPool> dst, std::span<const VkDescriptorPoolCreateInfo> cis, SourceLocationAtFrame loc) = 0;
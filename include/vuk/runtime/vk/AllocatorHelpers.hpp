@@ -89,6 +89,45 @@ namespace vuk {
 		return { expected_value, std::move(img) };
 	}
 
+	namespace detail {
+		inline Result<Unique<Image>, AllocateException>
+		allocate_image(Allocator& allocator, const ImageAttachment& attachment, bool for_attachment, SourceLocationAtFrame loc) {
+			Unique<Image> img(allocator);
+			ImageCreateInfo ici;
+			ici.format = vuk::Format(attachment.format);
+			ici.imageType = attachment.image_type;
+			ici.flags = attachment.image_flags;
+			ici.arrayLayers = attachment.layer_count;
+			ici.samples = attachment.sample_count.count;
+			ici.tiling = attachment.tiling;
+			ici.mipLevels = attachment.level_count;
+			ici.usage = attachment.usage;
+			ici.extent = attachment.extent;
+
+			VkImageFormatListCreateInfo listci = { VK_STRUCTURE_TYPE_IMAGE_FORMAT_LIST_CREATE_INFO };
+			VkFormat formats[2];
+			if (attachment.allow_srgb_unorm_mutable) {
+				auto unorm_fmt = srgb_to_unorm(attachment.format);
+				auto srgb_fmt = unorm_to_srgb(attachment.format);
+				formats[0] = (VkFormat)attachment.format;
+				formats[1] = unorm_fmt == vuk::Format::eUndefined ? (VkFormat)srgb_fmt : (VkFormat)unorm_fmt;
+				listci.pViewFormats = formats;
+				listci.viewFormatCount = formats[1] == VK_FORMAT_UNDEFINED ? 1 : 2;
+				if (listci.viewFormatCount > 1) {
+					ici.flags |= vuk::ImageCreateFlagBits::eMutableFormat;
+					ici.pNext = &listci;
+				}
+			}
+
+			auto res = for_attachment ? allocator.get_device_resource().allocate_attachment_images(std::span{ &img.get(), 1 }, std::span{ &ici, 1 }, loc)
+			                          : allocator.allocate_images(std::span{ &img.get(), 1 }, std::span{ &ici, 1 }, loc);
+			if (!res) {
+				return { expected_error, res.error() };
+			}
+			return { expected_value, std::move(img) };
+		}
+	} // namespace detail
+
 	/// @brief Allocate a single image from an Allocator
 	/// @param allocator Allocator to use
 	/// @param attachment ImageAttachment to make the Image from
@@ -96,37 +135,18 @@ namespace vuk {
 	/// @return Image in a RAII wrapper (Unique<T>) or AllocateException on error
 	inline Result<Unique<Image>, AllocateException>
 	allocate_image(Allocator& allocator, const ImageAttachment& attachment, SourceLocationAtFrame loc = VUK_HERE_AND_NOW()) {
-		Unique<Image> img(allocator);
-		ImageCreateInfo ici;
-		ici.format = vuk::Format(attachment.format);
-		ici.imageType = attachment.image_type;
-		ici.flags = attachment.image_flags;
-		ici.arrayLayers = attachment.layer_count;
-		ici.samples = attachment.sample_count.count;
-		ici.tiling = attachment.tiling;
-		ici.mipLevels = attachment.level_count;
-		ici.usage = attachment.usage;
-		ici.extent = attachment.extent;
-
-		VkImageFormatListCreateInfo listci = { VK_STRUCTURE_TYPE_IMAGE_FORMAT_LIST_CREATE_INFO };
-		VkFormat formats[2];
-		if (attachment.allow_srgb_unorm_mutable) {
-			auto unorm_fmt = srgb_to_unorm(attachment.format);
-			auto srgb_fmt = unorm_to_srgb(attachment.format);
-			formats[0] = (VkFormat)attachment.format;
-			formats[1] = unorm_fmt == vuk::Format::eUndefined ? (VkFormat)srgb_fmt : (VkFormat)unorm_fmt;
-			listci.pViewFormats = formats;
-			listci.viewFormatCount = formats[1] == VK_FORMAT_UNDEFINED ? 1 : 2;
-			if (listci.viewFormatCount > 1) {
-				ici.flags |= vuk::ImageCreateFlagBits::eMutableFormat;
-				ici.pNext = &listci;
-			}
-		}
+		return detail::allocate_image(allocator, attachment, false, loc);
+	}
 
-		if (auto res = allocator.allocate_images(std::span{ &img.get(), 1 }, std::span{ &ici, 1 }, loc); !res) {
-			return { expected_error, res.error() };
-		}
-		return { expected_value, std::move(img) };
+	/// @brief Allocate a single image for an attachment that is only accessed through the render graph
+	/// The image may be larger than the attachment (see DeviceResource::allocate_attachment_images)
+	/// @param allocator Allocator to use
+	/// @param attachment ImageAttachment to make the Image from
+	/// @param loc Source location information
+	/// @return Image in a RAII wrapper (Unique<T>) or AllocateException on error
+	inline Result<Unique<Image>, AllocateException>
+	allocate_attachment_image(Allocator& allocator, const ImageAttachment& attachment, SourceLocationAtFrame loc = VUK_HERE_AND_NOW()) {
+		return detail::allocate_image(allocator, attachment, true, loc);
 	}
 
 	/// @brief Allocate a single image view from an Allocator
@@ -7,7 +7,9 @@
 #include "vuk/runtime/vk/VkTypes.hpp" // TODO: leaking vk
 
 #include <array>
+#include <algorithm>
 #include <atomic>
+#include <condition_variable>
 #include <memory>
 #include <mutex>
 #include <plf_colony.h>
@@ -17,6 +19,7 @@
 
 namespace vuk {
 	struct DeviceResource;
+	class Runtime;
 
 	struct LinearSegment {
 		Buffer buffer;
@@ -27,23 +30,34 @@ namespace vuk {
 	struct BufferLinearAllocator {
 		DeviceResource* upstream;
 		std::mutex mutex;
-		std::atomic<int> current_buffer = -1;
+		std::condition_variable grown; // signalled when current_buffer advances or growing failed
+		int current_buffer = -1;
+		bool grow_failed = false;
 		std::atomic<size_t> needle = 0;
 		MemoryUsage mem_usage;
 		BufferUsageFlags usage;
-		// TODO: convert to deque
-		std::array<LinearSegment, 256> available_allocations; // up to 4 GB of allocations with the default block_size
-		std::array<LinearSegment, 256> used_allocations;      // up to 4 GB of allocations with the default block_size
-		size_t available_allocation_count = 0;
-		size_t used_allocation_count = 0;
+		std::vector<LinearSegment> available_allocations;
+		std::vector<LinearSegment> used_allocations; // one entry per block, guarded by mutex
 
 		size_t block_size;
+		// small allocations are made from per-thread chunks of this size, so that they don't touch the shared needle
+		size_t chunk_size;
+		// unique among the live linear allocators, indexes the per-thread chunk of this allocator
+		uint32_t slot;
+		// unique over all linear allocators, changes on every reset, invalidating the per-thread chunks
+		std::atomic<uint64_t> generation;
+		// if set, the blocks in use are reported to the memory statistics of this runtime
+		Runtime* runtime = nullptr;
+		size_t reported_blocks = 0;
 
 		BufferLinearAllocator(DeviceResource& upstream, MemoryUsage mem_usage, BufferUsageFlags buf_usage, size_t block_size = 1024 * 1024 * 16) :
 		    upstream(&upstream),
 		    mem_usage(mem_usage),
 		    usage(buf_usage),
-		    block_size(block_size) {}
+		    block_size(block_size),
+		    chunk_size(std::min(block_size / 16, size_t(64 * 1024))),
+		    slot(_acquire_slot()),
+		    generation(_next_generation()) {}
 		~BufferLinearAllocator();
 
 		Result<void, AllocateException> grow(size_t num_blocks, SourceLocationAtFrame source);
@@ -54,31 +68,38 @@ namespace vuk {
 		void reset();
 		// explicitly release resources
 		void free();
-	};
 
-	struct BufferBlock {
-		Buffer buffer = {};
-		size_t allocation_count = 0;
+	private:
+		static uint64_t _next_generation();
+		static uint32_t _acquire_slot();
+		static void _release_slot(uint32_t slot);
+		Result<void, AllocateException> _grow(size_t num_blocks, SourceLocationAtFrame source);
+		// bump the shared needle, growing or waiting for growth if needed
+		Result<Buffer, AllocateException> _allocate_shared(size_t size, size_t alignment, size_t& base, SourceLocationAtFrame source);
 	};
 
-	struct SubAllocation {
-		size_t block_index;
-		VmaVirtualAllocation allocation;
-	};
+	struct SubAllocatorShard;
 
+	/// @brief Two-level segregated fit (TLSF) allocator handing out parts of blocks of block_size
+	/// Allocations never cross blocks and respect any alignment. Threads are spread over shards, each with its own blocks and lock.
+	/// A thread takes room from the other shards before its shard adds a block, so sharding does not multiply the number of blocks held.
 	struct BufferSubAllocator {
 		DeviceResource* upstream;
 		MemoryUsage mem_usage;
 		BufferUsageFlags usage;
-		std::vector<BufferBlock> blocks;
-		VmaVirtualBlock virtual_alloc;
-		std::mutex mutex;
 		size_t block_size;
+		// if set, the allocations are reported to the memory statistics of this runtime
+		Runtime* runtime = nullptr;
 
 		BufferSubAllocator(DeviceResource& upstream, MemoryUsage mem_usage, BufferUsageFlags buf_usage, size_t block_size);
 		~BufferSubAllocator();
 
 		Result<Buffer, AllocateException> allocate_buffer(size_t size, size_t alignment, SourceLocationAtFrame source);
 		void deallocate_buffer(const Buffer& buf);
+
+		static constexpr size_t shard_count = 4;
+
+	private:
+		std::unique_ptr<SubAllocatorShard[]> shards;
 	};
 }; // namespace vuk
@@ -78,6 +78,13 @@ namespace vuk {
 		DescriptorType variable_count_binding_type;
 		unsigned variable_count_binding_max_size;
 		bool push;
+		// writes element 0 of the bindings in template_bindings from an array of DescriptorTemplateEntry indexed by binding
+		// for push layouts the template is made per pipeline layout
+		VkDescriptorUpdateTemplate update_template = VK_NULL_HANDLE;
+		uint64_t template_bindings = 0;
+		// for layouts created for descriptor buffers: size of one set and the offset of each binding in it
+		VkDeviceSize descriptor_buffer_size = 0;
+		std::array<VkDeviceSize, VUK_MAX_BINDINGS> descriptor_buffer_offsets = {};
 
 		bool operator==(const DescriptorSetLayoutAllocInfo& o) const noexcept {
 			return layout == o.layout && descriptor_counts == o.descriptor_counts;
@@ -111,6 +118,13 @@ namespace vuk {
 		}
 	};
 
+	/// @brief Element of the data read by descriptor update templates
+	union DescriptorTemplateEntry {
+		VkDescriptorBufferInfo buffer;
+		VkDescriptorImageInfo image;
+		VkAccelerationStructureKHR as;
+	};
+
 	struct ASInfo {
 		VkWriteDescriptorSetAccelerationStructureKHR wds{ VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET_ACCELERATION_STRUCTURE_KHR };
 		VkAccelerationStructureKHR as;
@@ -180,11 +194,23 @@ namespace vuk {
 		uint64_t hash = 0;
 
 		SetBinding finalize(Bitset<VUK_MAX_BINDINGS> used_mask);
+		/// @brief Hash the layout and the used bindings, call after the bindings are final
+		void compute_hash() noexcept;
+		/// @brief Pack the used bindings for the update template of the layout
+		/// @return false if there is no template or it doesn't write exactly the used bindings
+		bool pack_template_data(DescriptorTemplateEntry (&dst)[VUK_MAX_BINDINGS]) const noexcept;
 
+		// sets with the same layout and the same used bindings can be used interchangeably
 		bool operator==(const SetBinding& o) const noexcept {
-			if (layout_info != o.layout_info)
+			if (hash != o.hash || !(used == o.used))
 				return false;
-			return memcmp(bindings, o.bindings, VUK_MAX_BINDINGS * sizeof(DescriptorBinding)) == 0;
+			if ((layout_info ? layout_info->layout : VK_NULL_HANDLE) != (o.layout_info ? o.layout_info->layout : VK_NULL_HANDLE))
+				return false;
+			for (uint32_t i = 0; i < VUK_MAX_BINDINGS; i++) {
+				if (used.test(i) && !(bindings[i] == o.bindings[i]))
+					return false;
+			}
+			return true;
 		}
 	};
 
@@ -213,7 +239,7 @@ namespace vuk {
 	struct DescriptorPool {
 		void grow(Runtime& ptc, DescriptorSetLayoutAllocInfo layout_alloc_info);
 		VkDescriptorSet acquire(Runtime& ptc, DescriptorSetLayoutAllocInfo layout_alloc_info);
-		void release(VkDescriptorSet ds);
+		void release(Runtime& ptc, VkDescriptorSet ds);
 		void destroy(Runtime& ctx, VkDevice) const;
 
 		DescriptorPool();
@@ -287,13 +313,8 @@ namespace std {
 	template<>
 	struct hash<vuk::DescriptorSetLayoutAllocInfo> {
 		size_t operator()(vuk::DescriptorSetLayoutAllocInfo const& x) const noexcept {
-			size_t h = 0;
 			// TODO: should use vuk::DescriptorSetLayout here
-			hash_combine(h,
-			             ::hash::fnv1a::hash(
-			                 (const char*)&x.descriptor_counts[0], x.descriptor_counts.size() * sizeof(x.descriptor_counts[0]), ::hash::fnv1a::default_offset_basis),
-			             (VkDescriptorSetLayout)x.layout);
-			return h;
+			return ::hash::wyhash::hash(x.descriptor_counts.data(), x.descriptor_counts.size() * sizeof(x.descriptor_counts[0]), reinterpret_cast<uint64_t>(x.layout));
 		}
 	};
 
@@ -310,9 +331,9 @@ namespace std {
 	template<>
 	struct hash<vuk::DescriptorSetLayoutCreateInfo> {
 		size_t operator()(vuk::DescriptorSetLayoutCreateInfo const& x) const noexcept {
-			size_t h = 0;
-			hash_combine(h, std::span(x.bindings));
-			return h;
+			// VkDescriptorSetLayoutBinding has no padding, and equality compares all of its fields
+			auto h = ::hash::wyhash::hash(x.bindings.data(), x.bindings.size() * sizeof(VkDescriptorSetLayoutBinding), x.dslci.flags);
+			return ::hash::wyhash::hash(x.flags.data(), x.flags.size() * sizeof(VkDescriptorBindingFlags), h);
 		}
 	};
 }; // namespace std
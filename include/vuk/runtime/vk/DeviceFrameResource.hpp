@@ -54,6 +54,9 @@ namespace vuk {
 
 		void deallocate_images(std::span<const Image> src) override; // noop
 
+		// attachment images may come from a larger cached image, if enabled on the superframe resource
+		Result<void, AllocateException> allocate_attachment_images(std::span<Image> dst, std::span<const ImageCreateInfo> cis, SourceLocationAtFrame loc) override;
+
 		Result<void, AllocateException>
 		allocate_image_views(std::span<ImageView> dst, std::span<const ImageViewCreateInfo> cis, SourceLocationAtFrame loc) override;
 
@@ -72,6 +75,11 @@ namespace vuk {
 		allocate_descriptor_sets(std::span<DescriptorSet> dst, std::span<const DescriptorSetLayoutAllocInfo> cis, SourceLocationAtFrame loc) override;
 
 		void deallocate_descriptor_sets(std::span<const DescriptorSet> src) override;
+		// descriptor sets written with the same bindings are reused until the frame is recycled
+		bool find_descriptor_set(DescriptorSet& dst, const SetBinding& value) override;
+		void record_descriptor_set(const DescriptorSet& ds, const SetBinding& value) override;
+		// descriptor buffer memory is allocated linearly, from blocks that are reused by the next use of this frame
+		Result<Buffer, AllocateException> allocate_descriptor_buffer_memory(size_t size, size_t alignment, SourceLocationAtFrame loc) override;
 
 		Result<void, AllocateException>
 		allocate_timestamp_query_pools(std::span<TimestampQueryPool> dst, std::span<const VkQueryPoolCreateInfo> cis, SourceLocationAtFrame loc) override;
@@ -142,6 +150,7 @@ namespace vuk {
 	/// All resources allocated are also deallocated at recycle time - it is not necessary (but not an error) to deallocate them.
 	struct DeviceMultiFrameResource final : DeviceFrameResource {
 		Result<void, AllocateException> allocate_images(std::span<Image> dst, std::span<const ImageCreateInfo> cis, SourceLocationAtFrame loc) override;
+		Result<void, AllocateException> allocate_attachment_images(std::span<Image> dst, std::span<const ImageCreateInfo> cis, SourceLocationAtFrame loc) override;
 
 		DeviceMultiFrameResource(VkDevice device, DeviceSuperFrameResource& upstream, uint32_t frame_lifetime);
 
@@ -160,6 +169,20 @@ namespace vuk {
 		DeviceMultiFrameResource& operator=(DeviceMultiFrameResource&&) = delete;
 	};
 
+	/// @brief Statistics of the transient image cache of a DeviceSuperFrameResource
+	struct TransientImageCacheStats {
+		/// @brief Requests served by a cached image during the last completed frame
+		uint64_t hits = 0;
+		/// @brief Requests that had to create a new image during the last completed frame
+		uint64_t misses = 0;
+		/// @brief Images destroyed during the last completed frame, because they aged out or to stay within the budget
+		uint64_t evictions = 0;
+		/// @brief Number of images currently held by the cache
+		size_t image_count = 0;
+		/// @brief Estimated memory currently held by the cache, in bytes
+		uint64_t bytes = 0;
+	};
+
 	/// @brief DeviceSuperFrameResource is an allocator that gives out DeviceFrameResource allocators, and manages their resources
 	///
 	/// DeviceSuperFrameResource models resource lifetimes that span multiple frames - these can be allocated directly from this resource
@@ -193,7 +216,11 @@ namespace vuk {
 
 		void deallocate_images(std::span<const Image> src) override;
 
-		Result<void, AllocateException> allocate_cached_images(std::span<Image> dst, std::span<const ImageCreateInfo> cis, SourceLocationAtFrame loc);
+		/// @brief Allocate transient images from the cache, which live until the frame after `frame_lifetime` frames
+		/// Requests are matched to cached images with the same extent and a superset of the requested usage.
+		/// @param allow_larger if set and extent bucketing is enabled, the extent is rounded up to a bucket first, so the returned images may be larger than requested
+		Result<void, AllocateException> allocate_cached_images(
+		    std::span<Image> dst, std::span<const ImageCreateInfo> cis, SourceLocationAtFrame loc, uint32_t frame_lifetime = 1, bool allow_larger = false);
 
 		Result<void, AllocateException> allocate_cached_image_views(std::span<ImageView> dst, std::span<const ImageViewCreateInfo> cis, SourceLocationAtFrame loc);
 
@@ -242,6 +269,17 @@ namespace vuk {
 
 		void force_collect();
 
+		/// @brief Set the amount of memory the transient image cache may hold, in bytes
+		/// Idle images are evicted, largest and least recently used first, when the cache would grow beyond the budget.
+		void set_transient_image_budget(uint64_t bytes);
+
+		/// @brief Let attachments created by the render graph reuse cached images up to 12.5% larger per dimension, disabled by default
+		/// Only enable this if the attachments are not accessed in ways that depend on the extent of the image, such as sampling with normalized coordinates.
+		void set_attachment_extent_bucketing(bool enable);
+
+		/// @brief Get the transient image cache statistics of the last completed frame
+		TransientImageCacheStats get_transient_image_stats();
+
 		virtual ~DeviceSuperFrameResource();
 
 		const uint64_t frames_in_flight;
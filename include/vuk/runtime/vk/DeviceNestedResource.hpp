@@ -43,6 +43,8 @@ namespace vuk {
 
 		void deallocate_images(std::span<const Image> src) override;
 
+		Result<void, AllocateException> allocate_attachment_images(std::span<Image> dst, std::span<const ImageCreateInfo> cis, SourceLocationAtFrame loc) override;
+
 		void set_image_allocation_name(Image& dst, Name name) override final;
 
 		Result<void, AllocateException>
@@ -64,6 +66,12 @@ namespace vuk {
 
 		void deallocate_descriptor_sets(std::span<const DescriptorSet> src) override;
 
+		bool find_descriptor_set(DescriptorSet& dst, const SetBinding& value) override;
+
+		void record_descriptor_set(const DescriptorSet& ds, const SetBinding& value) override;
+
+		Result<Buffer, AllocateException> allocate_descriptor_buffer_memory(size_t size, size_t alignment, SourceLocationAtFrame loc) override;
+
 		Result<void, AllocateException>
 		allocate_descriptor_pools(std::span<VkDescriptorPool> dst, std::span<const VkDescriptorPoolCreateInfo> cis, SourceLocationAtFrame loc) override;
 
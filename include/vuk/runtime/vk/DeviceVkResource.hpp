@@ -3,7 +3,11 @@
 #include "vuk/Config.hpp"
 #include "vuk/runtime/vk/Allocator.hpp"
 
+#include <vector>
+
 namespace vuk {
+	struct MemoryHeapStats;
+
 	/// @brief Device resource that performs direct allocation from the resources from the Vulkan runtime.
 	struct DeviceVkResource final : DeviceResource {
 		DeviceVkResource(Runtime& ctx);
@@ -100,6 +104,15 @@ namespace vuk {
 		                                                            SourceLocationAtFrame loc) override;
 		void deallocate_graphics_pipelines(std::span<const GraphicsPipelineInfo> src) override;
 
+		/// @brief Create link-time optimized pipelines for pipelines that were fast-linked from pipeline libraries
+		/// Only has an effect with GraphicsPipelineStrategy::eLibraryFastLink. Optimized links are queued and performed on a background thread, this
+		/// performs the queued links on the calling thread instead.
+		/// @param max_count Maximum number of pipelines to link
+		/// @return Number of pipelines linked
+		size_t link_optimized_graphics_pipelines(size_t max_count = SIZE_MAX);
+		/// @brief Retrieve the optimized replacement of a fast-linked pipeline, or the pipeline itself if there is none (yet)
+		VkPipeline get_optimized_graphics_pipeline(VkPipeline pipeline);
+
 		Result<void, AllocateException>
 		allocate_compute_pipelines(std::span<ComputePipelineInfo> dst, std::span<const ComputePipelineInstanceCreateInfo> cis, SourceLocationAtFrame loc) override;
 		void deallocate_compute_pipelines(std::span<const ComputePipelineInfo> src) override;
@@ -125,10 +138,15 @@ namespace vuk {
 			return *ctx;
 		}
 
+		/// @brief Query the usage and budget of each memory heap from VMA
+		std::vector<MemoryHeapStats> get_memory_heap_stats();
+
 		Runtime* ctx;
 		VkDevice device;
 
 	private:
+		void start_link_thread();
+
 		struct DeviceVkResourceImpl* impl;
 	};
 } // namespace vuk
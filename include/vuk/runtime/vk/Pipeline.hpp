@@ -136,13 +136,16 @@ namespace vuk {
 		ShaderCompileOptions compile_options = {};
 		/// @brief Recursion depth for RT pipelines, corresponding to maxPipelineRayRecursionDepth
 		uint32_t max_ray_recursion_depth = 1;
+		/// @brief Bind shader objects (VK_EXT_shader_object) instead of pipelines. All state is set dynamically and no pipelines are compiled.
+		bool use_shader_objects = false;
 
 		friend struct std::hash<PipelineBaseCreateInfo>;
 
 	public:
 		static fixed_vector<DescriptorSetLayoutCreateInfo, VUK_MAX_SETS> build_descriptor_layouts(const Program&, const PipelineBaseCreateInfoBase&);
 		bool operator==(const PipelineBaseCreateInfo& o) const noexcept {
-			return shaders == o.shaders && binding_flags == o.binding_flags && variable_count_max == o.variable_count_max && defines == o.defines;
+			return shaders == o.shaders && binding_flags == o.binding_flags && variable_count_max == o.variable_count_max && defines == o.defines &&
+			       use_shader_objects == o.use_shader_objects;
 		}
 	};
 
@@ -152,10 +155,15 @@ namespace vuk {
 		std::vector<VkPipelineShaderStageCreateInfo> psscis;
 		std::vector<std::string> entry_point_names;
 		VkPipelineLayout pipeline_layout;
+		// content hashes of the shader modules (one per entry in psscis) and of the pipeline layout, these identify pipeline library parts
+		std::vector<size_t> shader_hashes;
+		size_t pipeline_layout_hash = 0;
 		std::array<DescriptorSetLayoutAllocInfo, VUK_MAX_SETS> layout_info = {};
 		fixed_vector<DescriptorSetLayoutCreateInfo, VUK_MAX_SETS> dslcis = {}; // saved for debug purposes
 		std::vector<HitGroup> hit_groups;
 		uint32_t max_ray_recursion_depth;
+		// if not empty, these are bound instead of pipelines (one per entry in psscis)
+		std::vector<VkShaderEXT> shader_objects;
 
 		// 4 valid flags
 		Bitset<4 * VUK_MAX_SETS * VUK_MAX_BINDINGS> binding_flags = {};
@@ -212,7 +220,7 @@ namespace std {
 	struct hash<vuk::PipelineBaseCreateInfo> {
 		size_t operator()(vuk::PipelineBaseCreateInfo const& x) const noexcept {
 			size_t h = 0;
-			hash_combine(h, x.shaders, x.defines);
+			hash_combine(h, x.shaders, x.defines, x.use_shader_objects);
 			return h;
 		}
 	};
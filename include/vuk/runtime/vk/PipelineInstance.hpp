@@ -16,7 +16,7 @@ namespace vuk {
 	struct GraphicsPipelineInstanceCreateInfo {
 		PipelineBaseInfo* base;
 		VkRenderPass render_pass;
-		uint16_t dynamic_state_flags : 6;
+		uint32_t dynamic_state_flags : 23;
 		uint16_t extended_size = 0;
 		struct RecordsExist {
 			uint32_t nonzero_subpass : 1;
@@ -48,6 +48,7 @@ namespace vuk {
 			std::byte inline_data[80];
 			std::byte* extended_data;
 		};
+		uint64_t hash = 0; // computed by compute_hash() once the key is complete
 
 #pragma pack(push, 1)
 		struct VertexInputBindingDescription {
@@ -125,8 +126,31 @@ namespace vuk {
 
 #pragma pack(pop)
 
+		/// @brief Upper bound of extended_size under the VUK_MAX_* limits
+		static constexpr size_t max_extended_size = sizeof(uint8_t) + // subpass
+		                                            VUK_MAX_ATTRIBUTES * sizeof(VertexInputAttributeDescription) + sizeof(uint8_t) +
+		                                            VUK_MAX_ATTRIBUTES * sizeof(VertexInputBindingDescription) +
+		                                            VUK_MAX_COLOR_ATTACHMENTS * sizeof(PipelineColorBlendAttachmentState) + sizeof(BlendStateLogicOp) +
+		                                            sizeof(float) * 4 + // blend constants
+		                                            sizeof(Bitset<VUK_MAX_SPECIALIZATIONCONSTANT_RANGES>) + VUK_MAX_SPECIALIZATIONCONSTANT_SIZE +
+		                                            sizeof(RasterizationState) + sizeof(DepthBias) + sizeof(ConservativeState) + sizeof(TessellationState) +
+		                                            sizeof(Depth) + sizeof(Stencil) + sizeof(DepthBounds) + sizeof(Multisample) + sizeof(uint8_t) +
+		                                            VUK_MAX_VIEWPORTS * sizeof(VkViewport) + sizeof(uint8_t) + VUK_MAX_SCISSORS * sizeof(VkRect2D);
+
+		/// @brief Hash the key and store it - must be called after all the state (including the extended data) has been written
+		void compute_hash() noexcept {
+			uint64_t fixed[3] = { reinterpret_cast<uint64_t>(base),
+				                    reinterpret_cast<uint64_t>(render_pass),
+				                    (uint64_t)dynamic_state_flags | ((uint64_t)std::bit_cast<uint32_t>(records) << 32) };
+			uint64_t state = (uint64_t)extended_size | ((uint64_t)attachmentCount << 16) | ((uint64_t)topology << 24) | ((uint64_t)primitive_restart_enable << 28) |
+			                 ((uint64_t)cullMode << 29);
+			auto seed = ::hash::wyhash::hash(fixed, sizeof(fixed), state);
+			hash = ::hash::wyhash::hash(is_inline() ? inline_data : extended_data, extended_size, seed);
+		}
+
 		bool operator==(const GraphicsPipelineInstanceCreateInfo& o) const noexcept {
-			return base == o.base && render_pass == o.render_pass && extended_size == o.extended_size && attachmentCount == o.attachmentCount &&
+			return hash == o.hash && base == o.base && render_pass == o.render_pass && dynamic_state_flags == o.dynamic_state_flags &&
+			       std::bit_cast<uint32_t>(records) == std::bit_cast<uint32_t>(o.records) && extended_size == o.extended_size && attachmentCount == o.attachmentCount &&
 			       topology == o.topology && primitive_restart_enable == o.primitive_restart_enable && cullMode == o.cullMode &&
 			       (is_inline() ? (memcmp(inline_data, o.inline_data, extended_size) == 0) : (memcmp(extended_data, o.extended_data, extended_size) == 0));
 		}
@@ -149,9 +173,18 @@ namespace vuk {
 		std::array<std::byte, VUK_MAX_SPECIALIZATIONCONSTANT_SIZE> specialization_constant_data = {};
 		fixed_vector<VkSpecializationMapEntry, VUK_MAX_SPECIALIZATIONCONSTANT_RANGES> specialization_map_entries;
 		VkSpecializationInfo specialization_info = {};
+		uint64_t hash = 0; // computed by compute_hash() once the key is complete
+
+		/// @brief Hash the key and store it - must be called after the specialization constants have been written
+		void compute_hash() noexcept {
+			auto seed = ::hash::wyhash::hash(specialization_map_entries.data(),
+			                                 specialization_map_entries.size() * sizeof(VkSpecializationMapEntry),
+			                                 reinterpret_cast<uint64_t>(base));
+			hash = ::hash::wyhash::hash(specialization_constant_data.data(), specialization_info.dataSize, seed);
+		}
 
 		bool operator==(const ComputePipelineInstanceCreateInfo& o) const noexcept {
-			return base == o.base && specialization_map_entries == o.specialization_map_entries && specialization_info.dataSize == o.specialization_info.dataSize &&
+			return hash == o.hash && base == o.base && specialization_map_entries == o.specialization_map_entries && specialization_info.dataSize == o.specialization_info.dataSize &&
 			       memcmp(specialization_constant_data.data(), o.specialization_constant_data.data(), specialization_info.dataSize) == 0;
 		}
 	};
@@ -166,9 +199,18 @@ namespace vuk {
 		std::array<std::byte, VUK_MAX_SPECIALIZATIONCONSTANT_SIZE> specialization_constant_data = {};
 		fixed_vector<VkSpecializationMapEntry, VUK_MAX_SPECIALIZATIONCONSTANT_RANGES> specialization_map_entries;
 		VkSpecializationInfo specialization_info = {};
+		uint64_t hash = 0; // computed by compute_hash() once the key is complete
+
+		/// @brief Hash the key and store it - must be called after the specialization constants have been written
+		void compute_hash() noexcept {
+			auto seed = ::hash::wyhash::hash(specialization_map_entries.data(),
+			                                 specialization_map_entries.size() * sizeof(VkSpecializationMapEntry),
+			                                 reinterpret_cast<uint64_t>(base));
+			hash = ::hash::wyhash::hash(specialization_constant_data.data(), specialization_info.dataSize, seed);
+		}
 
 		bool operator==(const RayTracingPipelineInstanceCreateInfo& o) const noexcept {
-			return base == o.base && specialization_map_entries == o.specialization_map_entries && specialization_info.dataSize == o.specialization_info.dataSize &&
+			return hash == o.hash && base == o.base && specialization_map_entries == o.specialization_map_entries && specialization_info.dataSize == o.specialization_info.dataSize &&
 			       memcmp(specialization_constant_data.data(), o.specialization_constant_data.data(), specialization_info.dataSize) == 0;
 		}
 	};
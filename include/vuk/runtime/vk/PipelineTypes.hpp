@@ -322,37 +322,29 @@ namespace vuk {
 		eDepthBias = 1 << 3,
 		eBlendConstants = 1 << 4,
 		eDepthBounds = 1 << 5,
+		// VK_EXT_extended_dynamic_state
+		eCullMode = 1 << 6,
+		eFrontFace = 1 << 7,
+		ePrimitiveTopology = 1 << 8,
+		eDepthTestEnable = 1 << 9,
+		eDepthWriteEnable = 1 << 10,
+		eDepthCompareOp = 1 << 11,
+		eStencilTestEnable = 1 << 12,
+		eStencilOp = 1 << 13,
+		// VK_EXT_extended_dynamic_state2
+		eRasterizerDiscardEnable = 1 << 14,
+		eDepthBiasEnable = 1 << 15,
+		ePrimitiveRestartEnable = 1 << 16,
+		// VK_EXT_extended_dynamic_state3
+		eDepthClampEnable = 1 << 17,
+		ePolygonMode = 1 << 18,
+		eColorBlendEnable = 1 << 19,
+		eColorBlendEquation = 1 << 20,
+		eColorWriteMask = 1 << 21,
+		// VK_EXT_vertex_input_dynamic_state
+		eVertexInput = 1 << 22,
 		// additional dynamic state to implement:
-		/*eStencilCompareMask = 1 << 6,
-		eStencilWriteMask = 1 << 7,
-		eStencilReference = 1 << 8,
-		eViewportWScalingNV = 1 << 9,
-		eDiscardRectangleEXT = 1 << 10,
-		eSampleLocationsEXT = 1 << 11,
-		eRaytracingPipelineStackSizeKHR = 1 << 12,
-		eViewportShadingRatePaletteNV = 1 << 13,
-		eViewportCoarseSampleOrderNV = 1 << 14,
-		eExclusiveScissorNV = 1 << 15,
-		eFragmentShadingRateKHR = 1 << 16,
-		eLineStippleEXT = 1 << 17,
-		eCullModeEXT = 1 << 18,
-		eFrontFaceEXT = 1 << 19,
-		ePrimitiveTopologyEXT = 1 << 20,
-		eViewportWithCountEXT = 1 << 21,
-		eScissorWithCountEXT = 1 << 22,
-		eVertexInputBindingStrideEXT = 1 << 23,
-		eDepthTestEnableEXT = 1 << 24,
-		eDepthWriteEnableEXT = 1 << 25,
-		eDepthCompareOpEXT = 1 << 26,
-		eStencilTestEnableEXT = 1 << 27,
-		eStencilOpEXT = 1 << 28,
-		eVertexInputEXT = 1 << 29,
-		ePatchControlPointsEXT = 1 << 30,
-		eRasterizerDiscardEnableEXT = 1 << 31,
-		eDepthBiasEnableEXT = 1Ui64 << 32,
-		eLogicOpEXT = 1Ui64 << 33,
-		ePrimitiveRestartEnableEXT = 1Ui64 << 34,
-		eColorWriteEnableEXT = 1Ui64 << 35*/
+		/*eStencilCompareMask, eStencilWriteMask, eStencilReference, eLineStippleEXT, eLogicOpEXT, ePatchControlPointsEXT, eColorWriteEnableEXT */
 	};
 
 	using DynamicStateFlags = Flags<DynamicStateFlagBits>;
@@ -368,6 +360,9 @@ namespace vuk {
 	inline constexpr DynamicStateFlags operator^(DynamicStateFlagBits bit0, DynamicStateFlagBits bit1) noexcept {
 		return (DynamicStateFlags)bit0 ^ bit1;
 	}
+
+	/// @brief Dynamic states provided by extensions (eCullMode to eVertexInput) - these are excluded from pipeline instance keys when enabled
+	inline constexpr DynamicStateFlags extended_dynamic_state_flags = DynamicStateFlags{ ((1ull << 23) - 1) & ~((1ull << 6) - 1) };
 }; // namespace vuk
 
 inline bool operator==(VkPushConstantRange const& lhs, VkPushConstantRange const& rhs) noexcept {
@@ -12,6 +12,10 @@
 #include <vector>
 
 namespace vuk {
+	namespace detail {
+		struct SpirvReflector;
+	}
+
 	struct Program {
 		enum class Type {
 			einvalid,
@@ -116,7 +120,15 @@ namespace vuk {
 			std::vector<Member> members;
 		};
 
+		/// @brief Reflect all entry points of a SPIR-V module, using the native parser and falling back to spirv-cross for unsupported modules
 		static std::vector<Program> introspect(const uint32_t* ir, size_t word_count);
+		/// @brief Reflect with the single-pass native SPIR-V parser
+		/// @return the reflected entry points, or std::nullopt if the module uses constructs the parser does not handle
+		static std::optional<std::vector<Program>> introspect_native(const uint32_t* ir, size_t word_count);
+		/// @brief Reflect with spirv-cross
+		static std::vector<Program> introspect_spirv_cross(const uint32_t* ir, size_t word_count);
+		/// @brief Compare everything reflected for two entry points, used to cross-check the native parser against spirv-cross
+		static bool same_reflection(const Program& a, const Program& b);
 		std::string entry_point;
 
 		std::array<unsigned, 3> local_size;
@@ -135,13 +147,18 @@ namespace vuk {
 		void append(const Program& o);
 
 	private:
+		friend struct detail::SpirvReflector;
+
 		void flatten_bindings();
+		void finalize();
 		Descriptors& ensure_set(size_t set_index);
 	};
 
 	struct ShaderModule {
 		VkShaderModule shader_module;
 		std::vector<Program> reflection_info;
+		/// @brief SPIR-V of the module, only kept if shader objects can be created
+		std::vector<uint32_t> spirv;
 	};
 
 	struct ShaderModuleCreateInfo;
@@ -17,6 +17,7 @@ VUK_X(vkCreateAccelerationStructureKHR)
 VUK_X(vkDestroyAccelerationStructureKHR)
 VUK_X(vkGetRayTracingShaderGroupHandlesKHR)
 VUK_X(vkCreateRayTracingPipelinesKHR)
+VUK_X(vkGetAccelerationStructureDeviceAddressKHR)
 
 // VK_EXT_calibrated_timestamps
 VUK_X(vkGetCalibratedTimestampsEXT)
@@ -24,8 +25,57 @@ VUK_Y(vkGetPhysicalDeviceCalibrateableTimeDomainsEXT)
 
 // VK_KHR_push_descriptors
 VUK_X(vkCmdPushDescriptorSetKHR)
+VUK_X(vkCmdPushDescriptorSetWithTemplateKHR)
+
+// VK_EXT_descriptor_buffer
+VUK_X(vkGetDescriptorSetLayoutSizeEXT)
+VUK_X(vkGetDescriptorSetLayoutBindingOffsetEXT)
+VUK_X(vkGetDescriptorEXT)
+VUK_X(vkCmdBindDescriptorBuffersEXT)
+VUK_X(vkCmdSetDescriptorBufferOffsetsEXT)
 
 // VK_EXT_mesh_shader
 VUK_X(vkCmdDrawMeshTasksEXT)
 VUK_X(vkCmdDrawMeshTasksIndirectEXT)
-VUK_X(vkCmdDrawMeshTasksIndirectCountEXT)
\ No newline at end of file
+VUK_X(vkCmdDrawMeshTasksIndirectCountEXT)
+// VK_EXT_extended_dynamic_state
+VUK_X(vkCmdSetCullModeEXT)
+VUK_X(vkCmdSetFrontFaceEXT)
+VUK_X(vkCmdSetPrimitiveTopologyEXT)
+VUK_X(vkCmdSetDepthTestEnableEXT)
+VUK_X(vkCmdSetDepthWriteEnableEXT)
+VUK_X(vkCmdSetDepthCompareOpEXT)
+VUK_X(vkCmdSetStencilTestEnableEXT)
+VUK_X(vkCmdSetStencilOpEXT)
+
+// VK_EXT_extended_dynamic_state2
+VUK_X(vkCmdSetRasterizerDiscardEnableEXT)
+VUK_X(vkCmdSetDepthBiasEnableEXT)
+VUK_X(vkCmdSetPrimitiveRestartEnableEXT)
+
+// VK_EXT_extended_dynamic_state3
+VUK_X(vkCmdSetDepthClampEnableEXT)
+VUK_X(vkCmdSetPolygonModeEXT)
+VUK_X(vkCmdSetColorBlendEnableEXT)
+VUK_X(vkCmdSetColorBlendEquationEXT)
+VUK_X(vkCmdSetColorWriteMaskEXT)
+
+// VK_EXT_vertex_input_dynamic_state
+VUK_X(vkCmdSetVertexInputEXT)
+
+// VK_EXT_shader_object
+VUK_X(vkCreateShadersEXT)
+VUK_X(vkDestroyShaderEXT)
+VUK_X(vkCmdBindShadersEXT)
+VUK_X(vkCmdSetViewportWithCountEXT)
+VUK_X(vkCmdSetScissorWithCountEXT)
+VUK_X(vkCmdSetDepthBoundsTestEnableEXT)
+VUK_X(vkCmdSetPatchControlPointsEXT)
+VUK_X(vkCmdSetRasterizationSamplesEXT)
+VUK_X(vkCmdSetSampleMaskEXT)
+VUK_X(vkCmdSetAlphaToCoverageEnableEXT)
+VUK_X(vkCmdSetLogicOpEnableEXT)
+// core, but only set separately for shader objects
+VUK_X(vkCmdSetStencilCompareMask)
+VUK_X(vkCmdSetStencilWriteMask)
+VUK_X(vkCmdSetStencilReference)
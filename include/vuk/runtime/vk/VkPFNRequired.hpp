@@ -52,6 +52,10 @@ VUK_X(vkDestroyDescriptorPool)
 VUK_X(vkAllocateDescriptorSets)
 VUK_X(vkUpdateDescriptorSets)
 
+VUK_X(vkCreateDescriptorUpdateTemplate)
+VUK_X(vkDestroyDescriptorUpdateTemplate)
+VUK_X(vkUpdateDescriptorSetWithTemplate)
+
 VUK_X(vkCreateGraphicsPipelines)
 VUK_X(vkCreateComputePipelines)
 VUK_X(vkDestroyPipeline)
@@ -63,6 +67,7 @@ VUK_X(vkDestroyQueryPool)
 VUK_X(vkCreatePipelineCache)
 VUK_X(vkGetPipelineCacheData)
 VUK_X(vkDestroyPipelineCache)
+VUK_X(vkMergePipelineCaches)
 
 VUK_X(vkCreateRenderPass)
 VUK_X(vkCmdBeginRenderPass)
@@ -115,6 +120,7 @@ VUK_X(vkDestroyImage)
 
 // 1.1
 VUK_Y(vkGetPhysicalDeviceProperties2)
+VUK_Y(vkGetPhysicalDeviceMemoryProperties2)
 
 // 1.2 
 VUK_X(vkGetBufferDeviceAddress)
@@ -3,6 +3,7 @@
 #include <array>
 #include <optional>
 #include <span>
+#include <string>
 #include <string_view>
 #include <vector>
 
@@ -10,6 +11,7 @@
 #include "vuk/Executor.hpp"
 #include "vuk/runtime/vk/Allocator.hpp"
 #include "vuk/runtime/vk/Image.hpp"
+#include "vuk/runtime/vk/PipelineTypes.hpp"
 #include "vuk/runtime/vk/VkSwapchain.hpp"
 #include "vuk/vuk_fwd.hpp"
 
@@ -40,6 +42,17 @@ namespace vuk {
 	std::unique_ptr<Executor>
 	create_vkqueue_executor(const FunctionPointers& fps, VkDevice device, VkQueue queue, uint32_t queue_family_index, DomainFlagBits domain);
 
+	/// @brief Settings controlling how the Runtime manages and persists Vulkan pipeline caches
+	struct PipelineCacheSettings {
+		/// @brief If true, each thread creating pipelines receives its own VkPipelineCache, which are merged into the main cache on save
+		bool per_thread_caches = false;
+		/// @brief If not empty, the pipeline cache is loaded from this path on creation, and saved to it periodically and on destruction
+		std::string path;
+		/// @brief Number of frames between automatic saves to `path` (0 = only save on destruction)
+		/// Automatic saves are merged, serialized and written on a background thread
+		uint64_t save_interval = 0;
+	};
+
 	/// @brief Parameters used for creating a Runtime
 	struct RuntimeCreateParameters {
 		/// @brief Vulkan instance
@@ -52,6 +65,75 @@ namespace vuk {
 		std::vector<std::unique_ptr<Executor>> executors;
 		/// @brief User provided function pointers. If you want dynamic loading, you must set vkGetInstanceProcAddr & vkGetDeviceProcAddr
 		FunctionPointers pointers;
+		/// @brief Pipeline cache persistence settings
+		PipelineCacheSettings pipeline_cache_settings;
+		/// @brief Set if VK_EXT_memory_budget was enabled on the device, so that heap budgets reported by get_memory_stats() come from the driver
+		bool memory_budget_enabled = false;
+		/// @brief Set if the graphicsPipelineLibrary feature of VK_EXT_graphics_pipeline_library was enabled on the device
+		bool graphics_pipeline_library_enabled = false;
+		/// @brief Set if the shaderObject feature of VK_EXT_shader_object was enabled on the device
+		bool shader_object_enabled = false;
+		/// @brief Set if the taskShader feature of VK_EXT_mesh_shader was enabled on the device
+		bool task_shader_enabled = false;
+		/// @brief Set if the meshShader feature of VK_EXT_mesh_shader was enabled on the device
+		bool mesh_shader_enabled = false;
+	};
+
+	/// @brief Kind of allocation accounted in MemoryStats
+	/// The kinds are layers of the allocator chain rather than a partition of memory, so the same bytes can be counted under several kinds:
+	/// the blocks of the BufferSubAllocators and the buffers too large for them are also eBuffer, and the blocks of the frame linear allocators are
+	/// allocated from the superframe resource, so they are also eSubAllocatedBuffer. Only eBuffer and eImage add up to the total.
+	enum class AllocationKind {
+		eBuffer,            ///< buffer created by DeviceVkResource
+		eImage,             ///< image created by DeviceVkResource
+		eLinearBlock,       ///< block of a frame linear allocator, in use by a frame
+		eSubAllocatedBuffer ///< buffer handed out by the BufferSubAllocators of a DeviceSuperFrameResource
+	};
+
+	inline constexpr size_t allocation_kind_count = 4;
+	inline constexpr size_t memory_usage_count = 5;
+
+	/// @brief Number and size of live allocations
+	struct AllocationCounter {
+		uint64_t count = 0;
+		uint64_t bytes = 0;
+	};
+
+	/// @brief Use of a Vulkan memory heap, with the budget from VK_EXT_memory_budget if enabled, or estimated from the heap size otherwise
+	struct MemoryHeapStats {
+		VkMemoryHeapFlags flags;
+		/// @brief Size of the heap
+		uint64_t size;
+		/// @brief Memory of the heap used by the process
+		uint64_t usage;
+		/// @brief Memory of the heap the process can use before allocations start failing or hurting performance
+		uint64_t budget;
+		/// @brief Memory allocated from the heap into VkDeviceMemory blocks by vuk
+		uint64_t block_bytes;
+		/// @brief Memory of these blocks in use by allocations
+		uint64_t allocation_bytes;
+	};
+
+	/// @brief Snapshot of the memory allocated through a Runtime
+	struct MemoryStats {
+		/// @brief Live allocations, indexed by AllocationKind and MemoryUsage - kinds overlap, see AllocationKind
+		std::array<std::array<AllocationCounter, memory_usage_count>, allocation_kind_count> allocations = {};
+		/// @brief Heaps of the physical device
+		std::vector<MemoryHeapStats> heaps;
+
+		const AllocationCounter& get(AllocationKind kind, MemoryUsage usage) const {
+			return allocations[(size_t)kind][(size_t)usage];
+		}
+
+		/// @brief Live allocations of a kind, over all memory usages
+		AllocationCounter total(AllocationKind kind) const {
+			AllocationCounter sum;
+			for (auto& c : allocations[(size_t)kind]) {
+				sum.count += c.count;
+				sum.bytes += c.bytes;
+			}
+			return sum;
+		}
 	};
 
 	class Runtime : public FunctionPointers {
@@ -78,7 +160,19 @@ namespace vuk {
 		VkPhysicalDeviceProperties physical_device_properties;
 		VkPhysicalDeviceRayTracingPipelinePropertiesKHR rt_properties{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_TRACING_PIPELINE_PROPERTIES_KHR };
 		VkPhysicalDeviceAccelerationStructurePropertiesKHR as_properties{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ACCELERATION_STRUCTURE_PROPERTIES_KHR };
+		VkPhysicalDeviceDescriptorBufferPropertiesEXT descriptor_buffer_properties{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_BUFFER_PROPERTIES_EXT };
+		VkPhysicalDevicePushDescriptorPropertiesKHR push_descriptor_properties{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PUSH_DESCRIPTOR_PROPERTIES_KHR };
 		size_t min_buffer_alignment;
+		/// @brief If VK_EXT_memory_budget is enabled on the device
+		bool memory_budget_enabled;
+		/// @brief If the graphicsPipelineLibrary feature is enabled on the device
+		bool graphics_pipeline_library_enabled;
+		/// @brief If the shaderObject feature is enabled on the device
+		bool shader_object_enabled;
+		/// @brief If the taskShader feature is enabled on the device
+		bool task_shader_enabled;
+		/// @brief If the meshShader feature is enabled on the device
+		bool mesh_shader_enabled;
 
 		// Executors
 		std::vector<uint32_t> all_queue_families;
@@ -134,9 +228,21 @@ namespace vuk {
 		void set_shader_target_version(uint32_t target_version = VK_API_VERSION_1_3);
 
 		/// @brief Load a Vulkan pipeline cache
+		/// @return false if the data was rejected because its header does not match this device (an empty cache is used instead)
+		/// Must not be called concurrently with pipeline creation
 		bool load_pipeline_cache(std::span<std::byte> data);
-		/// @brief Retrieve the current Vulkan pipeline cache
+		/// @brief Retrieve the current Vulkan pipeline cache, merging in all per-thread caches
+		/// The caches of threads that have exited are destroyed after merging
 		std::vector<std::byte> save_pipeline_cache();
+		/// @brief Load a Vulkan pipeline cache from a file
+		/// @return false if the file could not be read or the data was rejected
+		bool load_pipeline_cache_from_file(std::string_view path);
+		/// @brief Save the current Vulkan pipeline cache to a file
+		/// The data is first written to a temporary file, which then replaces the target, so that the file is never left partially written
+		/// @return false if the file could not be written
+		bool save_pipeline_cache_to_file(std::string_view path);
+		/// @brief Retrieve the pipeline cache to use for pipeline creation on the calling thread
+		VkPipelineCache get_thread_pipeline_cache();
 
 		// Allocator support
 
@@ -203,9 +309,27 @@ namespace vuk {
 
 		/// @brief Descriptor set strategy to use by default, can be overridden on the CommandBuffer
 		DescriptorSetStrategyFlags default_descriptor_set_strategy = {};
+		/// @brief Strategy used to create graphics pipeline instances
+		/// eLibraryFastLink requires the graphicsPipelineLibrary feature to be enabled on the device, otherwise eMonolithic is used
+		GraphicsPipelineStrategy graphics_pipeline_strategy = GraphicsPipelineStrategy::eMonolithic;
+		/// @brief Dynamic state that can be used with the loaded function pointers
+		/// For VK_EXT_extended_dynamic_state3 states, the corresponding device features must be enabled too
+		DynamicStateFlags supported_dynamic_state_flags = {};
+		/// @brief Dynamic state enabled on CommandBuffers by default, can be overridden on the CommandBuffer
+		DynamicStateFlags default_dynamic_state_flags = {};
+		/// @brief Create shader objects for all pipelines, as if PipelineBaseCreateInfo::use_shader_objects was set
+		/// Has no effect if the shaderObject feature is not enabled
+		bool default_use_shader_objects = false;
 		/// @brief Retrieve a unique uint64_t value
 		uint64_t get_unique_handle_id();
 
+		// Memory statistics
+
+		/// @brief Account for allocations made (positive values) or released (negative values) by an allocator
+		void record_allocations(AllocationKind kind, MemoryUsage usage, int64_t count, int64_t bytes) noexcept;
+		/// @brief Get a snapshot of the live allocations and of the memory heaps, for sizing and leak detection
+		MemoryStats get_memory_stats();
+
 		/// @brief Create a wrapped handle type (eg. a ImageView) from an externally sourced Vulkan handle
 		/// @tparam T Vulkan handle type to wrap
 		/// @param payload Vulkan handle to wrap
@@ -5,10 +5,24 @@
 #include "vuk/Value.hpp"
 #include "vuk/runtime/CommandBuffer.hpp"
 #include "vuk/runtime/vk/AllocatorHelpers.hpp"
+#include "vuk/vsl/StagingRing.hpp"
 #include <math.h>
 #include <span>
 
 namespace vuk {
+	/// @brief Copy staged data into a buffer
+	/// @param src Buffer holding the data
+	/// @param dst Buffer to fill
+	inline Value<Buffer> staged_data_to_buffer(const Buffer& src, Buffer dst, VUK_CALLSTACK) {
+		auto src_buf = acquire_buf("_src", src, Access::eNone, VUK_CALL);
+		auto dst_buf = discard_buf("_dst", dst, VUK_CALL);
+		auto pass = make_pass("upload buffer", [](CommandBuffer& command_buffer, VUK_BA(Access::eTransferRead) src, VUK_BA(Access::eTransferWrite) dst) {
+			command_buffer.copy_buffer(src, dst);
+			return dst;
+		});
+		return pass(std::move(src_buf), std::move(dst_buf), VUK_CALL);
+	}
+
 	/// @brief Fill a buffer with host data
 	/// @param allocator Allocator to use for temporary allocations
 	/// @param copy_domain The domain where the copy should happen (when dst is mapped, the copy happens on host)
@@ -25,13 +39,7 @@ namespace vuk {
 		auto src = *allocate_buffer(allocator, BufferCreateInfo{ MemoryUsage::eCPUonly, size, 1 });
 		::memcpy(src->mapped_ptr, src_data, size);
 
-		auto src_buf = acquire_buf("_src", *src, Access::eNone, VUK_CALL);
-		auto dst_buf = discard_buf("_dst", dst, VUK_CALL);
-		auto pass = make_pass("upload buffer", [](CommandBuffer& command_buffer, VUK_BA(Access::eTransferRead) src, VUK_BA(Access::eTransferWrite) dst) {
-			command_buffer.copy_buffer(src, dst);
-			return dst;
-		});
-		return pass(std::move(src_buf), std::move(dst_buf), VUK_CALL);
+		return staged_data_to_buffer(*src, dst, VUK_CALL);
 	}
 
 	/// @brief Fill a buffer with host data
@@ -44,7 +52,41 @@ namespace vuk {
 		return host_data_to_buffer(allocator, copy_domain, dst, data.data(), data.size_bytes(), VUK_CALL);
 	}
 
+	/// @brief Fill a buffer with host data, staged through a StagingRing
+	/// Records a copy pass for this upload alone, many small uploads are better added to an UploadBatch created from the ring
+	/// @param staging StagingRing to stage through, if it is full the staging memory is allocated from its allocator
+	/// @param copy_domain The domain where the copy should happen (when dst is mapped, the copy happens on host)
+	/// @param buffer Buffer to fill
+	/// @param src_data pointer to source data
+	/// @param size size of source data
+	inline Value<Buffer> host_data_to_buffer(StagingRing& staging, DomainFlagBits copy_domain, Buffer dst, const void* src_data, size_t size, VUK_CALLSTACK) {
+		if (dst.mapped_ptr) {
+			memcpy(dst.mapped_ptr, src_data, size);
+			return { acquire_buf("_dst", dst, Access::eNone, VUK_CALL) };
+		}
+
+		auto src = staging.allocate(size, 1);
+		if (!src.holds_value()) {
+			return host_data_to_buffer(staging.get_allocator(), copy_domain, dst, src_data, size, VUK_CALL);
+		}
+		::memcpy(src->mapped_ptr, src_data, size);
+
+		return staged_data_to_buffer(*src, dst, VUK_CALL);
+	}
+
+	/// @brief Fill a buffer with host data, staged through a StagingRing
+	/// Records a copy pass for this upload alone, many small uploads are better added to an UploadBatch created from the ring
+	/// @param staging StagingRing to stage through, if it is full the staging memory is allocated from its allocator
+	/// @param copy_domain The domain where the copy should happen (when dst is mapped, the copy happens on host)
+	/// @param dst Buffer to fill
+	/// @param data source data
+	template<class T>
+	Value<Buffer> host_data_to_buffer(StagingRing& staging, DomainFlagBits copy_domain, Buffer dst, std::span<T> data, VUK_CALLSTACK) {
+		return host_data_to_buffer(staging, copy_domain, dst, data.data(), data.size_bytes(), VUK_CALL);
+	}
+
 	/// @brief Download a buffer to GPUtoCPU memory
+	/// To read back every frame without waiting on the result, use a ReadbackRing instead
 	/// @param buffer_src Buffer to download
 	inline Value<Buffer> download_buffer(Value<Buffer> buffer_src, VUK_CALLSTACK) {
 		auto dst = declare_buf("dst", Buffer{ .memory_usage = MemoryUsage::eGPUtoCPU }, VUK_CALL);
@@ -57,18 +99,10 @@ namespace vuk {
 		return download(std::move(buffer_src), std::move(dst), VUK_CALL);
 	}
 
-	/// @brief Fill an image with host data
-	/// @param allocator Allocator to use for temporary allocations
-	/// @param copy_domain The domain where the copy should happen
+	/// @brief Copy staged data into an image
+	/// @param src Buffer holding the data, tightly packed
 	/// @param image ImageAttachment to fill
-	/// @param src_data pointer to source data
-	inline Value<ImageAttachment>
-	host_data_to_image(Allocator& allocator, DomainFlagBits copy_domain, ImageAttachment image, const void* src_data, VUK_CALLSTACK) {
-		size_t alignment = format_to_texel_block_size(image.format);
-		size_t size = compute_image_size(image.format, image.extent);
-		auto src = *allocate_buffer(allocator, BufferCreateInfo{ MemoryUsage::eCPUonly, size, alignment });
-		::memcpy(src->mapped_ptr, src_data, size);
-
+	inline Value<ImageAttachment> staged_data_to_image(const Buffer& src, ImageAttachment image, VUK_CALLSTACK) {
 		BufferImageCopy bc;
 		bc.imageOffset = { 0, 0, 0 };
 		bc.bufferRowLength = 0;
@@ -79,9 +113,9 @@ namespace vuk {
 		bc.imageSubresource.baseArrayLayer = image.base_layer;
 		assert(image.layer_count == 1); // unsupported yet
 		bc.imageSubresource.layerCount = image.layer_count;
-		bc.bufferOffset = src->offset;
+		bc.bufferOffset = src.offset;
 
-		auto srcbuf = acquire_buf("src", *src, Access::eNone, VUK_CALL);
+		auto srcbuf = acquire_buf("src", src, Access::eNone, VUK_CALL);
 		auto dst = declare_ia("dst", image, VUK_CALL);
 		auto image_upload =
 		    make_pass("image upload", [bc](CommandBuffer& command_buffer, VUK_BA(Access::eTransferRead) src, VUK_IA(Access::eTransferWrite) dst) {
@@ -92,6 +126,66 @@ namespace vuk {
 		return image_upload(std::move(srcbuf), std::move(dst), VUK_CALL);
 	}
 
+	/// @brief Fill an image with host data
+	/// @param allocator Allocator to use for temporary allocations
+	/// @param copy_domain The domain where the copy should happen
+	/// @param image ImageAttachment to fill
+	/// @param src_data pointer to source data
+	inline Value<ImageAttachment>
+	host_data_to_image(Allocator& allocator, DomainFlagBits copy_domain, ImageAttachment image, const void* src_data, VUK_CALLSTACK) {
+		size_t alignment = format_to_texel_block_size(image.format);
+		size_t size = compute_image_size(image.format, image.extent);
+		auto src = *allocate_buffer(allocator, BufferCreateInfo{ MemoryUsage::eCPUonly, size, alignment });
+		::memcpy(src->mapped_ptr, src_data, size);
+
+		return staged_data_to_image(*src, image, VUK_CALL);
+	}
+
+	/// @brief Fill an image with host data in a different format, converted on the host while writing the staging memory
+	/// Large images are converted in chunks on multiple threads (see convert_texels_parallel)
+	/// @param allocator Allocator to use for temporary allocations
+	/// @param copy_domain The domain where the copy should happen
+	/// @param image ImageAttachment to fill
+	/// @param src_format Format of the source data (see can_convert_format)
+	/// @param src_data pointer to source data
+	/// @return The filled image or a FormatConversionException if the source format can't be converted to the format of image
+	inline Result<Value<ImageAttachment>>
+	host_data_to_image(Allocator& allocator, DomainFlagBits copy_domain, ImageAttachment image, Format src_format, const void* src_data, VUK_CALLSTACK) {
+		size_t alignment = format_to_texel_block_size(image.format);
+		size_t size = compute_image_size(image.format, image.extent);
+		auto src = allocate_buffer(allocator, BufferCreateInfo{ MemoryUsage::eCPUonly, size, alignment });
+		if (!src) {
+			return std::move(src);
+		}
+		size_t texel_count = (size_t)image.extent.width * image.extent.height * image.extent.depth;
+		if (!convert_texels_parallel(src_format, src_data, image.format, (*src)->mapped_ptr, texel_count)) {
+			return { expected_error,
+				       FormatConversionException{ std::string("Can't convert texels from ") + std::string(format_to_sv(src_format)) + " to " +
+				                                  std::string(format_to_sv(image.format)) } };
+		}
+
+		return { expected_value, staged_data_to_image(**src, image, VUK_CALL) };
+	}
+
+	/// @brief Fill an image with host data, staged through a StagingRing
+	/// Records a copy pass for this upload alone, many small uploads are better added to an UploadBatch created from the ring
+	/// @param staging StagingRing to stage through, if it is full the staging memory is allocated from its allocator
+	/// @param copy_domain The domain where the copy should happen
+	/// @param image ImageAttachment to fill
+	/// @param src_data pointer to source data
+	inline Value<ImageAttachment>
+	host_data_to_image(StagingRing& staging, DomainFlagBits copy_domain, ImageAttachment image, const void* src_data, VUK_CALLSTACK) {
+		size_t alignment = format_to_texel_block_size(image.format);
+		size_t size = compute_image_size(image.format, image.extent);
+		auto src = staging.allocate(size, alignment);
+		if (!src.holds_value()) {
+			return host_data_to_image(staging.get_allocator(), copy_domain, image, src_data, VUK_CALL);
+		}
+		::memcpy(src->mapped_ptr, src_data, size);
+
+		return staged_data_to_image(*src, image, VUK_CALL);
+	}
+
 	/// @brief Allocates & fills a buffer with explicitly managed lifetime
 	/// @param allocator Allocator to allocate this Buffer from
 	/// @param mem_usage Where to allocate the buffer (host visible buffers will be automatically mapped)
@@ -118,6 +212,37 @@ namespace vuk {
 		return create_image_with_data(allocator, copy_domain, ia, data.data(), VUK_CALL);
 	}
 
+	/// @return The image and its upload or a FormatConversionException if the source format can't be converted to the format of ia
+	inline Result<std::pair<Unique<Image>, Value<ImageAttachment>>>
+	create_image_with_data(Allocator& allocator, DomainFlagBits copy_domain, ImageAttachment& ia, Format src_format, const void* data, VUK_CALLSTACK) {
+		auto image = allocate_image(allocator, ia, VUK_CALL);
+		ia.image = **image;
+		auto uploaded = host_data_to_image(allocator, copy_domain, ia, src_format, data, VUK_CALL);
+		if (!uploaded) {
+			return std::move(uploaded);
+		}
+		return { expected_value, std::move(*image), std::move(*uploaded) };
+	}
+
+	template<class T>
+	Result<std::pair<Unique<Image>, Value<ImageAttachment>>>
+	create_image_with_data(Allocator& allocator, DomainFlagBits copy_domain, ImageAttachment& ia, Format src_format, std::span<T> data, VUK_CALLSTACK) {
+		return create_image_with_data(allocator, copy_domain, ia, src_format, data.data(), VUK_CALL);
+	}
+
+	inline std::pair<Unique<Image>, Value<ImageAttachment>>
+	create_image_with_data(StagingRing& staging, DomainFlagBits copy_domain, ImageAttachment& ia, const void* data, VUK_CALLSTACK) {
+		auto image = allocate_image(staging.get_allocator(), ia, VUK_CALL);
+		ia.image = **image;
+		return { std::move(*image), host_data_to_image(staging, copy_domain, ia, data, VUK_CALL) };
+	}
+
+	template<class T>
+	std::pair<Unique<Image>, Value<ImageAttachment>>
+	create_image_with_data(StagingRing& staging, DomainFlagBits copy_domain, ImageAttachment& ia, std::span<T> data, VUK_CALLSTACK) {
+		return create_image_with_data(staging, copy_domain, ia, data.data(), VUK_CALL);
+	}
+
 	inline std::tuple<Unique<Image>, Unique<ImageView>, Value<ImageAttachment>>
 	create_image_and_view_with_data(Allocator& allocator, DomainFlagBits copy_domain, ImageAttachment& ia, const void* data, VUK_CALLSTACK) {
 		auto image = allocate_image(allocator, ia, VUK_CALL);
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "vuk/RenderGraph.hpp"
+#include "vuk/SourceLocation.hpp"
+#include "vuk/Value.hpp"
+#include "vuk/runtime/CommandBuffer.hpp"
+#include "vuk/runtime/FileReader.hpp"
+#include "vuk/runtime/vk/AllocatorHelpers.hpp"
+
+#include <memory>
+#include <span>
+#include <string>
+
+namespace vuk {
+	namespace detail {
+		// staging memory a file is read into, owned by the pass copying out of it
+		// if the pass is destroyed without running, the read is waited for before the memory is released
+		struct FileStaging {
+			Unique<Buffer> buffer;
+			FileRead read;
+
+			FileStaging(Unique<Buffer> buffer) : buffer(std::move(buffer)) {}
+			FileStaging(const FileStaging&) = delete;
+			FileStaging& operator=(const FileStaging&) = delete;
+
+			~FileStaging() {
+				if (read) {
+					(void)read.wait().holds_value();
+				}
+			}
+		};
+	} // namespace detail
+
+	/// @brief Fill a buffer with ranges of a file, read on the FileReader's thread straight into staging memory
+	/// The read overlaps with recording, the copy waits for it when the graph is submitted - the returned Value must be submitted with the frame of the allocator
+	/// The staging memory is owned by the pass and given back to the allocator when the pass is destroyed, which a frame allocator defers until the frame is recycled
+	/// @param allocator Allocator to use for temporary allocations
+	/// @param reader FileReader to read the file with
+	/// @param dst Buffer to fill, the ranges are packed one after the other
+	/// @param path path of the file
+	/// @param ranges ranges of the file to read
+	inline Value<Buffer>
+	file_to_buffer(Allocator& allocator, FileReader& reader, Buffer dst, std::string path, std::span<const FileRange> ranges, VUK_CALLSTACK) {
+		size_t size = 0;
+		for (auto& range : ranges) {
+			size += range.size;
+		}
+		assert(size <= dst.size);
+		auto staging = std::make_shared<detail::FileStaging>(std::move(*allocate_buffer(allocator, BufferCreateInfo{ MemoryUsage::eCPUonly, size, 1 })));
+		staging->read = reader.read(std::move(path), ranges, staging->buffer->mapped_ptr);
+
+		auto src_buf = acquire_buf("_src", *staging->buffer, Access::eNone, VUK_CALL);
+		auto dst_buf = discard_buf("_dst", dst, VUK_CALL);
+		auto pass = make_pass("upload file", [staging](CommandBuffer& command_buffer, VUK_BA(Access::eTransferRead) src, VUK_BA(Access::eTransferWrite) dst) {
+			if (auto res = staging->read.wait(); !res) {
+				res.error().throw_this();
+			}
+			BufferCopy region{ .srcOffset = 0, .dstOffset = 0, .size = src->size };
+			command_buffer.copy_buffer(src, dst, std::span{ &region, 1 });
+			return dst;
+		});
+		return pass(std::move(src_buf), std::move(dst_buf), VUK_CALL);
+	}
+
+	/// @brief Fill an image with a range of a file, read on the FileReader's thread straight into staging memory
+	/// The read overlaps with recording, the copy waits for it when the graph is submitted - the returned Value must be submitted with the frame of the allocator
+	/// The staging memory is owned by the pass and given back to the allocator when the pass is destroyed, which a frame allocator defers until the frame is recycled
+	/// @param allocator Allocator to use for temporary allocations
+	/// @param reader FileReader to read the file with
+	/// @param image ImageAttachment to fill
+	/// @param path path of the file
+	/// @param offset offset of the tightly packed image data in the file
+	inline Value<ImageAttachment>
+	file_to_image(Allocator& allocator, FileReader& reader, ImageAttachment image, std::string path, uint64_t offset, VUK_CALLSTACK) {
+		size_t alignment = format_to_texel_block_size(image.format);
+		size_t size = compute_image_size(image.format, image.extent);
+		auto staging = std::make_shared<detail::FileStaging>(std::move(*allocate_buffer(allocator, BufferCreateInfo{ MemoryUsage::eCPUonly, size, alignment })));
+		FileRange range{ offset, size };
+		staging->read = reader.read(std::move(path), std::span{ &range, 1 }, staging->buffer->mapped_ptr);
+
+		BufferImageCopy bc;
+		bc.imageOffset = { 0, 0, 0 };
+		bc.bufferRowLength = 0;
+		bc.bufferImageHeight = 0;
+		bc.imageExtent = image.extent;
+		bc.imageSubresource.aspectMask = format_to_aspect(image.format);
+		bc.imageSubresource.mipLevel = image.base_level;
+		bc.imageSubresource.baseArrayLayer = image.base_layer;
+		assert(image.layer_count == 1); // unsupported yet
+		bc.imageSubresource.layerCount = image.layer_count;
+		bc.bufferOffset = staging->buffer->offset;
+
+		auto srcbuf = acquire_buf("src", *staging->buffer, Access::eNone, VUK_CALL);
+		auto dst = declare_ia("dst", image, VUK_CALL);
+		auto image_upload =
+		    make_pass("upload file", [staging, bc](CommandBuffer& command_buffer, VUK_BA(Access::eTransferRead) src, VUK_IA(Access::eTransferWrite) dst) {
+			    if (auto res = staging->read.wait(); !res) {
+				    res.error().throw_this();
+			    }
+			    command_buffer.copy_buffer_to_image(src, dst, bc);
+			    return dst;
+		    });
+
+		return image_upload(std::move(srcbuf), std::move(dst), VUK_CALL);
+	}
+} // namespace vuk
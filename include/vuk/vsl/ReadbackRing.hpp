@@ -0,0 +1,222 @@
+#pragma once
+
+#include "vuk/RenderGraph.hpp"
+#include "vuk/SourceLocation.hpp"
+#include "vuk/Value.hpp"
+#include "vuk/runtime/CommandBuffer.hpp"
+#include "vuk/runtime/vk/AllocatorHelpers.hpp"
+
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace vuk {
+	class ReadbackRing;
+
+	/// @brief Handle to data being read back through a ReadbackRing
+	struct Readback {
+		ReadbackRing* ring = nullptr;
+		uint64_t id = ~0ULL;
+
+		explicit operator bool() const noexcept {
+			return ring != nullptr;
+		}
+	};
+
+	/// @brief A persistently mapped ring buffer to read back GPU data through, without waiting for the work producing it.
+	///
+	/// read() records a copy into the ring and returns a Readback handle. After submit(), the handle can be polled with ready() or given a callback with
+	/// on_ready() that is invoked from update() once the timeline semaphore of the copy has passed. The data stays valid until the handle is released.
+	/// When the ring is full, read() fails instead of waiting.
+	///
+	/// Example usage:
+	/// @code
+	/// ReadbackRing readbacks(allocator, 1024 * 1024);
+	/// // each frame
+	/// auto counts = *readbacks.read(std::move(culling_counts), sizeof(uint32_t) * 64);
+	/// readbacks.on_ready(counts, [](std::span<const std::byte> data) { ... });
+	/// readbacks.submit(frame_allocator, compiler);
+	/// readbacks.update();
+	/// @endcode
+	class ReadbackRing {
+	public:
+		using Callback = std::function<void(std::span<const std::byte>)>;
+
+		/// @brief Create a ring
+		/// @param allocator Allocator to allocate the ring from
+		/// @param size Size of the ring in bytes
+		ReadbackRing(Allocator& allocator, size_t size) :
+		    ring(*allocate_buffer(allocator, BufferCreateInfo{ MemoryUsage::eGPUtoCPU, size, 16 })),
+		    capacity(size) {}
+
+		ReadbackRing(const ReadbackRing&) = delete;
+		ReadbackRing& operator=(const ReadbackRing&) = delete;
+
+		/// @brief Record a copy of the beginning of a buffer into the ring
+		/// @param src Buffer to read back
+		/// @param size number of bytes to read back
+		/// @return Handle to the data or an error if the ring does not have enough free space
+		Result<Readback, AllocateException> read(Value<Buffer> src, size_t size, VUK_CALLSTACK) {
+			std::scoped_lock _(mutex);
+			uint64_t begin = (head + 15) / 16 * 16;
+			// readbacks don't wrap around, start again from the beginning of the ring instead
+			if (begin % capacity + size > capacity) {
+				begin = (begin + capacity - 1) / capacity * capacity;
+			}
+			if (size > capacity || begin + size - tail > capacity) {
+				return { expected_error, AllocateException{ VK_ERROR_OUT_OF_DEVICE_MEMORY } };
+			}
+			head = begin + size;
+
+			Buffer dst = ring->add_offset(begin % capacity);
+			dst.size = size;
+			auto readback = make_pass("readback", [size](CommandBuffer& command_buffer, VUK_BA(Access::eTransferRead) src, VUK_BA(Access::eTransferWrite) dst) {
+				BufferCopy region{ .srcOffset = 0, .dstOffset = 0, .size = size };
+				command_buffer.copy_buffer(src, dst, std::span{ &region, 1 });
+				return dst;
+			});
+			auto value = readback(std::move(src), discard_buf("readback", dst, VUK_CALL), VUK_CALL);
+
+			entries.push_back(Entry{ std::move(value), dst.mapped_ptr, size, head, {} });
+			return { expected_value, Readback{ this, first_id + entries.size() - 1 } };
+		}
+
+		/// @brief Submit the copies recorded since the last submit, without waiting for them
+		Result<void> submit(Allocator& allocator, Compiler& compiler, RenderGraphCompileOptions options = {}) {
+			std::vector<UntypedValue> to_submit;
+			std::scoped_lock _(mutex);
+			for (auto& entry : entries) {
+				if (!entry.submitted) {
+					to_submit.push_back(entry.value);
+				}
+			}
+			if (to_submit.empty()) {
+				return { expected_value };
+			}
+			VUK_DO_OR_RETURN(vuk::submit(allocator, compiler, std::span(to_submit), options));
+			for (auto& entry : entries) {
+				entry.submitted = true;
+			}
+			return { expected_value };
+		}
+
+		/// @brief Check if the data of a readback has arrived, never waits
+		Result<bool> ready(Readback readback) {
+			std::scoped_lock _(mutex);
+			return poll(get(readback));
+		}
+
+		/// @brief Get the data of a readback, only valid if ready() returned true and until the readback is released
+		std::span<const std::byte> data(Readback readback) {
+			std::scoped_lock _(mutex);
+			auto& entry = get(readback);
+			assert(entry.complete);
+			return { entry.mapped_ptr, entry.size };
+		}
+
+		/// @brief Invoke a callback from update() once the data of a readback has arrived
+		/// The readback is released after the callback returns
+		void on_ready(Readback readback, Callback callback) {
+			std::scoped_lock _(mutex);
+			auto& entry = get(readback);
+			entry.callback = std::move(callback);
+			entry.released = true;
+		}
+
+		/// @brief Release a readback, allowing its memory to be reused once the copy has completed
+		void release(Readback readback) {
+			std::scoped_lock _(mutex);
+			get(readback).released = true;
+			reclaim();
+		}
+
+		/// @brief Poll the readbacks in flight, invoking the callbacks of the ones that arrived and reclaiming released memory
+		Result<void> update() {
+			std::vector<std::pair<Entry*, Callback>> arrived;
+			{
+				std::scoped_lock _(mutex);
+				for (auto& entry : entries) {
+					auto res = poll(entry);
+					if (!res) {
+						return res;
+					}
+					// the callback is taken out under the lock, so concurrent updates never invoke it twice
+					if (*res && entry.callback) {
+						entry.pinned = true;
+						arrived.emplace_back(&entry, std::move(entry.callback));
+						entry.callback = {};
+					}
+				}
+			}
+			// callbacks are invoked without holding the lock, pinned entries are not reclaimed until their callback has run
+			for (auto& [entry, callback] : arrived) {
+				callback(std::span<const std::byte>{ entry->mapped_ptr, entry->size });
+			}
+			std::scoped_lock _(mutex);
+			for (auto& [entry, callback] : arrived) {
+				entry->pinned = false;
+			}
+			reclaim();
+			return { expected_value };
+		}
+
+		/// @brief Bytes that can be read back before the ring is full, not accounting for alignment and wrapping
+		size_t available() {
+			std::scoped_lock _(mutex);
+			return capacity - (head - tail);
+		}
+
+	private:
+		struct Entry {
+			Value<Buffer> value;
+			std::byte* mapped_ptr;
+			size_t size;
+			// position of the end of this readback in the ring
+			uint64_t end;
+			Callback callback;
+			// set while the callback is running
+			bool pinned = false;
+			bool submitted = false;
+			bool complete = false;
+			bool released = false;
+		};
+
+		Entry& get(Readback readback) {
+			assert(readback.ring == this && readback.id >= first_id && readback.id - first_id < entries.size());
+			return entries[readback.id - first_id];
+		}
+
+		Result<bool> poll(Entry& entry) {
+			if (entry.submitted && !entry.complete) {
+				auto status = entry.value.poll();
+				if (!status) {
+					return status;
+				}
+				entry.complete = *status == Signal::Status::eHostAvailable;
+			}
+			return { expected_value, entry.complete };
+		}
+
+		// readbacks complete in order of submission, but can be released in any order - memory is reclaimed up to the oldest one still in use
+		void reclaim() {
+			while (!entries.empty() && entries.front().complete && entries.front().released && !entries.front().callback && !entries.front().pinned) {
+				tail = entries.front().end;
+				entries.pop_front();
+				first_id++;
+			}
+		}
+
+		Unique<Buffer> ring;
+		size_t capacity;
+
+		std::mutex mutex;
+		// monotonic positions, the ring offset is position % capacity
+		uint64_t head = 0;
+		uint64_t tail = 0;
+		std::deque<Entry> entries;
+		uint64_t first_id = 0;
+	};
+} // namespace vuk
@@ -0,0 +1,152 @@
+#pragma once
+
+#include "vuk/Buffer.hpp"
+#include "vuk/runtime/vk/Allocator.hpp"
+#include "vuk/runtime/vk/AllocatorHelpers.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <optional>
+
+namespace vuk {
+	/// @brief A persistently mapped ring buffer to stage uploads through, instead of allocating a staging buffer per upload.
+	///
+	/// Memory handed out is reused once `frames_in_flight` more frames have been started with next_frame(), by when the frames using it have been waited on.
+	/// When the ring is full, allocate() fails instead of waiting - check available() to throttle streaming, or let the upload helpers fall back to
+	/// allocating staging memory from the allocator. A thread streaming besides the one calling next_frame() can apply back-pressure with
+	/// allocate_blocking(), which waits for next_frame() to reclaim enough memory.
+	///
+	/// The host_data_to_X helpers record a copy pass per upload. To stage many uploads in one allocation from the ring and copy them in one pass,
+	/// add them to an UploadBatch created from the ring.
+	///
+	/// Requirements:
+	/// - Allocator must wrap a DeviceSuperFrameResource for persistent resource lifetime
+	/// - next_frame() must be called once per frame, after DeviceSuperFrameResource::get_next_frame()
+	///
+	/// Example usage:
+	/// @code
+	/// StagingRing staging(allocator, 64 * 1024 * 1024, 3);
+	/// // each frame
+	/// auto& frame_resource = superframe_resource.get_next_frame();
+	/// staging.next_frame();
+	/// auto uploaded = host_data_to_buffer(staging, DomainFlagBits::eAny, dst, std::span(data));
+	/// @endcode
+	class StagingRing {
+	public:
+		/// @brief Create a ring
+		/// @param allocator Allocator to allocate the ring from, and to allocate staging memory from when the ring is full
+		/// @param size Size of the ring in bytes
+		/// @param frames_in_flight Number of frames in flight of the DeviceSuperFrameResource
+		StagingRing(Allocator& allocator, size_t size, uint32_t frames_in_flight) :
+		    allocator(allocator),
+		    ring(*allocate_buffer(allocator, BufferCreateInfo{ MemoryUsage::eCPUonly, size, 256 })),
+		    capacity(size),
+		    frames_in_flight(frames_in_flight) {}
+
+		StagingRing(const StagingRing&) = delete;
+		StagingRing& operator=(const StagingRing&) = delete;
+
+		/// @brief Allocate mapped staging memory from the ring, valid until the frame it was allocated in is recycled
+		/// @return The staging memory or an error if the ring does not have enough free space
+		Result<Buffer, AllocateException> allocate(size_t size, size_t alignment) {
+			std::scoped_lock _(mutex);
+			if (auto staging = try_allocate(size, alignment)) {
+				return { expected_value, *staging };
+			}
+			return { expected_error, AllocateException{ VK_ERROR_OUT_OF_DEVICE_MEMORY } };
+		}
+
+		/// @brief Allocate mapped staging memory from the ring, waiting for next_frame() to reclaim memory if the ring is full
+		/// Must not be called on the thread that calls next_frame(), as it would wait forever.
+		/// @return The staging memory or an error if the allocation can never fit into the ring
+		Result<Buffer, AllocateException> allocate_blocking(size_t size, size_t alignment) {
+			std::unique_lock lock(mutex);
+			if (align_up(ring->offset, alignment) - ring->offset + size > capacity) {
+				return { expected_error, AllocateException{ VK_ERROR_OUT_OF_DEVICE_MEMORY } };
+			}
+			std::optional<Buffer> staging;
+			reclaimed.wait(lock, [&] {
+				staging = try_allocate(size, alignment);
+				return staging.has_value();
+			});
+			return { expected_value, *staging };
+		}
+
+		/// @brief Bytes that can be allocated before the ring is full, not accounting for alignment and wrapping
+		size_t available() {
+			std::scoped_lock _(mutex);
+			return capacity - (head - tail);
+		}
+
+		/// @brief Start a new frame, reclaiming the memory of the frame started `frames_in_flight` frames ago
+		void next_frame() {
+			{
+				std::scoped_lock _(mutex);
+				frame_heads.push_back(head);
+				if (frame_heads.size() > frames_in_flight) {
+					tail = frame_heads.front();
+					frame_heads.pop_front();
+				}
+			}
+			reclaimed.notify_all();
+		}
+
+		Allocator& get_allocator() {
+			return allocator;
+		}
+
+	private:
+		static uint64_t align_up(uint64_t value, uint64_t alignment) {
+			return (value + alignment - 1) / alignment * alignment;
+		}
+
+		// must be called with the mutex held
+		std::optional<Buffer> try_allocate(size_t size, size_t alignment) {
+			if (auto staging = try_allocate_at_head(size, alignment)) {
+				return staging;
+			}
+			// nothing is in flight in an empty ring, so it can start over from the beginning - anything that fits the ring is allocated once it drains
+			if (head == tail && head % capacity != 0) {
+				head = tail = align_up(head, capacity);
+				std::fill(frame_heads.begin(), frame_heads.end(), head);
+				return try_allocate_at_head(size, alignment);
+			}
+			return {};
+		}
+
+		std::optional<Buffer> try_allocate_at_head(size_t size, size_t alignment) {
+			// the alignment applies to the offset in the VkBuffer, which the ring is only a part of
+			uint64_t lap = head / capacity * capacity;
+			uint64_t offset = align_up(ring->offset + (head - lap), alignment) - ring->offset;
+			// allocations don't wrap around, start again from the beginning of the ring instead
+			if (offset + size > capacity) {
+				lap += capacity;
+				offset = align_up(ring->offset, alignment) - ring->offset;
+			}
+			uint64_t begin = lap + offset;
+			if (offset + size > capacity || begin + size - tail > capacity) {
+				return {};
+			}
+			head = begin + size;
+
+			Buffer staging = ring->add_offset(offset);
+			staging.size = size;
+			return staging;
+		}
+
+		Allocator& allocator;
+		Unique<Buffer> ring;
+		size_t capacity;
+		uint32_t frames_in_flight;
+
+		std::mutex mutex;
+		std::condition_variable reclaimed;
+		// monotonic positions, the ring offset is position % capacity
+		uint64_t head = 0;
+		uint64_t tail = 0;
+		// head at the start of each frame still in flight
+		std::deque<uint64_t> frame_heads;
+	};
+} // namespace vuk
@@ -0,0 +1,255 @@
+#pragma once
+
+#include "vuk/RenderGraph.hpp"
+#include "vuk/SourceLocation.hpp"
+#include "vuk/Value.hpp"
+#include "vuk/runtime/CommandBuffer.hpp"
+#include "vuk/runtime/vk/AllocatorHelpers.hpp"
+#include "vuk/vsl/StagingRing.hpp"
+
+#include <cstring>
+#include <numeric>
+#include <optional>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace vuk {
+	/// @brief Collects many uploads, to be staged through a single staging allocation and copied in a single pass.
+	///
+	/// Every upload into the same Buffer is merged into one copy with multiple regions, and every mip level of an image is copied with one command.
+	/// The host data is copied into staging memory on record(), so it needs to be kept alive until then.
+	///
+	/// Example usage:
+	/// @code
+	/// UploadBatch batch(allocator);
+	/// auto vertices = batch.add(vertex_buffer, std::span(vertex_data));
+	/// auto albedo = batch.add(albedo_ia, albedo_pixels.data());
+	/// auto uploads = batch.record();
+	/// auto albedo_uploaded = std::move(uploads.images[albedo]);
+	/// @endcode
+	class UploadBatch {
+	public:
+		/// @brief Values of the uploaded destinations, indexed by the indices returned from add()
+		struct Uploads {
+			std::vector<Value<Buffer>> buffers;
+			std::vector<Value<ImageAttachment>> images;
+		};
+
+		/// @brief Create a batch that allocates its staging memory from an allocator
+		explicit UploadBatch(Allocator& allocator) : allocator(allocator) {}
+		/// @brief Create a batch that stages through a StagingRing, allocating from its allocator when the ring is full
+		explicit UploadBatch(StagingRing& staging) : allocator(staging.get_allocator()), staging(&staging) {}
+
+		/// @brief Add an upload of host data into a buffer
+		/// @param dst Buffer to fill
+		/// @param src_data pointer to source data, must be valid until record()
+		/// @param size size of source data
+		/// @param dst_offset offset in dst to write to
+		/// @return Index of dst in Uploads::buffers
+		size_t add(Buffer dst, const void* src_data, size_t size, size_t dst_offset = 0) {
+			assert(dst_offset + size <= dst.size);
+			auto [it, inserted] = buffer_indices.try_emplace(dst, buffer_dsts.size());
+			if (inserted) {
+				buffer_dsts.push_back(BufferDestination{ dst, {} });
+			}
+			auto staging_offset = stage(src_data, size, 1);
+			buffer_dsts[it->second].regions.push_back(BufferCopy{ .srcOffset = staging_offset, .dstOffset = dst_offset, .size = size });
+			return it->second;
+		}
+
+		/// @brief Add an upload of host data into a buffer
+		/// @param dst Buffer to fill
+		/// @param data source data, must be valid until record()
+		/// @param dst_offset offset in dst to write to
+		/// @return Index of dst in Uploads::buffers
+		template<class T>
+		size_t add(Buffer dst, std::span<T> data, size_t dst_offset = 0) {
+			return add(dst, data.data(), data.size_bytes(), dst_offset);
+		}
+
+		/// @brief Add an upload of host data into all the mip levels and layers of an image
+		/// @param dst ImageAttachment to fill
+		/// @param src_data pointer to source data, tightly packed mip level after mip level with all layers of a level together, must be valid until
+		/// record()
+		/// @return Index of dst in Uploads::images
+		size_t add(ImageAttachment dst, const void* src_data) {
+			return add(dst, dst.format, src_data);
+		}
+
+		/// @brief Add an upload of host data in a different format into all the mip levels and layers of an image, converted when writing the staging
+		/// memory
+		/// @param dst ImageAttachment to fill
+		/// @param src_format Format of the source data, must be convertible to the format of dst (see can_convert_format)
+		/// @param src_data pointer to source data, tightly packed mip level after mip level with all layers of a level together, must be valid until
+		/// record()
+		/// @return Index of dst in Uploads::images
+		size_t add(ImageAttachment dst, Format src_format, const void* src_data) {
+			assert(dst.level_count != VK_REMAINING_MIP_LEVELS && dst.layer_count != VK_REMAINING_ARRAY_LAYERS);
+			assert(can_convert_format(src_format, dst.format));
+			size_t alignment = std::lcm<size_t>(format_to_texel_block_size(dst.format), 4);
+			ImageDestination destination{ dst, {} };
+			auto data = static_cast<const std::byte*>(src_data);
+			for (uint32_t level = dst.base_level; level < dst.base_level + dst.level_count; level++) {
+				Extent3D extent = { std::max(1u, dst.extent.width >> level), std::max(1u, dst.extent.height >> level), std::max(1u, dst.extent.depth >> level) };
+				size_t size = (size_t)compute_image_size(dst.format, extent) * dst.layer_count;
+
+				BufferImageCopy bc;
+				if (src_format == dst.format) {
+					bc.bufferOffset = stage(data, size, alignment);
+					data += size;
+				} else {
+					size_t texel_count = (size_t)extent.width * extent.height * extent.depth * dst.layer_count;
+					bc.bufferOffset = stage(data, size, alignment, src_format, dst.format, texel_count);
+					data += texel_count * format_to_texel_block_size(src_format);
+				}
+				bc.imageExtent = extent;
+				bc.imageSubresource.aspectMask = format_to_aspect(dst.format);
+				bc.imageSubresource.mipLevel = level;
+				bc.imageSubresource.baseArrayLayer = dst.base_layer;
+				bc.imageSubresource.layerCount = dst.layer_count;
+				destination.regions.push_back(bc);
+			}
+			image_dsts.push_back(std::move(destination));
+			return image_dsts.size() - 1;
+		}
+
+		/// @brief Add an upload of host data into all the mip levels and layers of an image
+		/// @param dst ImageAttachment to fill
+		/// @param data source data, must be valid until record()
+		/// @return Index of dst in Uploads::images
+		template<class T>
+		size_t add(ImageAttachment dst, std::span<T> data) {
+			return add(dst, data.data());
+		}
+
+		/// @brief Size of staging memory needed for the uploads added so far
+		size_t staging_size() const {
+			return total_size;
+		}
+
+		/// @brief Copy all the added uploads into staging memory and record the copies into a single pass
+		/// @return Values of the filled destinations, the batch is empty afterwards
+		Uploads record(VUK_CALLSTACK) {
+			Uploads uploads;
+			if (buffer_dsts.empty() && image_dsts.empty()) {
+				return uploads;
+			}
+
+			// staging memory from the ring when we have one and it has space, otherwise a fresh allocation that lives for the frame
+			std::optional<Buffer> from_ring;
+			if (staging) {
+				if (auto res = staging->allocate(total_size, staging_alignment); res.holds_value()) {
+					from_ring = *res;
+				}
+			}
+			Unique<Buffer> allocated(allocator);
+			if (!from_ring) {
+				allocated = std::move(*allocate_buffer(allocator, BufferCreateInfo{ MemoryUsage::eCPUonly, total_size, staging_alignment }));
+			}
+			Buffer src = from_ring ? *from_ring : *allocated;
+
+			for (auto& pending : pending_copies) {
+				if (pending.src_format != Format::eUndefined) {
+					convert_texels_parallel(pending.src_format, pending.src_data, pending.dst_format, src.mapped_ptr + pending.staging_offset, pending.texel_count);
+				} else {
+					::memcpy(src.mapped_ptr + pending.staging_offset, pending.src_data, pending.size);
+				}
+			}
+
+			std::vector<Value<Buffer>> buffer_values;
+			std::vector<std::vector<BufferCopy>> buffer_regions;
+			for (auto& dst : buffer_dsts) {
+				buffer_values.push_back(discard_buf("_dst", dst.dst, VUK_CALL));
+				buffer_regions.push_back(std::move(dst.regions));
+			}
+			std::vector<Value<ImageAttachment>> image_values;
+			std::vector<std::vector<BufferImageCopy>> image_regions;
+			for (auto& dst : image_dsts) {
+				image_values.push_back(declare_ia("_dst", dst.dst, VUK_CALL));
+				// image copies address the VkBuffer, not the staging Buffer
+				for (auto& region : dst.regions) {
+					region.bufferOffset += src.offset;
+				}
+				image_regions.push_back(std::move(dst.regions));
+			}
+
+			auto src_buf = acquire_buf("_src", src, Access::eNone, VUK_CALL);
+			auto buffers = declare_array("_dst_buffers", std::span(buffer_values), VUK_CALL);
+			auto images = declare_array("_dst_images", std::span(image_values), VUK_CALL);
+			using DstBuffers = VUK_ARG(Buffer[], Access::eTransferWrite);
+			using DstImages = VUK_ARG(ImageAttachment[], Access::eTransferWrite);
+			auto pass = make_pass("upload batch",
+			                      [buffer_regions = std::move(buffer_regions), image_regions = std::move(image_regions)](
+			                          CommandBuffer& command_buffer, VUK_BA(Access::eTransferRead) src, DstBuffers buffers, DstImages images) {
+				                      for (size_t i = 0; i < buffers.size(); i++) {
+					                      command_buffer.copy_buffer(src, buffers[i], buffer_regions[i]);
+				                      }
+				                      for (size_t i = 0; i < images.size(); i++) {
+					                      command_buffer.copy_buffer_to_image(src, images[i], image_regions[i]);
+				                      }
+				                      return std::make_tuple(buffers, images);
+			                      });
+			auto [filled_buffers, filled_images] = pass(std::move(src_buf), std::move(buffers), std::move(images), VUK_CALL);
+			for (size_t i = 0; i < buffer_values.size(); i++) {
+				uploads.buffers.push_back(filled_buffers[i]);
+			}
+			for (size_t i = 0; i < image_values.size(); i++) {
+				uploads.images.push_back(filled_images[i]);
+			}
+
+			buffer_dsts.clear();
+			buffer_indices.clear();
+			image_dsts.clear();
+			pending_copies.clear();
+			total_size = 0;
+			staging_alignment = 1;
+			return uploads;
+		}
+
+	private:
+		struct BufferDestination {
+			Buffer dst;
+			std::vector<BufferCopy> regions;
+		};
+
+		struct ImageDestination {
+			ImageAttachment dst;
+			std::vector<BufferImageCopy> regions;
+		};
+
+		struct PendingCopy {
+			const void* src_data;
+			size_t size;
+			size_t staging_offset;
+			// converted from src_format if not eUndefined
+			Format src_format = Format::eUndefined;
+			Format dst_format = Format::eUndefined;
+			size_t texel_count = 0;
+		};
+
+		// reserves space in the staging memory, returning the offset the data will be copied to
+		size_t stage(const void* src_data,
+		             size_t size,
+		             size_t alignment,
+		             Format src_format = Format::eUndefined,
+		             Format dst_format = Format::eUndefined,
+		             size_t texel_count = 0) {
+			size_t offset = (total_size + alignment - 1) / alignment * alignment;
+			pending_copies.push_back(PendingCopy{ src_data, size, offset, src_format, dst_format, texel_count });
+			total_size = offset + size;
+			staging_alignment = std::lcm(staging_alignment, alignment);
+			return offset;
+		}
+
+		Allocator& allocator;
+		StagingRing* staging = nullptr;
+
+		std::vector<BufferDestination> buffer_dsts;
+		std::unordered_map<Buffer, size_t> buffer_indices;
+		std::vector<ImageDestination> image_dsts;
+		std::vector<PendingCopy> pending_copies;
+		size_t total_size = 0;
+		size_t staging_alignment = 1;
+	};
+} // namespace vuk
@@ -1,5 +1,14 @@
 #include "vuk/runtime/vk/Image.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
 #include <cassert>
+#include <cmath>
+#include <cstring>
+#include <optional>
+#include <thread>
+#include <vector>
 
 namespace vuk {
 	uint32_t format_to_texel_block_size(Format format) noexcept {
@@ -1169,6 +1178,354 @@ namespace vuk {
 		}
 	}
 
+	namespace {
+		enum class ChannelType { eUnorm8, eSnorm8, eUint8, eSint8, eSrgb8, eSfloat16, eSfloat32 };
+
+		struct TexelLayout {
+			ChannelType type;
+			uint32_t channel_count;
+			// memory position of the R, G, B, A channels
+			std::array<uint8_t, 4> position = { 0, 1, 2, 3 };
+		};
+
+		constexpr std::array<uint8_t, 4> bgra = { 2, 1, 0, 3 };
+
+		std::optional<TexelLayout> texel_layout(Format format) noexcept {
+			switch (format) {
+			case Format::eR8Unorm:
+				return TexelLayout{ ChannelType::eUnorm8, 1 };
+			case Format::eR8G8Unorm:
+				return TexelLayout{ ChannelType::eUnorm8, 2 };
+			case Format::eR8G8B8Unorm:
+				return TexelLayout{ ChannelType::eUnorm8, 3 };
+			case Format::eB8G8R8Unorm:
+				return TexelLayout{ ChannelType::eUnorm8, 3, bgra };
+			case Format::eR8G8B8A8Unorm:
+				return TexelLayout{ ChannelType::eUnorm8, 4 };
+			case Format::eB8G8R8A8Unorm:
+				return TexelLayout{ ChannelType::eUnorm8, 4, bgra };
+			case Format::eR8G8B8Snorm:
+				return TexelLayout{ ChannelType::eSnorm8, 3 };
+			case Format::eB8G8R8Snorm:
+				return TexelLayout{ ChannelType::eSnorm8, 3, bgra };
+			case Format::eR8G8B8A8Snorm:
+				return TexelLayout{ ChannelType::eSnorm8, 4 };
+			case Format::eB8G8R8A8Snorm:
+				return TexelLayout{ ChannelType::eSnorm8, 4, bgra };
+			case Format::eR8G8B8Uint:
+				return TexelLayout{ ChannelType::eUint8, 3 };
+			case Format::eB8G8R8Uint:
+				return TexelLayout{ ChannelType::eUint8, 3, bgra };
+			case Format::eR8G8B8A8Uint:
+				return TexelLayout{ ChannelType::eUint8, 4 };
+			case Format::eB8G8R8A8Uint:
+				return TexelLayout{ ChannelType::eUint8, 4, bgra };
+			case Format::eR8G8B8Sint:
+				return TexelLayout{ ChannelType::eSint8, 3 };
+			case Format::eB8G8R8Sint:
+				return TexelLayout{ ChannelType::eSint8, 3, bgra };
+			case Format::eR8G8B8A8Sint:
+				return TexelLayout{ ChannelType::eSint8, 4 };
+			case Format::eB8G8R8A8Sint:
+				return TexelLayout{ ChannelType::eSint8, 4, bgra };
+			case Format::eR8Srgb:
+				return TexelLayout{ ChannelType::eSrgb8, 1 };
+			case Format::eR8G8Srgb:
+				return TexelLayout{ ChannelType::eSrgb8, 2 };
+			case Format::eR8G8B8Srgb:
+				return TexelLayout{ ChannelType::eSrgb8, 3 };
+			case Format::eB8G8R8Srgb:
+				return TexelLayout{ ChannelType::eSrgb8, 3, bgra };
+			case Format::eR8G8B8A8Srgb:
+				return TexelLayout{ ChannelType::eSrgb8, 4 };
+			case Format::eB8G8R8A8Srgb:
+				return TexelLayout{ ChannelType::eSrgb8, 4, bgra };
+			case Format::eR16Sfloat:
+				return TexelLayout{ ChannelType::eSfloat16, 1 };
+			case Format::eR16G16Sfloat:
+				return TexelLayout{ ChannelType::eSfloat16, 2 };
+			case Format::eR16G16B16Sfloat:
+				return TexelLayout{ ChannelType::eSfloat16, 3 };
+			case Format::eR16G16B16A16Sfloat:
+				return TexelLayout{ ChannelType::eSfloat16, 4 };
+			case Format::eR32Sfloat:
+				return TexelLayout{ ChannelType::eSfloat32, 1 };
+			case Format::eR32G32Sfloat:
+				return TexelLayout{ ChannelType::eSfloat32, 2 };
+			case Format::eR32G32B32Sfloat:
+				return TexelLayout{ ChannelType::eSfloat32, 3 };
+			case Format::eR32G32B32A32Sfloat:
+				return TexelLayout{ ChannelType::eSfloat32, 4 };
+			default:
+				return {};
+			}
+		}
+
+		bool is_byte_channel(ChannelType type) noexcept {
+			return type != ChannelType::eSfloat16 && type != ChannelType::eSfloat32;
+		}
+
+		// value of the channels missing from the source: 0 for colors, 1 for alpha
+		uint8_t byte_fill(ChannelType type, uint32_t channel) noexcept {
+			if (channel < 3) {
+				return 0;
+			}
+			switch (type) {
+			case ChannelType::eUnorm8:
+			case ChannelType::eSrgb8:
+				return 0xff;
+			case ChannelType::eSnorm8:
+				return 0x7f;
+			default:
+				return 1;
+			}
+		}
+
+		// the conversions are branchless so that the loops using them vectorize
+		// based on https://github.com/Maratyszcza/FP16
+		uint16_t float_to_half(float f) noexcept {
+			const float scale_to_inf = 0x1.0p+112f;
+			const float scale_to_zero = 0x1.0p-110f;
+			float base = (std::fabs(f) * scale_to_inf) * scale_to_zero;
+
+			const uint32_t w = std::bit_cast<uint32_t>(f);
+			const uint32_t shl1_w = w + w;
+			const uint32_t sign = w & 0x80000000u;
+			uint32_t bias = shl1_w & 0xff000000u;
+			bias = bias < 0x71000000u ? 0x71000000u : bias;
+
+			base = std::bit_cast<float>((bias >> 1) + 0x07800000u) + base;
+			const uint32_t bits = std::bit_cast<uint32_t>(base);
+			const uint32_t exp_bits = (bits >> 13) & 0x00007c00u;
+			const uint32_t mantissa_bits = bits & 0x00000fffu;
+			const uint32_t nonsign = exp_bits + mantissa_bits;
+			return (uint16_t)((sign >> 16) | (shl1_w > 0xff000000u ? 0x7e00u : nonsign));
+		}
+
+		float half_to_float(uint16_t h) noexcept {
+			const uint32_t w = (uint32_t)h << 16;
+			const uint32_t sign = w & 0x80000000u;
+			const uint32_t two_w = w + w;
+
+			const float normalized = std::bit_cast<float>((two_w >> 4) + (0xe0u << 23)) * 0x1.0p-112f;
+			const float denormalized = std::bit_cast<float>((two_w >> 17) | (126u << 23)) - 0.5f;
+			const uint32_t result = sign | (two_w < (1u << 27) ? std::bit_cast<uint32_t>(denormalized) : std::bit_cast<uint32_t>(normalized));
+			return std::bit_cast<float>(result);
+		}
+
+		const std::array<float, 256>& srgb_to_linear_table() noexcept {
+			static const std::array<float, 256> table = [] {
+				std::array<float, 256> t;
+				for (uint32_t i = 0; i < 256; i++) {
+					float c = i / 255.f;
+					t[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+				}
+				return t;
+			}();
+			return table;
+		}
+
+		// reorders, drops and adds 8 bit channels - covers RGB to RGBA expansion and RGBA to BGRA swizzles
+		template<uint32_t SrcChannels, uint32_t DstChannels>
+		void convert_bytes(const uint8_t* __restrict src, uint8_t* __restrict dst, size_t count, std::array<uint8_t, 4> source, std::array<uint8_t, 4> fill) {
+			for (size_t i = 0; i < count; i++) {
+				for (uint32_t c = 0; c < DstChannels; c++) {
+					dst[i * DstChannels + c] = source[c] < SrcChannels ? src[i * SrcChannels + source[c]] : fill[c];
+				}
+			}
+		}
+
+		template<uint32_t SrcChannels>
+		void convert_bytes(const uint8_t* src, uint8_t* dst, uint32_t dst_channels, size_t count, std::array<uint8_t, 4> source, std::array<uint8_t, 4> fill) {
+			switch (dst_channels) {
+			case 1:
+				return convert_bytes<SrcChannels, 1>(src, dst, count, source, fill);
+			case 2:
+				return convert_bytes<SrcChannels, 2>(src, dst, count, source, fill);
+			case 3:
+				return convert_bytes<SrcChannels, 3>(src, dst, count, source, fill);
+			case 4:
+				return convert_bytes<SrcChannels, 4>(src, dst, count, source, fill);
+			}
+		}
+
+		template<ChannelType Type>
+		float load_channel(const std::byte* src, size_t index) noexcept {
+			if constexpr (Type == ChannelType::eSfloat32) {
+				float f;
+				memcpy(&f, src + index * sizeof(float), sizeof(float));
+				return f;
+			} else if constexpr (Type == ChannelType::eSfloat16) {
+				uint16_t h;
+				memcpy(&h, src + index * sizeof(uint16_t), sizeof(uint16_t));
+				return half_to_float(h);
+			} else if constexpr (Type == ChannelType::eUnorm8) {
+				return (uint8_t)src[index] * (1.f / 255.f);
+			} else if constexpr (Type == ChannelType::eSnorm8) {
+				return std::max((int8_t)src[index] * (1.f / 127.f), -1.f);
+			} else {
+				return srgb_to_linear_table()[(uint8_t)src[index]];
+			}
+		}
+
+		// converts to floating point channels - covers float to half and sRGB linearization
+		template<ChannelType SrcType, ChannelType DstType>
+		void convert_floats(const std::byte* __restrict src,
+		                    uint32_t src_channels,
+		                    std::byte* __restrict dst,
+		                    uint32_t dst_channels,
+		                    size_t count,
+		                    std::array<uint8_t, 4> source) {
+			for (size_t i = 0; i < count; i++) {
+				for (uint32_t c = 0; c < dst_channels; c++) {
+					float value;
+					if (source[c] >= src_channels) {
+						value = c == 3 ? 1.f : 0.f;
+					} else if (SrcType == ChannelType::eSrgb8 && source[c] == 3) {
+						// alpha is stored linearly in sRGB formats
+						value = load_channel<ChannelType::eUnorm8>(src, i * src_channels + source[c]);
+					} else {
+						value = load_channel<SrcType>(src, i * src_channels + source[c]);
+					}
+					if constexpr (DstType == ChannelType::eSfloat32) {
+						memcpy(dst + (i * dst_channels + c) * sizeof(float), &value, sizeof(float));
+					} else {
+						uint16_t h = float_to_half(value);
+						memcpy(dst + (i * dst_channels + c) * sizeof(uint16_t), &h, sizeof(uint16_t));
+					}
+				}
+			}
+		}
+
+		template<ChannelType DstType>
+		void convert_floats(ChannelType src_type,
+		                    const std::byte* src,
+		                    uint32_t src_channels,
+		                    std::byte* dst,
+		                    uint32_t dst_channels,
+		                    size_t count,
+		                    std::array<uint8_t, 4> source) {
+			switch (src_type) {
+			case ChannelType::eSfloat32:
+				return convert_floats<ChannelType::eSfloat32, DstType>(src, src_channels, dst, dst_channels, count, source);
+			case ChannelType::eSfloat16:
+				return convert_floats<ChannelType::eSfloat16, DstType>(src, src_channels, dst, dst_channels, count, source);
+			case ChannelType::eUnorm8:
+				return convert_floats<ChannelType::eUnorm8, DstType>(src, src_channels, dst, dst_channels, count, source);
+			case ChannelType::eSnorm8:
+				return convert_floats<ChannelType::eSnorm8, DstType>(src, src_channels, dst, dst_channels, count, source);
+			case ChannelType::eSrgb8:
+				return convert_floats<ChannelType::eSrgb8, DstType>(src, src_channels, dst, dst_channels, count, source);
+			default:
+				assert(0 && "not reached.");
+			}
+		}
+
+		void convert_texel_range(TexelLayout src_layout, const std::byte* src, TexelLayout dst_layout, std::byte* dst, size_t count) noexcept {
+			// for each channel in dst memory order, the channel in src memory order it comes from (or 4 if it is missing from src)
+			std::array<uint8_t, 4> source = { 4, 4, 4, 4 };
+			for (uint32_t c = 0; c < dst_layout.channel_count; c++) {
+				auto semantic = std::find(dst_layout.position.begin(), dst_layout.position.end(), c) - dst_layout.position.begin();
+				source[c] = src_layout.position[semantic] < src_layout.channel_count ? src_layout.position[semantic] : 4;
+			}
+
+			if (is_byte_channel(dst_layout.type)) {
+				std::array<uint8_t, 4> fill;
+				for (uint32_t c = 0; c < 4; c++) {
+					auto semantic = std::find(dst_layout.position.begin(), dst_layout.position.end(), c) - dst_layout.position.begin();
+					fill[c] = byte_fill(dst_layout.type, (uint32_t)semantic);
+				}
+				auto s = reinterpret_cast<const uint8_t*>(src);
+				auto d = reinterpret_cast<uint8_t*>(dst);
+				switch (src_layout.channel_count) {
+				case 1:
+					return convert_bytes<1>(s, d, dst_layout.channel_count, count, source, fill);
+				case 2:
+					return convert_bytes<2>(s, d, dst_layout.channel_count, count, source, fill);
+				case 3:
+					return convert_bytes<3>(s, d, dst_layout.channel_count, count, source, fill);
+				case 4:
+					return convert_bytes<4>(s, d, dst_layout.channel_count, count, source, fill);
+				}
+			} else if (dst_layout.type == ChannelType::eSfloat32) {
+				convert_floats<ChannelType::eSfloat32>(src_layout.type, src, src_layout.channel_count, dst, dst_layout.channel_count, count, source);
+			} else {
+				convert_floats<ChannelType::eSfloat16>(src_layout.type, src, src_layout.channel_count, dst, dst_layout.channel_count, count, source);
+			}
+		}
+	} // namespace
+
+	bool can_convert_format(Format src_format, Format dst_format) noexcept {
+		if (src_format == dst_format) {
+			return true;
+		}
+		auto src_layout = texel_layout(src_format);
+		auto dst_layout = texel_layout(dst_format);
+		if (!src_layout || !dst_layout) {
+			return false;
+		}
+		// 8 bit channels are only reordered, integer channels can't be converted to floating point
+		if (is_byte_channel(dst_layout->type)) {
+			return src_layout->type == dst_layout->type;
+		}
+		return src_layout->type != ChannelType::eUint8 && src_layout->type != ChannelType::eSint8;
+	}
+
+	bool convert_texels(Format src_format, const void* src, Format dst_format, void* dst, size_t texel_count) noexcept {
+		if (!can_convert_format(src_format, dst_format)) {
+			return false;
+		}
+		if (src_format == dst_format) {
+			memcpy(dst, src, texel_count * format_to_texel_block_size(src_format));
+			return true;
+		}
+		auto src_layout = *texel_layout(src_format);
+		auto dst_layout = *texel_layout(dst_format);
+		convert_texel_range(src_layout, static_cast<const std::byte*>(src), dst_layout, static_cast<std::byte*>(dst), texel_count);
+		return true;
+	}
+
+	bool convert_texels_parallel(Format src_format, const void* src, Format dst_format, void* dst, size_t texel_count, uint32_t max_threads) noexcept {
+		constexpr size_t texels_per_chunk = 1 << 18;
+		size_t chunk_count = (texel_count + texels_per_chunk - 1) / texels_per_chunk;
+		size_t thread_count = std::min<size_t>(std::min<size_t>(std::thread::hardware_concurrency(), max_threads), chunk_count);
+		if (src_format == dst_format || thread_count <= 1) {
+			return convert_texels(src_format, src, dst_format, dst, texel_count);
+		}
+		if (!can_convert_format(src_format, dst_format)) {
+			return false;
+		}
+		auto src_layout = *texel_layout(src_format);
+		auto dst_layout = *texel_layout(dst_format);
+		auto src_texel_size = format_to_texel_block_size(src_format);
+		auto dst_texel_size = format_to_texel_block_size(dst_format);
+		auto s = static_cast<const std::byte*>(src);
+		auto d = static_cast<std::byte*>(dst);
+
+		std::atomic<size_t> next_chunk = 0;
+		auto convert_chunks = [&] {
+			for (size_t chunk = next_chunk++; chunk < chunk_count; chunk = next_chunk++) {
+				size_t begin = chunk * texels_per_chunk;
+				size_t count = std::min(texels_per_chunk, texel_count - begin);
+				convert_texel_range(src_layout, s + begin * src_texel_size, dst_layout, d + begin * dst_texel_size, count);
+			}
+		};
+		std::vector<std::thread> threads;
+		try {
+			threads.reserve(thread_count - 1);
+			for (size_t i = 1; i < thread_count; i++) {
+				threads.emplace_back(convert_chunks);
+			}
+		} catch (...) {
+			// the chunks are shared, so the threads that did start and the calling thread convert all of them
+		}
+		convert_chunks();
+		for (auto& thread : threads) {
+			thread.join();
+		}
+		return true;
+	}
+
 	std::string_view image_view_type_to_sv(ImageViewType view_type) noexcept {
 		switch (view_type) {
 		case ImageViewType::e1D:
@@ -48,6 +48,8 @@ namespace vuk::extra {
 		vkbphysical_device.enable_extension_if_present(VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME);
 		// enable push descriptor if available (useful for some optimisations)
 		vkbphysical_device.enable_extension_if_present(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME);
+		// enable memory budget if available (for memory statistics)
+		vkbphysical_device.enable_extension_if_present(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
 #ifdef __APPLE__
 		// enable portability if available (for Apple systems)
 		vkbphysical_device.enable_extension_if_present(VK_KHR_PORTABILITY_ENUMERATION_EXTENSION_NAME);
@@ -210,7 +212,10 @@ namespace vuk::extra {
 		// create an executor for the main thread
 		executors.push_back(std::make_unique<ThisThreadExecutor>());
 		// create the runtime
-		sr->runtime.emplace(RuntimeCreateParameters{ instance, sr->vkbdevice.device, physical_device.physical_device, std::move(executors), fps });
+		RuntimeCreateParameters rcp{ instance, sr->vkbdevice.device, physical_device.physical_device, std::move(executors), fps };
+		rcp.memory_budget_enabled = physical_device.is_extension_present(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+		rcp.task_shader_enabled = rcp.mesh_shader_enabled = physical_device.is_extension_present(VK_EXT_MESH_SHADER_EXTENSION_NAME);
+		sr->runtime.emplace(std::move(rcp));
 
 		// create a superframe resource and allocator
 		sr->superframe_resource.emplace(*sr->runtime, num_inflight_frames);
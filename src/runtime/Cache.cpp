@@ -1,192 +1,384 @@
 #include "vuk/runtime/Cache.hpp"
 #include "vuk/runtime/vk/PipelineInstance.hpp"
 
+#include <algorithm>
+#include <array>
+#include <memory>
 #include <mutex>
 #include <plf_colony.h>
 #include <robin_hood.h>
 #include <shared_mutex>
+#include <thread>
+#include <vector>
 
 namespace vuk {
+	namespace {
+		// process-wide, so that a generation is never shared between two caches (even if one is allocated where the other used to be)
+		std::atomic<uint64_t> cache_generation_counter = 1;
+
+		// front cache hits are read without locks: a thread marks itself reading by making its sequence odd, and entries are only freed after
+		// every thread that was reading when the generation changed has finished
+		struct alignas(64) ReaderRecord {
+			std::atomic<uint64_t> sequence = 0;
+			bool in_use = false;
+		};
+
+		std::mutex reader_records_mtx;
+		std::vector<std::unique_ptr<ReaderRecord>> reader_records;
+
+		struct ThreadReaderRecord {
+			ReaderRecord* record;
+
+			ThreadReaderRecord() {
+				std::scoped_lock _(reader_records_mtx);
+				for (auto& r : reader_records) {
+					if (!r->in_use) {
+						r->in_use = true;
+						record = r.get();
+						return;
+					}
+				}
+				record = reader_records.emplace_back(std::make_unique<ReaderRecord>()).get();
+				record->in_use = true;
+			}
+
+			~ThreadReaderRecord() {
+				std::scoped_lock _(reader_records_mtx);
+				record->in_use = false;
+			}
+		};
+
+		ReaderRecord& thread_reader_record() {
+			thread_local ThreadReaderRecord record;
+			return *record.record;
+		}
+
+		// wait until the threads that were reading a front cache entry have finished
+		// must be called after changing the generation, the readers that start afterwards see the new generation and do not use stale entries
+		void wait_for_readers() {
+			std::vector<std::pair<ReaderRecord*, uint64_t>> reading;
+			{
+				std::scoped_lock _(reader_records_mtx);
+				for (auto& r : reader_records) {
+					auto sequence = r->sequence.load(std::memory_order_seq_cst);
+					if (sequence & 1) {
+						reading.emplace_back(r.get(), sequence);
+					}
+				}
+			}
+			for (auto& [record, sequence] : reading) {
+				while (record->sequence.load(std::memory_order_acquire) == sequence) {
+					std::this_thread::yield();
+				}
+			}
+		}
+	} // namespace
+
 	template<class T>
 	struct CacheImpl {
-		plf::colony<T> pool;
-		robin_hood::unordered_node_map<create_info_t<T>, typename Cache<T>::LRUEntry> lru_map;
-		std::shared_mutex cache_mtx;
-	};
+		using LRUEntry = typename Cache<T>::LRUEntry;
+		using Key = create_info_t<T>;
+		using Map = robin_hood::unordered_node_map<Key, LRUEntry>;
+		using Node = typename Map::value_type;
 
-	template<class T>
-	Cache<T>::Cache(void* allocator, create_fn create, destroy_fn destroy) : impl(new CacheImpl<T>()), create(create), destroy(destroy), allocator(allocator) {}
+		static constexpr size_t shard_bits = 5;
+		static constexpr size_t front_cache_size = 32;
+		static constexpr size_t wheel_size = 64;
+		// entries acquired without a frame are never collected
+		static constexpr uint64_t never_collect = INT64_MAX;
 
-	template<class T>
-	T& Cache<T>::acquire(const create_info_t<T>& ci) {
-		assert(0);
-		static T t;
-		return t;
-	}
+		struct alignas(64) Shard {
+			plf::colony<T> pool;
+			Map lru_map;
+			std::shared_mutex cache_mtx;
+			// timing wheel of collectable entries, bucketed by frame
+			// entries are not moved when they are used - they get refiled when their bucket comes up for collection
+			std::array<std::vector<Node*>, wheel_size> wheel;
+			// advanced every time an object of this shard finished creating (or failed to), acquirers of objects being created wait on this
+			std::atomic<uint32_t> creation_epoch = 0;
+		};
 
-	template<class T>
-	T& Cache<T>::acquire(const create_info_t<T>& ci, uint64_t current_frame) {
-		std::shared_lock _(impl->cache_mtx);
-		if (auto it = impl->lru_map.find(ci); it != impl->lru_map.end()) {
-			it->second.last_use_frame = current_frame;
-			return *it->second.ptr;
-		} else {
-			_.unlock();
-			std::unique_lock ulock(impl->cache_mtx);
-			auto pit = impl->pool.emplace(create(allocator, ci));
-			typename Cache::LRUEntry entry{ &*pit, current_frame };
-			it = impl->lru_map.emplace(ci, entry).first;
-			return *it->second.ptr;
+		// direct mapped, per-thread cache of the last acquired entries
+		// entries are only valid while the generation of the owning cache matches, which is checked without locking before and after reading them
+		struct FrontCacheEntry {
+			const CacheImpl* owner = nullptr;
+			uint64_t generation = 0;
+			size_t hash = 0;
+			const Key* key = nullptr;
+			LRUEntry* entry = nullptr;
+		};
+
+		std::array<Shard, 1 << shard_bits> shards;
+		// changed under the unique lock of a shard before any of its entries is removed, invalidating all front cache entries pointing into this cache
+		// the removed entries are freed after wait_for_readers()
+		alignas(64) std::atomic<uint64_t> generation = cache_generation_counter.fetch_add(1);
+
+		std::mutex collect_mtx;
+		// entries last used before this frame have already been collected
+		uint64_t collected_until = 0;
+
+		static size_t hash(const Key& ci) {
+			return robin_hood::hash<Key>{}(ci);
 		}
-	}
 
-	template<class T>
-	void Cache<T>::collect(uint64_t current_frame, size_t threshold) {
-		std::unique_lock _(impl->cache_mtx);
-		for (auto it = impl->lru_map.begin(); it != impl->lru_map.end();) {
-			auto last_use_frame = it->second.last_use_frame;
-			if ((int64_t)current_frame - (int64_t)last_use_frame > (int64_t)threshold) {
-				destroy(allocator, *it->second.ptr);
-				impl->pool.erase(impl->pool.get_iterator(it->second.ptr));
-				it = impl->lru_map.erase(it);
-			} else {
-				++it;
+		Shard& shard_for(size_t hash) {
+			return shards[((uint64_t)hash * 0x9E3779B97F4A7C15ull) >> (64 - shard_bits)];
+		}
+
+		static FrontCacheEntry& front_slot(size_t hash) {
+			thread_local std::array<FrontCacheEntry, front_cache_size> front_cache;
+			return front_cache[hash % front_cache_size];
+		}
+
+		void invalidate() {
+			// sequentially consistent, so that either a reader sees the new generation or wait_for_readers() sees the reader
+			generation.store(cache_generation_counter.fetch_add(1), std::memory_order_seq_cst);
+		}
+
+		// returns the cached object if the front cache slot holds `ci`, without locking
+		T* front_cache_hit(const FrontCacheEntry& slot, const Key& ci, size_t h, uint64_t current_frame) {
+			auto& record = thread_reader_record();
+			record.sequence.fetch_add(1, std::memory_order_seq_cst);
+			T* result = nullptr;
+			auto before = generation.load(std::memory_order_seq_cst);
+			if (slot.owner == this && slot.generation == before && slot.hash == h && *slot.key == ci) {
+				stamp(*slot.entry, current_frame);
+				result = slot.entry->ptr;
+				// if the entry was invalidated meanwhile, it might be collected without having seen the stamp
+				if (generation.load(std::memory_order_acquire) != before) {
+					result = nullptr;
+				}
 			}
+			record.sequence.fetch_add(1, std::memory_order_release);
+			return result;
 		}
-	}
 
-	template<class T>
-	void Cache<T>::clear() {
-		std::unique_lock _(impl->cache_mtx);
-		for (auto it = impl->pool.begin(); it != impl->pool.end(); ++it) {
-			destroy(allocator, *it);
+		static void stamp(LRUEntry& entry, uint64_t current_frame) {
+			// only write when the frame advances, so that the cache line stays shared for the hits within a frame
+			if (entry.last_use_frame.load(std::memory_order_relaxed) < current_frame) {
+				entry.last_use_frame.store(current_frame, std::memory_order_relaxed);
+			}
 		}
-		impl->pool.clear();
-		impl->lru_map.clear();
-	}
 
-	template<>
-	vuk::ShaderModule& Cache<vuk::ShaderModule>::acquire(const create_info_t<vuk::ShaderModule>& ci) {
-		std::shared_lock _(impl->cache_mtx);
-		if (auto it = impl->lru_map.find(ci); it != impl->lru_map.end()) {
-			if (it->second.load_cnt.load(std::memory_order_relaxed) == 0) { // perform a relaxed load to skip the atomic_wait path
-				std::atomic_wait(&it->second.load_cnt, 0);
-			}
-			return *it->second.ptr;
-		} else {
-			_.unlock();
-			auto elem = create(allocator, ci);
-			std::unique_lock ulock(impl->cache_mtx);
-			typename Cache::LRUEntry entry{ nullptr, INT64_MAX };
-			it = impl->lru_map.emplace(ci, entry).first;
-			auto pit = impl->pool.emplace(std::move(elem));
-			it->second.ptr = &*pit;
-			it->second.load_cnt.store(1);
-			it->second.load_cnt.notify_all();
-			return *it->second.ptr;
+		static void file(Shard& shard, Node& node, uint64_t frame) {
+			node.second.wheel_frame = frame;
+			shard.wheel[frame % wheel_size].push_back(&node);
 		}
-	}
 
-	template<>
-	vuk::PipelineBaseInfo& Cache<vuk::PipelineBaseInfo>::acquire(const create_info_t<vuk::PipelineBaseInfo>& ci) {
-		std::shared_lock _(impl->cache_mtx);
-		if (auto it = impl->lru_map.find(ci); it != impl->lru_map.end()) {
-			return *it->second.ptr;
-		} else {
-			_.unlock();
-			auto elem = create(allocator, ci);
-			std::unique_lock ulock(impl->cache_mtx);
-			auto pit = impl->pool.emplace(std::move(elem));
-			typename Cache::LRUEntry entry{ &*pit, INT64_MAX };
-			it = impl->lru_map.emplace(ci, entry).first;
-			return *it->second.ptr;
+		// unfortunately, we need to manage extended_data lifetime here
+		static std::byte* extended_data(const Key& key) {
+			if constexpr (std::is_same_v<T, GraphicsPipelineInfo>) {
+				if (!key.is_inline()) {
+					return key.extended_data;
+				}
+			}
+			return nullptr;
 		}
-	}
 
-	template<>
-	vuk::DescriptorSetLayoutAllocInfo& Cache<vuk::DescriptorSetLayoutAllocInfo>::acquire(const create_info_t<vuk::DescriptorSetLayoutAllocInfo>& ci) {
-		std::shared_lock _(impl->cache_mtx);
-		if (auto it = impl->lru_map.find(ci); it != impl->lru_map.end()) {
-			return *it->second.ptr;
-		} else {
-			_.unlock();
-			std::unique_lock ulock(impl->cache_mtx);
-			auto pit = impl->pool.emplace(create(allocator, ci));
-			typename Cache::LRUEntry entry{ &*pit, INT64_MAX };
-			it = impl->lru_map.emplace(ci, entry).first;
-			return *it->second.ptr;
+		static void unfile(Shard& shard, Node& node) {
+			if (node.second.wheel_frame == never_collect) {
+				return;
+			}
+			auto& bucket = shard.wheel[node.second.wheel_frame % wheel_size];
+			auto it = std::find(bucket.begin(), bucket.end(), &node);
+			if (it != bucket.end()) {
+				*it = bucket.back();
+				bucket.pop_back();
+			}
 		}
-	}
 
-	template<>
-	VkPipelineLayout& Cache<VkPipelineLayout>::acquire(const create_info_t<VkPipelineLayout>& ci) {
-		std::shared_lock _(impl->cache_mtx);
-		if (auto it = impl->lru_map.find(ci); it != impl->lru_map.end()) {
-			return *it->second.ptr;
-		} else {
-			_.unlock();
-			std::unique_lock ulock(impl->cache_mtx);
-			auto pit = impl->pool.emplace(create(allocator, ci));
-			typename Cache::LRUEntry entry{ &*pit, INT64_MAX };
-			it = impl->lru_map.emplace(ci, entry).first;
-			return *it->second.ptr;
+		template<class CopyKey>
+		T& acquire(Cache<T>& cache, const Key& ci, uint64_t current_frame, CopyKey&& copy_key) {
+			auto h = hash(ci);
+			auto& slot = front_slot(h);
+			auto& shard = shard_for(h);
+			if (auto hit = front_cache_hit(slot, ci, h, current_frame)) {
+				return *hit;
+			}
+			while (true) {
+				uint32_t epoch;
+				bool being_created = false;
+				{
+					std::shared_lock _(shard.cache_mtx);
+					// the generation only changes under the unique lock of the shard whose entries are removed, so this slot stays valid until then
+					auto current_generation = generation.load(std::memory_order_acquire);
+					auto it = shard.lru_map.find(ci);
+					if (it != shard.lru_map.end() && it->second.load_cnt.load(std::memory_order_acquire) != 0) {
+						stamp(it->second, current_frame);
+						slot = FrontCacheEntry{ this, current_generation, h, &it->first, &it->second };
+						return *it->second.ptr;
+					}
+					epoch = shard.creation_epoch.load(std::memory_order_acquire);
+					being_created = it != shard.lru_map.end();
+				}
+				if (being_created) {
+					// wait for the other thread to finish or fail creating, then look again
+					// if creation failed, the placeholder is gone and we retry creating the object ourselves
+					std::atomic_wait(&shard.creation_epoch, epoch);
+					continue;
+				}
+
+				std::unique_lock ulock(shard.cache_mtx);
+				if (shard.lru_map.find(ci) != shard.lru_map.end()) {
+					continue; // inserted concurrently
+				}
+				// insert a placeholder, so that concurrent acquires of this key wait for our object instead of creating their own
+				auto it = shard.lru_map.emplace(copy_key(ci), LRUEntry{ nullptr, current_frame }).first;
+				if (current_frame != never_collect) {
+					file(shard, *it, current_frame);
+				}
+				// nodes are stable, so this stays valid after unlocking
+				Node& node = *it;
+				ulock.unlock();
+				std::optional<T> elem;
+				try {
+					elem.emplace(cache.create(cache.allocator, node.first));
+				} catch (...) {
+					// remove the placeholder and wake the waiters, they retry creating the object
+					ulock.lock();
+					unfile(shard, node);
+					auto ext = extended_data(node.first);
+					shard.lru_map.erase(node.first);
+					ulock.unlock();
+					delete[] ext;
+					shard.creation_epoch.fetch_add(1, std::memory_order_release);
+					std::atomic_notify_all(&shard.creation_epoch);
+					throw;
+				}
+				ulock.lock();
+				auto pit = shard.pool.emplace(std::move(*elem));
+				node.second.ptr = &*pit;
+				node.second.load_cnt.store(1, std::memory_order_release);
+				slot = FrontCacheEntry{ this, generation.load(std::memory_order_acquire), h, &node.first, &node.second };
+				ulock.unlock();
+				shard.creation_epoch.fetch_add(1, std::memory_order_release);
+				std::atomic_notify_all(&shard.creation_epoch);
+				return *pit;
+			}
 		}
+
+		void collect(Cache<T>& cache, uint64_t current_frame, size_t threshold) {
+			std::unique_lock collect_lock(collect_mtx);
+			// an entry expires if current_frame - last_use_frame > threshold
+			if (current_frame <= threshold) {
+				return;
+			}
+			uint64_t expire_before = current_frame - threshold;
+			if (expire_before <= collected_until) {
+				return;
+			}
+			// every bucket is visited at most once
+			auto frame_count = std::min<uint64_t>(expire_before - collected_until, wheel_size);
+			collected_until = expire_before;
+
+			struct Expired {
+				T object;
+				std::byte* extended_data;
+			};
+			std::vector<Expired> expired;
+			for (auto& shard : shards) {
+				std::unique_lock _(shard.cache_mtx);
+				bool invalidated = false;
+				for (uint64_t i = 0; i < frame_count; i++) {
+					auto& bucket = shard.wheel[(expire_before - 1 - i) % wheel_size];
+					auto pending = std::move(bucket);
+					bucket.clear();
+					for (auto node : pending) {
+						auto& entry = node->second;
+						auto last_use_frame = entry.last_use_frame.load(std::memory_order_relaxed);
+						// still being created
+						if (entry.load_cnt.load(std::memory_order_acquire) == 0) {
+							file(shard, *node, current_frame);
+							continue;
+						}
+						// front cache hits stamp entries without locking - stop them before deciding, so that no stamp is missed
+						if (last_use_frame < expire_before && !invalidated) {
+							invalidate();
+							wait_for_readers();
+							invalidated = true;
+							last_use_frame = entry.last_use_frame.load(std::memory_order_relaxed);
+						}
+						// used since it was filed
+						if (last_use_frame >= expire_before) {
+							file(shard, *node, last_use_frame);
+							continue;
+						}
+						expired.push_back(Expired{ std::move(*entry.ptr), extended_data(node->first) });
+						shard.pool.erase(shard.pool.get_iterator(entry.ptr));
+						shard.lru_map.erase(node->first);
+					}
+				}
+			}
+			collect_lock.unlock();
+
+			// destroy outside of the locks, acquirers of other keys are not blocked by this
+			for (auto& e : expired) {
+				cache.destroy(cache.allocator, e.object);
+				delete[] e.extended_data;
+			}
+		}
+	};
+
+	template<class T>
+	Cache<T>::Cache(void* allocator, create_fn create, destroy_fn destroy) : impl(new CacheImpl<T>()), create(create), destroy(destroy), allocator(allocator) {}
+
+	template<class T>
+	T& Cache<T>::acquire(const create_info_t<T>& ci) {
+		return impl->acquire(*this, ci, CacheImpl<T>::never_collect, [](const create_info_t<T>& ci) { return ci; });
 	}
+
+	template<class T>
+	T& Cache<T>::acquire(const create_info_t<T>& ci, uint64_t current_frame) {
+		return impl->acquire(*this, ci, current_frame, [](const create_info_t<T>& ci) { return ci; });
+	}
+
 	// unfortunately, we need to manage extended_data lifetime here
 	template<>
 	vuk::GraphicsPipelineInfo& Cache<vuk::GraphicsPipelineInfo>::acquire(const create_info_t<vuk::GraphicsPipelineInfo>& ci, uint64_t current_frame) {
-		std::shared_lock _(impl->cache_mtx);
-		if (auto it = impl->lru_map.find(ci); it != impl->lru_map.end()) {
-			it->second.last_use_frame = current_frame;
-			if (it->second.load_cnt.load(std::memory_order_relaxed) == 0) { // perform a relaxed load to skip the atomic_wait path
-				std::atomic_wait(&it->second.load_cnt, 0);
-			}
-			return *it->second.ptr;
-		} else {
-			_.unlock();
+		return impl->acquire(*this, ci, current_frame, [](const create_info_t<vuk::GraphicsPipelineInfo>& ci) {
 			auto ci_copy = ci;
 			if (!ci_copy.is_inline()) {
 				ci_copy.extended_data = new std::byte[ci_copy.extended_size];
 				memcpy(ci_copy.extended_data, ci.extended_data, ci_copy.extended_size);
 			}
-			std::unique_lock ulock(impl->cache_mtx);
-			typename Cache::LRUEntry entry{ nullptr, current_frame };
-			it = impl->lru_map.emplace(ci_copy, entry).first;
-			auto pit = impl->pool.emplace(create(allocator, ci_copy));
-			ulock.unlock();
-			it->second.ptr = &*pit;
-			it->second.load_cnt.store(1);
-			it->second.load_cnt.notify_all();
-			return *it->second.ptr;
-		}
+			return ci_copy;
+		});
 	}
 
-	template<>
-	void Cache<vuk::GraphicsPipelineInfo>::collect(uint64_t current_frame, size_t threshold) {
-		std::unique_lock _(impl->cache_mtx);
-		for (auto it = impl->lru_map.begin(); it != impl->lru_map.end();) {
-			auto last_use_frame = it->second.last_use_frame;
-			if ((int64_t)current_frame - (int64_t)last_use_frame > (int64_t)threshold) {
-				destroy(allocator, *it->second.ptr);
-				if (!it->first.is_inline()) {
-					delete it->first.extended_data;
-				}
-				impl->pool.erase(impl->pool.get_iterator(it->second.ptr));
-				it = impl->lru_map.erase(it);
-			} else {
-				++it;
+	template<class T>
+	void Cache<T>::collect(uint64_t current_frame, size_t threshold) {
+		impl->collect(*this, current_frame, threshold);
+	}
+
+	template<class T>
+	void Cache<T>::clear() {
+		impl->invalidate();
+		wait_for_readers();
+		for (auto& shard : impl->shards) {
+			std::unique_lock _(shard.cache_mtx);
+			for (auto it = shard.pool.begin(); it != shard.pool.end(); ++it) {
+				destroy(allocator, *it);
+			}
+			shard.pool.clear();
+			shard.lru_map.clear();
+			for (auto& bucket : shard.wheel) {
+				bucket.clear();
 			}
 		}
 	}
 
 	template<class T>
 	std::optional<T> Cache<T>::remove(const create_info_t<T>& ci) {
-		std::unique_lock _(impl->cache_mtx);
-		auto it = impl->lru_map.find(ci);
-		if (it != impl->lru_map.end()) {
+		auto& shard = impl->shard_for(CacheImpl<T>::hash(ci));
+		std::unique_lock _(shard.cache_mtx);
+		auto it = shard.lru_map.find(ci);
+		if (it != shard.lru_map.end() && it->second.load_cnt.load(std::memory_order_acquire) != 0) {
+			impl->invalidate();
+			wait_for_readers();
+			CacheImpl<T>::unfile(shard, *it);
 			auto res = std::move(*it->second.ptr);
-			impl->pool.erase(impl->pool.get_iterator(it->second.ptr));
-			impl->lru_map.erase(it);
+			shard.pool.erase(shard.pool.get_iterator(it->second.ptr));
+			shard.lru_map.erase(it);
 			return res;
 		}
 		return {};
@@ -194,20 +386,27 @@ namespace vuk {
 
 	template<class T>
 	void Cache<T>::remove_ptr(const T* ptr) {
-		std::unique_lock _(impl->cache_mtx);
-		for (auto it = impl->lru_map.begin(); it != impl->lru_map.end(); ++it) {
-			if (ptr == it->second.ptr) {
-				impl->pool.erase(impl->pool.get_iterator(it->second.ptr));
-				impl->lru_map.erase(it);
-				return;
+		for (auto& shard : impl->shards) {
+			std::unique_lock _(shard.cache_mtx);
+			for (auto it = shard.lru_map.begin(); it != shard.lru_map.end(); ++it) {
+				if (ptr == it->second.ptr) {
+					impl->invalidate();
+					wait_for_readers();
+					CacheImpl<T>::unfile(shard, *it);
+					shard.pool.erase(shard.pool.get_iterator(it->second.ptr));
+					shard.lru_map.erase(it);
+					return;
+				}
 			}
 		}
 	}
 
 	template<class T>
 	Cache<T>::~Cache() {
-		for (auto& v : impl->pool) {
-			destroy(allocator, v);
+		for (auto& shard : impl->shards) {
+			for (auto& v : shard.pool) {
+				destroy(allocator, v);
+			}
 		}
 		delete impl;
 	}
@@ -226,4 +425,4 @@ namespace vuk {
 	template class Cache<vuk::ImageView>;
 
 	template class Cache<vuk::DescriptorPool>;
-} // namespace vuk
\ No newline at end of file
+} // namespace vuk
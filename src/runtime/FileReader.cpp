@@ -0,0 +1,171 @@
+#include "vuk/runtime/FileReader.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#if VUK_OS_WINDOWS
+#include <Windows.h>
+#else
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace vuk {
+	struct FileReadState {
+		std::mutex mutex;
+		std::condition_variable cv;
+		bool done = false;
+		// empty on success
+		std::string error;
+	};
+
+	bool FileRead::ready() const {
+		assert(state);
+		std::scoped_lock _(state->mutex);
+		return state->done;
+	}
+
+	Result<void> FileRead::wait() const {
+		assert(state);
+		std::unique_lock lock(state->mutex);
+		state->cv.wait(lock, [this] { return state->done; });
+		if (!state->error.empty()) {
+			return { expected_error, FileIOException{ state->error } };
+		}
+		return { expected_value };
+	}
+
+	namespace {
+		struct FileReadJob {
+			std::string path;
+			std::vector<FileRange> ranges;
+			std::byte* dst;
+			std::shared_ptr<FileReadState> state;
+		};
+
+		// reads all the ranges into dst, returning an error message on failure
+		std::string read_ranges(const FileReadJob& job) {
+#if VUK_OS_WINDOWS
+			HANDLE file = CreateFileA(job.path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+			if (file == INVALID_HANDLE_VALUE) {
+				return "Could not open file " + job.path;
+			}
+			std::string error;
+			std::byte* dst = job.dst;
+			for (auto& range : job.ranges) {
+				uint64_t done = 0;
+				while (done < range.size) {
+					uint64_t offset = range.offset + done;
+					OVERLAPPED overlapped = {};
+					overlapped.Offset = (DWORD)offset;
+					overlapped.OffsetHigh = (DWORD)(offset >> 32);
+					DWORD chunk = (DWORD)(std::min<uint64_t>)(range.size - done, 1u << 30);
+					DWORD read = 0;
+					if (!ReadFile(file, dst + done, chunk, &read, &overlapped) || read == 0) {
+						error = "Could not read file " + job.path;
+						break;
+					}
+					done += read;
+				}
+				if (!error.empty()) {
+					break;
+				}
+				dst += range.size;
+			}
+			CloseHandle(file);
+			return error;
+#else
+			int fd = open(job.path.c_str(), O_RDONLY);
+			if (fd < 0) {
+				return "Could not open file " + job.path + ": " + strerror(errno);
+			}
+#if VUK_OS_LINUX
+			posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+			std::string error;
+			std::byte* dst = job.dst;
+			for (auto& range : job.ranges) {
+				uint64_t done = 0;
+				while (done < range.size) {
+					auto read = pread(fd, dst + done, range.size - done, (off_t)(range.offset + done));
+					if (read < 0 && errno == EINTR) {
+						continue;
+					}
+					if (read <= 0) {
+						error = "Could not read file " + job.path + (read == 0 ? ": unexpected end of file" : std::string(": ") + strerror(errno));
+						break;
+					}
+					done += read;
+				}
+				if (!error.empty()) {
+					break;
+				}
+				dst += range.size;
+			}
+			close(fd);
+			return error;
+#endif
+		}
+	} // namespace
+
+	struct FileReaderImpl {
+		std::mutex mutex;
+		std::condition_variable cv;
+		std::deque<FileReadJob> jobs;
+		bool stop = false;
+		std::thread thread;
+
+		void run() {
+			while (true) {
+				FileReadJob job;
+				{
+					std::unique_lock lock(mutex);
+					cv.wait(lock, [this] { return stop || !jobs.empty(); });
+					if (jobs.empty()) {
+						return;
+					}
+					job = std::move(jobs.front());
+					jobs.pop_front();
+				}
+				auto error = read_ranges(job);
+				{
+					std::scoped_lock _(job.state->mutex);
+					job.state->error = std::move(error);
+					job.state->done = true;
+				}
+				job.state->cv.notify_all();
+			}
+		}
+	};
+
+	FileReader::FileReader() : impl(new FileReaderImpl) {
+		impl->thread = std::thread([this] { impl->run(); });
+	}
+
+	FileReader::~FileReader() {
+		{
+			std::scoped_lock _(impl->mutex);
+			impl->stop = true;
+		}
+		impl->cv.notify_one();
+		// reads already queued are finished, their destinations are still being waited on
+		impl->thread.join();
+		delete impl;
+	}
+
+	FileRead FileReader::read(std::string path, std::span<const FileRange> ranges, std::byte* dst) {
+		FileRead read;
+		read.state = std::make_shared<FileReadState>();
+		{
+			std::scoped_lock _(impl->mutex);
+			impl->jobs.push_back(FileReadJob{ std::move(path), std::vector<FileRange>(ranges.begin(), ranges.end()), dst, read.state });
+		}
+		impl->cv.notify_one();
+		return read;
+	}
+} // namespace vuk
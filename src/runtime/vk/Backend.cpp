@@ -490,6 +490,7 @@ namespace vuk {
 			si.command_buffers.emplace_back(*hl_cbuf);
 
 			cbuf = hl_cbuf->command_buffer;
+			bound_descriptor_buffer = 0;
 
 			VkCommandBufferBeginInfo cbi{ .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO, .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT };
 			alloc.get_context().vkBeginCommandBuffer(cbuf, &cbi);
@@ -1404,7 +1405,7 @@ namespace vuk {
 						auto allocator = node->construct.allocator ? *node->construct.allocator : alloc;
 						attachment.usage |= impl->compute_usage(&first(node).link());
 						assert(attachment.usage != ImageUsageFlags{});
-						auto img = allocate_image(allocator, attachment);
+						auto img = allocate_attachment_image(allocator, attachment);
 						if (!img) {
 							return img;
 						}
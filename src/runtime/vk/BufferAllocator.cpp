@@ -3,6 +3,12 @@
 #include "vuk/Result.hpp"
 #include "vuk/SourceLocation.hpp"
 #include "vuk/runtime/vk/Allocator.hpp"
+#include "vuk/runtime/vk/VkRuntime.hpp"
+
+#include <bit>
+#include <deque>
+#include <optional>
+#include <thread>
 
 // Aligns given value down to nearest multiply of align value. For example: VmaAlignUp(11, 8) = 8.
 // Use types like uint32_t, uint64_t as T.
@@ -19,15 +25,58 @@ static inline T VmaAlignUp(T val, T align) {
 }
 
 namespace vuk {
+	namespace {
+		std::atomic<uint64_t> linear_allocator_generation = 1;
+
+		// slots released by destroyed allocators are reused, their stale chunks are told apart by the generation
+		std::mutex linear_allocator_slot_mutex;
+		std::vector<uint32_t> free_linear_allocator_slots;
+		uint32_t linear_allocator_slot_count = 0;
+
+		// the part of a shared allocation a thread bumps through without synchronization
+		struct ThreadChunk {
+			uint64_t generation = 0;
+			Buffer buffer;     // whole chunk
+			size_t base = 0;   // needle position of the chunk start
+			size_t cursor = 0; // needle position of the next allocation
+			size_t end = 0;
+		};
+		// indexed by the slot of the allocator, so every allocator keeps its own chunk on every thread
+		thread_local std::vector<ThreadChunk> thread_chunks;
+	} // namespace
+
+	uint64_t BufferLinearAllocator::_next_generation() {
+		return linear_allocator_generation.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	uint32_t BufferLinearAllocator::_acquire_slot() {
+		std::lock_guard _(linear_allocator_slot_mutex);
+		if (free_linear_allocator_slots.empty()) {
+			return linear_allocator_slot_count++;
+		}
+		auto slot = free_linear_allocator_slots.back();
+		free_linear_allocator_slots.pop_back();
+		return slot;
+	}
+
+	void BufferLinearAllocator::_release_slot(uint32_t slot) {
+		std::lock_guard _(linear_allocator_slot_mutex);
+		free_linear_allocator_slots.push_back(slot);
+	}
+
 	Result<void, AllocateException> BufferLinearAllocator::grow(size_t num_blocks, SourceLocationAtFrame source) {
 		std::lock_guard _(mutex);
+		return _grow(num_blocks, source);
+	}
 
+	Result<void, AllocateException> BufferLinearAllocator::_grow(size_t num_blocks, SourceLocationAtFrame source) {
 		int best_fit_block_size = 1024;
 		int best_fit_index = -1;
 		size_t actual_blocks = num_blocks;
+		size_t first = used_allocations.size();
 
 		// find best fit allocation
-		for (size_t i = 0; i < available_allocation_count; i++) {
+		for (size_t i = 0; i < available_allocations.size(); i++) {
 			int block_over = (int)available_allocations[i].num_blocks - (int)num_blocks;
 			if (block_over >= 0 && block_over < best_fit_block_size) {
 				best_fit_block_size = block_over;
@@ -40,151 +89,378 @@ namespace vuk {
 
 		if (best_fit_index == -1) { // no allocation suitable, allocate new one
 			Buffer alloc;
-			BufferCreateInfo bci{ .mem_usage = mem_usage, .size = block_size * num_blocks };
+			BufferCreateInfo bci{ .mem_usage = mem_usage, .size = block_size * num_blocks, .usage = usage };
 			auto result = upstream->allocate_buffers(std::span{ &alloc, 1 }, std::span{ &bci, 1 }, source);
 			if (!result) {
 				return result;
 			}
-			for (auto i = 0; i < num_blocks; i++) {
-				used_allocations[used_allocation_count + i] = { alloc, i > 0 ? 0 : num_blocks, 0 };
+			for (size_t i = 0; i < num_blocks; i++) {
+				used_allocations.push_back({ alloc, i > 0 ? 0 : num_blocks, 0 });
 			}
-			current_buffer += (int)num_blocks;
-		} else { // we found one, we swap it into the used allocations and compact the available allocations
-			std::swap(used_allocations[used_allocation_count], available_allocations[best_fit_index]);
-			std::swap(available_allocations[best_fit_index], available_allocations[available_allocation_count - 1]);
-			available_allocation_count--;
+		} else { // we found one, we move it into the used allocations and compact the available allocations
+			auto alloc = available_allocations[best_fit_index];
+			available_allocations[best_fit_index] = available_allocations.back();
+			available_allocations.pop_back();
 
-			auto& alloc = used_allocations[used_allocation_count];
-			for (auto i = 1; i < alloc.num_blocks; i++) {
+			used_allocations.push_back(alloc);
+			for (size_t i = 1; i < alloc.num_blocks; i++) {
 				// create 1 entry per block in used_allocations
-				used_allocations[used_allocation_count + i] = { alloc.buffer, 0, 0 };
+				used_allocations.push_back({ alloc.buffer, 0, 0 });
 			}
-			current_buffer += (int)used_allocations[used_allocation_count].num_blocks;
-			actual_blocks = used_allocations[used_allocation_count].num_blocks;
+			actual_blocks = alloc.num_blocks;
 		}
-		used_allocations[0].base_address = 0;
-		for (auto i = 0; i < actual_blocks; i++) {
-			if (used_allocation_count + i == 0) {
-				continue;
-			}
-			if (i == 0) { // the first block will have its based_address calculated, the remaining blocks share this address
-				for (int j = (int)used_allocation_count - 1; j >= 0; j--) {
-					if (used_allocations[j].num_blocks > 0) {
-						used_allocations[used_allocation_count].base_address = used_allocations[j].base_address + used_allocations[j].num_blocks * block_size;
-						break;
-					}
-				}
-			} else {
-				used_allocations[used_allocation_count + i].base_address = used_allocations[used_allocation_count + i - 1].base_address;
+		// the first block of the allocation starts after the previous allocation, the remaining blocks share its base address
+		uint64_t base_address = 0;
+		for (size_t j = first; j-- > 0;) {
+			if (used_allocations[j].num_blocks > 0) {
+				base_address = used_allocations[j].base_address + used_allocations[j].num_blocks * block_size;
+				break;
 			}
 		}
-		used_allocation_count += actual_blocks;
+		for (size_t i = first; i < first + actual_blocks; i++) {
+			used_allocations[i].base_address = base_address;
+		}
+		current_buffer += (int)actual_blocks;
+		if (runtime) {
+			runtime->record_allocations(AllocationKind::eLinearBlock, mem_usage, (int64_t)actual_blocks, (int64_t)(actual_blocks * block_size));
+		}
+		reported_blocks += actual_blocks;
+		grown.notify_all();
 
 		return { expected_value };
 	}
 
-	// lock-free bump allocation if there is still space
-	Result<Buffer, AllocateException> BufferLinearAllocator::allocate_buffer(size_t size, size_t alignment, SourceLocationAtFrame source) {
-		if (size == 0) {
-			return { expected_value, Buffer{ .buffer = VK_NULL_HANDLE, .size = 0 } };
-		}
-
+	// bump allocation on the shared needle, only the thread that moves the needle into a new block grows
+	Result<Buffer, AllocateException> BufferLinearAllocator::_allocate_shared(size_t size, size_t alignment, size_t& base, SourceLocationAtFrame source) {
 		size_t old_needle = needle.load();
-		size_t new_needle = VmaAlignUp(old_needle, alignment) + size;
-		size_t low_buffer = old_needle / block_size;
-		size_t high_buffer = new_needle / block_size;
-		bool is_straddling = low_buffer != high_buffer;
-		if (is_straddling) { // boost alignment to place on block start
-			new_needle = VmaAlignUp(old_needle, block_size) + size;
-			low_buffer = old_needle / block_size;
-			high_buffer = new_needle / block_size;
-			is_straddling = low_buffer != high_buffer;
-		}
-		while (!std::atomic_compare_exchange_strong(&needle, &old_needle, new_needle)) { // CAS loop
-			old_needle = needle.load();
+		size_t new_needle;
+		do {
 			new_needle = VmaAlignUp(old_needle, alignment) + size;
-			low_buffer = old_needle / block_size;
-			high_buffer = new_needle / block_size;
-			is_straddling = low_buffer != high_buffer;
-			if (is_straddling) { // boost alignment to place on block start
+			// boost alignment to place on block start if the allocation would straddle blocks
+			if ((new_needle - size) / block_size != (new_needle - 1) / block_size) {
 				new_needle = VmaAlignUp(old_needle, block_size) + size;
-				low_buffer = old_needle / block_size;
-				high_buffer = new_needle / block_size;
-				is_straddling = low_buffer != high_buffer;
 			}
-		}
+		} while (!needle.compare_exchange_weak(old_needle, new_needle));
+
+		base = new_needle - size;
+		size_t base_buffer = base / block_size;
+		size_t high_buffer = (new_needle - 1) / block_size;
+		// blocks up to the one holding the last byte before old_needle were entered by earlier allocations
+		// the thread that moves the needle past them is the one that allocates the new blocks
+		int last_entered_buffer = old_needle == 0 ? -1 : (int)((old_needle - 1) / block_size);
+		bool needs_to_create = (int)high_buffer > last_entered_buffer;
 
-		size_t base = new_needle - size;
-		int base_buffer = (int)(base / block_size);
-		bool needs_to_create = old_needle == 0 || is_straddling;
+		std::unique_lock lock(mutex);
 		if (needs_to_create) {
-			size_t num_blocks = std::max({ high_buffer - low_buffer + (old_needle == 0 ? 1 : 0), static_cast<size_t>(1) });
-			while (current_buffer.load() < (int)high_buffer) {
-				grow(num_blocks, source);
+			while (current_buffer < (int)high_buffer) {
+				// blocks below this allocation were entered by other threads that haven't grown yet, this allocation needs its blocks in one buffer
+				size_t num_blocks = current_buffer + 1 < (int)base_buffer ? 1 : (size_t)((int)high_buffer - current_buffer);
+				if (auto result = _grow(num_blocks, source); !result) {
+					grow_failed = true;
+					grown.notify_all();
+					return result;
+				}
+			}
+		} else { // wait for the thread that moved the needle into this block to allocate it
+			grown.wait(lock, [&] { return current_buffer >= (int)high_buffer || grow_failed; });
+			if (current_buffer < (int)high_buffer) {
+				return { expected_error, AllocateException{ VK_ERROR_OUT_OF_DEVICE_MEMORY } };
 			}
-			assert(base % block_size == 0);
 		}
-		// wait for the buffer to be allocated
-		while (current_buffer.load() < (int)high_buffer) {
-		};
 		auto& current_alloc = used_allocations[base_buffer];
 		auto offset = base - current_alloc.base_address;
 		Buffer b = current_alloc.buffer;
+		lock.unlock();
+
 		b.offset += offset;
 		b.size = size;
 		b.mapped_ptr = b.mapped_ptr != nullptr ? b.mapped_ptr + offset : nullptr;
 		b.device_address = b.device_address != 0 ? b.device_address + offset : 0;
+		return { expected_value, b };
+	}
+
+	Result<Buffer, AllocateException> BufferLinearAllocator::allocate_buffer(size_t size, size_t alignment, SourceLocationAtFrame source) {
+		if (size == 0) {
+			return { expected_value, Buffer{ .buffer = VK_NULL_HANDLE, .size = 0 } };
+		}
+		size_t base;
+		// large allocations would waste most of a chunk
+		if (size + alignment > chunk_size / 4) {
+			return _allocate_shared(size, alignment, base, source);
+		}
 
+		if (slot >= thread_chunks.size()) {
+			thread_chunks.resize(slot + 1);
+		}
+		auto& chunk = thread_chunks[slot];
+		auto current_generation = generation.load(std::memory_order_acquire);
+		size_t aligned_cursor = VmaAlignUp(chunk.cursor, alignment);
+		if (chunk.generation != current_generation || aligned_cursor + size > chunk.end) {
+			auto result = _allocate_shared(chunk_size, alignment, base, source);
+			if (!result) {
+				return result;
+			}
+			chunk = { current_generation, *result, base, base, base + chunk_size };
+			aligned_cursor = base;
+		}
+		chunk.cursor = aligned_cursor + size;
+
+		auto offset = aligned_cursor - chunk.base;
+		Buffer b = chunk.buffer;
+		b.offset += offset;
+		b.size = size;
+		b.mapped_ptr = b.mapped_ptr != nullptr ? b.mapped_ptr + offset : nullptr;
+		b.device_address = b.device_address != 0 ? b.device_address + offset : 0;
 		return { expected_value, b };
 	}
 
 	void BufferLinearAllocator::reset() {
 		std::lock_guard _(mutex);
-		for (size_t i = 0; i < used_allocation_count;) {
-			available_allocations[available_allocation_count++] = used_allocations[i];
+		for (size_t i = 0; i < used_allocations.size();) {
+			available_allocations.push_back(used_allocations[i]);
 			i += used_allocations[i].num_blocks;
 		}
-		used_allocations = {};
-		used_allocation_count = 0;
+		used_allocations.clear();
+		if (runtime) {
+			runtime->record_allocations(AllocationKind::eLinearBlock, mem_usage, -(int64_t)reported_blocks, -(int64_t)(reported_blocks * block_size));
+		}
+		reported_blocks = 0;
 		current_buffer = -1;
+		grow_failed = false;
 		needle = 0;
+		generation.store(_next_generation(), std::memory_order_release);
 	}
 
 	// we just destroy the buffers that we have left in the available allocations
 	void BufferLinearAllocator::trim() {
 		std::lock_guard _(mutex);
-		for (size_t i = 0; i < available_allocation_count; i++) {
-			auto& alloc = available_allocations[i];
+		for (auto& alloc : available_allocations) {
 			if (alloc.num_blocks > 0) {
 				upstream->deallocate_buffers(std::span{ &alloc.buffer, 1 });
 			}
 		}
-		available_allocation_count = 0;
+		available_allocations.clear();
 	}
 
 	BufferLinearAllocator::~BufferLinearAllocator() {
 		free();
+		_release_slot(slot);
 	}
 
 	void BufferLinearAllocator::free() {
-		for (size_t i = 0; i < used_allocation_count; i++) {
-			auto& buf = used_allocations[i].buffer;
-			if (buf && used_allocations[i].num_blocks > 0) {
-				upstream->deallocate_buffers(std::span{ &buf, 1 });
+		if (runtime) {
+			runtime->record_allocations(AllocationKind::eLinearBlock, mem_usage, -(int64_t)reported_blocks, -(int64_t)(reported_blocks * block_size));
+		}
+		reported_blocks = 0;
+		for (auto& alloc : used_allocations) {
+			if (alloc.buffer && alloc.num_blocks > 0) {
+				upstream->deallocate_buffers(std::span{ &alloc.buffer, 1 });
 			}
 		}
-		used_allocation_count = 0;
+		used_allocations.clear();
 
-		for (size_t i = 0; i < available_allocation_count; i++) {
-			auto& buf = available_allocations[i].buffer;
-			if (buf && available_allocations[i].num_blocks > 0) {
-				upstream->deallocate_buffers(std::span{ &buf, 1 });
+		for (auto& alloc : available_allocations) {
+			if (alloc.buffer && alloc.num_blocks > 0) {
+				upstream->deallocate_buffers(std::span{ &alloc.buffer, 1 });
 			}
 		}
-
-		available_allocation_count = 0;
+		available_allocations.clear();
 	}
 
+	namespace {
+		constexpr uint32_t tlsf_sl_bits = 5;
+		constexpr uint32_t tlsf_sl_count = 1 << tlsf_sl_bits;
+		constexpr uint32_t tlsf_fl_count = 64 - tlsf_sl_bits + 1;
+
+		struct TLSFIndex {
+			uint32_t fl;
+			uint32_t sl;
+		};
+
+		// sizes below tlsf_sl_count have a class each, above that each power of two is split into tlsf_sl_count classes
+		TLSFIndex tlsf_mapping(size_t size) {
+			if (size < tlsf_sl_count) {
+				return { 0, (uint32_t)size };
+			}
+			uint32_t log2 = 63 - (uint32_t)std::countl_zero(size);
+			return { log2 - tlsf_sl_bits + 1, (uint32_t)(size >> (log2 - tlsf_sl_bits)) - tlsf_sl_count };
+		}
+
+		// round up to the next class boundary, so that every free range of the class found fits
+		size_t tlsf_round_up(size_t size) {
+			if (size < tlsf_sl_count) {
+				return size;
+			}
+			uint32_t log2 = 63 - (uint32_t)std::countl_zero(size);
+			return size + (size_t(1) << (log2 - tlsf_sl_bits)) - 1;
+		}
+	} // namespace
+
+	struct SubAllocationNode {
+		size_t offset; // within the block
+		size_t size;
+		// neighbouring ranges in the same block
+		SubAllocationNode* phys_prev;
+		SubAllocationNode* phys_next;
+		// free list of the size class, if free
+		SubAllocationNode* free_prev;
+		SubAllocationNode* free_next;
+		uint32_t shard;
+		uint32_t block;
+		bool is_free;
+#if VUK_DEBUG_ALLOCATIONS
+		// where the range was allocated, if it is in use
+		std::optional<SourceLocationAtFrame> source;
+#endif
+	};
+
+	struct SubAllocatorShard {
+		std::mutex mutex;
+		uint64_t fl_bitmap = 0;
+		std::array<uint32_t, tlsf_fl_count> sl_bitmaps = {};
+		std::array<std::array<SubAllocationNode*, tlsf_sl_count>, tlsf_fl_count> free_lists = {};
+
+		struct Block {
+			Buffer buffer = {};
+			size_t allocation_count = 0;
+		};
+		std::vector<Block> blocks;
+		std::vector<uint32_t> free_block_indices;
+
+		// nodes are referenced from Buffer::allocation, so they need stable addresses
+		std::deque<SubAllocationNode> node_storage;
+		std::vector<SubAllocationNode*> free_nodes;
+
+		SubAllocationNode* new_node() {
+			if (!free_nodes.empty()) {
+				auto n = free_nodes.back();
+				free_nodes.pop_back();
+				return n;
+			}
+			return &node_storage.emplace_back();
+		}
+
+		void insert_free(SubAllocationNode* n) {
+			auto [fl, sl] = tlsf_mapping(n->size);
+			auto& head = free_lists[fl][sl];
+			n->is_free = true;
+			n->free_prev = nullptr;
+			n->free_next = head;
+			if (head) {
+				head->free_prev = n;
+			}
+			head = n;
+			fl_bitmap |= 1ULL << fl;
+			sl_bitmaps[fl] |= 1U << sl;
+		}
+
+		void remove_free(SubAllocationNode* n) {
+			auto [fl, sl] = tlsf_mapping(n->size);
+			if (n->free_prev) {
+				n->free_prev->free_next = n->free_next;
+			} else {
+				free_lists[fl][sl] = n->free_next;
+				if (!n->free_next) {
+					sl_bitmaps[fl] &= ~(1U << sl);
+					if (sl_bitmaps[fl] == 0) {
+						fl_bitmap &= ~(1ULL << fl);
+					}
+				}
+			}
+			if (n->free_next) {
+				n->free_next->free_prev = n->free_prev;
+			}
+			n->is_free = false;
+		}
+
+		// a free range in the first non-empty class that can hold size, nullptr if there is none
+		SubAllocationNode* find_free(size_t size) {
+			auto [fl, sl] = tlsf_mapping(tlsf_round_up(size));
+			if (fl >= tlsf_fl_count) {
+				return nullptr;
+			}
+			uint32_t sl_map = sl_bitmaps[fl] & (~0U << sl);
+			if (sl_map == 0) {
+				uint64_t fl_map = fl + 1 < 64 ? fl_bitmap & (~0ULL << (fl + 1)) : 0;
+				if (fl_map == 0) {
+					return nullptr;
+				}
+				fl = (uint32_t)std::countr_zero(fl_map);
+				sl_map = sl_bitmaps[fl];
+			}
+			sl = (uint32_t)std::countr_zero(sl_map);
+			return free_lists[fl][sl];
+		}
+
+		// split the tail of a node off into a new free node
+		void split(SubAllocationNode* n, size_t size) {
+			if (n->size == size) {
+				return;
+			}
+			auto rest = new_node();
+			*rest = { .offset = n->offset + size, .size = n->size - size, .phys_prev = n, .phys_next = n->phys_next, .shard = n->shard, .block = n->block };
+			if (n->phys_next) {
+				n->phys_next->phys_prev = rest;
+			}
+			n->phys_next = rest;
+			n->size = size;
+			insert_free(rest);
+		}
+
+		// merge a node into its free neighbours, returns the merged node
+		SubAllocationNode* coalesce(SubAllocationNode* n) {
+			if (auto next = n->phys_next; next && next->is_free) {
+				remove_free(next);
+				n->size += next->size;
+				n->phys_next = next->phys_next;
+				if (next->phys_next) {
+					next->phys_next->phys_prev = n;
+				}
+				free_nodes.push_back(next);
+			}
+			if (auto prev = n->phys_prev; prev && prev->is_free) {
+				remove_free(prev);
+				prev->size += n->size;
+				prev->phys_next = n->phys_next;
+				if (n->phys_next) {
+					n->phys_next->phys_prev = prev;
+				}
+				free_nodes.push_back(n);
+				n = prev;
+			}
+			return n;
+		}
+
+		// take a range for the allocation out of the free lists, nullptr if this shard has no room
+		SubAllocationNode* allocate(size_t size, size_t alignment, size_t block_size) {
+			// a range in the class of the size fits without padding if it happens to be aligned, only otherwise look for room for the worst case padding
+			auto node = find_free(size);
+			if (node && VmaAlignUp(node->offset, alignment) + size > node->offset + node->size) {
+				node = nullptr;
+			}
+			if (!node && size + alignment - 1 < block_size) {
+				node = find_free(size + alignment - 1);
+			}
+			if (!node) {
+				return nullptr;
+			}
+
+			remove_free(node);
+			// padding in front of the allocation goes back to the free lists
+			size_t padding = VmaAlignUp(node->offset, alignment) - node->offset;
+			if (padding > 0) {
+				auto front = node;
+				split(front, padding);
+				node = front->phys_next;
+				remove_free(node);
+				insert_free(front);
+			}
+			split(node, size);
+			blocks[node->block].allocation_count++;
+			return node;
+		}
+	};
+
 	Result<Buffer, AllocateException> BufferSubAllocator::allocate_buffer(size_t size, size_t alignment, SourceLocationAtFrame source) {
 		if (size >= block_size) { // allocate-through
 			BufferCreateInfo bci{ .mem_usage = mem_usage, .size = size, .alignment = alignment };
@@ -192,94 +468,100 @@ namespace vuk {
 			auto result = upstream->allocate_buffers(std::span{ &buf, 1 }, std::span{ &bci, 1 }, source);
 			if (!result) {
 				return result;
-			} else {
-				return { expected_value, buf };
 			}
+			if (runtime) {
+				runtime->record_allocations(AllocationKind::eSubAllocatedBuffer, mem_usage, 1, (int64_t)size);
+			}
+			return { expected_value, buf };
 		}
 
-		std::lock_guard _(mutex);
-
-		VmaVirtualAllocation va;
-		VkDeviceSize offset;
-		VmaVirtualAllocationCreateInfo vaci{};
-		vaci.size = size + alignment;
-		vaci.alignment = 0; // VMA does not handle NPOT alignment
+		auto make_buffer = [&](SubAllocatorShard& shard, SubAllocationNode* node) {
 #if VUK_DEBUG_ALLOCATIONS
-		vaci.pUserData = new SourceLocationAtFrame(source);
+			node->source = source;
 #endif
-
-		std::vector<VmaVirtualAllocation> straddlers;
-		bool is_straddling = true;
-		while (is_straddling) {
-			auto result = vmaVirtualAllocate(virtual_alloc, &vaci, &va, &offset);
-			if (result != VK_SUCCESS) { // this must always succeed, we have 128 GiB memory to allocate from
-				return { expected_error, AllocateException(result) };
-			}
-			is_straddling = offset / block_size != (offset + vaci.size) / block_size;
-			if (is_straddling) {
-				straddlers.push_back(va);
+			Buffer buf = shard.blocks[node->block].buffer.add_offset(node->offset);
+			assert(buf.offset % alignment == 0);
+			buf.size = size;
+			buf.allocation = node;
+			if (runtime) {
+				runtime->record_allocations(AllocationKind::eSubAllocatedBuffer, mem_usage, 1, (int64_t)size);
 			}
-		}
-		for (auto& s : straddlers) {
-			vmaVirtualFree(virtual_alloc, s);
-		}
+			return buf;
+		};
 
-		auto block_index = offset / block_size;
-		if (blocks.size() <= block_index) {
-			blocks.resize(block_index + 1);
+		// threads start at their own shard, but take room from any shard before a new block is added
+		// so the shards together hold no more blocks than a single free list would, plus the blocks being added concurrently
+		auto home_index = (uint32_t)(std::hash<std::thread::id>{}(std::this_thread::get_id()) % shard_count);
+		for (uint32_t i = 0; i < shard_count; i++) {
+			auto& shard = shards[(home_index + i) % shard_count];
+			std::lock_guard _(shard.mutex);
+			if (auto node = shard.allocate(size, alignment, block_size)) {
+				return { expected_value, make_buffer(shard, node) };
+			}
 		}
 
-		if (!blocks[block_index].buffer) {
+		auto& shard = shards[home_index];
+		std::lock_guard _(shard.mutex);
+		// room might have been freed in this shard since it was searched
+		auto node = shard.allocate(size, alignment, block_size);
+		if (!node) { // no room left, add a new block
+			uint32_t block_index;
+			if (!shard.free_block_indices.empty()) {
+				block_index = shard.free_block_indices.back();
+				shard.free_block_indices.pop_back();
+			} else {
+				block_index = (uint32_t)shard.blocks.size();
+				shard.blocks.emplace_back();
+			}
 			BufferCreateInfo bci{ .mem_usage = mem_usage, .size = block_size, .alignment = 256 };
-			auto result = upstream->allocate_buffers(std::span{ &blocks[block_index].buffer, 1 }, std::span{ &bci, 1 }, source);
+			auto result = upstream->allocate_buffers(std::span{ &shard.blocks[block_index].buffer, 1 }, std::span{ &bci, 1 }, source);
 			if (!result) {
+				shard.free_block_indices.push_back(block_index);
 				return result;
 			}
+			node = shard.new_node();
+			*node = { .offset = 0, .size = block_size, .shard = home_index, .block = block_index };
+			shard.insert_free(node);
+			node = shard.allocate(size, alignment, block_size);
+			assert(node);
 		}
-
-		const size_t aligned_offset = VmaAlignUp(static_cast<size_t>(offset - (block_index * block_size)), alignment);
-		Buffer buf = blocks[block_index].buffer.add_offset(aligned_offset);
-		assert(buf.offset % alignment == 0);
-		assert((buf.offset + size) < block_size);
-		buf.size = size;
-		buf.allocation = new SubAllocation{ block_index, va };
-		blocks[block_index].allocation_count++;
-		return { expected_value, buf };
+		return { expected_value, make_buffer(shard, node) };
 	}
 
 	void BufferSubAllocator::deallocate_buffer(const Buffer& buf) {
+		if (runtime) {
+			runtime->record_allocations(AllocationKind::eSubAllocatedBuffer, mem_usage, -1, -(int64_t)buf.size);
+		}
 		if (buf.size >= block_size) {
 			upstream->deallocate_buffers(std::span{ &buf, 1 });
 			return;
 		}
-		std::lock_guard _(mutex);
-		auto sa = static_cast<SubAllocation*>(buf.allocation);
+		auto node = static_cast<SubAllocationNode*>(buf.allocation);
+		auto& shard = shards[node->shard];
+		std::lock_guard _(shard.mutex);
 #if VUK_DEBUG_ALLOCATIONS
-		VmaVirtualAllocationInfo info;
-		vmaGetVirtualAllocationInfo(virtual_alloc, sa->allocation, &info);
-		delete reinterpret_cast<SourceLocationAtFrame*>(info.pUserData);
+		node->source.reset();
 #endif
-		vmaVirtualFree(virtual_alloc, sa->allocation);
-		if (--blocks[sa->block_index].allocation_count == 0) {
-			upstream->deallocate_buffers(std::span{ &blocks[sa->block_index].buffer, 1 });
-			blocks[sa->block_index].buffer = {};
+		auto& block = shard.blocks[node->block];
+		node = shard.coalesce(node);
+		if (--block.allocation_count == 0) { // the whole block is free again, give it back
+			assert(node->offset == 0 && node->size == block_size);
+			upstream->deallocate_buffers(std::span{ &block.buffer, 1 });
+			block.buffer = {};
+			shard.free_block_indices.push_back(node->block);
+			shard.free_nodes.push_back(node);
+		} else {
+			shard.insert_free(node);
 		}
-		delete sa;
 	}
 
 	BufferSubAllocator::BufferSubAllocator(DeviceResource& upstream, MemoryUsage mem_usage, BufferUsageFlags buf_usage, size_t block_size) :
 	    upstream(&upstream),
 	    mem_usage(mem_usage),
 	    usage(buf_usage),
-	    block_size(block_size) {
-		VmaVirtualBlockCreateInfo vbci{};
-		vbci.size = 1024ULL * 1024 * 1024 * 128; // 128 GiB baybeh
-		auto result2 = vmaCreateVirtualBlock(&vbci, &virtual_alloc);
-		assert(result2 == VK_SUCCESS);
-	}
+	    block_size(block_size),
+	    shards(new SubAllocatorShard[shard_count]) {}
 
-	BufferSubAllocator::~BufferSubAllocator() {
-		vmaDestroyVirtualBlock(virtual_alloc);
-	}
+	BufferSubAllocator::~BufferSubAllocator() {}
 
 } // namespace vuk
\ No newline at end of file
@@ -62,6 +62,7 @@ namespace vuk {
 	    allocator(&allocator),
 	    command_buffer(cb),
 	    stream(&stream),
+	    dynamic_state_flags(ctx.default_dynamic_state_flags),
 	    ds_strategy_flags(ctx.default_descriptor_set_strategy) {}
 
 	const CommandBuffer::RenderPassInfo& CommandBuffer::get_ongoing_render_pass() const {
@@ -87,11 +88,15 @@ namespace vuk {
 		// determine which states change to dynamic now - those states need to be flushed into the command buffer
 		DynamicStateFlags not_enabled = DynamicStateFlags{ ~dynamic_state_flags.m_mask }; // has invalid bits, but doesn't matter
 		auto to_dynamic = not_enabled & flags;
-		if (to_dynamic & DynamicStateFlagBits::eViewport && viewports.size() > 0) {
-			ctx.vkCmdSetViewport(command_buffer, 0, (uint32_t)viewports.size(), viewports.data());
+		if (to_dynamic & DynamicStateFlagBits::eViewport) {
+			for (uint32_t i = 0; i < viewports.size(); i++) {
+				_set_viewport(i);
+			}
 		}
-		if (to_dynamic & DynamicStateFlagBits::eScissor && scissors.size() > 0) {
-			ctx.vkCmdSetScissor(command_buffer, 0, (uint32_t)scissors.size(), scissors.data());
+		if (to_dynamic & DynamicStateFlagBits::eScissor) {
+			for (uint32_t i = 0; i < scissors.size(); i++) {
+				_set_scissor(i);
+			}
 		}
 		if (to_dynamic & DynamicStateFlagBits::eLineWidth) {
 			ctx.vkCmdSetLineWidth(command_buffer, line_width);
@@ -106,6 +111,9 @@ namespace vuk {
 		if (to_dynamic & DynamicStateFlagBits::eDepthBounds && depth_stencil_state) {
 			ctx.vkCmdSetDepthBounds(command_buffer, depth_stencil_state->minDepthBounds, depth_stencil_state->maxDepthBounds);
 		}
+		assert(!(flags & DynamicStateFlags{ ~ctx.supported_dynamic_state_flags.m_mask }) && "Dynamic state not supported by the runtime.");
+		// extended dynamic state is flushed on the next draw
+		dirty_dynamic_state |= to_dynamic;
 		dynamic_state_flags = flags;
 		return *this;
 	}
@@ -117,9 +125,10 @@ namespace vuk {
 			viewports.resize(index + 1);
 		}
 		viewports[index] = vp;
+		dirty_dynamic_state |= DynamicStateFlagBits::eViewport;
 
 		if (dynamic_state_flags & DynamicStateFlagBits::eViewport) {
-			ctx.vkCmdSetViewport(command_buffer, index, 1, &viewports[index]);
+			_set_viewport(index);
 		}
 		return *this;
 	}
@@ -165,8 +174,9 @@ namespace vuk {
 			scissors.resize(index + 1);
 		}
 		scissors[index] = vp;
+		dirty_dynamic_state |= DynamicStateFlagBits::eScissor;
 		if (dynamic_state_flags & DynamicStateFlagBits::eScissor) {
-			ctx.vkCmdSetScissor(command_buffer, index, 1, &scissors[index]);
+			_set_scissor(index);
 		}
 		return *this;
 	}
@@ -174,6 +184,9 @@ namespace vuk {
 	CommandBuffer& CommandBuffer::set_rasterization(PipelineRasterizationStateCreateInfo state) {
 		VUK_EARLY_RET();
 		rasterization_state = state;
+		dirty_dynamic_state |= DynamicStateFlagBits::eCullMode | DynamicStateFlagBits::eFrontFace | DynamicStateFlagBits::eRasterizerDiscardEnable |
+		                       DynamicStateFlagBits::eDepthBiasEnable | DynamicStateFlagBits::eDepthClampEnable | DynamicStateFlagBits::ePolygonMode |
+		                       DynamicStateFlagBits::eLineWidth | DynamicStateFlagBits::eDepthBias;
 		if (state.depthBiasEnable && (dynamic_state_flags & DynamicStateFlagBits::eDepthBias)) {
 			ctx.vkCmdSetDepthBias(command_buffer, state.depthBiasConstantFactor, state.depthBiasClamp, state.depthBiasSlopeFactor);
 		}
@@ -186,6 +199,8 @@ namespace vuk {
 	CommandBuffer& CommandBuffer::set_depth_stencil(PipelineDepthStencilStateCreateInfo state) {
 		VUK_EARLY_RET();
 		depth_stencil_state = state;
+		dirty_dynamic_state |= DynamicStateFlagBits::eDepthTestEnable | DynamicStateFlagBits::eDepthWriteEnable | DynamicStateFlagBits::eDepthCompareOp |
+		                       DynamicStateFlagBits::eStencilTestEnable | DynamicStateFlagBits::eStencilOp | DynamicStateFlagBits::eDepthBounds;
 		if (state.depthBoundsTestEnable && (dynamic_state_flags & DynamicStateFlagBits::eDepthBounds)) {
 			ctx.vkCmdSetDepthBounds(command_buffer, state.minDepthBounds, state.maxDepthBounds);
 		}
@@ -201,6 +216,9 @@ namespace vuk {
 	CommandBuffer& CommandBuffer::set_patch_control_points(uint32_t new_patch_control_points) {
 		VUK_EARLY_RET();
 		patch_control_points = new_patch_control_points;
+		if (shader_objects_bound && patch_control_points > 0) {
+			ctx.vkCmdSetPatchControlPointsEXT(command_buffer, patch_control_points);
+		}
 		return *this;
 	}
 
@@ -231,6 +249,7 @@ namespace vuk {
 		color_blend_attachments[0] = state;
 		set_color_blend_attachments.set(0, true);
 		broadcast_color_blend_attachment_0 = true;
+		dirty_dynamic_state |= DynamicStateFlagBits::eColorBlendEnable | DynamicStateFlagBits::eColorBlendEquation | DynamicStateFlagBits::eColorWriteMask;
 		return *this;
 	}
 
@@ -249,6 +268,7 @@ namespace vuk {
 		set_color_blend_attachments.set(idx, true);
 		color_blend_attachments[idx] = state;
 		broadcast_color_blend_attachment_0 = false;
+		dirty_dynamic_state |= DynamicStateFlagBits::eColorBlendEnable | DynamicStateFlagBits::eColorBlendEquation | DynamicStateFlagBits::eColorWriteMask;
 		return *this;
 	}
 
@@ -260,6 +280,7 @@ namespace vuk {
 	CommandBuffer& CommandBuffer::set_blend_constants(std::array<float, 4> constants) {
 		VUK_EARLY_RET();
 		blend_constants = constants;
+		dirty_dynamic_state |= DynamicStateFlagBits::eBlendConstants;
 		if (dynamic_state_flags & DynamicStateFlagBits::eBlendConstants) {
 			ctx.vkCmdSetBlendConstants(command_buffer, constants.data());
 		}
@@ -329,10 +350,10 @@ namespace vuk {
 		vibd.stride = offset;
 		binding_descriptions[binding] = vibd;
 		VUK_SB_SET(set_binding_descriptions, binding, true);
+		dirty_dynamic_state |= DynamicStateFlagBits::eVertexInput;
 
 		if (buf.buffer) {
-			const VkDeviceSize len = static_cast<VkDeviceSize>(buf.offset);
-			ctx.vkCmdBindVertexBuffers(command_buffer, binding, 1, &buf.buffer, &len);
+			_bind_vertex_buffer(binding, buf.buffer, buf.offset);
 		}
 		return *this;
 	}
@@ -355,23 +376,31 @@ namespace vuk {
 		vibd.stride = stride;
 		binding_descriptions[binding] = vibd;
 		VUK_SB_SET(set_binding_descriptions, binding, true);
+		dirty_dynamic_state |= DynamicStateFlagBits::eVertexInput;
 
 		if (buf.buffer) {
-			const VkDeviceSize len = static_cast<VkDeviceSize>(buf.offset);
-			ctx.vkCmdBindVertexBuffers(command_buffer, binding, 1, &buf.buffer, &len);
+			_bind_vertex_buffer(binding, buf.buffer, buf.offset);
 		}
 		return *this;
 	}
 
 	CommandBuffer& CommandBuffer::bind_index_buffer(const Buffer& buf, IndexType type) {
 		VUK_EARLY_RET();
+		if (emitted.index_buffer == buf.buffer && emitted.index_buffer_offset == buf.offset && emitted.index_type == (VkIndexType)type) {
+			skipped_redundant_calls++;
+			return *this;
+		}
 		ctx.vkCmdBindIndexBuffer(command_buffer, buf.buffer, buf.offset, (VkIndexType)type);
+		emitted.index_buffer = buf.buffer;
+		emitted.index_buffer_offset = buf.offset;
+		emitted.index_type = (VkIndexType)type;
 		return *this;
 	}
 
 	CommandBuffer& CommandBuffer::set_primitive_topology(PrimitiveTopology topo) {
 		VUK_EARLY_RET();
 		topology = topo;
+		dirty_dynamic_state |= DynamicStateFlagBits::ePrimitiveTopology;
 		return *this;
 	}
 
@@ -394,11 +423,25 @@ namespace vuk {
 
 	CommandBuffer& CommandBuffer::specialize_constants(uint32_t constant_id, void* data, size_t size) {
 		VUK_EARLY_RET();
-		auto v = spec_map_entries.emplace(constant_id, SpecEntry{ size == sizeof(double) });
-		memcpy(&v.first->second.data, data, size);
+		auto entry = find_spec_entry(constant_id);
+		if (!entry) {
+			assert(spec_map_entries.size() < VUK_MAX_SPECIALIZATIONCONSTANT_RANGES);
+			entry = &spec_map_entries.emplace_back(SpecEntry{ constant_id });
+		}
+		entry->is_double = size == sizeof(double);
+		memcpy(&entry->data, data, size);
 		return *this;
 	}
 
+	CommandBuffer::SpecEntry* CommandBuffer::find_spec_entry(uint32_t constant_id) noexcept {
+		for (auto& entry : spec_map_entries) {
+			if (entry.constant_id == constant_id) {
+				return &entry;
+			}
+		}
+		return nullptr;
+	}
+
 	CommandBuffer& CommandBuffer::bind_buffer(unsigned set, unsigned binding, const Buffer& buffer) {
 		VUK_EARLY_RET();
 		assert(set < VUK_MAX_SETS);
@@ -407,6 +450,7 @@ namespace vuk {
 		set_bindings[set].bindings[binding].type = DescriptorType::eUniformBuffer; // just means buffer
 		set_bindings[set].bindings[binding].buffer = VkDescriptorBufferInfo{ buffer.buffer, buffer.offset, buffer.size };
 		set_bindings[set].used.set(binding);
+		buffer_addresses[set][binding] = buffer.device_address;
 		return *this;
 	}
 
@@ -891,6 +935,19 @@ namespace vuk {
 		return *this;
 	}
 
+	CommandBuffer& CommandBuffer::copy_buffer_to_image(const Buffer& src, const ImageAttachment& dst, std::span<const BufferImageCopy> regions) {
+		VUK_EARLY_RET();
+
+		if (regions.empty()) {
+			return *this;
+		}
+
+		ctx.vkCmdCopyBufferToImage(
+		    command_buffer, src.buffer, dst.image.image, (VkImageLayout)dst.layout, (uint32_t)regions.size(), (const VkBufferImageCopy*)regions.data());
+
+		return *this;
+	}
+
 	CommandBuffer& CommandBuffer::copy_image_to_buffer(const ImageAttachment& src, const Buffer& dst, BufferImageCopy bic) {
 		VUK_EARLY_RET();
 
@@ -922,6 +979,26 @@ namespace vuk {
 		return *this;
 	}
 
+	CommandBuffer& CommandBuffer::copy_buffer(const Buffer& src, const Buffer& dst, std::span<const BufferCopy> regions) {
+		VUK_EARLY_RET();
+
+		if (regions.empty()) {
+			return *this;
+		}
+
+		std::vector<VkBufferCopy> bcs(regions.size());
+		for (size_t i = 0; i < regions.size(); i++) {
+			assert(regions[i].srcOffset + regions[i].size <= src.size);
+			assert(regions[i].dstOffset + regions[i].size <= dst.size);
+			bcs[i].srcOffset = src.offset + regions[i].srcOffset;
+			bcs[i].dstOffset = dst.offset + regions[i].dstOffset;
+			bcs[i].size = regions[i].size;
+		}
+
+		ctx.vkCmdCopyBuffer(command_buffer, src.buffer, dst.buffer, (uint32_t)bcs.size(), bcs.data());
+		return *this;
+	}
+
 	CommandBuffer& CommandBuffer::fill_buffer(const Buffer& dst, uint32_t data) {
 		if (dst.size == 0) {
 			return *this;
@@ -1035,16 +1112,22 @@ namespace vuk {
 	VkCommandBuffer CommandBuffer::bind_compute_state() {
 		auto result = _bind_compute_pipeline_state();
 		assert(result);
+		emitted = {};
+		stream->bound_descriptor_buffer = 0;
 		return command_buffer;
 	}
 	VkCommandBuffer CommandBuffer::bind_graphics_state() {
 		auto result = _bind_graphics_pipeline_state();
 		assert(result);
+		emitted = {};
+		stream->bound_descriptor_buffer = 0;
 		return command_buffer;
 	}
 	VkCommandBuffer CommandBuffer::bind_ray_tracing_state() {
 		auto result = _bind_ray_tracing_pipeline_state();
 		assert(result);
+		emitted = {};
+		stream->bound_descriptor_buffer = 0;
 		return command_buffer;
 	}
 
@@ -1083,25 +1166,46 @@ namespace vuk {
 			current_layout = current_ray_tracing_pipeline->pipeline_layout;
 			break;
 		}
-		VkPipelineBindPoint bind_point;
-		switch (pipe_type) {
-		case PipeType::eGraphics:
-			bind_point = VK_PIPELINE_BIND_POINT_GRAPHICS;
-			break;
-		case PipeType::eCompute:
-			bind_point = VK_PIPELINE_BIND_POINT_COMPUTE;
-			break;
-		case PipeType::eRayTracing:
-			bind_point = VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR;
-			break;
-		}
-
 		for (auto& pcr : pcrs) {
-			void* data = push_constant_buffer + pcr.offset;
-			ctx.vkCmdPushConstants(command_buffer, current_layout, pcr.stageFlags, pcr.offset, pcr.size, data);
+			_push_constants(current_layout, pcr);
 		}
 		pcrs.clear();
 
+		// descriptor buffer sets of the pipeline are written into memory of the frame, allocated for all of them when any needs writing
+		// binding another descriptor buffer invalidates the offsets set before, so the sets of the pipe type are written again
+		auto& layout_infos = pipe_type == PipeType::eGraphics ? current_graphics_pipeline->layout_info
+		                     : pipe_type == PipeType::eCompute ? current_compute_pipeline->layout_info
+		                                                       : current_ray_tracing_pipeline->layout_info;
+		auto remark_descriptor_buffer_sets = [&] {
+			for (size_t set_index = 0; set_index < VUK_MAX_SETS; set_index++) {
+				if (sets_used.test(set_index) && !persistent_sets_to_bind.test(set_index) && layout_infos[set_index].descriptor_buffer_size > 0) {
+					sets_to_bind.set(set_index, true);
+				}
+			}
+			descriptor_buffer_offsets_stale[(size_t)pipe_type] = false;
+		};
+		if (descriptor_buffer_offsets_stale[(size_t)pipe_type]) {
+			remark_descriptor_buffer_sets();
+		}
+		VkDeviceSize descriptor_buffer_required = 0;
+		bool descriptor_buffer_write = false;
+		for (size_t set_index = 0; set_index < VUK_MAX_SETS; set_index++) {
+			if (layout_infos[set_index].descriptor_buffer_size > 0) {
+				descriptor_buffer_required += align_up(layout_infos[set_index].descriptor_buffer_size, ctx.descriptor_buffer_properties.descriptorBufferOffsetAlignment);
+				descriptor_buffer_write |= sets_to_bind.test(set_index) && sets_used.test(set_index) && !persistent_sets_to_bind.test(set_index);
+			}
+		}
+		Buffer descriptor_buffer_memory = {};
+		VkDeviceSize descriptor_buffer_offset = 0;
+		if (descriptor_buffer_write) {
+			if (!_allocate_descriptor_buffer_memory(descriptor_buffer_required, descriptor_buffer_memory)) {
+				return false;
+			}
+			if (descriptor_buffer_offsets_stale[(size_t)pipe_type]) {
+				remark_descriptor_buffer_sets();
+			}
+		}
+
 		auto sets_mask = sets_to_bind.to_ulong();
 		auto persistent_sets_mask = persistent_sets_to_bind.to_ulong();
 		size_t highest_undisturbed_binding_required = 0;
@@ -1257,14 +1361,28 @@ namespace vuk {
 					}
 				}
 
+				// descriptor buffer layouts bypass descriptor pools, the set is written into the descriptor buffer
+				if (ds_layout_alloc_info->descriptor_buffer_size > 0) {
+					auto offset = descriptor_buffer_offset;
+					_write_descriptor_buffer_set(*ds_layout_alloc_info, sb, buffer_addresses[set_index], descriptor_buffer_memory.mapped_ptr + offset);
+					descriptor_buffer_offset += align_up(ds_layout_alloc_info->descriptor_buffer_size, ctx.descriptor_buffer_properties.descriptorBufferOffsetAlignment);
+					// offsets are relative to the bound VkBuffer
+					_set_descriptor_buffer_offset(pipe_type, current_layout, (uint32_t)set_index, descriptor_buffer_memory.offset + offset);
+					set_layouts_used[set_index] = pipeline_set_layout;
+					continue;
+				}
+
 				auto strategy = ds_strategy_flags.m_mask == 0 ? DescriptorSetStrategyFlagBits::eCommon : ds_strategy_flags;
 				Unique<DescriptorSet> ds;
-				if (strategy & DescriptorSetStrategyFlagBits::ePerLayout) {
+				sb.compute_hash();
+				if (!ds_layout_alloc_info->push && allocator->get_device_resource().find_descriptor_set(*ds, sb)) {
+					// a set with these bindings was already written
+				} else if ((strategy & DescriptorSetStrategyFlagBits::ePerLayout) && !ds_layout_alloc_info->push) {
 					if (auto ret = allocator->allocate_descriptor_sets_with_value(std::span{ &*ds, 1 }, std::span{ &sb, 1 }); !ret) {
 						current_error = std::move(ret);
 						return false;
 					}
-				} else if ((strategy & DescriptorSetStrategyFlagBits::eCommon) || (strategy & DescriptorSetStrategyFlagBits::ePushDescriptor)) {
+				} else if (ds_layout_alloc_info->push || (strategy & DescriptorSetStrategyFlagBits::eCommon) || (strategy & DescriptorSetStrategyFlagBits::ePushDescriptor)) {
 					if (!ds_layout_alloc_info->push) {
 						if (auto ret = allocator->allocate_descriptor_sets(std::span{ &*ds, 1 }, std::span{ ds_layout_alloc_info, 1 }); !ret) {
 							current_error = std::move(ret);
@@ -1272,51 +1390,64 @@ namespace vuk {
 						}
 					}
 
-					auto& cinfo = sb;
-					auto mask = cinfo.used.to_ulong();
-					uint32_t leading_ones = num_leading_ones((uint32_t)mask);
-					VkWriteDescriptorSet writes[VUK_MAX_BINDINGS];
-					int j = 0;
-					for (uint32_t i = 0; i < leading_ones; i++, j++) {
-						bool used;
-						VUK_SB_TEST(cinfo.used, i, used);
-						if (!used) {
-							j--;
-							continue;
+					DescriptorTemplateEntry template_data[VUK_MAX_BINDINGS];
+					if (sb.pack_template_data(template_data)) {
+						if (!ds_layout_alloc_info->push) {
+							ctx.vkUpdateDescriptorSetWithTemplate(allocator->get_context().device, ds->descriptor_set, ds_layout_alloc_info->update_template, template_data);
+						} else {
+							_push_descriptor_set(pipe_type, current_layout, (uint32_t)set_index, ds_layout_alloc_info->update_template, template_data);
+						}
+					} else {
+						auto& cinfo = sb;
+						auto mask = cinfo.used.to_ulong();
+						uint32_t leading_ones = num_leading_ones((uint32_t)mask);
+						VkWriteDescriptorSet writes[VUK_MAX_BINDINGS];
+						int j = 0;
+						for (uint32_t i = 0; i < leading_ones; i++, j++) {
+							bool used;
+							VUK_SB_TEST(cinfo.used, i, used);
+							if (!used) {
+								j--;
+								continue;
+							}
+							auto& write = writes[j];
+							write = { .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET };
+							auto& binding = cinfo.bindings[i];
+							write.descriptorType = DescriptorBinding::vk_descriptor_type(binding.type);
+							write.dstArrayElement = 0;
+							write.descriptorCount = 1;
+							write.dstBinding = i;
+							write.dstSet = ds->descriptor_set;
+							switch (binding.type) {
+							case DescriptorType::eUniformBuffer:
+							case DescriptorType::eStorageBuffer:
+								write.pBufferInfo = &binding.buffer;
+								break;
+							case DescriptorType::eSampledImage:
+							case DescriptorType::eSampler:
+							case DescriptorType::eCombinedImageSampler:
+							case DescriptorType::eStorageImage:
+								write.pImageInfo = &binding.image.dii;
+								break;
+							case DescriptorType::eAccelerationStructureKHR:
+								binding.as.wds = { VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET_ACCELERATION_STRUCTURE_KHR };
+								binding.as.wds.accelerationStructureCount = 1;
+								binding.as.wds.pAccelerationStructures = &binding.as.as;
+								write.pNext = &binding.as.wds;
+								break;
+							default:
+								assert(0);
+							}
 						}
-						auto& write = writes[j];
-						write = { .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET };
-						auto& binding = cinfo.bindings[i];
-						write.descriptorType = DescriptorBinding::vk_descriptor_type(binding.type);
-						write.dstArrayElement = 0;
-						write.descriptorCount = 1;
-						write.dstBinding = i;
-						write.dstSet = ds->descriptor_set;
-						switch (binding.type) {
-						case DescriptorType::eUniformBuffer:
-						case DescriptorType::eStorageBuffer:
-							write.pBufferInfo = &binding.buffer;
-							break;
-						case DescriptorType::eSampledImage:
-						case DescriptorType::eSampler:
-						case DescriptorType::eCombinedImageSampler:
-						case DescriptorType::eStorageImage:
-							write.pImageInfo = &binding.image.dii;
-							break;
-						case DescriptorType::eAccelerationStructureKHR:
-							binding.as.wds = { VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET_ACCELERATION_STRUCTURE_KHR };
-							binding.as.wds.accelerationStructureCount = 1;
-							binding.as.wds.pAccelerationStructures = &binding.as.as;
-							write.pNext = &binding.as.wds;
-							break;
-						default:
-							assert(0);
+						if (!ds_layout_alloc_info->push) {
+							ctx.vkUpdateDescriptorSets(allocator->get_context().device, j, writes, 0, nullptr);
+						} else {
+							_push_descriptor_set(pipe_type, current_layout, (uint32_t)set_index, j, writes);
 						}
 					}
 					if (!ds_layout_alloc_info->push) {
-						ctx.vkUpdateDescriptorSets(allocator->get_context().device, j, writes, 0, nullptr);
+						allocator->get_device_resource().record_descriptor_set(*ds, sb);
 					} else {
-						ctx.vkCmdPushDescriptorSetKHR(command_buffer, bind_point, current_layout, (uint32_t)set_index, j, writes);
 						ds->layout_info.layout = ds_layout_alloc_info->layout;
 					}
 				} else {
@@ -1324,11 +1455,12 @@ namespace vuk {
 				}
 
 				if (!ds_layout_alloc_info->push) {
-					ctx.vkCmdBindDescriptorSets(command_buffer, bind_point, current_layout, (uint32_t)set_index, 1, &ds->descriptor_set, 0, nullptr);
+					_bind_descriptor_set(pipe_type, current_layout, (uint32_t)set_index, ds->descriptor_set);
 				}
 				set_layouts_used[set_index] = ds->layout_info.layout;
 			} else {
-				ctx.vkCmdBindDescriptorSets(command_buffer, bind_point, current_layout, (uint32_t)set_index, 1, &persistent_sets[set_index].first, 0, nullptr);
+				assert(ds_layout_alloc_info->descriptor_buffer_size == 0 && "Persistent descriptor sets can't be bound to a pipeline using descriptor buffers.");
+				_bind_descriptor_set(pipe_type, current_layout, (uint32_t)set_index, persistent_sets[set_index].first);
 				set_layouts_used[set_index] = persistent_sets[set_index].second;
 			}
 		}
@@ -1342,7 +1474,239 @@ namespace vuk {
 		return true;
 	}
 
+	VkPipelineBindPoint CommandBuffer::_bind_point(PipeType pipe_type) {
+		switch (pipe_type) {
+		case PipeType::eGraphics:
+			return VK_PIPELINE_BIND_POINT_GRAPHICS;
+		case PipeType::eCompute:
+			return VK_PIPELINE_BIND_POINT_COMPUTE;
+		case PipeType::eRayTracing:
+			return VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR;
+		}
+		assert(0);
+		return VK_PIPELINE_BIND_POINT_MAX_ENUM;
+	}
+
+	void CommandBuffer::_bind_pipeline(PipeType pipe_type, VkPipeline pipeline) {
+		auto& emitted_pipeline = emitted.pipelines[(size_t)pipe_type];
+		if (emitted_pipeline == pipeline) {
+			skipped_redundant_calls++;
+			return;
+		}
+		ctx.vkCmdBindPipeline(command_buffer, _bind_point(pipe_type), pipeline);
+		emitted_pipeline = pipeline;
+		// static state of the pipeline overwrites the dynamic state set before
+		if (pipe_type == PipeType::eGraphics) {
+			if (!(dynamic_state_flags & DynamicStateFlagBits::eViewport)) {
+				emitted.viewports_valid.reset();
+			}
+			if (!(dynamic_state_flags & DynamicStateFlagBits::eScissor)) {
+				emitted.scissors_valid.reset();
+			}
+		}
+	}
+
+	void CommandBuffer::_bind_descriptor_set(PipeType pipe_type, VkPipelineLayout layout, uint32_t set_index, VkDescriptorSet set) {
+		auto& emitted_layout = emitted.set_layouts[(size_t)pipe_type];
+		auto& emitted_sets = emitted.sets[(size_t)pipe_type];
+		// binding with a different layout may disturb the other sets, we don't track compatibility
+		if (emitted_layout != layout) {
+			std::fill(std::begin(emitted_sets), std::end(emitted_sets), VK_NULL_HANDLE);
+			emitted_layout = layout;
+		} else if (emitted_sets[set_index] == set) {
+			skipped_redundant_calls++;
+			return;
+		}
+		ctx.vkCmdBindDescriptorSets(command_buffer, _bind_point(pipe_type), layout, set_index, 1, &set, 0, nullptr);
+		emitted_sets[set_index] = set;
+	}
+
+	void CommandBuffer::_push_descriptor_set(PipeType pipe_type, VkPipelineLayout layout, uint32_t set_index, uint32_t write_count, const VkWriteDescriptorSet* writes) {
+		auto& emitted_layout = emitted.set_layouts[(size_t)pipe_type];
+		auto& emitted_sets = emitted.sets[(size_t)pipe_type];
+		if (emitted_layout != layout) {
+			std::fill(std::begin(emitted_sets), std::end(emitted_sets), VK_NULL_HANDLE);
+			emitted_layout = layout;
+		}
+		ctx.vkCmdPushDescriptorSetKHR(command_buffer, _bind_point(pipe_type), layout, set_index, write_count, writes);
+		emitted_sets[set_index] = VK_NULL_HANDLE;
+	}
+
+	void CommandBuffer::_push_descriptor_set(PipeType pipe_type, VkPipelineLayout layout, uint32_t set_index, VkDescriptorUpdateTemplate update_template, const void* data) {
+		auto& emitted_layout = emitted.set_layouts[(size_t)pipe_type];
+		auto& emitted_sets = emitted.sets[(size_t)pipe_type];
+		if (emitted_layout != layout) {
+			std::fill(std::begin(emitted_sets), std::end(emitted_sets), VK_NULL_HANDLE);
+			emitted_layout = layout;
+		}
+		ctx.vkCmdPushDescriptorSetWithTemplateKHR(command_buffer, update_template, layout, set_index, data);
+		emitted_sets[set_index] = VK_NULL_HANDLE;
+	}
+
+	void CommandBuffer::_set_descriptor_buffer_offset(PipeType pipe_type, VkPipelineLayout layout, uint32_t set_index, VkDeviceSize offset) {
+		auto& emitted_layout = emitted.set_layouts[(size_t)pipe_type];
+		auto& emitted_sets = emitted.sets[(size_t)pipe_type];
+		if (emitted_layout != layout) {
+			std::fill(std::begin(emitted_sets), std::end(emitted_sets), VK_NULL_HANDLE);
+			emitted_layout = layout;
+		}
+		uint32_t buffer_index = 0;
+		ctx.vkCmdSetDescriptorBufferOffsetsEXT(command_buffer, _bind_point(pipe_type), layout, set_index, 1, &buffer_index, &offset);
+		emitted_sets[set_index] = VK_NULL_HANDLE;
+	}
+
+	bool CommandBuffer::_allocate_descriptor_buffer_memory(VkDeviceSize size, Buffer& dst) {
+		// the memory lives until the frame is recycled
+		auto res = allocator->get_device_resource().allocate_descriptor_buffer_memory(
+		    size, ctx.descriptor_buffer_properties.descriptorBufferOffsetAlignment, VUK_HERE_AND_NOW());
+		if (!res) {
+			current_error = std::move(res);
+			return false;
+		}
+		dst = *res;
+		// the blocks are shared by the frame, so the command buffer only binds again when the allocation comes from another block
+		auto block_address = dst.device_address - dst.offset;
+		if (stream->bound_descriptor_buffer != block_address) {
+			VkDescriptorBufferBindingInfoEXT dbbi{ .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_BUFFER_BINDING_INFO_EXT,
+				                                     .address = block_address,
+				                                     .usage = VK_BUFFER_USAGE_SAMPLER_DESCRIPTOR_BUFFER_BIT_EXT | VK_BUFFER_USAGE_RESOURCE_DESCRIPTOR_BUFFER_BIT_EXT };
+			ctx.vkCmdBindDescriptorBuffersEXT(command_buffer, 1, &dbbi);
+			stream->bound_descriptor_buffer = block_address;
+			std::fill(std::begin(descriptor_buffer_offsets_stale), std::end(descriptor_buffer_offsets_stale), true);
+		}
+		return true;
+	}
+
+	void CommandBuffer::_write_descriptor_buffer_set(const DescriptorSetLayoutAllocInfo& layout_info,
+	                                                 const SetBinding& sb,
+	                                                 const uint64_t* addresses,
+	                                                 std::byte* dst) {
+		auto& props = ctx.descriptor_buffer_properties;
+		auto device = allocator->get_context().device;
+		auto mask = sb.used.to_ulong();
+		while (mask) {
+			uint32_t i = (uint32_t)std::countr_zero(mask);
+			mask &= mask - 1;
+			auto& binding = sb.bindings[i];
+			VkDescriptorGetInfoEXT dgi{ .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_GET_INFO_EXT, .type = DescriptorBinding::vk_descriptor_type(binding.type) };
+			VkDescriptorAddressInfoEXT dai{ .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_ADDRESS_INFO_EXT };
+			size_t size = 0;
+			switch (binding.type) {
+			case DescriptorType::eUniformBuffer:
+			case DescriptorType::eStorageBuffer: {
+				// the address cached on bind already includes the offset, buffers without one are queried
+				if (addresses[i] != 0) {
+					dai.address = addresses[i];
+				} else {
+					VkBufferDeviceAddressInfo bdai{ .sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO, .buffer = binding.buffer.buffer };
+					dai.address = ctx.vkGetBufferDeviceAddress(device, &bdai) + binding.buffer.offset;
+				}
+				dai.range = binding.buffer.range;
+				if (binding.type == DescriptorType::eUniformBuffer) {
+					dgi.data.pUniformBuffer = &dai;
+					size = props.uniformBufferDescriptorSize;
+				} else {
+					dgi.data.pStorageBuffer = &dai;
+					size = props.storageBufferDescriptorSize;
+				}
+				break;
+			}
+			case DescriptorType::eSampledImage:
+				dgi.data.pSampledImage = &binding.image.dii;
+				size = props.sampledImageDescriptorSize;
+				break;
+			case DescriptorType::eStorageImage:
+				dgi.data.pStorageImage = &binding.image.dii;
+				size = props.storageImageDescriptorSize;
+				break;
+			case DescriptorType::eCombinedImageSampler:
+				dgi.data.pCombinedImageSampler = &binding.image.dii;
+				size = props.combinedImageSamplerDescriptorSize;
+				break;
+			case DescriptorType::eSampler:
+				dgi.data.pSampler = &binding.image.dii.sampler;
+				size = props.samplerDescriptorSize;
+				break;
+			case DescriptorType::eAccelerationStructureKHR: {
+				VkAccelerationStructureDeviceAddressInfoKHR asdai{ .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_DEVICE_ADDRESS_INFO_KHR,
+					                                                 .accelerationStructure = binding.as.as };
+				dgi.data.accelerationStructure = ctx.vkGetAccelerationStructureDeviceAddressKHR(device, &asdai);
+				size = props.accelerationStructureDescriptorSize;
+				break;
+			}
+			default:
+				assert(0);
+				continue;
+			}
+			ctx.vkGetDescriptorEXT(device, &dgi, size, dst + layout_info.descriptor_buffer_offsets[i]);
+		}
+	}
+
+	void CommandBuffer::_push_constants(VkPipelineLayout layout, const VkPushConstantRange& pcr) {
+		if (emitted.push_constant_layout != layout) {
+			std::fill(std::begin(emitted.push_constant_stages), std::end(emitted.push_constant_stages), 0);
+			emitted.push_constant_layout = layout;
+		}
+		// offset and size are multiples of 4
+		uint32_t first_word = pcr.offset / 4;
+		uint32_t end_word = (pcr.offset + pcr.size) / 4;
+		bool redundant = true;
+		for (uint32_t w = first_word; w < end_word; w++) {
+			bool same = memcmp(emitted.push_constants + w * 4, push_constant_buffer + w * 4, 4) == 0;
+			redundant = redundant && same && (emitted.push_constant_stages[w] & pcr.stageFlags) == pcr.stageFlags;
+			// stages not pushed to now keep the old value
+			emitted.push_constant_stages[w] = same ? emitted.push_constant_stages[w] | pcr.stageFlags : pcr.stageFlags;
+		}
+		if (redundant) {
+			skipped_redundant_calls++;
+			return;
+		}
+		void* data = push_constant_buffer + pcr.offset;
+		ctx.vkCmdPushConstants(command_buffer, layout, pcr.stageFlags, pcr.offset, pcr.size, data);
+		memcpy(emitted.push_constants + pcr.offset, data, pcr.size);
+	}
+
+	void CommandBuffer::_bind_vertex_buffer(uint32_t binding, VkBuffer buffer, VkDeviceSize offset) {
+		if (emitted.vertex_buffers[binding] == buffer && emitted.vertex_buffer_offsets[binding] == offset) {
+			skipped_redundant_calls++;
+			return;
+		}
+		ctx.vkCmdBindVertexBuffers(command_buffer, binding, 1, &buffer, &offset);
+		emitted.vertex_buffers[binding] = buffer;
+		emitted.vertex_buffer_offsets[binding] = offset;
+	}
+
+	void CommandBuffer::_set_viewport(uint32_t index) {
+		if (emitted.viewports_valid.test(index) && memcmp(&emitted.viewports[index], &viewports[index], sizeof(VkViewport)) == 0) {
+			skipped_redundant_calls++;
+			return;
+		}
+		ctx.vkCmdSetViewport(command_buffer, index, 1, &viewports[index]);
+		emitted.viewports[index] = viewports[index];
+		emitted.viewports_valid.set(index);
+	}
+
+	void CommandBuffer::_set_scissor(uint32_t index) {
+		if (emitted.scissors_valid.test(index) && memcmp(&emitted.scissors[index], &scissors[index], sizeof(VkRect2D)) == 0) {
+			skipped_redundant_calls++;
+			return;
+		}
+		ctx.vkCmdSetScissor(command_buffer, index, 1, &scissors[index]);
+		emitted.scissors[index] = scissors[index];
+		emitted.scissors_valid.set(index);
+	}
+
 	bool CommandBuffer::_bind_compute_pipeline_state() {
+		// specialization constants are only supported through pipelines
+		if (next_compute_pipeline && !next_compute_pipeline->shader_objects.empty() && spec_map_entries.empty()) {
+			auto base = next_compute_pipeline;
+			current_compute_pipeline = ComputePipelineInfo{ { base, VK_NULL_HANDLE, base->pipeline_layout, base->layout_info }, base->reflection_info.local_size };
+			VkShaderStageFlagBits stage = VK_SHADER_STAGE_COMPUTE_BIT;
+			ctx.vkCmdBindShadersEXT(command_buffer, 1, &stage, base->shader_objects.data());
+			// binding shaders unbinds the pipeline
+			emitted.pipelines[(size_t)PipeType::eCompute] = VK_NULL_HANDLE;
+			next_compute_pipeline = nullptr;
+		}
 		if (next_compute_pipeline) {
 			ComputePipelineInstanceCreateInfo pi;
 			pi.base = next_compute_pipeline;
@@ -1350,9 +1714,8 @@ namespace vuk {
 			bool empty = true;
 			unsigned offset = 0;
 			for (auto& sc : pi.base->reflection_info.spec_constants) {
-				auto it = spec_map_entries.find(sc.binding);
-				if (it != spec_map_entries.end()) {
-					auto& map_e = it->second;
+				if (auto map_e_ptr = find_spec_entry(sc.binding)) {
+					auto& map_e = *map_e_ptr;
 					unsigned size = map_e.is_double ? (unsigned)sizeof(double) : 4;
 					assert(pi.specialization_map_entries.size() < VUK_MAX_SPECIALIZATIONCONSTANT_RANGES);
 					pi.specialization_map_entries.push_back(VkSpecializationMapEntry{ sc.binding, offset, size });
@@ -1372,19 +1735,37 @@ namespace vuk {
 
 				pi.base->psscis[0].pSpecializationInfo = &pi.specialization_info;
 			}
+			pi.compute_hash();
 
 			current_compute_pipeline = ComputePipelineInfo{};
 			allocator->allocate_compute_pipelines(std::span{ &current_compute_pipeline.value(), 1 }, std::span{ &pi, 1 });
 			// drop pipeline immediately
 			allocator->deallocate(std::span{ &current_compute_pipeline.value(), 1 });
 
-			ctx.vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, current_compute_pipeline->pipeline);
+			_bind_pipeline(PipeType::eCompute, current_compute_pipeline->pipeline);
 			next_compute_pipeline = nullptr;
 		}
 
 		return _bind_state(PipeType::eCompute);
 	}
 
+	// topologies of the same class are interchangeable with dynamic primitive topology
+	static PrimitiveTopology topology_class(PrimitiveTopology topology) {
+		switch (topology) {
+		case PrimitiveTopology::ePointList:
+			return PrimitiveTopology::ePointList;
+		case PrimitiveTopology::eLineList:
+		case PrimitiveTopology::eLineStrip:
+		case PrimitiveTopology::eLineListWithAdjacency:
+		case PrimitiveTopology::eLineStripWithAdjacency:
+			return PrimitiveTopology::eLineList;
+		case PrimitiveTopology::ePatchList:
+			return PrimitiveTopology::ePatchList;
+		default:
+			return PrimitiveTopology::eTriangleList;
+		}
+	}
+
 	template<class T>
 	void write(std::byte*& data_ptr, const T& data) {
 		memcpy(data_ptr, &data, sizeof(T));
@@ -1392,6 +1773,29 @@ namespace vuk {
 	};
 
 	bool CommandBuffer::_bind_graphics_pipeline_state() {
+		// color blend state that is set dynamically is reset to the defaults in the key
+		auto to_key = [this](PipelineColorBlendAttachmentState cba) {
+			PipelineColorBlendAttachmentState def{};
+			if (dynamic_state_flags & DynamicStateFlagBits::eColorBlendEnable) {
+				cba.blendEnable = def.blendEnable;
+			}
+			if (dynamic_state_flags & DynamicStateFlagBits::eColorBlendEquation) {
+				cba.srcColorBlendFactor = def.srcColorBlendFactor;
+				cba.dstColorBlendFactor = def.dstColorBlendFactor;
+				cba.colorBlendOp = def.colorBlendOp;
+				cba.srcAlphaBlendFactor = def.srcAlphaBlendFactor;
+				cba.dstAlphaBlendFactor = def.dstAlphaBlendFactor;
+				cba.alphaBlendOp = def.alphaBlendOp;
+			}
+			if (dynamic_state_flags & DynamicStateFlagBits::eColorWriteMask) {
+				cba.colorWriteMask = def.colorWriteMask;
+			}
+			return cba;
+		};
+		// specialization constants and conservative rasterization are only supported through pipelines
+		if (next_pipeline && !next_pipeline->shader_objects.empty() && spec_map_entries.empty() && !conservative_state) {
+			_bind_graphics_shader_objects();
+		}
 		if (next_pipeline) {
 			GraphicsPipelineInstanceCreateInfo pi;
 			pi.base = next_pipeline;
@@ -1402,12 +1806,13 @@ namespace vuk {
 				records.nonzero_subpass = true;
 				pi.extended_size += sizeof(uint8_t);
 			}
-			pi.topology = (VkPrimitiveTopology)topology;
+			// with dynamic topology, only the topology class is baked into the pipeline
+			pi.topology = (VkPrimitiveTopology)((dynamic_state_flags & DynamicStateFlagBits::ePrimitiveTopology) ? topology_class(topology) : topology);
 			pi.primitive_restart_enable = false;
 
 			// VERTEX INPUT
 			Bitset<VUK_MAX_ATTRIBUTES> used_bindings = {};
-			if (pi.base->reflection_info.attributes.size() > 0) {
+			if (pi.base->reflection_info.attributes.size() > 0 && !(dynamic_state_flags & DynamicStateFlagBits::eVertexInput)) {
 				records.vertex_input = true;
 				for (unsigned i = 0; i < pi.base->reflection_info.attributes.size(); i++) {
 					auto& reflected_att = pi.base->reflection_info.attributes[i];
@@ -1436,7 +1841,7 @@ namespace vuk {
 					bool set;
 					VUK_SB_TEST(set_color_blend_attachments, 0, set);
 					assert(set && "Broadcast turned on, but no blend state set.");
-					if (color_blend_attachments[0] != PipelineColorBlendAttachmentState{}) {
+					if (to_key(color_blend_attachments[0]) != to_key(PipelineColorBlendAttachmentState{})) {
 						records.color_blend_attachments = true;
 						pi.extended_size += sizeof(GraphicsPipelineInstanceCreateInfo::PipelineColorBlendAttachmentState);
 					}
@@ -1460,8 +1865,7 @@ namespace vuk {
 				for (unsigned i = 0; i < pi.base->reflection_info.spec_constants.size(); i++) {
 					auto& sc = pi.base->reflection_info.spec_constants[i];
 					auto size = sc.type == Program::Type::edouble ? sizeof(double) : 4;
-					auto it = spec_map_entries.find(sc.binding);
-					if (it != spec_map_entries.end()) {
+					if (find_spec_entry(sc.binding)) {
 						spec_const_size += (uint32_t)size;
 						VUK_SB_SET(set_constants, i, true);
 					}
@@ -1474,8 +1878,52 @@ namespace vuk {
 
 			assert(rasterization_state && "You must set the rasterization state.");
 
-			pi.cullMode = (VkCullModeFlags)rasterization_state->cullMode;
-			PipelineRasterizationStateCreateInfo def{ .cullMode = rasterization_state->cullMode };
+			// state that is set dynamically is reset to the defaults in the key
+			auto raster_key = *rasterization_state;
+			if (dynamic_state_flags & DynamicStateFlagBits::eCullMode) {
+				raster_key.cullMode = {};
+			}
+			if (dynamic_state_flags & DynamicStateFlagBits::eFrontFace) {
+				raster_key.frontFace = FrontFace::eCounterClockwise;
+			}
+			if (dynamic_state_flags & DynamicStateFlagBits::eRasterizerDiscardEnable) {
+				raster_key.rasterizerDiscardEnable = false;
+			}
+			if (dynamic_state_flags & DynamicStateFlagBits::eDepthBiasEnable) {
+				raster_key.depthBiasEnable = false;
+			}
+			if (dynamic_state_flags & DynamicStateFlagBits::eDepthClampEnable) {
+				raster_key.depthClampEnable = false;
+			}
+			if (dynamic_state_flags & DynamicStateFlagBits::ePolygonMode) {
+				raster_key.polygonMode = PolygonMode::eFill;
+			}
+			std::optional<PipelineDepthStencilStateCreateInfo> depth_stencil_key = depth_stencil_state;
+			if (depth_stencil_key) {
+				auto& ds = *depth_stencil_key;
+				if (dynamic_state_flags & DynamicStateFlagBits::eDepthTestEnable) {
+					ds.depthTestEnable = false;
+				}
+				if (dynamic_state_flags & DynamicStateFlagBits::eDepthWriteEnable) {
+					ds.depthWriteEnable = false;
+				}
+				if (dynamic_state_flags & DynamicStateFlagBits::eDepthCompareOp) {
+					ds.depthCompareOp = CompareOp::eNever;
+				}
+				// the stencil masks and reference remain static, so the stencil state is kept if the test can be enabled dynamically
+				if (dynamic_state_flags & DynamicStateFlagBits::eStencilTestEnable) {
+					ds.stencilTestEnable = true;
+				}
+				if (dynamic_state_flags & DynamicStateFlagBits::eStencilOp) {
+					for (auto* face : { &ds.front, &ds.back }) {
+						face->failOp = face->passOp = face->depthFailOp = StencilOp::eKeep;
+						face->compareOp = CompareOp::eNever;
+					}
+				}
+			}
+
+			pi.cullMode = (VkCullModeFlags)raster_key.cullMode;
+			PipelineRasterizationStateCreateInfo def{ .cullMode = raster_key.cullMode };
 			if (dynamic_state_flags & DynamicStateFlagBits::eDepthBias) {
 				def.depthBiasConstantFactor = rasterization_state->depthBiasConstantFactor;
 				def.depthBiasClamp = rasterization_state->depthBiasClamp;
@@ -1486,8 +1934,8 @@ namespace vuk {
 				assert(rasterization_state->depthBiasClamp == def.depthBiasClamp);
 				assert(rasterization_state->depthBiasSlopeFactor == def.depthBiasSlopeFactor);
 			}
-			records.depth_bias_enable = rasterization_state->depthBiasEnable; // the enable itself is not dynamic state in core
-			if (*rasterization_state != def) {
+			records.depth_bias_enable = raster_key.depthBiasEnable; // the enable itself is not dynamic state in core
+			if (raster_key != def) {
 				records.non_trivial_raster_state = true;
 				pi.extended_size += sizeof(GraphicsPipelineInstanceCreateInfo::RasterizationState);
 			}
@@ -1508,12 +1956,12 @@ namespace vuk {
 				records.depth_stencil = true;
 				pi.extended_size += sizeof(GraphicsPipelineInstanceCreateInfo::Depth);
 
-				if (depth_stencil_state->stencilTestEnable) {
+				if (depth_stencil_key->stencilTestEnable) {
 					records.stencil_state = true;
 					pi.extended_size += sizeof(GraphicsPipelineInstanceCreateInfo::Stencil);
 				}
 
-				if (depth_stencil_state->depthBoundsTestEnable) {
+				if (depth_stencil_key->depthBoundsTestEnable) {
 					records.depth_bounds = true;
 					pi.extended_size += sizeof(GraphicsPipelineInstanceCreateInfo::DepthBounds);
 				}
@@ -1550,8 +1998,9 @@ namespace vuk {
 			std::byte* data_start_ptr;
 			if (pi.is_inline()) {
 				data_start_ptr = data_ptr = pi.inline_data;
-			} else { // otherwise we allocate
-				pi.extended_data = new std::byte[pi.extended_size];
+			} else { // otherwise we write it to scratch space, the cache makes a copy if needed
+				assert(pi.extended_size <= sizeof(pipeline_key_scratch));
+				pi.extended_data = pipeline_key_scratch;
 				data_start_ptr = data_ptr = pi.extended_data;
 			}
 			// start writing packed stream
@@ -1587,7 +2036,7 @@ namespace vuk {
 			if (records.color_blend_attachments) {
 				uint32_t num_pcba_to_write = records.broadcast_color_blend_attachment_0 ? 1 : (uint32_t)color_blend_attachments.size();
 				for (uint32_t i = 0; i < num_pcba_to_write; i++) {
-					auto& cba = color_blend_attachments[i];
+					auto cba = to_key(color_blend_attachments[i]);
 					GraphicsPipelineInstanceCreateInfo::PipelineColorBlendAttachmentState pcba{ .blendEnable = cba.blendEnable,
 						                                                                          .srcColorBlendFactor = cba.srcColorBlendFactor,
 						                                                                          .dstColorBlendFactor = cba.dstColorBlendFactor,
@@ -1613,7 +2062,7 @@ namespace vuk {
 					if (set) {
 						auto& sc = pi.base->reflection_info.spec_constants[i];
 						auto size = sc.type == Program::Type::edouble ? sizeof(double) : 4;
-						auto& map_e = spec_map_entries.find(sc.binding)->second;
+						auto& map_e = *find_spec_entry(sc.binding);
 						memcpy(data_ptr, map_e.data, size);
 						data_ptr += size;
 					}
@@ -1621,10 +2070,10 @@ namespace vuk {
 			}
 
 			if (records.non_trivial_raster_state) {
-				GraphicsPipelineInstanceCreateInfo::RasterizationState rs{ .depthClampEnable = (bool)rasterization_state->depthClampEnable,
-					                                                         .rasterizerDiscardEnable = (bool)rasterization_state->rasterizerDiscardEnable,
-					                                                         .polygonMode = (uint8_t)rasterization_state->polygonMode,
-					                                                         .frontFace = (uint8_t)rasterization_state->frontFace };
+				GraphicsPipelineInstanceCreateInfo::RasterizationState rs{ .depthClampEnable = (bool)raster_key.depthClampEnable,
+					                                                         .rasterizerDiscardEnable = (bool)raster_key.rasterizerDiscardEnable,
+					                                                         .polygonMode = (uint8_t)raster_key.polygonMode,
+					                                                         .frontFace = (uint8_t)raster_key.frontFace };
 				write(data_ptr, rs);
 				// TODO: support depth bias
 			}
@@ -1642,19 +2091,19 @@ namespace vuk {
 			}
 
 			if (ongoing_render_pass->depth_stencil_attachment) {
-				GraphicsPipelineInstanceCreateInfo::Depth ds = { .depthTestEnable = (bool)depth_stencil_state->depthTestEnable,
-					                                               .depthWriteEnable = (bool)depth_stencil_state->depthWriteEnable,
-					                                               .depthCompareOp = (uint8_t)depth_stencil_state->depthCompareOp };
+				GraphicsPipelineInstanceCreateInfo::Depth ds = { .depthTestEnable = (bool)depth_stencil_key->depthTestEnable,
+					                                               .depthWriteEnable = (bool)depth_stencil_key->depthWriteEnable,
+					                                               .depthCompareOp = (uint8_t)depth_stencil_key->depthCompareOp };
 				write(data_ptr, ds);
 
-				if (depth_stencil_state->stencilTestEnable) {
-					GraphicsPipelineInstanceCreateInfo::Stencil ss = { .front = depth_stencil_state->front, .back = depth_stencil_state->back };
+				if (depth_stencil_key->stencilTestEnable) {
+					GraphicsPipelineInstanceCreateInfo::Stencil ss = { .front = depth_stencil_key->front, .back = depth_stencil_key->back };
 					write(data_ptr, ss);
 				}
 
-				if (depth_stencil_state->depthBoundsTestEnable) {
-					GraphicsPipelineInstanceCreateInfo::DepthBounds dps = { .minDepthBounds = depth_stencil_state->minDepthBounds,
-						                                                      .maxDepthBounds = depth_stencil_state->maxDepthBounds };
+				if (depth_stencil_key->depthBoundsTestEnable) {
+					GraphicsPipelineInstanceCreateInfo::DepthBounds dps = { .minDepthBounds = depth_stencil_key->minDepthBounds,
+						                                                      .maxDepthBounds = depth_stencil_key->maxDepthBounds };
 					write(data_ptr, dps);
 				}
 			}
@@ -1683,20 +2132,241 @@ namespace vuk {
 			}
 
 			assert(data_ptr - data_start_ptr == pi.extended_size); // sanity check: we wrote all the data we wanted to
+			pi.compute_hash();
 			// acquire_pipeline makes copy of extended_data if it needs to
 			current_graphics_pipeline = GraphicsPipelineInfo{};
 			allocator->allocate_graphics_pipelines(std::span{ &current_graphics_pipeline.value(), 1 }, std::span{ &pi, 1 });
-			if (!pi.is_inline()) {
-				delete pi.extended_data;
-			}
 			// drop pipeline immediately
 			allocator->deallocate(std::span{ &current_graphics_pipeline.value(), 1 });
 
-			ctx.vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, current_graphics_pipeline->pipeline);
+			_bind_pipeline(PipeType::eGraphics, current_graphics_pipeline->pipeline);
 			next_pipeline = nullptr;
+			// vertex input depends on the attributes of the pipeline
+			dirty_dynamic_state |= DynamicStateFlagBits::eVertexInput;
+			if (shader_objects_bound) {
+				// state set for the shader objects is overwritten by the static state of the pipeline
+				dirty_dynamic_state |= extended_dynamic_state_flags;
+				shader_objects_bound = false;
+			}
 		}
+		_set_extended_dynamic_state();
 		return _bind_state(PipeType::eGraphics);
 	}
+
+	void CommandBuffer::_bind_graphics_shader_objects() {
+		auto base = next_pipeline;
+		assert(rasterization_state && "You must set the rasterization state.");
+		current_graphics_pipeline = GraphicsPipelineInfo{ base, VK_NULL_HANDLE, base->pipeline_layout, base->layout_info };
+
+		// every graphics stage of an enabled feature must be bound, stages not in the base are unbound
+		std::array<VkShaderStageFlagBits, 7> graphics_stages = { VK_SHADER_STAGE_VERTEX_BIT,
+			                                                       VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT,
+			                                                       VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT,
+			                                                       VK_SHADER_STAGE_GEOMETRY_BIT,
+			                                                       VK_SHADER_STAGE_FRAGMENT_BIT };
+		uint32_t stage_count = 5;
+		if (ctx.task_shader_enabled) {
+			graphics_stages[stage_count++] = VK_SHADER_STAGE_TASK_BIT_EXT;
+		}
+		if (ctx.mesh_shader_enabled) {
+			graphics_stages[stage_count++] = VK_SHADER_STAGE_MESH_BIT_EXT;
+		}
+		std::array<VkShaderEXT, graphics_stages.size()> shaders = {};
+		for (uint32_t i = 0; i < stage_count; i++) {
+			for (size_t j = 0; j < base->psscis.size(); j++) {
+				if (base->psscis[j].stage == graphics_stages[i]) {
+					shaders[i] = base->shader_objects[j];
+				}
+			}
+		}
+		ctx.vkCmdBindShadersEXT(command_buffer, stage_count, graphics_stages.data(), shaders.data());
+		emitted.pipelines[(size_t)PipeType::eGraphics] = VK_NULL_HANDLE;
+
+		// state that has no vuk-side equivalent
+		ctx.vkCmdSetRasterizationSamplesEXT(command_buffer, (VkSampleCountFlagBits)ongoing_render_pass->samples);
+		VkSampleMask sample_mask = ~0u;
+		ctx.vkCmdSetSampleMaskEXT(command_buffer, (VkSampleCountFlagBits)ongoing_render_pass->samples, &sample_mask);
+		ctx.vkCmdSetAlphaToCoverageEnableEXT(command_buffer, false);
+		if (ctx.vkCmdSetLogicOpEnableEXT) {
+			ctx.vkCmdSetLogicOpEnableEXT(command_buffer, false);
+		}
+		if (patch_control_points > 0) {
+			ctx.vkCmdSetPatchControlPointsEXT(command_buffer, patch_control_points);
+		}
+
+		next_pipeline = nullptr;
+		shader_objects_bound = true;
+		dirty_dynamic_state = extended_dynamic_state_flags | DynamicStateFlagBits::eViewport | DynamicStateFlagBits::eScissor | DynamicStateFlagBits::eLineWidth |
+		                      DynamicStateFlagBits::eDepthBias | DynamicStateFlagBits::eBlendConstants | DynamicStateFlagBits::eDepthBounds;
+	}
+
+	void CommandBuffer::_set_extended_dynamic_state() {
+		// with pipelines, core dynamic state is emitted when it is set
+		auto to_set = dirty_dynamic_state & (shader_objects_bound ? DynamicStateFlags{ ~0u } : dynamic_state_flags & extended_dynamic_state_flags);
+		dirty_dynamic_state = {};
+		if (!to_set) {
+			return;
+		}
+
+		if (rasterization_state && to_set & (DynamicStateFlagBits::eCullMode | DynamicStateFlagBits::eFrontFace | DynamicStateFlagBits::eRasterizerDiscardEnable |
+		              DynamicStateFlagBits::eDepthBiasEnable | DynamicStateFlagBits::eDepthClampEnable | DynamicStateFlagBits::ePolygonMode)) {
+			auto& rs = *rasterization_state;
+			if (to_set & DynamicStateFlagBits::eCullMode) {
+				ctx.vkCmdSetCullModeEXT(command_buffer, (VkCullModeFlags)rs.cullMode);
+			}
+			if (to_set & DynamicStateFlagBits::eFrontFace) {
+				ctx.vkCmdSetFrontFaceEXT(command_buffer, (VkFrontFace)rs.frontFace);
+			}
+			if (to_set & DynamicStateFlagBits::eRasterizerDiscardEnable) {
+				ctx.vkCmdSetRasterizerDiscardEnableEXT(command_buffer, rs.rasterizerDiscardEnable);
+			}
+			if (to_set & DynamicStateFlagBits::eDepthBiasEnable) {
+				ctx.vkCmdSetDepthBiasEnableEXT(command_buffer, rs.depthBiasEnable);
+			}
+			if (to_set & DynamicStateFlagBits::eDepthClampEnable) {
+				ctx.vkCmdSetDepthClampEnableEXT(command_buffer, rs.depthClampEnable);
+			}
+			if (to_set & DynamicStateFlagBits::ePolygonMode) {
+				ctx.vkCmdSetPolygonModeEXT(command_buffer, (VkPolygonMode)rs.polygonMode);
+			}
+		}
+		if (to_set & DynamicStateFlagBits::ePrimitiveTopology) {
+			ctx.vkCmdSetPrimitiveTopologyEXT(command_buffer, (VkPrimitiveTopology)topology);
+		}
+		if (to_set & DynamicStateFlagBits::ePrimitiveRestartEnable) {
+			ctx.vkCmdSetPrimitiveRestartEnableEXT(command_buffer, false);
+		}
+
+		// without a depth/stencil attachment these are not used, but must still be set
+		auto ds = depth_stencil_state.value_or(PipelineDepthStencilStateCreateInfo{});
+		if (to_set & DynamicStateFlagBits::eDepthTestEnable) {
+			ctx.vkCmdSetDepthTestEnableEXT(command_buffer, ds.depthTestEnable);
+		}
+		if (to_set & DynamicStateFlagBits::eDepthWriteEnable) {
+			ctx.vkCmdSetDepthWriteEnableEXT(command_buffer, ds.depthWriteEnable);
+		}
+		if (to_set & DynamicStateFlagBits::eDepthCompareOp) {
+			ctx.vkCmdSetDepthCompareOpEXT(command_buffer, (VkCompareOp)ds.depthCompareOp);
+		}
+		if (to_set & DynamicStateFlagBits::eStencilTestEnable) {
+			ctx.vkCmdSetStencilTestEnableEXT(command_buffer, ds.stencilTestEnable);
+		}
+		if (to_set & DynamicStateFlagBits::eStencilOp) {
+			ctx.vkCmdSetStencilOpEXT(command_buffer,
+			                         VK_STENCIL_FACE_FRONT_BIT,
+			                         (VkStencilOp)ds.front.failOp,
+			                         (VkStencilOp)ds.front.passOp,
+			                         (VkStencilOp)ds.front.depthFailOp,
+			                         (VkCompareOp)ds.front.compareOp);
+			ctx.vkCmdSetStencilOpEXT(command_buffer,
+			                         VK_STENCIL_FACE_BACK_BIT,
+			                         (VkStencilOp)ds.back.failOp,
+			                         (VkStencilOp)ds.back.passOp,
+			                         (VkStencilOp)ds.back.depthFailOp,
+			                         (VkCompareOp)ds.back.compareOp);
+		}
+
+		uint32_t attachment_count = (uint32_t)ongoing_render_pass->color_attachments.size();
+		if (attachment_count > 0 &&
+		    (to_set & (DynamicStateFlagBits::eColorBlendEnable | DynamicStateFlagBits::eColorBlendEquation | DynamicStateFlagBits::eColorWriteMask))) {
+			fixed_vector<VkBool32, VUK_MAX_COLOR_ATTACHMENTS> enables;
+			fixed_vector<VkColorBlendEquationEXT, VUK_MAX_COLOR_ATTACHMENTS> equations;
+			fixed_vector<VkColorComponentFlags, VUK_MAX_COLOR_ATTACHMENTS> write_masks;
+			for (uint32_t i = 0; i < attachment_count; i++) {
+				auto& cba = color_blend_attachments[broadcast_color_blend_attachment_0 ? 0 : i];
+				enables.push_back(cba.blendEnable);
+				equations.push_back(VkColorBlendEquationEXT{ (VkBlendFactor)cba.srcColorBlendFactor,
+				                                             (VkBlendFactor)cba.dstColorBlendFactor,
+				                                             (VkBlendOp)cba.colorBlendOp,
+				                                             (VkBlendFactor)cba.srcAlphaBlendFactor,
+				                                             (VkBlendFactor)cba.dstAlphaBlendFactor,
+				                                             (VkBlendOp)cba.alphaBlendOp });
+				write_masks.push_back((VkColorComponentFlags)cba.colorWriteMask);
+			}
+			if (to_set & DynamicStateFlagBits::eColorBlendEnable) {
+				ctx.vkCmdSetColorBlendEnableEXT(command_buffer, 0, attachment_count, enables.data());
+			}
+			if (to_set & DynamicStateFlagBits::eColorBlendEquation) {
+				ctx.vkCmdSetColorBlendEquationEXT(command_buffer, 0, attachment_count, equations.data());
+			}
+			if (to_set & DynamicStateFlagBits::eColorWriteMask) {
+				ctx.vkCmdSetColorWriteMaskEXT(command_buffer, 0, attachment_count, write_masks.data());
+			}
+		}
+
+		if (to_set & DynamicStateFlagBits::eVertexInput) {
+			auto& attributes = current_graphics_pipeline->base->reflection_info.attributes;
+			fixed_vector<VkVertexInputAttributeDescription2EXT, VUK_MAX_ATTRIBUTES> viads;
+			fixed_vector<VkVertexInputBindingDescription2EXT, VUK_MAX_ATTRIBUTES> vibds;
+			Bitset<VUK_MAX_ATTRIBUTES> used_bindings = {};
+			for (auto& reflected_att : attributes) {
+				assert(set_attribute_descriptions.test(reflected_att.location) && "Pipeline expects attribute, but was never set in command buffer.");
+				auto& att = attribute_descriptions[reflected_att.location];
+				viads.push_back(VkVertexInputAttributeDescription2EXT{ .sType = VK_STRUCTURE_TYPE_VERTEX_INPUT_ATTRIBUTE_DESCRIPTION_2_EXT,
+				                                                       .location = att.location,
+				                                                       .binding = att.binding,
+				                                                       .format = (VkFormat)att.format,
+				                                                       .offset = att.offset });
+				VUK_SB_SET(used_bindings, att.binding, true);
+			}
+			for (unsigned i = 0; i < VUK_MAX_ATTRIBUTES; i++) {
+				bool used;
+				VUK_SB_TEST(used_bindings, i, used);
+				if (used) {
+					auto& bin = binding_descriptions[i];
+					vibds.push_back(VkVertexInputBindingDescription2EXT{ .sType = VK_STRUCTURE_TYPE_VERTEX_INPUT_BINDING_DESCRIPTION_2_EXT,
+					                                                     .binding = bin.binding,
+					                                                     .stride = bin.stride,
+					                                                     .inputRate = bin.inputRate,
+					                                                     .divisor = 1 });
+				}
+			}
+			ctx.vkCmdSetVertexInputEXT(command_buffer, (uint32_t)vibds.size(), vibds.data(), (uint32_t)viads.size(), viads.data());
+		}
+
+		if (!shader_objects_bound) {
+			return;
+		}
+		// the counts are part of the state with shader objects
+		if (to_set & DynamicStateFlagBits::eViewport && viewports.size() > 0) {
+			ctx.vkCmdSetViewportWithCountEXT(command_buffer, (uint32_t)viewports.size(), viewports.data());
+			for (uint32_t i = 0; i < viewports.size(); i++) {
+				emitted.viewports[i] = viewports[i];
+				emitted.viewports_valid.set(i);
+			}
+		}
+		if (to_set & DynamicStateFlagBits::eScissor && scissors.size() > 0) {
+			ctx.vkCmdSetScissorWithCountEXT(command_buffer, (uint32_t)scissors.size(), scissors.data());
+			for (uint32_t i = 0; i < scissors.size(); i++) {
+				emitted.scissors[i] = scissors[i];
+				emitted.scissors_valid.set(i);
+			}
+		}
+		if (to_set & DynamicStateFlagBits::eLineWidth) {
+			ctx.vkCmdSetLineWidth(command_buffer, line_width);
+		}
+		if (to_set & DynamicStateFlagBits::eDepthBias && rasterization_state) {
+			ctx.vkCmdSetDepthBias(
+			    command_buffer, rasterization_state->depthBiasConstantFactor, rasterization_state->depthBiasClamp, rasterization_state->depthBiasSlopeFactor);
+		}
+		if (to_set & DynamicStateFlagBits::eBlendConstants && blend_constants) {
+			ctx.vkCmdSetBlendConstants(command_buffer, blend_constants.value().data());
+		}
+		if (to_set & DynamicStateFlagBits::eDepthBounds) {
+			ctx.vkCmdSetDepthBoundsTestEnableEXT(command_buffer, ds.depthBoundsTestEnable);
+			if (ds.depthBoundsTestEnable) {
+				ctx.vkCmdSetDepthBounds(command_buffer, ds.minDepthBounds, ds.maxDepthBounds);
+			}
+		}
+		if (to_set & DynamicStateFlagBits::eStencilOp) {
+			ctx.vkCmdSetStencilCompareMask(command_buffer, VK_STENCIL_FACE_FRONT_BIT, ds.front.compareMask);
+			ctx.vkCmdSetStencilCompareMask(command_buffer, VK_STENCIL_FACE_BACK_BIT, ds.back.compareMask);
+			ctx.vkCmdSetStencilWriteMask(command_buffer, VK_STENCIL_FACE_FRONT_BIT, ds.front.writeMask);
+			ctx.vkCmdSetStencilWriteMask(command_buffer, VK_STENCIL_FACE_BACK_BIT, ds.back.writeMask);
+			ctx.vkCmdSetStencilReference(command_buffer, VK_STENCIL_FACE_FRONT_BIT, ds.front.reference);
+			ctx.vkCmdSetStencilReference(command_buffer, VK_STENCIL_FACE_BACK_BIT, ds.back.reference);
+		}
+	}
 	bool CommandBuffer::_bind_ray_tracing_pipeline_state() {
 		if (next_ray_tracing_pipeline) {
 			RayTracingPipelineInstanceCreateInfo pi;
@@ -1705,9 +2375,8 @@ namespace vuk {
 			bool empty = true;
 			unsigned offset = 0;
 			for (auto& sc : pi.base->reflection_info.spec_constants) {
-				auto it = spec_map_entries.find(sc.binding);
-				if (it != spec_map_entries.end()) {
-					auto& map_e = it->second;
+				if (auto map_e_ptr = find_spec_entry(sc.binding)) {
+					auto& map_e = *map_e_ptr;
 					unsigned size = map_e.is_double ? (unsigned)sizeof(double) : 4;
 					assert(pi.specialization_map_entries.size() < VUK_MAX_SPECIALIZATIONCONSTANT_RANGES);
 					pi.specialization_map_entries.push_back(VkSpecializationMapEntry{ sc.binding, offset, size });
@@ -1727,13 +2396,14 @@ namespace vuk {
 
 				pi.base->psscis[0].pSpecializationInfo = &pi.specialization_info;
 			}
+			pi.compute_hash();
 
 			current_ray_tracing_pipeline = RayTracingPipelineInfo{};
 			allocator->allocate_ray_tracing_pipelines(std::span{ &current_ray_tracing_pipeline.value(), 1 }, std::span{ &pi, 1 });
 			// drop pipeline immediately
 			allocator->deallocate(std::span{ &current_ray_tracing_pipeline.value(), 1 });
 
-			ctx.vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, current_ray_tracing_pipeline->pipeline);
+			_bind_pipeline(PipeType::eRayTracing, current_ray_tracing_pipeline->pipeline);
 			next_ray_tracing_pipeline = nullptr;
 		}
 
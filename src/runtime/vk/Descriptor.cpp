@@ -1,16 +1,125 @@
 #include "vuk/runtime/vk/Descriptor.hpp"
 #include "vuk/runtime/vk/VkRuntime.hpp"
 
-#include <concurrentqueue.h>
+#include <algorithm>
 #include <mutex>
 #include <robin_hood.h>
+#include <span>
+#include <thread>
 
 namespace vuk {
 	struct DescriptorPoolImpl {
-		std::mutex grow_mutex;
-		std::vector<VkDescriptorPool> pools;
+		// sets are handed out from caches shared by a few threads each, which refill from and spill into the central free list in bulk
+		static constexpr size_t shard_count = 8;
+		static constexpr size_t refill_count = 32;
+		static constexpr size_t spill_threshold = 2 * refill_count;
+		// pools grow geometrically up to this many sets, after that more pools of this size are made
+		static constexpr uint32_t min_sets_per_pool = 16;
+		static constexpr uint32_t max_sets_per_pool = 1024;
+
+		struct alignas(64) Shard {
+			std::mutex mutex;
+			std::vector<VkDescriptorSet> free_sets;
+		};
+		std::array<Shard, shard_count> shards;
+
+		struct Pool {
+			VkDescriptorPool pool;
+			uint32_t capacity;
+			uint32_t free_count; // sets of this pool in the central free list
+		};
+
+		// guards everything below, threads that need sets while the pool grows wait on it
+		std::mutex mutex;
+		std::vector<Pool> pools;
+		std::vector<VkDescriptorSet> free_sets;
+		robin_hood::unordered_flat_map<VkDescriptorSet, VkDescriptorPool> set_to_pool;
 		uint32_t sets_allocated = 0;
-		moodycamel::ConcurrentQueue<VkDescriptorSet> free_sets{ 1024 };
+
+		Shard& get_shard() {
+			return shards[std::hash<std::thread::id>{}(std::this_thread::get_id()) % shard_count];
+		}
+
+		Pool* find_pool(VkDescriptorPool pool) {
+			for (auto& p : pools) {
+				if (p.pool == pool) {
+					return &p;
+				}
+			}
+			return nullptr;
+		}
+
+		// called with mutex held
+		bool grow(Runtime& ctx, const DescriptorSetLayoutAllocInfo& layout_alloc_info) {
+			VkDescriptorPoolCreateInfo dpci{ .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO };
+			dpci.maxSets = std::clamp(sets_allocated, min_sets_per_pool, max_sets_per_pool);
+			std::array<VkDescriptorPoolSize, 12> descriptor_counts = {};
+			size_t count = ctx.vkCmdBuildAccelerationStructuresKHR ? descriptor_counts.size() : descriptor_counts.size() - 1;
+			uint32_t used_idx = 0;
+			for (size_t i = 0; i < count; i++) {
+				if (layout_alloc_info.descriptor_counts[i] > 0) {
+					auto& d = descriptor_counts[used_idx];
+					d.type = i == 11 ? VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR : VkDescriptorType(i);
+					d.descriptorCount = layout_alloc_info.descriptor_counts[i] * dpci.maxSets;
+					used_idx++;
+				}
+			}
+			dpci.pPoolSizes = descriptor_counts.data();
+			dpci.poolSizeCount = used_idx;
+			VkDescriptorPool pool;
+			if (ctx.vkCreateDescriptorPool(ctx.device, &dpci, nullptr, &pool) != VK_SUCCESS) {
+				return false;
+			}
+
+			VkDescriptorSetAllocateInfo dsai{ .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO };
+			dsai.descriptorPool = pool;
+			dsai.descriptorSetCount = dpci.maxSets;
+			std::vector<VkDescriptorSetLayout> layouts(dpci.maxSets, layout_alloc_info.layout);
+			dsai.pSetLayouts = layouts.data();
+			// allocate all the descriptorsets
+			auto first = free_sets.size();
+			free_sets.resize(first + dsai.descriptorSetCount);
+			if (ctx.vkAllocateDescriptorSets(ctx.device, &dsai, free_sets.data() + first) != VK_SUCCESS) {
+				free_sets.resize(first);
+				ctx.vkDestroyDescriptorPool(ctx.device, pool, nullptr);
+				return false;
+			}
+			for (auto i = first; i < free_sets.size(); i++) {
+				set_to_pool.emplace(free_sets[i], pool);
+			}
+			pools.push_back(Pool{ pool, dpci.maxSets, dpci.maxSets });
+			sets_allocated += dpci.maxSets;
+			return true;
+		}
+
+		// called with mutex held
+		void return_sets(Runtime& ctx, std::span<const VkDescriptorSet> sets) {
+			free_sets.insert(free_sets.end(), sets.begin(), sets.end());
+			for (auto& ds : sets) {
+				auto p = find_pool(set_to_pool.at(ds));
+				p->free_count++;
+				// destroy pools that are entirely free, as long as the other pools keep enough free sets around that this one wouldn't be made again right away
+				if (p->free_count == p->capacity && free_sets.size() >= 2 * size_t(p->capacity)) {
+					reclaim(ctx, *p);
+				}
+			}
+		}
+
+		// called with mutex held
+		void reclaim(Runtime& ctx, Pool& p) {
+			auto pool = p.pool;
+			std::erase_if(free_sets, [&](VkDescriptorSet ds) {
+				if (set_to_pool.at(ds) != pool) {
+					return false;
+				}
+				set_to_pool.erase(ds);
+				return true;
+			});
+			sets_allocated -= p.capacity;
+			ctx.vkDestroyDescriptorPool(ctx.device, pool, nullptr);
+			std::swap(p, pools.back());
+			pools.pop_back();
+		}
 	};
 
 	DescriptorPool::DescriptorPool() : impl(new DescriptorPoolImpl) {}
@@ -27,56 +136,46 @@ namespace vuk {
 	}
 
 	void DescriptorPool::grow(Runtime& ctx, DescriptorSetLayoutAllocInfo layout_alloc_info) {
-		if (!impl->grow_mutex.try_lock())
-			return;
-		VkDescriptorPoolCreateInfo dpci{ .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO };
-		dpci.maxSets = impl->sets_allocated == 0 ? 1 : impl->sets_allocated * 2;
-		std::array<VkDescriptorPoolSize, 12> descriptor_counts = {};
-		size_t count = ctx.vkCmdBuildAccelerationStructuresKHR ? descriptor_counts.size() : descriptor_counts.size() - 1;
-		uint32_t used_idx = 0;
-		for (size_t i = 0; i < count; i++) {
-			if (layout_alloc_info.descriptor_counts[i] > 0) {
-				auto& d = descriptor_counts[used_idx];
-				d.type = i == 11 ? VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR : VkDescriptorType(i);
-				d.descriptorCount = layout_alloc_info.descriptor_counts[i] * dpci.maxSets;
-				used_idx++;
-			}
-		}
-		dpci.pPoolSizes = descriptor_counts.data();
-		dpci.poolSizeCount = used_idx;
-		VkDescriptorPool pool;
-		ctx.vkCreateDescriptorPool(ctx.device, &dpci, nullptr, &pool);
-		impl->pools.emplace_back(pool);
-
-		VkDescriptorSetAllocateInfo dsai{ .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO };
-		dsai.descriptorPool = impl->pools.back();
-		dsai.descriptorSetCount = dpci.maxSets;
-		std::vector<VkDescriptorSetLayout> layouts(dpci.maxSets, layout_alloc_info.layout);
-		dsai.pSetLayouts = layouts.data();
-		// allocate all the descriptorsets
-		std::vector<VkDescriptorSet> sets(dsai.descriptorSetCount);
-		ctx.vkAllocateDescriptorSets(ctx.device, &dsai, sets.data());
-		impl->free_sets.enqueue_bulk(sets.data(), sets.size());
-		impl->sets_allocated = dpci.maxSets;
-
-		impl->grow_mutex.unlock();
+		std::scoped_lock _(impl->mutex);
+		impl->grow(ctx, layout_alloc_info);
 	}
 
 	VkDescriptorSet DescriptorPool::acquire(Runtime& ctx, DescriptorSetLayoutAllocInfo layout_alloc_info) {
-		VkDescriptorSet ds;
-		while (!impl->free_sets.try_dequeue(ds)) {
-			grow(ctx, layout_alloc_info);
+		auto& shard = impl->get_shard();
+		std::scoped_lock shard_lock(shard.mutex);
+		if (shard.free_sets.empty()) {
+			std::scoped_lock _(impl->mutex);
+			if (impl->free_sets.empty() && !impl->grow(ctx, layout_alloc_info)) {
+				return VK_NULL_HANDLE;
+			}
+			auto count = std::min(impl->free_sets.size(), DescriptorPoolImpl::refill_count);
+			auto first = impl->free_sets.end() - count;
+			for (auto it = first; it != impl->free_sets.end(); ++it) {
+				impl->find_pool(impl->set_to_pool.at(*it))->free_count--;
+			}
+			shard.free_sets.insert(shard.free_sets.end(), first, impl->free_sets.end());
+			impl->free_sets.erase(first, impl->free_sets.end());
 		}
+		auto ds = shard.free_sets.back();
+		shard.free_sets.pop_back();
 		return ds;
 	}
 
-	void DescriptorPool::release(VkDescriptorSet ds) {
-		impl->free_sets.enqueue(ds);
+	void DescriptorPool::release(Runtime& ctx, VkDescriptorSet ds) {
+		auto& shard = impl->get_shard();
+		std::scoped_lock shard_lock(shard.mutex);
+		shard.free_sets.push_back(ds);
+		if (shard.free_sets.size() >= DescriptorPoolImpl::spill_threshold) {
+			std::scoped_lock _(impl->mutex);
+			auto first = shard.free_sets.begin() + DescriptorPoolImpl::refill_count;
+			impl->return_sets(ctx, std::span{ &*first, (size_t)(shard.free_sets.end() - first) });
+			shard.free_sets.erase(first, shard.free_sets.end());
+		}
 	}
 
 	void DescriptorPool::destroy(Runtime& ctx, VkDevice device) const {
 		for (auto& p : impl->pools) {
-			ctx.vkDestroyDescriptorPool(device, p, nullptr);
+			ctx.vkDestroyDescriptorPool(device, p.pool, nullptr);
 		}
 	}
 
@@ -94,4 +193,81 @@ namespace vuk {
 		}
 		return final;
 	}
+
+	void SetBinding::compute_hash() noexcept {
+		// only the active member of the used bindings is hashed, the rest of the unions is not initialized
+		uint64_t words[VUK_MAX_BINDINGS * 6];
+		size_t count = 0;
+		for (uint32_t i = 0; i < VUK_MAX_BINDINGS; i++) {
+			if (!used.test(i)) {
+				continue;
+			}
+			auto& binding = bindings[i];
+			words[count++] = (uint64_t)i << 8 | (uint64_t)binding.type;
+			switch (binding.type) {
+			case DescriptorType::eUniformBuffer:
+			case DescriptorType::eStorageBuffer:
+				words[count++] = reinterpret_cast<uint64_t>(binding.buffer.buffer);
+				words[count++] = binding.buffer.offset;
+				words[count++] = binding.buffer.range;
+				break;
+			case DescriptorType::eStorageImage:
+			case DescriptorType::eSampledImage:
+			case DescriptorType::eSampler:
+			case DescriptorType::eCombinedImageSampler:
+				words[count++] = reinterpret_cast<uint64_t>(binding.image.dii.sampler);
+				words[count++] = reinterpret_cast<uint64_t>(binding.image.dii.imageView);
+				words[count++] = (uint64_t)binding.image.dii.imageLayout;
+				words[count++] = binding.image.image_view_id;
+				words[count++] = binding.image.sampler_id;
+				break;
+			case DescriptorType::eAccelerationStructureKHR:
+				words[count++] = reinterpret_cast<uint64_t>(binding.as.as);
+				break;
+			default:
+				break;
+			}
+		}
+		auto layout = layout_info ? layout_info->layout : VK_NULL_HANDLE;
+		hash = ::hash::wyhash::hash(words, count * sizeof(uint64_t), reinterpret_cast<uint64_t>(layout));
+	}
+
+	bool SetBinding::pack_template_data(DescriptorTemplateEntry (&dst)[VUK_MAX_BINDINGS]) const noexcept {
+		if (!layout_info || layout_info->update_template == VK_NULL_HANDLE) {
+			return false;
+		}
+		uint64_t mask = 0;
+		for (uint32_t i = 0; i < VUK_MAX_BINDINGS; i++) {
+			if (used.test(i)) {
+				mask |= 1ULL << i;
+			}
+		}
+		if (mask != layout_info->template_bindings) {
+			return false;
+		}
+		for (uint32_t i = 0; i < VUK_MAX_BINDINGS; i++) {
+			if (!(mask & (1ULL << i))) {
+				continue;
+			}
+			auto& binding = bindings[i];
+			switch (binding.type) {
+			case DescriptorType::eUniformBuffer:
+			case DescriptorType::eStorageBuffer:
+				dst[i].buffer = binding.buffer;
+				break;
+			case DescriptorType::eSampledImage:
+			case DescriptorType::eSampler:
+			case DescriptorType::eCombinedImageSampler:
+			case DescriptorType::eStorageImage:
+				dst[i].image = binding.image.dii;
+				break;
+			case DescriptorType::eAccelerationStructureKHR:
+				dst[i].as = binding.as.as;
+				break;
+			default:
+				return false;
+			}
+		}
+		return true;
+	}
 } // namespace vuk
\ No newline at end of file
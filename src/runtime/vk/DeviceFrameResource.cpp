@@ -9,13 +9,150 @@
 #include "vuk/runtime/vk/VkQueueExecutor.hpp"
 #include "vuk/runtime/vk/VkRuntime.hpp"
 
+#include <algorithm>
 #include <atomic>
+#include <bit>
+#include <memory>
 #include <mutex>
 #include <numeric>
 #include <plf_colony.h>
+#include <robin_hood.h>
 #include <shared_mutex>
+#include <unordered_map>
 
 namespace vuk {
+	/// @brief Typed append-only log that any number of threads push to without locking
+	/// Precondition of drain() and clear(): every push has returned and happens-before the call. Before that, a committed count may include
+	/// reservations that are still being copied into. Frame recycling guarantees this: pushes through the superframe hold new_frame_mutex shared,
+	/// get_next_frame holds it exclusively while draining, and a frame must not be used directly after it is recycled.
+	template<class T>
+	struct DeferredReleaseLog {
+		struct Segment {
+			T* items;
+			size_t capacity;
+			std::atomic<size_t> reserved = 0;
+			// reservations are handed out in order, so the committed items always form a prefix
+			std::atomic<size_t> committed = 0;
+			Segment* next = nullptr;
+		};
+
+		static constexpr size_t initial_capacity = 64;
+		std::atomic<Segment*> head = nullptr;
+
+		DeferredReleaseLog() = default;
+		DeferredReleaseLog(const DeferredReleaseLog&) = delete;
+		DeferredReleaseLog& operator=(const DeferredReleaseLog&) = delete;
+
+		~DeferredReleaseLog() {
+			clear();
+			if (auto s = head.load(std::memory_order_relaxed)) {
+				destroy_segment(s);
+			}
+		}
+
+		void push(std::span<const T> src) {
+			if (src.empty()) {
+				return;
+			}
+			Segment* s = head.load(std::memory_order_acquire);
+			while (true) {
+				if (s) {
+					auto start = s->reserved.fetch_add(src.size(), std::memory_order_relaxed);
+					if (start + src.size() <= s->capacity) {
+						std::uninitialized_copy(src.begin(), src.end(), s->items + start);
+						s->committed.fetch_add(src.size(), std::memory_order_release);
+						return;
+					}
+				}
+				// segment is full: publish a larger one that already holds our items
+				auto ns = create_segment(std::max(s ? 2 * s->capacity : initial_capacity, src.size()));
+				std::uninitialized_copy(src.begin(), src.end(), ns->items);
+				ns->reserved.store(src.size(), std::memory_order_relaxed);
+				ns->committed.store(src.size(), std::memory_order_relaxed);
+				ns->next = s;
+				if (head.compare_exchange_strong(s, ns, std::memory_order_acq_rel, std::memory_order_acquire)) {
+					return;
+				}
+				ns->next = nullptr;
+				destroy_segment(ns);
+			}
+		}
+
+		void push(const T& item) {
+			push(std::span{ &item, 1 });
+		}
+
+		/// @brief Calls f with each span of pushed items, only valid once no thread pushes anymore
+		template<class F>
+		void drain(F&& f) {
+			for (auto s = head.load(std::memory_order_acquire); s; s = s->next) {
+				if (auto count = s->committed.load(std::memory_order_acquire); count > 0) {
+					f(std::span<const T>{ s->items, count });
+				}
+			}
+		}
+
+		/// @brief Destroys the items, keeping only the newest (largest) segment for reuse
+		void clear() {
+			auto s = head.load(std::memory_order_acquire);
+			if (!s) {
+				return;
+			}
+			for (auto it = s->next; it;) {
+				auto next = it->next;
+				destroy_segment(it);
+				it = next;
+			}
+			std::destroy_n(s->items, s->committed.load(std::memory_order_relaxed));
+			s->next = nullptr;
+			s->reserved.store(0, std::memory_order_relaxed);
+			s->committed.store(0, std::memory_order_relaxed);
+		}
+
+	private:
+		static Segment* create_segment(size_t capacity) {
+			auto s = new Segment;
+			s->items = std::allocator<T>{}.allocate(capacity);
+			s->capacity = capacity;
+			return s;
+		}
+
+		static void destroy_segment(Segment* s) {
+			std::destroy_n(s->items, s->committed.load(std::memory_order_relaxed));
+			std::allocator<T>{}.deallocate(s->items, s->capacity);
+			delete s;
+		}
+	};
+
+	namespace {
+		// extents are rounded up to 1/8th of their power of two, so an image at most 12.5% larger per dimension is reused
+		uint32_t bucket_dimension(uint32_t x) {
+			if (x <= 16) {
+				return x;
+			}
+			uint32_t step = std::bit_floor(x) / 8;
+			return (x + step - 1) / step * step;
+		}
+
+		uint64_t estimate_image_size(const ImageCreateInfo& ici) {
+			uint64_t size = 0;
+			for (uint32_t mip = 0; mip < ici.mipLevels; mip++) {
+				Extent3D mip_extent{ std::max(ici.extent.width >> mip, 1u), std::max(ici.extent.height >> mip, 1u), std::max(ici.extent.depth >> mip, 1u) };
+				size += compute_image_size(ici.format, mip_extent);
+			}
+			return size * ici.arrayLayers * (uint32_t)ici.samples;
+		}
+	} // namespace
+
+	struct TransientImageEntry {
+		Image image;
+		ImageUsageFlags usage;
+		uint64_t size;
+		uint64_t last_use_frame;
+		// the image can't be handed out again before this frame
+		uint64_t busy_until_frame;
+	};
+
 	struct DeviceSuperFrameResourceImpl {
 		DeviceSuperFrameResource* sfr;
 
@@ -32,9 +169,16 @@ namespace vuk {
 		std::mutex ds_pool_mutex;
 		std::vector<VkDescriptorPool> ds_pools;
 
+		// transient images, keyed on their create info without usage
+		// attachments may opt into having their extent bucketed, in which case they are keyed (and created) with the bucketed extent
 		std::mutex images_mutex;
-		std::unordered_map<ImageCreateInfo, uint32_t> image_identity;
-		Cache<ImageWithIdentity> image_cache;
+		bool attachment_extent_bucketing = false;
+		std::unordered_map<ImageCreateInfo, std::vector<TransientImageEntry>> transient_images;
+		uint64_t transient_image_budget = ~0ULL;
+		uint64_t transient_image_bytes = 0;
+		size_t transient_image_count = 0;
+		TransientImageCacheStats current_image_stats;
+		TransientImageCacheStats last_image_stats;
 		Cache<ImageView> image_view_cache;
 
 		Cache<GraphicsPipelineInfo> graphics_pipeline_cache;
@@ -48,17 +192,6 @@ namespace vuk {
 
 		DeviceSuperFrameResourceImpl(DeviceSuperFrameResource& sfr, size_t frames_in_flight) :
 		    sfr(&sfr),
-		    image_cache(
-		        this,
-		        +[](void* allocator, const CachedImageIdentifier& cii) {
-			        ImageWithIdentity i;
-			        reinterpret_cast<DeviceSuperFrameResourceImpl*>(allocator)->sfr->allocate_images(
-			            { &i.image, 1 }, { &cii.ici, 1 }, VUK_HERE_AND_NOW()); // TODO: dropping error
-			        return i;
-		        },
-		        +[](void* allocator, const ImageWithIdentity& i) {
-			        reinterpret_cast<DeviceSuperFrameResourceImpl*>(allocator)->sfr->deallocate_images({ &i.image, 1 });
-		        }),
 		    image_view_cache(
 		        this,
 		        +[](void* allocator, const CompressedImageViewCreateInfo& civci) {
@@ -121,58 +254,107 @@ namespace vuk {
 				new (frames_storage.get() + i * sizeof(DeviceFrameResource)) DeviceFrameResource(sfr.get_context().device, sfr);
 			}
 			frames = reinterpret_cast<DeviceFrameResource*>(frames_storage.get());
+			for (auto& suballocator : suballocators) {
+				suballocator.runtime = &sfr.get_context();
+			}
+		}
+
+		void evict_transient_image(std::vector<TransientImageEntry>& bucket, size_t index) {
+			auto& entry = bucket[index];
+			sfr->deallocate_images({ &entry.image, 1 });
+			transient_image_bytes -= entry.size;
+			transient_image_count--;
+			current_image_stats.evictions++;
+			bucket[index] = bucket.back();
+			bucket.pop_back();
+		}
+
+		// evict idle images until `incoming` more bytes fit into the budget, the largest and least recently used first
+		void trim_transient_images(uint64_t incoming, uint64_t current_frame) {
+			while (transient_image_bytes + incoming > transient_image_budget) {
+				std::vector<TransientImageEntry>* victim_bucket = nullptr;
+				size_t victim_index = 0;
+				uint64_t victim_score = 0;
+				for (auto& [ici, bucket] : transient_images) {
+					for (size_t i = 0; i < bucket.size(); i++) {
+						auto& entry = bucket[i];
+						if (entry.busy_until_frame >= current_frame) {
+							continue;
+						}
+						uint64_t score = entry.size * (current_frame - entry.last_use_frame + 1);
+						if (score > victim_score) {
+							victim_bucket = &bucket;
+							victim_index = i;
+							victim_score = score;
+						}
+					}
+				}
+				if (!victim_bucket) { // everything is in use, go over budget
+					return;
+				}
+				evict_transient_image(*victim_bucket, victim_index);
+			}
+		}
+
+		// evict idle images not used for more than `threshold` frames
+		void collect_transient_images(uint64_t current_frame, uint64_t threshold) {
+			for (auto it = transient_images.begin(); it != transient_images.end();) {
+				auto& bucket = it->second;
+				for (size_t i = 0; i < bucket.size();) {
+					auto& entry = bucket[i];
+					if (entry.busy_until_frame < current_frame && current_frame - entry.last_use_frame > threshold) {
+						evict_transient_image(bucket, i);
+					} else {
+						i++;
+					}
+				}
+				if (bucket.empty()) {
+					it = transient_images.erase(it);
+				} else {
+					++it;
+				}
+			}
 		}
 	};
 
 	struct DeviceFrameResourceImpl {
 		Runtime* ctx;
-		std::mutex sema_mutex;
-		std::vector<VkSemaphore> semaphores;
-		std::mutex buf_mutex;
-		std::vector<Buffer> buffers;
-		std::mutex fence_mutex;
-		std::vector<VkFence> fences;
-		std::mutex cbuf_mutex;
-		std::vector<CommandBufferAllocation> cmdbuffers_to_free;
-		std::vector<CommandPool> cmdpools_to_free;
-		std::mutex framebuffer_mutex;
-		std::vector<VkFramebuffer> framebuffers;
-		std::mutex images_mutex;
-		std::vector<Image> images;
-		std::mutex image_views_mutex;
-		std::vector<ImageView> image_views;
-		std::mutex pds_mutex;
-		std::vector<PersistentDescriptorSet> persistent_descriptor_sets;
+		// everything released into or allocated from the frame is recorded into lock-free logs, drained when the frame is recycled
+		DeferredReleaseLog<VkSemaphore> semaphores;
+		DeferredReleaseLog<VkFence> fences;
+		DeferredReleaseLog<CommandBufferAllocation> cmdbuffers_to_free;
+		DeferredReleaseLog<CommandPool> cmdpools_to_free;
+		DeferredReleaseLog<VkFramebuffer> framebuffers;
+		DeferredReleaseLog<Image> images;
+		DeferredReleaseLog<ImageView> image_views;
+		DeferredReleaseLog<PersistentDescriptorSet> persistent_descriptor_sets;
+		DeferredReleaseLog<DescriptorSet> descriptor_sets;
 		std::mutex ds_mutex;
-		std::vector<DescriptorSet> descriptor_sets;
 		std::atomic<VkDescriptorPool*> last_ds_pool;
 		plf::colony<VkDescriptorPool> ds_pools;
-		std::vector<VkDescriptorPool> ds_pools_to_destroy;
+		DeferredReleaseLog<VkDescriptorPool> ds_pools_to_destroy;
+		std::shared_mutex written_ds_mutex;
+		// node map: the recorded keys point into their values
+		robin_hood::unordered_node_map<SetBinding, DescriptorSet> written_descriptor_sets;
 
 		// only for use via SuperframeAllocator
-		std::mutex buffers_mutex;
-		std::vector<Buffer> buffer_gpus;
+		DeferredReleaseLog<Buffer> buffer_gpus;
 
+		// queries are written into the current pool in place, so the pools need random access and stay behind a lock
 		std::vector<TimestampQueryPool> ts_query_pools;
 		std::mutex query_pool_mutex;
 		std::mutex ts_query_mutex;
 		uint64_t query_index = 0;
 		uint64_t current_ts_pool = 0;
-		std::mutex syncpoints_mutex;
-		std::vector<SyncPoint> syncpoints;
-		std::mutex as_mutex;
-		std::vector<VkAccelerationStructureKHR> ass;
-		std::mutex swapchain_mutex;
-		std::vector<VkSwapchainKHR> swapchains;
-		std::mutex pipelines_mutex;
-		std::vector<GraphicsPipelineInfo> graphics_pipes;
-		std::vector<ComputePipelineInfo> compute_pipes;
-		std::vector<RayTracingPipelineInfo> ray_tracing_pipes;
-		std::mutex render_passes_mutex;
-		std::vector<VkRenderPass> render_passes;
-		std::mutex address_mutex;
-		std::vector<VirtualAddressSpace> virtual_address_spaces;
-		std::vector<VirtualAllocation> virtual_allocations;
+		DeferredReleaseLog<SyncPoint> syncpoints;
+		DeferredReleaseLog<VkAccelerationStructureKHR> ass;
+		DeferredReleaseLog<VkSwapchainKHR> swapchains;
+		DeferredReleaseLog<GraphicsPipelineInfo> graphics_pipes;
+		DeferredReleaseLog<ComputePipelineInfo> compute_pipes;
+		DeferredReleaseLog<RayTracingPipelineInfo> ray_tracing_pipes;
+		DeferredReleaseLog<VkRenderPass> render_passes;
+		DeferredReleaseLog<VirtualAddressSpace> virtual_address_spaces;
+		DeferredReleaseLog<VirtualAllocation> virtual_allocations;
 
 		BufferUsageFlags all_buffer_usage_flags;
 
@@ -180,6 +362,8 @@ namespace vuk {
 		BufferLinearAllocator linear_cpu_gpu;
 		BufferLinearAllocator linear_gpu_cpu;
 		BufferLinearAllocator linear_gpu_only;
+		// blocks come from the upstream of the superframe, bypassing its suballocators, as they only have the usages of descriptor buffers
+		BufferLinearAllocator descriptor_buffers;
 
 		DeviceFrameResourceImpl(VkDevice device, DeviceSuperFrameResource& upstream) :
 		    ctx(&upstream.get_context()),
@@ -187,7 +371,17 @@ namespace vuk {
 		    linear_cpu_only(upstream, vuk::MemoryUsage::eCPUonly, all_buffer_usage_flags),
 		    linear_cpu_gpu(upstream, vuk::MemoryUsage::eCPUtoGPU, all_buffer_usage_flags),
 		    linear_gpu_cpu(upstream, vuk::MemoryUsage::eGPUtoCPU, all_buffer_usage_flags),
-		    linear_gpu_only(upstream, vuk::MemoryUsage::eGPUonly, all_buffer_usage_flags) {}
+		    linear_gpu_only(upstream, vuk::MemoryUsage::eGPUonly, all_buffer_usage_flags),
+		    descriptor_buffers(*upstream.upstream,
+		                       vuk::MemoryUsage::eCPUtoGPU,
+		                       BufferUsageFlagBits::eSamplerDescriptorBufferEXT | BufferUsageFlagBits::eResourceDescriptorBufferEXT |
+		                           BufferUsageFlagBits::eShaderDeviceAddress,
+		                       1024 * 1024) {
+			linear_cpu_only.runtime = ctx;
+			linear_cpu_gpu.runtime = ctx;
+			linear_gpu_cpu.runtime = ctx;
+			linear_gpu_only.runtime = ctx;
+		}
 	};
 
 	DeviceFrameResource::DeviceFrameResource(VkDevice device, DeviceSuperFrameResource& pstream) :
@@ -197,9 +391,7 @@ namespace vuk {
 
 	Result<void, AllocateException> DeviceFrameResource::allocate_semaphores(std::span<VkSemaphore> dst, SourceLocationAtFrame loc) {
 		VUK_DO_OR_RETURN(upstream->allocate_semaphores(dst, loc));
-		std::unique_lock _(impl->sema_mutex);
-		auto& vec = impl->semaphores;
-		vec.insert(vec.end(), dst.begin(), dst.end());
+		impl->semaphores.push(dst);
 		return { expected_value };
 	}
 
@@ -207,9 +399,7 @@ namespace vuk {
 
 	Result<void, AllocateException> DeviceFrameResource::allocate_fences(std::span<VkFence> dst, SourceLocationAtFrame loc) {
 		VUK_DO_OR_RETURN(upstream->allocate_fences(dst, loc));
-		std::unique_lock _(impl->fence_mutex);
-		auto& vec = impl->fences;
-		vec.insert(vec.end(), dst.begin(), dst.end());
+		impl->fences.push(dst);
 		return { expected_value };
 	}
 
@@ -219,9 +409,7 @@ namespace vuk {
 	                                                                              std::span<const CommandBufferAllocationCreateInfo> cis,
 	                                                                              SourceLocationAtFrame loc) {
 		VUK_DO_OR_RETURN(upstream->allocate_command_buffers(dst, cis, loc));
-		std::unique_lock _(impl->cbuf_mutex);
-		auto& vec = impl->cmdbuffers_to_free;
-		vec.insert(vec.end(), dst.begin(), dst.end());
+		impl->cmdbuffers_to_free.push(dst);
 		return { expected_value };
 	}
 
@@ -230,9 +418,7 @@ namespace vuk {
 	Result<void, AllocateException>
 	DeviceFrameResource::allocate_command_pools(std::span<CommandPool> dst, std::span<const VkCommandPoolCreateInfo> cis, SourceLocationAtFrame loc) {
 		VUK_DO_OR_RETURN(upstream->allocate_command_pools(dst, cis, loc));
-		std::unique_lock _(impl->cbuf_mutex);
-		auto& vec = impl->cmdpools_to_free;
-		vec.insert(vec.end(), dst.begin(), dst.end());
+		impl->cmdpools_to_free.push(dst);
 		return { expected_value };
 	}
 
@@ -269,9 +455,7 @@ namespace vuk {
 	Result<void, AllocateException>
 	DeviceFrameResource::allocate_framebuffers(std::span<VkFramebuffer> dst, std::span<const FramebufferCreateInfo> cis, SourceLocationAtFrame loc) {
 		VUK_DO_OR_RETURN(upstream->allocate_framebuffers(dst, cis, loc));
-		std::unique_lock _(impl->framebuffer_mutex);
-		auto& vec = impl->framebuffers;
-		vec.insert(vec.end(), dst.begin(), dst.end());
+		impl->framebuffers.push(dst);
 		return { expected_value };
 	}
 
@@ -282,14 +466,18 @@ namespace vuk {
 		return { expected_value };
 	}
 
+	Result<void, AllocateException>
+	DeviceFrameResource::allocate_attachment_images(std::span<Image> dst, std::span<const ImageCreateInfo> cis, SourceLocationAtFrame loc) {
+		VUK_DO_OR_RETURN(static_cast<DeviceSuperFrameResource*>(upstream)->allocate_cached_images(dst, cis, loc, 1, true));
+		return { expected_value };
+	}
+
 	void DeviceFrameResource::deallocate_images(std::span<const Image> src) {} // noop
 
 	Result<void, AllocateException>
 	DeviceFrameResource::allocate_image_views(std::span<ImageView> dst, std::span<const ImageViewCreateInfo> cis, SourceLocationAtFrame loc) {
 		VUK_DO_OR_RETURN(upstream->allocate_image_views(dst, cis, loc));
-		std::unique_lock _(impl->image_views_mutex);
-		auto& vec = impl->image_views;
-		vec.insert(vec.end(), dst.begin(), dst.end());
+		impl->image_views.push(dst);
 		return { expected_value };
 	}
 
@@ -299,10 +487,7 @@ namespace vuk {
 	                                                                                         std::span<const PersistentDescriptorSetCreateInfo> cis,
 	                                                                                         SourceLocationAtFrame loc) {
 		VUK_DO_OR_RETURN(upstream->allocate_persistent_descriptor_sets(dst, cis, loc));
-		std::unique_lock _(impl->pds_mutex);
-
-		auto& vec = impl->persistent_descriptor_sets;
-		vec.insert(vec.end(), dst.begin(), dst.end());
+		impl->persistent_descriptor_sets.push(dst);
 		return { expected_value };
 	}
 
@@ -310,17 +495,41 @@ namespace vuk {
 
 	Result<void, AllocateException>
 	DeviceFrameResource::allocate_descriptor_sets_with_value(std::span<DescriptorSet> dst, std::span<const SetBinding> cis, SourceLocationAtFrame loc) {
-		VUK_DO_OR_RETURN(upstream->allocate_descriptor_sets_with_value(dst, cis, loc));
-
-		std::unique_lock _(impl->ds_mutex);
-
-		auto& vec = impl->descriptor_sets;
-		vec.insert(vec.end(), dst.begin(), dst.end());
+		assert(dst.size() == cis.size());
+		for (uint64_t i = 0; i < dst.size(); i++) {
+			if (find_descriptor_set(dst[i], cis[i])) {
+				continue;
+			}
+			VUK_DO_OR_RETURN(upstream->allocate_descriptor_sets_with_value(dst.subspan(i, 1), cis.subspan(i, 1), loc));
+			impl->descriptor_sets.push(dst[i]);
+			record_descriptor_set(dst[i], cis[i]);
+		}
 		return { expected_value };
 	}
 
 	void DeviceFrameResource::deallocate_descriptor_sets(std::span<const DescriptorSet> src) {} // noop
 
+	bool DeviceFrameResource::find_descriptor_set(DescriptorSet& dst, const SetBinding& value) {
+		std::shared_lock _(impl->written_ds_mutex);
+		auto it = impl->written_descriptor_sets.find(value);
+		if (it == impl->written_descriptor_sets.end()) {
+			return false;
+		}
+		dst = it->second;
+		return true;
+	}
+
+	void DeviceFrameResource::record_descriptor_set(const DescriptorSet& ds, const SetBinding& value) {
+		std::unique_lock _(impl->written_ds_mutex);
+		auto [it, inserted] = impl->written_descriptor_sets.emplace(value, ds);
+		// the layout info of the binding may not outlive the frame, point the key at our copy (does not change the hash)
+		const_cast<SetBinding&>(it->first).layout_info = &it->second.layout_info;
+	}
+
+	Result<Buffer, AllocateException> DeviceFrameResource::allocate_descriptor_buffer_memory(size_t size, size_t alignment, SourceLocationAtFrame loc) {
+		return impl->descriptor_buffers.allocate_buffer(size, alignment, loc);
+	}
+
 	Result<void, AllocateException>
 	DeviceFrameResource::allocate_descriptor_sets(std::span<DescriptorSet> dst, std::span<const DescriptorSetLayoutAllocInfo> cis, SourceLocationAtFrame loc) {
 		VkDescriptorPoolCreateInfo dpci{ .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO };
@@ -429,17 +638,11 @@ namespace vuk {
 	void DeviceFrameResource::deallocate_timestamp_queries(std::span<const TimestampQuery> src) {} // noop
 
 	void DeviceFrameResource::wait_sync_points(std::span<const SyncPoint> src) {
-		std::unique_lock _(impl->syncpoints_mutex);
-
-		auto& vec = impl->syncpoints;
-		vec.insert(vec.end(), src.begin(), src.end());
+		impl->syncpoints.push(src);
 	}
 
 	void DeviceFrameResource::deallocate_swapchains(std::span<const VkSwapchainKHR> src) {
-		std::scoped_lock _(impl->swapchain_mutex);
-
-		auto& vec = impl->swapchains;
-		vec.insert(vec.end(), src.begin(), src.end());
+		impl->swapchains.push(src);
 	}
 
 	Result<void, AllocateException> DeviceFrameResource::allocate_graphics_pipelines(std::span<GraphicsPipelineInfo> dst,
@@ -448,9 +651,15 @@ namespace vuk {
 		auto& sfr = *static_cast<DeviceSuperFrameResource*>(upstream);
 		assert(dst.size() == cis.size());
 
+		bool fast_link = sfr.direct && get_context().graphics_pipeline_strategy == GraphicsPipelineStrategy::eLibraryFastLink &&
+		                 get_context().graphics_pipeline_library_enabled;
 		for (uint64_t i = 0; i < dst.size(); i++) {
 			auto& ci = cis[i];
 			dst[i] = sfr.impl->graphics_pipeline_cache.acquire(ci, construction_frame);
+			// once the optimized link has finished, use the optimized pipeline instead of the fast-linked one
+			if (fast_link) {
+				dst[i].pipeline = sfr.direct->get_optimized_graphics_pipeline(dst[i].pipeline);
+			}
 		}
 
 		return { expected_value };
@@ -506,9 +715,7 @@ namespace vuk {
 	                                                                                     std::span<const VirtualAddressSpaceCreateInfo> cis,
 	                                                                                     SourceLocationAtFrame loc) {
 		VUK_DO_OR_RETURN(upstream->allocate_virtual_address_spaces(dst, cis, loc));
-		std::unique_lock _(impl->address_mutex);
-		auto& vec = impl->virtual_address_spaces;
-		vec.insert(vec.end(), dst.begin(), dst.end());
+		impl->virtual_address_spaces.push(dst);
 		return { expected_value };
 	}
 
@@ -518,42 +725,31 @@ namespace vuk {
 	                                                                                  std::span<const VirtualAllocationCreateInfo> cis,
 	                                                                                  SourceLocationAtFrame loc) {
 		VUK_DO_OR_RETURN(upstream->allocate_virtual_allocations(dst, cis, loc));
-		std::unique_lock _(impl->address_mutex);
-		auto& vec = impl->virtual_allocations;
-		vec.insert(vec.end(), dst.begin(), dst.end());
+		impl->virtual_allocations.push(dst);
 		return { expected_value };
 	}
 
 	void DeviceFrameResource::deallocate_virtual_allocations(std::span<const VirtualAllocation> src) {}
 
 	void DeviceFrameResource::wait() {
-		if (impl->fences.size() > 0) {
-			if (impl->fences.size() > 64) {
-				int i = 0;
-				for (; i < impl->fences.size() - 64; i += 64) {
-					impl->ctx->vkWaitForFences(device, 64, impl->fences.data() + i, true, UINT64_MAX);
-				}
-				impl->ctx->vkWaitForFences(device, (uint32_t)impl->fences.size() - i, impl->fences.data() + i, true, UINT64_MAX);
-			} else {
-				impl->ctx->vkWaitForFences(device, (uint32_t)impl->fences.size(), impl->fences.data(), true, UINT64_MAX);
+		impl->fences.drain([&](auto src) {
+			for (size_t i = 0; i < src.size(); i += 64) {
+				impl->ctx->vkWaitForFences(device, (uint32_t)std::min(src.size() - i, size_t(64)), src.data() + i, true, UINT64_MAX);
 			}
-		}
-		if (impl->syncpoints.size() > 0) {
-			VkSemaphoreWaitInfo swi{ VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO };
-
-			std::vector<VkSemaphore> semas;
-			semas.reserve(impl->syncpoints.size());
-			std::vector<uint64_t> values;
-			values.reserve(impl->syncpoints.size());
-
-			for (uint64_t i = 0; i < impl->syncpoints.size(); i++) {
-				auto& sp = impl->syncpoints[i];
+		});
+		std::vector<VkSemaphore> semas;
+		std::vector<uint64_t> values;
+		impl->syncpoints.drain([&](auto src) {
+			for (auto& sp : src) {
 				if (sp.executor->type == Executor::Type::eVulkanDeviceQueue) {
 					auto dev_queue = static_cast<QueueExecutor*>(sp.executor);
 					semas.push_back(dev_queue->get_semaphore());
 					values.push_back(sp.visibility);
 				}
 			}
+		});
+		if (semas.size() > 0) {
+			VkSemaphoreWaitInfo swi{ VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO };
 			swi.pSemaphores = semas.data();
 			swi.pValues = values.data();
 			swi.semaphoreCount = (uint32_t)semas.size();
@@ -569,7 +765,13 @@ namespace vuk {
 
 	Result<void, AllocateException>
 	DeviceMultiFrameResource::allocate_images(std::span<Image> dst, std::span<const ImageCreateInfo> cis, SourceLocationAtFrame loc) {
-		VUK_DO_OR_RETURN(static_cast<DeviceSuperFrameResource*>(upstream)->allocate_cached_images(dst, cis, loc));
+		VUK_DO_OR_RETURN(static_cast<DeviceSuperFrameResource*>(upstream)->allocate_cached_images(dst, cis, loc, frame_lifetime));
+		return { expected_value };
+	}
+
+	Result<void, AllocateException>
+	DeviceMultiFrameResource::allocate_attachment_images(std::span<Image> dst, std::span<const ImageCreateInfo> cis, SourceLocationAtFrame loc) {
+		VUK_DO_OR_RETURN(static_cast<DeviceSuperFrameResource*>(upstream)->allocate_cached_images(dst, cis, loc, frame_lifetime, true));
 		return { expected_value };
 	}
 
@@ -587,26 +789,17 @@ namespace vuk {
 
 	void DeviceSuperFrameResource::deallocate_semaphores(std::span<const VkSemaphore> src) {
 		std::shared_lock _s(impl->new_frame_mutex);
-		auto& f = get_last_frame();
-		std::unique_lock _(f.impl->sema_mutex);
-		auto& vec = get_last_frame().impl->semaphores;
-		vec.insert(vec.end(), src.begin(), src.end());
+		get_last_frame().impl->semaphores.push(src);
 	}
 
 	void DeviceSuperFrameResource::deallocate_fences(std::span<const VkFence> src) {
 		std::shared_lock _s(impl->new_frame_mutex);
-		auto& f = get_last_frame();
-		std::unique_lock _(f.impl->fence_mutex);
-		auto& vec = f.impl->fences;
-		vec.insert(vec.end(), src.begin(), src.end());
+		get_last_frame().impl->fences.push(src);
 	}
 
 	void DeviceSuperFrameResource::deallocate_command_buffers(std::span<const CommandBufferAllocation> src) {
 		std::shared_lock _s(impl->new_frame_mutex);
-		auto& f = get_last_frame();
-		std::unique_lock _(f.impl->cbuf_mutex);
-		auto& vec = f.impl->cmdbuffers_to_free;
-		vec.insert(vec.end(), src.begin(), src.end());
+		get_last_frame().impl->cmdbuffers_to_free.push(src);
 	}
 
 	Result<void, AllocateException>
@@ -635,37 +828,65 @@ namespace vuk {
 
 	void DeviceSuperFrameResource::deallocate_buffers(std::span<const Buffer> src) {
 		std::shared_lock _s(impl->new_frame_mutex);
-		auto& f = get_last_frame();
-		std::unique_lock _(f.impl->buffers_mutex);
-		auto& vec = f.impl->buffer_gpus;
-		vec.insert(vec.end(), src.begin(), src.end());
+		get_last_frame().impl->buffer_gpus.push(src);
 	}
 
 	void DeviceSuperFrameResource::deallocate_framebuffers(std::span<const VkFramebuffer> src) {
 		std::shared_lock _s(impl->new_frame_mutex);
-		auto& f = get_last_frame();
-		std::unique_lock _(f.impl->framebuffer_mutex);
-		auto& vec = f.impl->framebuffers;
-		vec.insert(vec.end(), src.begin(), src.end());
+		get_last_frame().impl->framebuffers.push(src);
 	}
 
 	void DeviceSuperFrameResource::deallocate_images(std::span<const Image> src) {
 		std::shared_lock _s(impl->new_frame_mutex);
-		auto& f = get_last_frame();
-		std::unique_lock _(f.impl->images_mutex);
-		auto& vec = f.impl->images;
-		vec.insert(vec.end(), src.begin(), src.end());
+		get_last_frame().impl->images.push(src);
 	}
 
-	Result<void, AllocateException>
-	DeviceSuperFrameResource::allocate_cached_images(std::span<Image> dst, std::span<const ImageCreateInfo> cis, SourceLocationAtFrame loc) {
+	Result<void, AllocateException> DeviceSuperFrameResource::allocate_cached_images(std::span<Image> dst,
+	                                                                                  std::span<const ImageCreateInfo> cis,
+	                                                                                  SourceLocationAtFrame loc,
+	                                                                                  uint32_t frame_lifetime,
+	                                                                                  bool allow_larger) {
 		std::unique_lock _(impl->images_mutex);
 		assert(dst.size() == cis.size());
+		uint64_t current_frame = impl->frame_counter;
 		for (uint64_t i = 0; i < dst.size(); i++) {
-			auto& ci = cis[i];
-			auto index = impl->image_identity[ci]++;
-			CachedImageIdentifier iici = { ci, index, 0 };
-			dst[i] = impl->image_cache.acquire(iici, impl->frame_counter).image;
+			auto ici = cis[i];
+			if (allow_larger && impl->attachment_extent_bucketing) {
+				ici.extent = { bucket_dimension(ici.extent.width), bucket_dimension(ici.extent.height), bucket_dimension(ici.extent.depth) };
+			}
+			auto key = ici;
+			key.usage = {};
+			auto& bucket = impl->transient_images[key];
+
+			// prefer an idle image with the exact usage, then one with a superset of it
+			TransientImageEntry* found = nullptr;
+			for (auto& entry : bucket) {
+				if (entry.busy_until_frame >= current_frame || (entry.usage & ici.usage) != ici.usage) {
+					continue;
+				}
+				if (!found || entry.usage == ici.usage) {
+					found = &entry;
+				}
+				if (entry.usage == ici.usage) {
+					break;
+				}
+			}
+
+			if (found) {
+				impl->current_image_stats.hits++;
+			} else {
+				impl->current_image_stats.misses++;
+				auto size = estimate_image_size(ici);
+				impl->trim_transient_images(size, current_frame);
+				Image image;
+				VUK_DO_OR_RETURN(allocate_images({ &image, 1 }, { &ici, 1 }, loc));
+				found = &bucket.emplace_back(TransientImageEntry{ image, ici.usage, size });
+				impl->transient_image_bytes += size;
+				impl->transient_image_count++;
+			}
+			found->last_use_frame = current_frame;
+			found->busy_until_frame = current_frame + frame_lifetime - 1;
+			dst[i] = found->image;
 		}
 		return { expected_value };
 	}
@@ -694,26 +915,17 @@ namespace vuk {
 
 	void DeviceSuperFrameResource::deallocate_image_views(std::span<const ImageView> src) {
 		std::shared_lock _s(impl->new_frame_mutex);
-		auto& f = get_last_frame();
-		std::unique_lock _(f.impl->image_views_mutex);
-		auto& vec = f.impl->image_views;
-		vec.insert(vec.end(), src.begin(), src.end());
+		get_last_frame().impl->image_views.push(src);
 	}
 
 	void DeviceSuperFrameResource::deallocate_persistent_descriptor_sets(std::span<const PersistentDescriptorSet> src) {
 		std::shared_lock _s(impl->new_frame_mutex);
-		auto& f = get_last_frame();
-		std::unique_lock _(f.impl->pds_mutex);
-		auto& vec = f.impl->persistent_descriptor_sets;
-		vec.insert(vec.end(), src.begin(), src.end());
+		get_last_frame().impl->persistent_descriptor_sets.push(src);
 	}
 
 	void DeviceSuperFrameResource::deallocate_descriptor_sets(std::span<const DescriptorSet> src) {
 		std::shared_lock _s(impl->new_frame_mutex);
-		auto& f = get_last_frame();
-		std::unique_lock _(f.impl->ds_mutex);
-		auto& vec = f.impl->descriptor_sets;
-		vec.insert(vec.end(), src.begin(), src.end());
+		get_last_frame().impl->descriptor_sets.push(src);
 	}
 
 	Result<void, AllocateException> DeviceSuperFrameResource::allocate_descriptor_pools(std::span<VkDescriptorPool> dst,
@@ -736,10 +948,7 @@ namespace vuk {
 
 	void DeviceSuperFrameResource::deallocate_descriptor_pools(std::span<const VkDescriptorPool> src) {
 		std::shared_lock _s(impl->new_frame_mutex);
-		auto& f = get_last_frame();
-		std::unique_lock _(f.impl->ds_mutex);
-		auto& vec = f.impl->ds_pools_to_destroy;
-		vec.insert(vec.end(), src.begin(), src.end());
+		get_last_frame().impl->ds_pools_to_destroy.push(src);
 	}
 
 	void DeviceSuperFrameResource::deallocate_timestamp_query_pools(std::span<const TimestampQueryPool> src) {
@@ -754,74 +963,47 @@ namespace vuk {
 
 	void DeviceSuperFrameResource::wait_sync_points(std::span<const SyncPoint> src) {
 		std::shared_lock _s(impl->new_frame_mutex);
-		auto& f = get_last_frame();
-		std::unique_lock _(f.impl->syncpoints_mutex);
-		auto& vec = f.impl->syncpoints;
-		vec.insert(vec.end(), src.begin(), src.end());
+		get_last_frame().impl->syncpoints.push(src);
 	}
 
 	void DeviceSuperFrameResource::deallocate_acceleration_structures(std::span<const VkAccelerationStructureKHR> src) {
 		std::shared_lock _s(impl->new_frame_mutex);
-		auto& f = get_last_frame();
-		std::unique_lock _(f.impl->as_mutex);
-		auto& vec = f.impl->ass;
-		vec.insert(vec.end(), src.begin(), src.end());
+		get_last_frame().impl->ass.push(src);
 	}
 
 	void DeviceSuperFrameResource::deallocate_swapchains(std::span<const VkSwapchainKHR> src) {
 		std::shared_lock _s(impl->new_frame_mutex);
-		auto& f = get_last_frame();
-		std::unique_lock _(f.impl->swapchain_mutex);
-		auto& vec = f.impl->swapchains;
-		vec.insert(vec.end(), src.begin(), src.end());
+		get_last_frame().impl->swapchains.push(src);
 	}
 
 	void DeviceSuperFrameResource::deallocate_graphics_pipelines(std::span<const GraphicsPipelineInfo> src) {
 		std::shared_lock _s(impl->new_frame_mutex);
-		auto& f = get_last_frame();
-		std::unique_lock _(f.impl->pipelines_mutex);
-		auto& vec = f.impl->graphics_pipes;
-		vec.insert(vec.end(), src.begin(), src.end());
+		get_last_frame().impl->graphics_pipes.push(src);
 	}
 
 	void DeviceSuperFrameResource::deallocate_compute_pipelines(std::span<const ComputePipelineInfo> src) {
 		std::shared_lock _s(impl->new_frame_mutex);
-		auto& f = get_last_frame();
-		std::unique_lock _(f.impl->pipelines_mutex);
-		auto& vec = f.impl->compute_pipes;
-		vec.insert(vec.end(), src.begin(), src.end());
+		get_last_frame().impl->compute_pipes.push(src);
 	}
 
 	void DeviceSuperFrameResource::deallocate_ray_tracing_pipelines(std::span<const RayTracingPipelineInfo> src) {
 		std::shared_lock _s(impl->new_frame_mutex);
-		auto& f = get_last_frame();
-		std::unique_lock _(f.impl->pipelines_mutex);
-		auto& vec = f.impl->ray_tracing_pipes;
-		vec.insert(vec.end(), src.begin(), src.end());
+		get_last_frame().impl->ray_tracing_pipes.push(src);
 	}
 
 	void DeviceSuperFrameResource::deallocate_render_passes(std::span<const VkRenderPass> src) {
 		std::shared_lock _s(impl->new_frame_mutex);
-		auto& f = get_last_frame();
-		std::unique_lock _(f.impl->render_passes_mutex);
-		auto& vec = f.impl->render_passes;
-		vec.insert(vec.end(), src.begin(), src.end());
+		get_last_frame().impl->render_passes.push(src);
 	}
 
 	void DeviceSuperFrameResource::deallocate_virtual_address_spaces(std::span<const VirtualAddressSpace> src) {
 		std::shared_lock _s(impl->new_frame_mutex);
-		auto& f = get_last_frame();
-		std::unique_lock _(f.impl->address_mutex);
-		auto& vec = f.impl->virtual_address_spaces;
-		vec.insert(vec.end(), src.begin(), src.end());
+		get_last_frame().impl->virtual_address_spaces.push(src);
 	}
 
 	void DeviceSuperFrameResource::deallocate_virtual_allocations(std::span<const VirtualAllocation> src) {
 		std::shared_lock _s(impl->new_frame_mutex);
-		auto& f = get_last_frame();
-		std::unique_lock _(f.impl->address_mutex);
-		auto& vec = f.impl->virtual_allocations;
-		vec.insert(vec.end(), src.begin(), src.end());
+		get_last_frame().impl->virtual_allocations.push(src);
 	}
 
 	DeviceFrameResource& DeviceSuperFrameResource::get_last_frame() {
@@ -838,6 +1020,7 @@ namespace vuk {
 					trim_frame.impl->linear_cpu_gpu.trim();
 					trim_frame.impl->linear_gpu_cpu.trim();
 					trim_frame.impl->linear_gpu_only.trim();
+					trim_frame.impl->descriptor_buffers.trim();
 				}
 			}
 		}
@@ -865,10 +1048,17 @@ namespace vuk {
 			}
 		}
 
-		impl->image_identity.clear();
 		_s.unlock();
 		// garbage collect caches
-		impl->image_cache.collect(impl->frame_counter, 16);
+		{
+			std::unique_lock _(impl->images_mutex);
+			impl->collect_transient_images(impl->frame_counter, 16);
+			impl->trim_transient_images(0, impl->frame_counter);
+			impl->last_image_stats = impl->current_image_stats;
+			impl->last_image_stats.image_count = impl->transient_image_count;
+			impl->last_image_stats.bytes = impl->transient_image_bytes;
+			impl->current_image_stats = {};
+		}
 		impl->image_view_cache.collect(impl->frame_counter, 16);
 		impl->graphics_pipeline_cache.collect(impl->frame_counter, 16);
 		impl->compute_pipeline_cache.collect(impl->frame_counter, 16);
@@ -888,41 +1078,44 @@ namespace vuk {
 	template<class T>
 	void DeviceSuperFrameResource::deallocate_frame(T& frame) {
 		auto& f = *frame.impl;
-		upstream->deallocate_semaphores(f.semaphores);
-		upstream->deallocate_fences(f.fences);
-		upstream->deallocate_command_buffers(f.cmdbuffers_to_free);
-		for (auto& pool : f.cmdpools_to_free) {
-			direct->ctx->vkResetCommandPool(get_context().device, pool.command_pool, {});
-		}
-		deallocate_command_pools(f.cmdpools_to_free);
-		for (Buffer& buf : f.buffer_gpus) {
-			impl->suballocators[(int)buf.memory_usage - 1].deallocate_buffer(buf);
-		}
-		upstream->deallocate_framebuffers(f.framebuffers);
-		upstream->deallocate_images(f.images);
-		upstream->deallocate_image_views(f.image_views);
-		upstream->deallocate_persistent_descriptor_sets(f.persistent_descriptor_sets);
-		upstream->deallocate_descriptor_sets(f.descriptor_sets);
+		f.semaphores.drain([&](auto src) { upstream->deallocate_semaphores(src); });
+		f.fences.drain([&](auto src) { upstream->deallocate_fences(src); });
+		f.cmdbuffers_to_free.drain([&](auto src) { upstream->deallocate_command_buffers(src); });
+		f.cmdpools_to_free.drain([&](auto src) {
+			for (auto& pool : src) {
+				direct->ctx->vkResetCommandPool(get_context().device, pool.command_pool, {});
+			}
+			deallocate_command_pools(src);
+		});
+		f.buffer_gpus.drain([&](auto src) {
+			for (const Buffer& buf : src) {
+				impl->suballocators[(int)buf.memory_usage - 1].deallocate_buffer(buf);
+			}
+		});
+		f.framebuffers.drain([&](auto src) { upstream->deallocate_framebuffers(src); });
+		f.images.drain([&](auto src) { upstream->deallocate_images(src); });
+		f.image_views.drain([&](auto src) { upstream->deallocate_image_views(src); });
+		f.persistent_descriptor_sets.drain([&](auto src) { upstream->deallocate_persistent_descriptor_sets(src); });
+		f.descriptor_sets.drain([&](auto src) { upstream->deallocate_descriptor_sets(src); });
 		get_context().make_timestamp_results_available(f.ts_query_pools);
 		upstream->deallocate_timestamp_query_pools(f.ts_query_pools);
-		upstream->deallocate_acceleration_structures(f.ass);
-		upstream->deallocate_swapchains(f.swapchains);
-		upstream->deallocate_buffers(f.buffers);
+		f.ass.drain([&](auto src) { upstream->deallocate_acceleration_structures(src); });
+		f.swapchains.drain([&](auto src) { upstream->deallocate_swapchains(src); });
 
 		for (auto& p : f.ds_pools) {
 			direct->ctx->vkResetDescriptorPool(get_context().device, p, {});
 			impl->ds_pools.push_back(p);
 		}
 
-		upstream->deallocate_descriptor_pools(f.ds_pools_to_destroy);
-		upstream->deallocate_graphics_pipelines(f.graphics_pipes);
-		upstream->deallocate_compute_pipelines(f.compute_pipes);
-		upstream->deallocate_ray_tracing_pipelines(f.ray_tracing_pipes);
-		upstream->deallocate_render_passes(f.render_passes);
+		f.ds_pools_to_destroy.drain([&](auto src) { upstream->deallocate_descriptor_pools(src); });
+		f.graphics_pipes.drain([&](auto src) { upstream->deallocate_graphics_pipelines(src); });
+		f.compute_pipes.drain([&](auto src) { upstream->deallocate_compute_pipelines(src); });
+		f.ray_tracing_pipes.drain([&](auto src) { upstream->deallocate_ray_tracing_pipelines(src); });
+		f.render_passes.drain([&](auto src) { upstream->deallocate_render_passes(src); });
 
 		// Deallocate virtual allocations before their address spaces
-		upstream->deallocate_virtual_allocations(f.virtual_allocations);
-		upstream->deallocate_virtual_address_spaces(f.virtual_address_spaces);
+		f.virtual_allocations.drain([&](auto src) { upstream->deallocate_virtual_allocations(src); });
+		f.virtual_address_spaces.drain([&](auto src) { upstream->deallocate_virtual_address_spaces(src); });
 
 		f.semaphores.clear();
 		f.fences.clear();
@@ -935,18 +1128,19 @@ namespace vuk {
 			f.linear_cpu_gpu.reset();
 			f.linear_gpu_cpu.reset();
 			f.linear_gpu_only.reset();
+			f.descriptor_buffers.reset();
 		}
 		f.framebuffers.clear();
 		f.images.clear();
 		f.image_views.clear();
 		f.persistent_descriptor_sets.clear();
 		f.descriptor_sets.clear();
+		f.written_descriptor_sets.clear();
 		f.ts_query_pools.clear();
 		f.query_index = 0;
 		f.syncpoints.clear();
 		f.ass.clear();
 		f.swapchains.clear();
-		f.buffers.clear();
 		f.ds_pools_to_destroy.clear();
 		f.graphics_pipes.clear();
 		f.compute_pipes.clear();
@@ -957,7 +1151,10 @@ namespace vuk {
 	}
 
 	void DeviceSuperFrameResource::force_collect() {
-		impl->image_cache.collect(impl->frame_counter, 0);
+		{
+			std::unique_lock _(impl->images_mutex);
+			impl->collect_transient_images(impl->frame_counter, 0);
+		}
 		impl->image_view_cache.collect(impl->frame_counter, 0);
 		impl->graphics_pipeline_cache.collect(impl->frame_counter, 0);
 		impl->compute_pipeline_cache.collect(impl->frame_counter, 0);
@@ -965,8 +1162,28 @@ namespace vuk {
 		impl->render_pass_cache.collect(impl->frame_counter, 0);
 	}
 
+	void DeviceSuperFrameResource::set_transient_image_budget(uint64_t bytes) {
+		std::unique_lock _(impl->images_mutex);
+		impl->transient_image_budget = bytes;
+	}
+
+	void DeviceSuperFrameResource::set_attachment_extent_bucketing(bool enable) {
+		std::unique_lock _(impl->images_mutex);
+		impl->attachment_extent_bucketing = enable;
+	}
+
+	TransientImageCacheStats DeviceSuperFrameResource::get_transient_image_stats() {
+		std::unique_lock _(impl->images_mutex);
+		return impl->last_image_stats;
+	}
+
 	DeviceSuperFrameResource::~DeviceSuperFrameResource() {
-		impl->image_cache.clear();
+		for (auto& [ici, bucket] : impl->transient_images) {
+			for (auto& entry : bucket) {
+				deallocate_images({ &entry.image, 1 });
+			}
+		}
+		impl->transient_images.clear();
 		impl->image_view_cache.clear();
 		impl->graphics_pipeline_cache.clear();
 		impl->compute_pipeline_cache.clear();
@@ -982,6 +1199,7 @@ namespace vuk {
 			f.impl->linear_gpu_cpu.free();
 			f.impl->linear_cpu_only.free();
 			f.impl->linear_gpu_only.free();
+			f.impl->descriptor_buffers.free();
 		}
 
 		for (auto i = 0; i < frames_in_flight; i++) {
@@ -17,8 +17,12 @@
 		printf("\n");                                                                                                                                              \
 	} while (false)
 #endif
+#include <condition_variable>
 #include <mutex>
+#include <robin_hood.h>
+#include <shared_mutex>
 #include <sstream>
+#include <thread>
 #include <vk_mem_alloc.h>
 
 namespace vuk {
@@ -45,6 +49,22 @@ namespace vuk {
 		}
 	}
 
+	// a graphics pipeline library part, alive as long as there are pipelines linked from it
+	struct PipelineLibrary {
+		VkPipeline pipeline;
+		uint32_t ref_count = 0;
+	};
+
+	using PipelineLibraryMap = robin_hood::unordered_node_map<std::string, PipelineLibrary>;
+
+	// the libraries a pipeline was fast-linked from, kept around to perform the optimized link later
+	struct PipelineLibraryLink {
+		std::array<PipelineLibraryMap::value_type*, 4> libraries;
+		VkPipelineLayout layout;
+		VkPipelineCreateFlags flags = 0;
+		VkPipeline optimized = VK_NULL_HANDLE;
+	};
+
 	struct DeviceVkResourceImpl {
 		std::mutex mutex;
 		VmaAllocator allocator;
@@ -53,6 +73,30 @@ namespace vuk {
 		uint32_t queue_family_count;
 
 		vuk::BufferUsageFlags all_buffer_usage_flags;
+
+		// graphics pipeline library parts, indexed by VkGraphicsPipelineLibraryFlagBitsEXT bit index:
+		// vertex input interface, pre-rasterization shaders, fragment shader, fragment output interface
+		// the keys are built from the content hashes of the shader modules, pipeline layouts and render passes, as handles are recycled
+		std::mutex library_mutex;
+		std::array<PipelineLibraryMap, 4> pipeline_libraries;
+		robin_hood::unordered_flat_map<VkRenderPass, size_t> render_pass_hashes;
+		std::shared_mutex linked_pipelines_mutex;
+		robin_hood::unordered_flat_map<VkPipeline, PipelineLibraryLink> linked_pipelines;
+		std::vector<VkPipeline> pending_optimized_links;
+		// optimized links are performed on a background thread, started when the first pipeline is fast-linked
+		std::condition_variable_any link_cv;
+		std::thread link_thread;
+		bool stop_linking = false;
+
+		void release_libraries(Runtime& ctx, VkDevice device, std::span<PipelineLibraryMap::value_type* const> libraries) {
+			std::scoped_lock _(library_mutex);
+			for (uint32_t part = 0; part < libraries.size(); part++) {
+				if (--libraries[part]->second.ref_count == 0) {
+					ctx.vkDestroyPipeline(device, libraries[part]->second.pipeline, nullptr);
+					pipeline_libraries[part].erase(pipeline_libraries[part].find(libraries[part]->first));
+				}
+			}
+		}
 	};
 
 	DeviceVkResource::DeviceVkResource(Runtime& ctx) : ctx(&ctx), device(ctx.device), impl(new DeviceVkResourceImpl) {
@@ -61,10 +105,14 @@ namespace vuk {
 		allocatorInfo.physicalDevice = ctx.physical_device;
 		allocatorInfo.device = device;
 		allocatorInfo.flags = VMA_ALLOCATOR_CREATE_EXTERNALLY_SYNCHRONIZED_BIT | VMA_ALLOCATOR_CREATE_BUFFER_DEVICE_ADDRESS_BIT;
+		if (ctx.memory_budget_enabled) {
+			allocatorInfo.flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
+		}
 
 		VmaVulkanFunctions vulkanFunctions = {};
 		vulkanFunctions.vkGetPhysicalDeviceProperties = ctx.vkGetPhysicalDeviceProperties;
 		vulkanFunctions.vkGetPhysicalDeviceMemoryProperties = ctx.vkGetPhysicalDeviceMemoryProperties;
+		vulkanFunctions.vkGetPhysicalDeviceMemoryProperties2KHR = ctx.vkGetPhysicalDeviceMemoryProperties2;
 		vulkanFunctions.vkAllocateMemory = ctx.vkAllocateMemory;
 		vulkanFunctions.vkFreeMemory = ctx.vkFreeMemory;
 		vulkanFunctions.vkMapMemory = ctx.vkMapMemory;
@@ -92,6 +140,22 @@ namespace vuk {
 	}
 
 	DeviceVkResource::~DeviceVkResource() {
+		if (impl->link_thread.joinable()) {
+			{
+				std::unique_lock _(impl->linked_pipelines_mutex);
+				impl->stop_linking = true;
+			}
+			impl->link_cv.notify_one();
+			impl->link_thread.join();
+		}
+		for (auto& [fast_linked, link] : impl->linked_pipelines) {
+			ctx->vkDestroyPipeline(device, link.optimized, nullptr);
+		}
+		for (auto& libraries : impl->pipeline_libraries) {
+			for (auto& [key, library] : libraries) {
+				ctx->vkDestroyPipeline(device, library.pipeline, nullptr);
+			}
+		}
 		vmaDestroyAllocator(impl->allocator);
 		delete impl;
 	}
@@ -215,7 +279,7 @@ namespace vuk {
 			auto& ci = cis[i];
 			VkBufferCreateInfo bci{ .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
 			bci.size = ci.size;
-			bci.usage = (VkBufferUsageFlags)impl->all_buffer_usage_flags;
+			bci.usage = (VkBufferUsageFlags)(ci.usage ? ci.usage : impl->all_buffer_usage_flags);
 			bci.queueFamilyIndexCount = impl->queue_family_count;
 			bci.sharingMode = bci.queueFamilyIndexCount > 1 ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE;
 			bci.pQueueFamilyIndices = impl->all_queue_families.data();
@@ -236,6 +300,7 @@ namespace vuk {
 #if VUK_DEBUG_ALLOCATIONS
 			vmaSetAllocationName(impl->allocator, allocation, to_string(loc).c_str());
 #endif
+			ctx->record_allocations(AllocationKind::eBuffer, ci.mem_usage, 1, (int64_t)allocation_info.size);
 			VkBufferDeviceAddressInfo bdai{ VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO, nullptr, buffer };
 			uint64_t device_address = ctx->vkGetBufferDeviceAddress(device, &bdai);
 			dst[i] = Buffer{ allocation, buffer, 0, ci.size, device_address, static_cast<std::byte*>(allocation_info.pMappedData), ci.mem_usage };
@@ -246,6 +311,9 @@ namespace vuk {
 	void DeviceVkResource::deallocate_buffers(std::span<const Buffer> src) {
 		for (auto& v : src) {
 			if (v) {
+				VmaAllocationInfo allocation_info;
+				vmaGetAllocationInfo(impl->allocator, static_cast<VmaAllocation>(v.allocation), &allocation_info);
+				ctx->record_allocations(AllocationKind::eBuffer, v.memory_usage, -1, -(int64_t)allocation_info.size);
 				vmaDestroyBuffer(impl->allocator, v.buffer, static_cast<VmaAllocation>(v.allocation));
 			}
 		}
@@ -264,13 +332,14 @@ namespace vuk {
 
 			VkImage vkimg;
 			VmaAllocation allocation;
+			VmaAllocationInfo allocation_info;
 			VkImageCreateInfo vkici = cis[i];
 			if (cis[i].usage & (vuk::ImageUsageFlagBits::eColorAttachment | vuk::ImageUsageFlagBits::eDepthStencilAttachment)) {
 				// this is a rendertarget, put it into the dedicated memory
 				aci.flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
 			}
 
-			auto res = vmaCreateImage(impl->allocator, &vkici, &aci, &vkimg, &allocation, nullptr);
+			auto res = vmaCreateImage(impl->allocator, &vkici, &aci, &vkimg, &allocation, &allocation_info);
 
 			if (res != VK_SUCCESS) {
 				deallocate_images({ dst.data(), (uint64_t)i });
@@ -279,6 +348,7 @@ namespace vuk {
 #if VUK_DEBUG_ALLOCATIONS
 			vmaSetAllocationName(impl->allocator, allocation, to_string(loc).c_str());
 #endif
+			ctx->record_allocations(AllocationKind::eImage, MemoryUsage::eGPUonly, 1, (int64_t)allocation_info.size);
 
 			dst[i] = Image{ vkimg, allocation };
 		}
@@ -288,11 +358,31 @@ namespace vuk {
 	void DeviceVkResource::deallocate_images(std::span<const Image> src) {
 		for (auto& v : src) {
 			if (v) {
+				VmaAllocationInfo allocation_info;
+				vmaGetAllocationInfo(impl->allocator, static_cast<VmaAllocation>(v.allocation), &allocation_info);
+				ctx->record_allocations(AllocationKind::eImage, MemoryUsage::eGPUonly, -1, -(int64_t)allocation_info.size);
 				vmaDestroyImage(impl->allocator, v.image, static_cast<VmaAllocation>(v.allocation));
 			}
 		}
 	}
 
+	std::vector<MemoryHeapStats> DeviceVkResource::get_memory_heap_stats() {
+		const VkPhysicalDeviceMemoryProperties* memory_properties;
+		vmaGetMemoryProperties(impl->allocator, &memory_properties);
+		std::array<VmaBudget, VK_MAX_MEMORY_HEAPS> budgets;
+		{
+			std::lock_guard _(impl->mutex);
+			vmaGetHeapBudgets(impl->allocator, budgets.data());
+		}
+		std::vector<MemoryHeapStats> heaps(memory_properties->memoryHeapCount);
+		for (uint32_t i = 0; i < memory_properties->memoryHeapCount; i++) {
+			auto& heap = memory_properties->memoryHeaps[i];
+			auto& budget = budgets[i];
+			heaps[i] = { heap.flags, heap.size, budget.usage, budget.budget, budget.statistics.blockBytes, budget.statistics.allocationBytes };
+		}
+		return heaps;
+	}
+
 	void DeviceVkResource::set_image_allocation_name(Image& dst, Name name) {
 		vmaSetAllocationName(impl->allocator, static_cast<VmaAllocation>(dst.allocation), name.c_str());
 	}
@@ -405,6 +495,16 @@ namespace vuk {
 			auto& cinfo = cis[i];
 			auto& pool = ctx->acquire_descriptor_pool(*cinfo.layout_info, ctx->get_frame_count());
 			auto ds = pool.acquire(*ctx, *cinfo.layout_info);
+			if (ds == VK_NULL_HANDLE) {
+				deallocate_descriptor_sets({ dst.data(), (uint64_t)i });
+				return { expected_error, AllocateException{ VK_ERROR_OUT_OF_POOL_MEMORY } };
+			}
+			DescriptorTemplateEntry template_data[VUK_MAX_BINDINGS];
+			if (cinfo.pack_template_data(template_data)) {
+				ctx->vkUpdateDescriptorSetWithTemplate(device, ds, cinfo.layout_info->update_template, template_data);
+				dst[i] = { ds, *cinfo.layout_info };
+				continue;
+			}
 			auto mask = cinfo.used.to_ulong();
 			uint32_t leading_ones = num_leading_ones((uint32_t)mask);
 			std::array<VkWriteDescriptorSet, VUK_MAX_BINDINGS> writes = {};
@@ -457,7 +557,12 @@ namespace vuk {
 		for (int64_t i = 0; i < (int64_t)dst.size(); i++) {
 			auto& cinfo = cis[i];
 			auto& pool = ctx->acquire_descriptor_pool(cinfo, ctx->get_frame_count());
-			dst[i] = { pool.acquire(*ctx, cinfo), cinfo };
+			auto ds = pool.acquire(*ctx, cinfo);
+			if (ds == VK_NULL_HANDLE) {
+				deallocate_descriptor_sets({ dst.data(), (uint64_t)i });
+				return { expected_error, AllocateException{ VK_ERROR_OUT_OF_POOL_MEMORY } };
+			}
+			dst[i] = { ds, cinfo };
 		}
 		return { expected_value };
 	}
@@ -465,7 +570,7 @@ namespace vuk {
 	void DeviceVkResource::deallocate_descriptor_sets(std::span<const DescriptorSet> src) {
 		for (int64_t i = 0; i < (int64_t)src.size(); i++) {
 			DescriptorPool& pool = ctx->acquire_descriptor_pool(src[i].layout_info, ctx->get_frame_count());
-			pool.release(src[i].descriptor_set);
+			pool.release(*ctx, src[i].descriptor_set);
 		}
 	}
 
@@ -577,6 +682,263 @@ namespace vuk {
 		return t;
 	};
 
+	// indexed by the bit index of DynamicStateFlagBits
+	static constexpr VkDynamicState dynamic_state_bit_to_vk[] = {
+		VK_DYNAMIC_STATE_VIEWPORT,
+		VK_DYNAMIC_STATE_SCISSOR,
+		VK_DYNAMIC_STATE_LINE_WIDTH,
+		VK_DYNAMIC_STATE_DEPTH_BIAS,
+		VK_DYNAMIC_STATE_BLEND_CONSTANTS,
+		VK_DYNAMIC_STATE_DEPTH_BOUNDS,
+		VK_DYNAMIC_STATE_CULL_MODE_EXT,
+		VK_DYNAMIC_STATE_FRONT_FACE_EXT,
+		VK_DYNAMIC_STATE_PRIMITIVE_TOPOLOGY_EXT,
+		VK_DYNAMIC_STATE_DEPTH_TEST_ENABLE_EXT,
+		VK_DYNAMIC_STATE_DEPTH_WRITE_ENABLE_EXT,
+		VK_DYNAMIC_STATE_DEPTH_COMPARE_OP_EXT,
+		VK_DYNAMIC_STATE_STENCIL_TEST_ENABLE_EXT,
+		VK_DYNAMIC_STATE_STENCIL_OP_EXT,
+		VK_DYNAMIC_STATE_RASTERIZER_DISCARD_ENABLE_EXT,
+		VK_DYNAMIC_STATE_DEPTH_BIAS_ENABLE_EXT,
+		VK_DYNAMIC_STATE_PRIMITIVE_RESTART_ENABLE_EXT,
+		VK_DYNAMIC_STATE_DEPTH_CLAMP_ENABLE_EXT,
+		VK_DYNAMIC_STATE_POLYGON_MODE_EXT,
+		VK_DYNAMIC_STATE_COLOR_BLEND_ENABLE_EXT,
+		VK_DYNAMIC_STATE_COLOR_BLEND_EQUATION_EXT,
+		VK_DYNAMIC_STATE_COLOR_WRITE_MASK_EXT,
+		VK_DYNAMIC_STATE_VERTEX_INPUT_EXT,
+	};
+
+	namespace {
+		// pipelines with descriptor buffer set layouts must be created for descriptor buffers
+		VkPipelineCreateFlags descriptor_buffer_flags(const PipelineBaseInfo& base) {
+			for (auto& li : base.layout_info) {
+				if (li.descriptor_buffer_size > 0) {
+					return VK_PIPELINE_CREATE_DESCRIPTOR_BUFFER_BIT_EXT;
+				}
+			}
+			return 0;
+		}
+
+		template<class T>
+		void append_key(std::string& key, const T& value) {
+			key.append(reinterpret_cast<const char*>(&value), sizeof(T));
+		}
+
+		template<class T>
+		void append_key(std::string& key, const T* values, uint32_t count) {
+			append_key(key, count);
+			if (values) {
+				key.append(reinterpret_cast<const char*>(values), sizeof(T) * count);
+			}
+		}
+
+		void append_key(std::string& key, const VkPipelineShaderStageCreateInfo& pssci, size_t shader_hash) {
+			append_key(key, pssci.stage);
+			append_key(key, shader_hash);
+			key.append(pssci.pName);
+			key.push_back('\0');
+			if (auto si = pssci.pSpecializationInfo) {
+				append_key(key, si->pMapEntries, si->mapEntryCount);
+				append_key(key, reinterpret_cast<const std::byte*>(si->pData), (uint32_t)si->dataSize);
+			}
+		}
+
+		void append_key(std::string& key, const VkPipelineMultisampleStateCreateInfo& ms) {
+			append_key(key, ms.rasterizationSamples);
+			append_key(key, ms.sampleShadingEnable);
+			append_key(key, ms.minSampleShading);
+			append_key(key, ms.alphaToCoverageEnable);
+			append_key(key, ms.alphaToOneEnable);
+		}
+
+		// acquires a reference to a library, released when the pipelines linked from it are deallocated
+		VkResult acquire_pipeline_library(Runtime& ctx,
+		                                  VkDevice device,
+		                                  DeviceVkResourceImpl& impl,
+		                                  uint32_t part,
+		                                  std::string key,
+		                                  VkGraphicsPipelineCreateInfo gpci,
+		                                  PipelineLibraryMap::value_type*& library) {
+			{
+				std::scoped_lock _(impl.library_mutex);
+				auto it = impl.pipeline_libraries[part].find(key);
+				if (it != impl.pipeline_libraries[part].end()) {
+					it->second.ref_count++;
+					library = &*it;
+					return VK_SUCCESS;
+				}
+			}
+			// compile outside of the lock
+			VkGraphicsPipelineLibraryCreateInfoEXT gplci{ .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_LIBRARY_CREATE_INFO_EXT,
+				                                            .flags = (VkGraphicsPipelineLibraryFlagsEXT)(1u << part) };
+			gpci.pNext = &gplci;
+			gpci.flags |= VK_PIPELINE_CREATE_LIBRARY_BIT_KHR | VK_PIPELINE_CREATE_RETAIN_LINK_TIME_OPTIMIZATION_INFO_BIT_EXT;
+			VkPipeline created;
+			VkResult res = ctx.vkCreateGraphicsPipelines(device, ctx.get_thread_pipeline_cache(), 1, &gpci, nullptr, &created);
+			if (res != VK_SUCCESS) {
+				return res;
+			}
+			std::scoped_lock _(impl.library_mutex);
+			auto [it, inserted] = impl.pipeline_libraries[part].try_emplace(std::move(key), PipelineLibrary{ created });
+			if (!inserted) { // another thread created the same library concurrently
+				ctx.vkDestroyPipeline(device, created, nullptr);
+			}
+			it->second.ref_count++;
+			library = &*it;
+			return VK_SUCCESS;
+		}
+
+		// split a complete pipeline description into the four library parts, acquire them and fast-link them
+		VkResult create_fast_linked_pipeline(Runtime& ctx,
+		                                     VkDevice device,
+		                                     DeviceVkResourceImpl& impl,
+		                                     const PipelineBaseInfo& base,
+		                                     const VkGraphicsPipelineCreateInfo& gpci,
+		                                     VkPipeline& pipeline) {
+			// the library keys identify render passes by contents, which is only known for render passes created here
+			size_t render_pass_hash = 0;
+			if (gpci.renderPass != VK_NULL_HANDLE) {
+				std::scoped_lock _(impl.library_mutex);
+				auto it = impl.render_pass_hashes.find(gpci.renderPass);
+				if (it == impl.render_pass_hashes.end()) {
+					return ctx.vkCreateGraphicsPipelines(device, ctx.get_thread_pipeline_cache(), 1, &gpci, nullptr, &pipeline);
+				}
+				render_pass_hash = it->second;
+			}
+
+			std::array<std::string, 4> keys;
+			std::array<VkGraphicsPipelineCreateInfo, 4> parts;
+			for (uint32_t i = 0; i < 4; i++) {
+				// all libraries and the linked pipeline must agree on using descriptor buffers
+				parts[i] = { .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO, .flags = gpci.flags, .pDynamicState = gpci.pDynamicState };
+				append_key(keys[i], gpci.flags);
+				append_key(keys[i], gpci.pDynamicState->pDynamicStates, gpci.pDynamicState->dynamicStateCount);
+			}
+
+			// VERTEX INPUT INTERFACE
+			auto& vertex_input = parts[0];
+			vertex_input.pVertexInputState = gpci.pVertexInputState;
+			vertex_input.pInputAssemblyState = gpci.pInputAssemblyState;
+			auto& vis = *gpci.pVertexInputState;
+			append_key(keys[0], vis.pVertexAttributeDescriptions, vis.vertexAttributeDescriptionCount);
+			append_key(keys[0], vis.pVertexBindingDescriptions, vis.vertexBindingDescriptionCount);
+			append_key(keys[0], gpci.pInputAssemblyState->topology);
+			append_key(keys[0], gpci.pInputAssemblyState->primitiveRestartEnable);
+
+			// PRE-RASTERIZATION SHADERS & FRAGMENT SHADER
+			fixed_vector<VkPipelineShaderStageCreateInfo, graphics_stage_count> pre_raster_stages;
+			fixed_vector<VkPipelineShaderStageCreateInfo, 1> fragment_stages;
+			for (uint32_t i = 0; i < gpci.stageCount; i++) {
+				if (gpci.pStages[i].stage == VK_SHADER_STAGE_FRAGMENT_BIT) {
+					fragment_stages.push_back(gpci.pStages[i]);
+					append_key(keys[2], gpci.pStages[i], base.shader_hashes[i]);
+				} else {
+					pre_raster_stages.push_back(gpci.pStages[i]);
+					append_key(keys[1], gpci.pStages[i], base.shader_hashes[i]);
+				}
+			}
+			auto& pre_raster = parts[1];
+			pre_raster.stageCount = (uint32_t)pre_raster_stages.size();
+			pre_raster.pStages = pre_raster_stages.data();
+			pre_raster.pViewportState = gpci.pViewportState;
+			pre_raster.pRasterizationState = gpci.pRasterizationState;
+			pre_raster.pTessellationState = gpci.pTessellationState;
+			auto& vps = *gpci.pViewportState;
+			append_key(keys[1], vps.pViewports, vps.viewportCount);
+			append_key(keys[1], vps.pScissors, vps.scissorCount);
+			auto& rs = *gpci.pRasterizationState;
+			append_key(keys[1], rs.depthClampEnable);
+			append_key(keys[1], rs.rasterizerDiscardEnable);
+			append_key(keys[1], rs.polygonMode);
+			append_key(keys[1], rs.cullMode);
+			append_key(keys[1], rs.frontFace);
+			append_key(keys[1], rs.depthBiasEnable);
+			append_key(keys[1], rs.depthBiasConstantFactor);
+			append_key(keys[1], rs.depthBiasClamp);
+			append_key(keys[1], rs.depthBiasSlopeFactor);
+			append_key(keys[1], rs.lineWidth);
+			if (rs.pNext) {
+				auto& cs = *reinterpret_cast<const VkPipelineRasterizationConservativeStateCreateInfoEXT*>(rs.pNext);
+				append_key(keys[1], cs.conservativeRasterizationMode);
+				append_key(keys[1], cs.extraPrimitiveOverestimationSize);
+			}
+			append_key(keys[1], gpci.pTessellationState->patchControlPoints);
+
+			auto& fragment_shader = parts[2];
+			fragment_shader.stageCount = (uint32_t)fragment_stages.size();
+			fragment_shader.pStages = fragment_stages.data();
+			fragment_shader.pDepthStencilState = gpci.pDepthStencilState;
+			fragment_shader.pMultisampleState = gpci.pMultisampleState;
+			if (auto ds = gpci.pDepthStencilState) {
+				append_key(keys[2], ds->depthTestEnable);
+				append_key(keys[2], ds->depthWriteEnable);
+				append_key(keys[2], ds->depthCompareOp);
+				append_key(keys[2], ds->depthBoundsTestEnable);
+				append_key(keys[2], ds->stencilTestEnable);
+				append_key(keys[2], ds->front);
+				append_key(keys[2], ds->back);
+				append_key(keys[2], ds->minDepthBounds);
+				append_key(keys[2], ds->maxDepthBounds);
+			}
+			append_key(keys[2], *gpci.pMultisampleState);
+
+			for (uint32_t i = 1; i < 3; i++) {
+				parts[i].layout = gpci.layout;
+				append_key(keys[i], base.pipeline_layout_hash);
+			}
+
+			// FRAGMENT OUTPUT INTERFACE
+			auto& fragment_output = parts[3];
+			fragment_output.pColorBlendState = gpci.pColorBlendState;
+			fragment_output.pMultisampleState = gpci.pMultisampleState;
+			auto& cbs = *gpci.pColorBlendState;
+			append_key(keys[3], cbs.pAttachments, cbs.attachmentCount);
+			append_key(keys[3], cbs.logicOpEnable);
+			append_key(keys[3], cbs.logicOp);
+			append_key(keys[3], cbs.blendConstants);
+			append_key(keys[3], *gpci.pMultisampleState);
+
+			for (uint32_t i = 1; i < 4; i++) {
+				parts[i].renderPass = gpci.renderPass;
+				parts[i].subpass = gpci.subpass;
+				append_key(keys[i], render_pass_hash);
+				append_key(keys[i], gpci.subpass);
+			}
+
+			std::array<PipelineLibraryMap::value_type*, 4> libraries;
+			for (uint32_t i = 0; i < 4; i++) {
+				VkResult res = acquire_pipeline_library(ctx, device, impl, i, std::move(keys[i]), parts[i], libraries[i]);
+				if (res != VK_SUCCESS) {
+					impl.release_libraries(ctx, device, std::span(libraries.data(), i));
+					return res;
+				}
+			}
+
+			std::array<VkPipeline, 4> library_pipelines;
+			for (uint32_t i = 0; i < 4; i++) {
+				library_pipelines[i] = libraries[i]->second.pipeline;
+			}
+			VkPipelineLibraryCreateInfoKHR plci{ .sType = VK_STRUCTURE_TYPE_PIPELINE_LIBRARY_CREATE_INFO_KHR,
+				                                   .libraryCount = (uint32_t)library_pipelines.size(),
+				                                   .pLibraries = library_pipelines.data() };
+			VkGraphicsPipelineCreateInfo link{ .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO, .pNext = &plci, .flags = gpci.flags, .layout = gpci.layout };
+			VkResult res = ctx.vkCreateGraphicsPipelines(device, ctx.get_thread_pipeline_cache(), 1, &link, nullptr, &pipeline);
+			if (res != VK_SUCCESS) {
+				impl.release_libraries(ctx, device, libraries);
+				return res;
+			}
+
+			{
+				std::unique_lock _(impl.linked_pipelines_mutex);
+				impl.linked_pipelines.emplace(pipeline, PipelineLibraryLink{ libraries, gpci.layout, gpci.flags });
+				impl.pending_optimized_links.push_back(pipeline);
+			}
+			impl.link_cv.notify_one();
+			return VK_SUCCESS;
+		}
+	} // namespace
+
 	Result<void, AllocateException> DeviceVkResource::allocate_graphics_pipelines(std::span<GraphicsPipelineInfo> dst,
 	                                                                              std::span<const GraphicsPipelineInstanceCreateInfo> cis,
 	                                                                              SourceLocationAtFrame loc) {
@@ -585,6 +947,7 @@ namespace vuk {
 			GraphicsPipelineInstanceCreateInfo cinfo = cis[i];
 			// create gfx pipeline
 			VkGraphicsPipelineCreateInfo gpci{ .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO };
+			gpci.flags = descriptor_buffer_flags(*cinfo.base);
 			gpci.renderPass = cinfo.render_pass;
 			gpci.layout = cinfo.base->pipeline_layout;
 			auto psscis = cinfo.base->psscis;
@@ -841,13 +1204,13 @@ namespace vuk {
 
 			VkPipelineDynamicStateCreateInfo dynamic_state{ .sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO };
 			dynamic_state.dynamicStateCount = std::popcount(cinfo.dynamic_state_flags);
-			fixed_vector<VkDynamicState, VkDynamicState::VK_DYNAMIC_STATE_DEPTH_BOUNDS> dyn_states;
+			fixed_vector<VkDynamicState, std::size(dynamic_state_bit_to_vk)> dyn_states;
 			uint64_t dyn_state_cnt = 0;
-			uint16_t mask = cinfo.dynamic_state_flags;
+			uint32_t mask = cinfo.dynamic_state_flags;
 			while (mask > 0) {
 				bool set = mask & 0x1;
 				if (set) {
-					dyn_states.push_back((VkDynamicState)dyn_state_cnt); // TODO: we will need a switch here instead of a cast when handling EXT
+					dyn_states.push_back(dynamic_state_bit_to_vk[dyn_state_cnt]);
 				}
 				mask >>= 1;
 				dyn_state_cnt++;
@@ -856,7 +1219,13 @@ namespace vuk {
 			gpci.pDynamicState = &dynamic_state;
 
 			VkPipeline pipeline;
-			VkResult res = ctx->vkCreateGraphicsPipelines(device, ctx->vk_pipeline_cache, 1, &gpci, nullptr, &pipeline);
+			VkResult res;
+			if (ctx->graphics_pipeline_strategy == GraphicsPipelineStrategy::eLibraryFastLink && ctx->graphics_pipeline_library_enabled) {
+				start_link_thread();
+				res = create_fast_linked_pipeline(*ctx, device, *impl, *cinfo.base, gpci, pipeline);
+			} else {
+				res = ctx->vkCreateGraphicsPipelines(device, ctx->get_thread_pipeline_cache(), 1, &gpci, nullptr, &pipeline);
+			}
 			if (res != VK_SUCCESS) {
 				deallocate_graphics_pipelines({ dst.data(), (uint64_t)i });
 				return { expected_error, AllocateException{ res } };
@@ -872,6 +1241,107 @@ namespace vuk {
 		for (auto& v : src) {
 			ctx->vkDestroyPipeline(device, v.pipeline, nullptr);
 		}
+		std::vector<PipelineLibraryLink> released;
+		{
+			std::unique_lock _(impl->linked_pipelines_mutex);
+			if (impl->linked_pipelines.empty()) {
+				return;
+			}
+			for (auto& v : src) {
+				auto it = impl->linked_pipelines.find(v.pipeline);
+				if (it != impl->linked_pipelines.end()) {
+					ctx->vkDestroyPipeline(device, it->second.optimized, nullptr);
+					released.push_back(it->second);
+					impl->linked_pipelines.erase(it);
+				}
+			}
+		}
+		// libraries are destroyed together with the last pipeline linked from them
+		for (auto& link : released) {
+			impl->release_libraries(*ctx, device, link.libraries);
+		}
+	}
+
+	void DeviceVkResource::start_link_thread() {
+		std::unique_lock _(impl->linked_pipelines_mutex);
+		if (impl->link_thread.joinable()) {
+			return;
+		}
+		impl->link_thread = std::thread([this] {
+			while (true) {
+				{
+					std::unique_lock lock(impl->linked_pipelines_mutex);
+					impl->link_cv.wait(lock, [this] { return impl->stop_linking || !impl->pending_optimized_links.empty(); });
+					if (impl->stop_linking) {
+						return;
+					}
+				}
+				link_optimized_graphics_pipelines(1);
+			}
+		});
+	}
+
+	size_t DeviceVkResource::link_optimized_graphics_pipelines(size_t max_count) {
+		size_t linked = 0;
+		while (linked < max_count) {
+			VkPipeline fast_linked;
+			PipelineLibraryLink link;
+			{
+				std::unique_lock _(impl->linked_pipelines_mutex);
+				if (impl->pending_optimized_links.empty()) {
+					break;
+				}
+				fast_linked = impl->pending_optimized_links.back();
+				impl->pending_optimized_links.pop_back();
+				auto it = impl->linked_pipelines.find(fast_linked);
+				if (it == impl->linked_pipelines.end()) { // pipeline was deallocated in the meantime
+					continue;
+				}
+				link = it->second;
+				// keep the libraries alive while linking, even if the fast-linked pipeline is deallocated meanwhile
+				std::scoped_lock _l(impl->library_mutex);
+				for (auto& library : link.libraries) {
+					library->second.ref_count++;
+				}
+			}
+
+			std::array<VkPipeline, 4> library_pipelines;
+			for (uint32_t i = 0; i < 4; i++) {
+				library_pipelines[i] = link.libraries[i]->second.pipeline;
+			}
+			VkPipelineLibraryCreateInfoKHR plci{ .sType = VK_STRUCTURE_TYPE_PIPELINE_LIBRARY_CREATE_INFO_KHR,
+				                                   .libraryCount = (uint32_t)library_pipelines.size(),
+				                                   .pLibraries = library_pipelines.data() };
+			VkGraphicsPipelineCreateInfo gpci{ .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+				                                 .pNext = &plci,
+				                                 .flags = VK_PIPELINE_CREATE_LINK_TIME_OPTIMIZATION_BIT_EXT | link.flags,
+				                                 .layout = link.layout };
+			VkPipeline optimized;
+			VkResult res = ctx->vkCreateGraphicsPipelines(device, ctx->get_thread_pipeline_cache(), 1, &gpci, nullptr, &optimized);
+			impl->release_libraries(*ctx, device, link.libraries);
+			if (res != VK_SUCCESS) {
+				continue; // keep using the fast-linked pipeline
+			}
+
+			std::unique_lock _(impl->linked_pipelines_mutex);
+			auto it = impl->linked_pipelines.find(fast_linked);
+			if (it == impl->linked_pipelines.end()) {
+				ctx->vkDestroyPipeline(device, optimized, nullptr);
+				continue;
+			}
+			it->second.optimized = optimized;
+			linked++;
+		}
+		return linked;
+	}
+
+	VkPipeline DeviceVkResource::get_optimized_graphics_pipeline(VkPipeline pipeline) {
+		std::shared_lock _(impl->linked_pipelines_mutex);
+		auto it = impl->linked_pipelines.find(pipeline);
+		if (it != impl->linked_pipelines.end() && it->second.optimized != VK_NULL_HANDLE) {
+			return it->second.optimized;
+		}
+		return pipeline;
 	}
 
 	Result<void, AllocateException> DeviceVkResource::allocate_compute_pipelines(std::span<ComputePipelineInfo> dst,
@@ -882,12 +1352,13 @@ namespace vuk {
 			ComputePipelineInstanceCreateInfo cinfo = cis[i];
 			// create compute pipeline
 			VkComputePipelineCreateInfo cpci{ .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO };
+			cpci.flags = descriptor_buffer_flags(*cinfo.base);
 			cpci.layout = cinfo.base->pipeline_layout;
 			cpci.stage = cinfo.base->psscis[0];
 			cpci.stage.pName = cinfo.base->entry_point_names[0].c_str();
 
 			VkPipeline pipeline;
-			VkResult res = ctx->vkCreateComputePipelines(device, ctx->vk_pipeline_cache, 1, &cpci, nullptr, &pipeline);
+			VkResult res = ctx->vkCreateComputePipelines(device, ctx->get_thread_pipeline_cache(), 1, &cpci, nullptr, &pipeline);
 			if (res != VK_SUCCESS) {
 				deallocate_compute_pipelines({ dst.data(), (uint64_t)i });
 				return { expected_error, AllocateException{ res } };
@@ -914,6 +1385,7 @@ namespace vuk {
 			RayTracingPipelineInstanceCreateInfo cinfo = cis[i];
 			// create ray tracing pipeline
 			VkRayTracingPipelineCreateInfoKHR cpci{ .sType = VK_STRUCTURE_TYPE_RAY_TRACING_PIPELINE_CREATE_INFO_KHR };
+			cpci.flags = descriptor_buffer_flags(*cinfo.base);
 			cpci.layout = cinfo.base->pipeline_layout;
 
 			std::vector<VkRayTracingShaderGroupCreateInfoKHR> groups;
@@ -968,7 +1440,7 @@ namespace vuk {
 			cpci.stageCount = (uint32_t)psscis.size();
 
 			VkPipeline pipeline;
-			VkResult res = ctx->vkCreateRayTracingPipelinesKHR(device, {}, ctx->vk_pipeline_cache, 1, &cpci, nullptr, &pipeline);
+			VkResult res = ctx->vkCreateRayTracingPipelinesKHR(device, {}, ctx->get_thread_pipeline_cache(), 1, &cpci, nullptr, &pipeline);
 
 			if (res != VK_SUCCESS) {
 				deallocate_ray_tracing_pipelines({ dst.data(), (uint64_t)i });
@@ -1065,13 +1537,18 @@ namespace vuk {
 				deallocate_render_passes({ dst.data(), (uint64_t)i });
 				return { expected_error, AllocateException{ res } };
 			}
+			// pipeline libraries refer to render passes by their contents
+			std::scoped_lock _(impl->library_mutex);
+			impl->render_pass_hashes.emplace(dst[i], std::hash<RenderPassCreateInfo>{}(cinfo));
 		}
 		return { expected_value };
 	}
 
 	void DeviceVkResource::deallocate_render_passes(std::span<const VkRenderPass> src) {
+		std::scoped_lock _(impl->library_mutex);
 		for (auto& v : src) {
 			ctx->vkDestroyRenderPass(device, v, nullptr);
+			impl->render_pass_hashes.erase(v);
 		}
 	}
 
@@ -1216,6 +1693,11 @@ namespace vuk {
 		upstream->deallocate_images(src);
 	}
 
+	Result<void, AllocateException>
+	DeviceNestedResource::allocate_attachment_images(std::span<Image> dst, std::span<const ImageCreateInfo> cis, SourceLocationAtFrame loc) {
+		return upstream->allocate_attachment_images(dst, cis, loc);
+	}
+
 	void DeviceNestedResource::set_image_allocation_name(Image& dst, Name name) {
 		upstream->set_image_allocation_name(dst, name);
 	}
@@ -1253,6 +1735,18 @@ namespace vuk {
 		upstream->deallocate_descriptor_sets(src);
 	}
 
+	bool DeviceNestedResource::find_descriptor_set(DescriptorSet& dst, const SetBinding& value) {
+		return upstream->find_descriptor_set(dst, value);
+	}
+
+	void DeviceNestedResource::record_descriptor_set(const DescriptorSet& ds, const SetBinding& value) {
+		upstream->record_descriptor_set(ds, value);
+	}
+
+	Result<Buffer, AllocateException> DeviceNestedResource::allocate_descriptor_buffer_memory(size_t size, size_t alignment, SourceLocationAtFrame loc) {
+		return upstream->allocate_descriptor_buffer_memory(size, alignment, loc);
+	}
+
 	Result<void, AllocateException>
 	DeviceNestedResource::allocate_descriptor_pools(std::span<VkDescriptorPool> dst, std::span<const VkDescriptorPoolCreateInfo> cis, SourceLocationAtFrame loc) {
 		return upstream->allocate_descriptor_pools(dst, cis, loc);
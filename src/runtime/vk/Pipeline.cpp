@@ -73,10 +73,7 @@ namespace vuk {
 
 namespace std {
 	size_t hash<vuk::GraphicsPipelineInstanceCreateInfo>::operator()(vuk::GraphicsPipelineInstanceCreateInfo const& x) const noexcept {
-		size_t h = 0;
-		auto ext_hash = x.is_inline() ? robin_hood::hash_bytes(x.inline_data, x.extended_size) : robin_hood::hash_bytes(x.extended_data, x.extended_size);
-		hash_combine(h, x.base, reinterpret_cast<uint64_t>((VkRenderPass)x.render_pass), x.extended_size, ext_hash);
-		return h;
+		return x.hash;
 	}
 
 	size_t hash<VkSpecializationMapEntry>::operator()(VkSpecializationMapEntry const& x) const noexcept {
@@ -86,15 +83,11 @@ namespace std {
 	}
 
 	size_t hash<vuk::ComputePipelineInstanceCreateInfo>::operator()(vuk::ComputePipelineInstanceCreateInfo const& x) const noexcept {
-		size_t h = 0;
-		hash_combine(h, x.base, robin_hood::hash_bytes(x.specialization_constant_data.data(), x.specialization_info.dataSize), x.specialization_map_entries);
-		return h;
+		return x.hash;
 	}
 
 	size_t hash<vuk::RayTracingPipelineInstanceCreateInfo>::operator()(vuk::RayTracingPipelineInstanceCreateInfo const& x) const noexcept {
-		size_t h = 0;
-		hash_combine(h, x.base, robin_hood::hash_bytes(x.specialization_constant_data.data(), x.specialization_info.dataSize), x.specialization_map_entries);
-		return h;
+		return x.hash;
 	}
 
 	size_t hash<VkPushConstantRange>::operator()(VkPushConstantRange const& x) const noexcept {
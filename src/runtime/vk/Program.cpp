@@ -2,6 +2,9 @@
 #include "vuk/runtime/vk/Program.hpp"
 #include "vuk/ShaderSource.hpp"
 
+#include <cstdio>
+#include <cstring>
+#include <span>
 #include <spirv_cross.hpp>
 
 static auto binding_cmp = [](auto& s1, auto& s2) {
@@ -246,7 +249,42 @@ namespace vuk {
 		return *sets[set];
 	}
 
-	std::vector<Program> Program::introspect(const uint32_t* ir, size_t word_count) {
+	VkShaderStageFlagBits to_stage(spv::ExecutionModel model) {
+		switch (model) {
+		case spv::ExecutionModel::ExecutionModelVertex:
+			return VK_SHADER_STAGE_VERTEX_BIT;
+		case spv::ExecutionModel::ExecutionModelTessellationControl:
+			return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+		case spv::ExecutionModel::ExecutionModelTessellationEvaluation:
+			return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+		case spv::ExecutionModel::ExecutionModelGeometry:
+			return VK_SHADER_STAGE_GEOMETRY_BIT;
+		case spv::ExecutionModel::ExecutionModelFragment:
+			return VK_SHADER_STAGE_FRAGMENT_BIT;
+		case spv::ExecutionModel::ExecutionModelGLCompute:
+			return VK_SHADER_STAGE_COMPUTE_BIT;
+		case spv::ExecutionModel::ExecutionModelTaskEXT:
+			return VK_SHADER_STAGE_TASK_BIT_EXT;
+		case spv::ExecutionModel::ExecutionModelMeshEXT:
+			return VK_SHADER_STAGE_MESH_BIT_EXT;
+		case spv::ExecutionModel::ExecutionModelAnyHitKHR:
+			return VK_SHADER_STAGE_ANY_HIT_BIT_KHR;
+		case spv::ExecutionModel::ExecutionModelCallableKHR:
+			return VK_SHADER_STAGE_CALLABLE_BIT_KHR;
+		case spv::ExecutionModel::ExecutionModelClosestHitKHR:
+			return VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR;
+		case spv::ExecutionModel::ExecutionModelIntersectionKHR:
+			return VK_SHADER_STAGE_INTERSECTION_BIT_KHR;
+		case spv::ExecutionModel::ExecutionModelMissKHR:
+			return VK_SHADER_STAGE_MISS_BIT_KHR;
+		case spv::ExecutionModel::ExecutionModelRayGenerationKHR:
+			return VK_SHADER_STAGE_RAYGEN_BIT_KHR;
+		default:
+			return VK_SHADER_STAGE_VERTEX_BIT;
+		}
+	}
+
+	std::vector<Program> Program::introspect_spirv_cross(const uint32_t* ir, size_t word_count) {
 		spirv_cross::Compiler refl(ir, word_count);
 		std::vector<Program> programs;
 		for (auto& entry_name : refl.get_entry_points_and_stages()) {
@@ -255,41 +293,7 @@ namespace vuk {
 			auto resources = refl.get_shader_resources();
 			program.entry_point = entry_name.name;
 			auto entry_point = refl.get_entry_point(entry_name.name, entry_name.execution_model);
-			auto model = entry_point.model;
-			auto stage = [=]() {
-				switch (model) {
-				case spv::ExecutionModel::ExecutionModelVertex:
-					return VK_SHADER_STAGE_VERTEX_BIT;
-				case spv::ExecutionModel::ExecutionModelTessellationControl:
-					return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
-				case spv::ExecutionModel::ExecutionModelTessellationEvaluation:
-					return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
-				case spv::ExecutionModel::ExecutionModelGeometry:
-					return VK_SHADER_STAGE_GEOMETRY_BIT;
-				case spv::ExecutionModel::ExecutionModelFragment:
-					return VK_SHADER_STAGE_FRAGMENT_BIT;
-				case spv::ExecutionModel::ExecutionModelGLCompute:
-					return VK_SHADER_STAGE_COMPUTE_BIT;
-				case spv::ExecutionModel::ExecutionModelTaskEXT:
-					return VK_SHADER_STAGE_TASK_BIT_EXT;
-				case spv::ExecutionModel::ExecutionModelMeshEXT:
-					return VK_SHADER_STAGE_MESH_BIT_EXT;
-				case spv::ExecutionModel::ExecutionModelAnyHitKHR:
-					return VK_SHADER_STAGE_ANY_HIT_BIT_KHR;
-				case spv::ExecutionModel::ExecutionModelCallableKHR:
-					return VK_SHADER_STAGE_CALLABLE_BIT_KHR;
-				case spv::ExecutionModel::ExecutionModelClosestHitKHR:
-					return VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR;
-				case spv::ExecutionModel::ExecutionModelIntersectionKHR:
-					return VK_SHADER_STAGE_INTERSECTION_BIT_KHR;
-				case spv::ExecutionModel::ExecutionModelMissKHR:
-					return VK_SHADER_STAGE_MISS_BIT_KHR;
-				case spv::ExecutionModel::ExecutionModelRayGenerationKHR:
-					return VK_SHADER_STAGE_RAYGEN_BIT_KHR;
-				default:
-					return VK_SHADER_STAGE_VERTEX_BIT;
-				}
-			}();
+			auto stage = to_stage(entry_point.model);
 			program.stages = stage;
 			if (stage == VK_SHADER_STAGE_VERTEX_BIT) {
 				for (auto& sb : resources.stage_inputs) {
@@ -444,30 +448,7 @@ namespace vuk {
 				    SpecConstant{ sc.constant_id, to_type(refl.get_type(refl.get_constant(sc.id).constant_type)), (VkShaderStageFlags)stage });
 			}
 
-			// remove duplicated bindings (aliased bindings)
-			// TODO: we need to preserve this information somewhere
-			for (auto& set : program.sets) {
-				if (!set) {
-					continue;
-				}
-				unq(set->bindings);
-				std::sort(set->bindings.begin(), set->bindings.end(), [](auto& a, auto& b) { return a.binding < b.binding; });
-			}
-
-			std::sort(program.spec_constants.begin(), program.spec_constants.end(), binding_cmp);
-
-			for (auto& set : program.sets) {
-				if (!set) {
-					continue;
-				}
-				unsigned max_binding = 0;
-				for (auto& ub : set->bindings) {
-					max_binding = std::max(max_binding, ub.binding);
-				}
-				set->highest_descriptor_binding = max_binding;
-			}
-
-			program.flatten_bindings();
+			program.finalize();
 
 			// push constants
 			for (auto& si : resources.push_constant_buffers) {
@@ -492,6 +473,1020 @@ namespace vuk {
 		return programs;
 	}
 
+	namespace {
+		// Reflection directly from the SPIR-V words. The module is scanned once up to the first function, which is where all the types, decorations and
+		// global variables live; the interface is then resolved from the collected ids. The results match what the spirv-cross path produces - modules
+		// with constructs that are not handled here (spec constant sized arrays, buffer references in blocks, ...) are reported as unsupported.
+		struct SpirvMember {
+			std::string_view name;
+			uint32_t offset = 0;
+			uint32_t matrix_stride = 0;
+			bool has_offset = false;
+			bool row_major = false;
+			bool col_major = false;
+			bool builtin = false;
+		};
+
+		struct SpirvId {
+			spv::Op op = spv::OpNop;
+			uint32_t type = 0;    // component, column, element or pointee type - result type for constants and variables
+			uint32_t count = 0;   // vector size, column count, array length id or member count
+			uint32_t storage = 0; // storage class of pointers and variables
+			uint32_t width = 0;
+			uint32_t value = 0; // low word of scalar constants
+			uint32_t dim = 0;
+			uint32_t sampled = 0;
+			uint32_t first_member = 0;
+			const uint32_t* member_types = nullptr;
+			std::string_view name;
+
+			uint32_t binding = 0;
+			uint32_t set = 0;
+			uint32_t location = 0;
+			uint32_t spec_id = 0;
+			uint32_t array_stride = 0;
+			bool is_signed = false;
+			bool depth = false;
+			bool is_spec_constant = false;
+			bool has_spec_id = false;
+			bool block = false;
+			bool buffer_block = false;
+			bool non_writable = false;
+			bool non_readable = false;
+			bool builtin = false;
+			bool hlsl_counter_buffer = false;
+		};
+
+		struct SpirvEntryPoint {
+			spv::ExecutionModel model;
+			uint32_t function;
+			std::string_view name;
+			std::span<const uint32_t> interface;
+			std::array<unsigned, 3> local_size = {};
+		};
+
+		std::string_view read_string(const uint32_t* words, size_t word_count, size_t& words_used) {
+			auto str = reinterpret_cast<const char*>(words);
+			auto len = strnlen(str, word_count * sizeof(uint32_t));
+			words_used = len / sizeof(uint32_t) + 1;
+			return { str, len };
+		}
+
+		// spirv-cross renames identifiers that are not valid in GLSL, so that names match between the two paths
+		bool is_numeric(char c) {
+			return c >= '0' && c <= '9';
+		}
+
+		bool is_alphanumeric(char c) {
+			return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || is_numeric(c);
+		}
+
+		bool is_reserved_prefix(std::string_view name) {
+			return name.starts_with("gl_") || name.starts_with("spv");
+		}
+
+		bool is_reserved_identifier(std::string_view name, bool member) {
+			if (is_reserved_prefix(name)) {
+				return true;
+			}
+			size_t index;
+			if (member) {
+				// _m[0-9]+$
+				if (name.size() < 3 || !name.starts_with("_m")) {
+					return false;
+				}
+				index = 2;
+				while (index < name.size() && is_numeric(name[index])) {
+					index++;
+				}
+				return index == name.size();
+			}
+			// _[0-9]+$ or _[0-9]+_
+			if (name.size() < 2 || name[0] != '_' || !is_numeric(name[1])) {
+				return false;
+			}
+			index = 2;
+			while (index < name.size() && is_numeric(name[index])) {
+				index++;
+			}
+			return index == name.size() || name[index] == '_';
+		}
+
+		std::string to_identifier(std::string_view name, bool member) {
+			std::string str(name);
+			bool valid = str.empty() || !is_numeric(str[0]);
+			bool saw_underscore = false;
+			for (auto c : str) {
+				bool is_underscore = c == '_';
+				valid = valid && (is_alphanumeric(c) || is_underscore) && !(is_underscore && saw_underscore);
+				saw_underscore = is_underscore;
+			}
+			if (!valid) {
+				str = str.substr(0, str.find('('));
+				if (!str.empty() && is_numeric(str[0])) {
+					str[0] = '_';
+				}
+				for (auto& c : str) {
+					if (!is_alphanumeric(c) && c != '_') {
+						c = '_';
+					}
+				}
+				auto last = std::unique(str.begin(), str.end(), [](char a, char b) { return a == '_' && b == '_'; });
+				str.erase(last, str.end());
+			}
+			if (is_reserved_identifier(str, member)) {
+				str = (is_reserved_prefix(str) ? "_RESERVED_IDENTIFIER_FIXUP_" : "_RESERVED_IDENTIFIER_FIXUP") + str;
+			}
+			return str;
+		}
+	} // namespace
+
+	namespace detail {
+		struct SpirvReflector {
+			uint32_t version = 0;
+			std::vector<SpirvId> ids;
+			std::vector<SpirvMember> members;
+			std::vector<SpirvEntryPoint> entry_points;
+			std::vector<uint32_t> variables;      // in declaration order
+			std::vector<uint32_t> spec_constants; // in declaration order
+			bool source_known = false;
+			bool source_hlsl = false;
+			bool unsupported = false;
+
+			bool parse(const uint32_t* words, size_t word_count) {
+				if (word_count < 5 || words[0] != spv::MagicNumber || words[3] == 0) {
+					return false;
+				}
+				version = words[1];
+				ids.resize(words[3]);
+
+				// member decorations and names can precede the struct they apply to
+				std::vector<const uint32_t*> member_instructions;
+				std::vector<const uint32_t*> execution_modes;
+				size_t offset = 5;
+				while (offset < word_count) {
+					uint32_t instruction_word_count = words[offset] >> 16;
+					auto op = (spv::Op)(words[offset] & 0xffff);
+					if (instruction_word_count == 0 || offset + instruction_word_count > word_count) {
+						return false;
+					}
+					const uint32_t* ops = words + offset + 1;
+					uint32_t op_count = instruction_word_count - 1;
+					// all types, decorations and globals precede the functions
+					if (op == spv::OpFunction) {
+						break;
+					}
+					if (!parse_instruction(op, ops, op_count, member_instructions, execution_modes)) {
+						return false;
+					}
+					offset += instruction_word_count;
+				}
+
+				for (auto& id : ids) {
+					if (id.op == spv::OpTypeStruct) {
+						id.first_member = (uint32_t)members.size();
+						members.resize(members.size() + id.count);
+					}
+				}
+				for (auto instruction : member_instructions) {
+					auto op = (spv::Op)(instruction[0] & 0xffff);
+					uint32_t op_count = (instruction[0] >> 16) - 1;
+					const uint32_t* ops = instruction + 1;
+					auto& strct = get(ops[0]);
+					if (strct.op != spv::OpTypeStruct || ops[1] >= strct.count) {
+						return false;
+					}
+					auto& member = members[strct.first_member + ops[1]];
+					if (op == spv::OpMemberName) {
+						size_t used;
+						member.name = read_string(ops + 2, op_count - 2, used);
+						continue;
+					}
+					switch ((spv::Decoration)ops[2]) {
+					case spv::DecorationOffset:
+						member.offset = ops[3];
+						member.has_offset = true;
+						break;
+					case spv::DecorationMatrixStride:
+						member.matrix_stride = ops[3];
+						break;
+					case spv::DecorationRowMajor:
+						member.row_major = true;
+						break;
+					case spv::DecorationColMajor:
+						member.col_major = true;
+						break;
+					case spv::DecorationBuiltIn:
+						member.builtin = true;
+						break;
+					default:
+						break;
+					}
+				}
+				for (auto ops : execution_modes) {
+					for (auto& ep : entry_points) {
+						if (ep.function == ops[0]) {
+							ep.local_size = { ops[2], ops[3], ops[4] };
+						}
+					}
+				}
+				return !unsupported;
+			}
+
+			bool parse_instruction(spv::Op op,
+			                       const uint32_t* ops,
+			                       uint32_t op_count,
+			                       std::vector<const uint32_t*>& member_instructions,
+			                       std::vector<const uint32_t*>& execution_modes) {
+				// smallest operand count of the instructions we look at
+				if (op_count < 1) {
+					return true;
+				}
+				size_t used;
+				switch (op) {
+				case spv::OpSource:
+					source_known = true;
+					source_hlsl = ops[0] == spv::SourceLanguageHLSL;
+					break;
+				case spv::OpEntryPoint: {
+					if (op_count < 3) {
+						return false;
+					}
+					auto name = read_string(ops + 2, op_count - 2, used);
+					if (2 + used > op_count) {
+						return false;
+					}
+					entry_points.push_back(SpirvEntryPoint{ (spv::ExecutionModel)ops[0], ops[1], name, std::span(ops + 2 + used, op_count - 2 - used) });
+					break;
+				}
+				case spv::OpExecutionMode:
+					if (op_count >= 5 && ops[1] == spv::ExecutionModeLocalSize) {
+						execution_modes.push_back(ops);
+					}
+					break;
+				case spv::OpName:
+					if (op_count < 2) {
+						return false;
+					}
+					get(ops[0]).name = read_string(ops + 1, op_count - 1, used);
+					break;
+				case spv::OpMemberName:
+				case spv::OpMemberDecorate:
+					if (op_count < 3) {
+						return false;
+					}
+					member_instructions.push_back(ops - 1);
+					break;
+				case spv::OpDecorate:
+					if (op_count < 2) {
+						return false;
+					}
+					decorate(get(ops[0]), (spv::Decoration)ops[1], ops + 2, op_count - 2);
+					break;
+				case spv::OpDecorateId:
+					if (op_count >= 3 && ops[1] == spv::DecorationHlslCounterBufferGOOGLE) {
+						get(ops[2]).hlsl_counter_buffer = true;
+					}
+					break;
+				case spv::OpTypeBool:
+				case spv::OpTypeSampler:
+				case spv::OpTypeAccelerationStructureKHR:
+					get(ops[0]).op = op;
+					break;
+				case spv::OpTypeInt:
+				case spv::OpTypeFloat: {
+					if (op_count < 2) {
+						return false;
+					}
+					auto& t = get(ops[0]);
+					t.op = op;
+					t.width = ops[1];
+					t.is_signed = op == spv::OpTypeInt && op_count > 2 && ops[2] == 1;
+					break;
+				}
+				case spv::OpTypeVector:
+				case spv::OpTypeMatrix:
+				case spv::OpTypeArray: {
+					if (op_count < 3) {
+						return false;
+					}
+					auto& t = get(ops[0]);
+					t.op = op;
+					t.type = ops[1];
+					t.count = ops[2];
+					break;
+				}
+				case spv::OpTypeRuntimeArray:
+				case spv::OpTypeSampledImage: {
+					if (op_count < 2) {
+						return false;
+					}
+					auto& t = get(ops[0]);
+					t.op = op;
+					t.type = ops[1];
+					break;
+				}
+				case spv::OpTypeImage: {
+					if (op_count < 7) {
+						return false;
+					}
+					auto& t = get(ops[0]);
+					t.op = op;
+					t.type = ops[1];
+					t.dim = ops[2];
+					t.depth = ops[3] == 1;
+					t.sampled = ops[6];
+					break;
+				}
+				case spv::OpTypeStruct: {
+					auto& t = get(ops[0]);
+					t.op = op;
+					t.member_types = ops + 1;
+					t.count = op_count - 1;
+					break;
+				}
+				case spv::OpTypePointer: {
+					if (op_count < 3) {
+						return false;
+					}
+					auto& t = get(ops[0]);
+					t.op = op;
+					t.storage = ops[1];
+					t.type = ops[2];
+					break;
+				}
+				case spv::OpConstant:
+				case spv::OpSpecConstant:
+				case spv::OpConstantTrue:
+				case spv::OpConstantFalse:
+				case spv::OpSpecConstantTrue:
+				case spv::OpSpecConstantFalse:
+				case spv::OpSpecConstantComposite:
+				case spv::OpSpecConstantOp: {
+					if (op_count < 2) {
+						return false;
+					}
+					auto& c = get(ops[1]);
+					c.op = op;
+					c.type = ops[0];
+					c.value = op_count > 2 ? ops[2] : 0;
+					c.is_spec_constant = op != spv::OpConstant && op != spv::OpConstantTrue && op != spv::OpConstantFalse;
+					if (c.is_spec_constant) {
+						spec_constants.push_back(ops[1]);
+					}
+					break;
+				}
+				case spv::OpVariable: {
+					if (op_count < 3) {
+						return false;
+					}
+					auto& v = get(ops[1]);
+					v.op = op;
+					v.type = ops[0];
+					v.storage = ops[2];
+					variables.push_back(ops[1]);
+					break;
+				}
+				default:
+					break;
+				}
+				return !unsupported;
+			}
+
+			void decorate(SpirvId& id, spv::Decoration decoration, const uint32_t* literals, uint32_t literal_count) {
+				auto literal = literal_count > 0 ? literals[0] : 0;
+				switch (decoration) {
+				case spv::DecorationBinding:
+					id.binding = literal;
+					break;
+				case spv::DecorationDescriptorSet:
+					id.set = literal;
+					break;
+				case spv::DecorationLocation:
+					id.location = literal;
+					break;
+				case spv::DecorationSpecId:
+					id.spec_id = literal;
+					id.has_spec_id = true;
+					break;
+				case spv::DecorationArrayStride:
+					id.array_stride = literal;
+					break;
+				case spv::DecorationBlock:
+					id.block = true;
+					break;
+				case spv::DecorationBufferBlock:
+					id.buffer_block = true;
+					break;
+				case spv::DecorationNonWritable:
+					id.non_writable = true;
+					break;
+				case spv::DecorationNonReadable:
+					id.non_readable = true;
+					break;
+				case spv::DecorationBuiltIn:
+					id.builtin = true;
+					break;
+				default:
+					break;
+				}
+			}
+
+			SpirvId& get(uint32_t id) {
+				if (id == 0 || id >= ids.size()) {
+					unsupported = true;
+					return ids[0];
+				}
+				return ids[id];
+			}
+
+			// strips pointers and arrays
+			uint32_t base_type(uint32_t id) {
+				for (int depth = 0; depth < 64; depth++) {
+					auto& t = get(id);
+					if (t.op != spv::OpTypePointer && t.op != spv::OpTypeArray && t.op != spv::OpTypeRuntimeArray) {
+						return id;
+					}
+					id = t.type;
+				}
+				unsupported = true;
+				return id;
+			}
+
+			uint32_t array_length(const SpirvId& t) {
+				if (t.op == spv::OpTypeRuntimeArray) {
+					return 0;
+				}
+				auto& length = get(t.count);
+				if (length.op != spv::OpConstant) {
+					unsupported = true;
+				}
+				return length.value;
+			}
+
+			struct ArrayInfo {
+				uint32_t dimensions = 0;
+				uint32_t innermost = 0;
+			};
+
+			ArrayInfo array_info(uint32_t id) {
+				ArrayInfo info;
+				if (get(id).op == spv::OpTypePointer) {
+					id = get(id).type;
+				}
+				for (auto* t = &get(id); t->op == spv::OpTypeArray || t->op == spv::OpTypeRuntimeArray; t = &get(t->type)) {
+					info.dimensions++;
+					info.innermost = array_length(*t);
+					if (info.dimensions > 64) {
+						unsupported = true;
+						break;
+					}
+				}
+				return info;
+			}
+
+			Program::Type to_type(uint32_t id) {
+				using T = Program::Type;
+				auto& t = get(base_type(id));
+				switch (t.op) {
+				case spv::OpTypeBool:
+					return T::ebool;
+				case spv::OpTypeInt:
+				case spv::OpTypeFloat:
+					return scalar_type(t, 1);
+				case spv::OpTypeVector:
+					return scalar_type(get(t.type), t.count);
+				case spv::OpTypeMatrix: {
+					auto& component = get(get(t.type).type);
+					if (component.op != spv::OpTypeFloat || (t.count != 3 && t.count != 4)) {
+						return T::einvalid;
+					}
+					if (component.width == 32) {
+						return t.count == 3 ? T::emat3 : T::emat4;
+					} else if (component.width == 64) {
+						return t.count == 3 ? T::edmat3 : T::edmat4;
+					}
+					return T::einvalid;
+				}
+				case spv::OpTypeStruct:
+					return T::estruct;
+				default:
+					return T::einvalid;
+				}
+			}
+
+			Program::Type scalar_type(const SpirvId& scalar, uint32_t vecsize) {
+				using T = Program::Type;
+				static constexpr T float_types[] = { T::efloat, T::evec2, T::evec3, T::evec4 };
+				static constexpr T double_types[] = { T::edouble, T::edvec2, T::edvec3, T::edvec4 };
+				static constexpr T int8_types[] = { T::eint8_t, T::ei8vec2, T::ei8vec3, T::ei8vec4 };
+				static constexpr T uint8_types[] = { T::euint8_t, T::eu8vec2, T::eu8vec3, T::eu8vec4 };
+				static constexpr T int16_types[] = { T::eint16_t, T::ei16vec2, T::ei16vec3, T::ei16vec4 };
+				static constexpr T uint16_types[] = { T::euint16_t, T::eu16vec2, T::eu16vec3, T::eu16vec4 };
+				static constexpr T int_types[] = { T::eint, T::eivec2, T::eivec3, T::eivec4 };
+				static constexpr T uint_types[] = { T::euint, T::euvec2, T::euvec3, T::euvec4 };
+				static constexpr T int64_types[] = { T::eint64_t, T::ei64vec2, T::ei64vec3, T::ei64vec4 };
+				static constexpr T uint64_types[] = { T::euint64_t, T::eu64vec2, T::eu64vec3, T::eu64vec4 };
+
+				if (vecsize < 1 || vecsize > 4) {
+					return T::einvalid;
+				}
+				const T* types = nullptr;
+				if (scalar.op == spv::OpTypeFloat) {
+					types = scalar.width == 32 ? float_types : scalar.width == 64 ? double_types : nullptr;
+				} else if (scalar.op == spv::OpTypeInt) {
+					switch (scalar.width) {
+					case 8:
+						types = scalar.is_signed ? int8_types : uint8_types;
+						break;
+					case 16:
+						types = scalar.is_signed ? int16_types : uint16_types;
+						break;
+					case 32:
+						types = scalar.is_signed ? int_types : uint_types;
+						break;
+					case 64:
+						types = scalar.is_signed ? int64_types : uint64_types;
+						break;
+					}
+				} else if (scalar.op == spv::OpTypeBool) {
+					return T::ebool;
+				}
+				return types ? types[vecsize - 1] : T::einvalid;
+			}
+
+			size_t member_size(const SpirvId& strct, uint32_t index) {
+				auto& member = members[strct.first_member + index];
+				auto& t = get(strct.member_types[index]);
+				switch (t.op) {
+				case spv::OpTypeArray:
+				case spv::OpTypeRuntimeArray: {
+					auto& element = get(base_type(strct.member_types[index]));
+					bool has_size = element.op == spv::OpTypeInt || element.op == spv::OpTypeFloat || element.op == spv::OpTypeVector ||
+					                element.op == spv::OpTypeMatrix || element.op == spv::OpTypeStruct;
+					// buffer references are handled by spirv-cross
+					if (!has_size || get(t.type).op == spv::OpTypePointer || t.array_stride == 0) {
+						unsupported = true;
+						return 0;
+					}
+					return (size_t)t.array_stride * array_length(t);
+				}
+				case spv::OpTypeStruct:
+					return struct_size(t);
+				case spv::OpTypeInt:
+				case spv::OpTypeFloat:
+					return t.width / 8;
+				case spv::OpTypeVector: {
+					auto& component = get(t.type);
+					if (component.op == spv::OpTypeBool) {
+						unsupported = true;
+						return 0;
+					}
+					return t.count * (component.width / 8);
+				}
+				case spv::OpTypeMatrix:
+					if (member.row_major) {
+						return (size_t)member.matrix_stride * get(t.type).count;
+					} else if (member.col_major) {
+						return (size_t)member.matrix_stride * t.count;
+					}
+					unsupported = true;
+					return 0;
+				default:
+					// opaque types and pointers
+					unsupported = true;
+					return 0;
+				}
+			}
+
+			size_t struct_size(const SpirvId& strct) {
+				if (strct.op != spv::OpTypeStruct || strct.count == 0) {
+					unsupported = true;
+					return 0;
+				}
+				// offsets can be declared out of order, the size is determined by the last member
+				uint32_t member_index = 0;
+				size_t highest_offset = 0;
+				for (uint32_t i = 0; i < strct.count; i++) {
+					auto& member = members[strct.first_member + i];
+					if (!member.has_offset) {
+						unsupported = true;
+						return 0;
+					}
+					if (member.offset > highest_offset) {
+						highest_offset = member.offset;
+						member_index = i;
+					}
+				}
+				return highest_offset + member_size(strct, member_index);
+			}
+
+			void reflect_members(uint32_t struct_id, std::vector<Program::Member>& out, uint32_t depth = 0) {
+				auto& strct = get(struct_id);
+				if (strct.op != spv::OpTypeStruct || depth > 32) {
+					unsupported = true;
+					return;
+				}
+				for (uint32_t i = 0; i < strct.count && !unsupported; i++) {
+					auto type_id = strct.member_types[i];
+					auto& member = members[strct.first_member + i];
+					Program::Member m;
+					m.type = to_type(type_id);
+					if (m.type == Program::Type::estruct) {
+						auto& t = get(type_id);
+						m.type_name = to_identifier(t.name, false);
+						if (m.type_name.empty() && (t.op == spv::OpTypeArray || t.op == spv::OpTypeRuntimeArray)) {
+							m.type_name = to_identifier(get(t.type).name, false);
+						}
+					}
+					m.name = to_identifier(member.name, true);
+					m.size = member_size(strct, i);
+					m.offset = member.offset;
+
+					if (m.type == Program::Type::estruct) {
+						auto member_struct = base_type(type_id);
+						m.size = struct_size(get(member_struct));
+						reflect_members(member_struct, m.members, depth + 1);
+					}
+
+					auto arrays = array_info(type_id);
+					m.array_size = arrays.dimensions > 0 ? arrays.innermost : 1;
+
+					out.push_back(std::move(m));
+				}
+			}
+
+			bool is_builtin(const SpirvId& var) {
+				if (var.builtin) {
+					return true;
+				}
+				auto& t = get(base_type(var.type));
+				if (t.op == spv::OpTypeStruct) {
+					for (uint32_t i = 0; i < t.count; i++) {
+						if (members[t.first_member + i].builtin) {
+							return true;
+						}
+					}
+				}
+				return false;
+			}
+
+			// HLSL style UAVs reuse the block type, so the instance name is the significant one
+			bool ssbo_instance_name_is_significant() {
+				if (source_known) {
+					return source_hlsl;
+				}
+				std::vector<uint32_t> ssbo_types;
+				for (auto var_id : variables) {
+					auto& var = get(var_id);
+					auto& ptr = get(var.type);
+					if (ptr.op != spv::OpTypePointer || var.storage == spv::StorageClassFunction) {
+						continue;
+					}
+					auto self = base_type(var.type);
+					bool ssbo = var.storage == spv::StorageClassStorageBuffer || (var.storage == spv::StorageClassUniform && get(self).buffer_block);
+					if (ssbo) {
+						if (std::find(ssbo_types.begin(), ssbo_types.end(), self) != ssbo_types.end()) {
+							return true;
+						}
+						ssbo_types.push_back(self);
+					}
+				}
+				return false;
+			}
+
+			std::string block_name(uint32_t var_id, bool prefer_instance_name) {
+				auto& var = get(var_id);
+				if (prefer_instance_name) {
+					return var.name.empty() ? "_" + std::to_string(var_id) : to_identifier(var.name, false);
+				}
+				auto self = base_type(var.type);
+				auto& block = get(self);
+				if (!block.name.empty()) {
+					return to_identifier(block.name, false);
+				}
+				return var.name.empty() ? "_" + std::to_string(self) + "_" + std::to_string(var_id) : to_identifier(var.name, false);
+			}
+
+			std::vector<Program> reflect() {
+				std::vector<Program> programs;
+				bool ssbo_instance_name = ssbo_instance_name_is_significant();
+				for (auto& ep : entry_points) {
+					auto& program = programs.emplace_back();
+					program.entry_point = std::string(ep.name);
+					auto stage = to_stage(ep.model);
+					program.stages = stage;
+
+					// resources are added in the same order as the spirv-cross path, so that aliased bindings resolve the same way
+					enum Category { eUniformBuffer, eStorageBuffer, eSampledImage, eSampler, eSeparateImage, eStorageImage, eSubpassInput, eAccelerationStructure, eCount };
+					std::array<std::vector<uint32_t>, eCount> resources;
+					std::vector<uint32_t> push_constants;
+
+					for (auto var_id : variables) {
+						auto& var = get(var_id);
+						auto& ptr = get(var.type);
+						if (var.storage == spv::StorageClassFunction || ptr.op != spv::OpTypePointer) {
+							continue;
+						}
+						bool active = true;
+						if (version < 0x10400) {
+							if ((var.storage == spv::StorageClassInput || var.storage == spv::StorageClassOutput) && entry_points.size() > 1) {
+								active = std::find(ep.interface.begin(), ep.interface.end(), var_id) != ep.interface.end();
+							}
+						} else {
+							// in SPIR-V 1.4 and up, every global used must be in the interface
+							active = std::find(ep.interface.begin(), ep.interface.end(), var_id) != ep.interface.end();
+						}
+						if (!active || is_builtin(var)) {
+							continue;
+						}
+						auto& base = get(base_type(var.type));
+						auto& image = base.op == spv::OpTypeSampledImage ? get(base.type) : base;
+
+						if (var.storage == spv::StorageClassInput) {
+							if (stage == VK_SHADER_STAGE_VERTEX_BIT) {
+								auto arrays = array_info(var.type);
+								unsigned count = arrays.dimensions > 0 ? arrays.innermost : 1;
+								for (uint32_t i = 0; i < count; i++) {
+									Program::Attribute a;
+									a.location = var.location + i;
+									a.name = base.block ? block_name(var_id, false) : to_identifier(var.name, false);
+									a.type = to_type(var.type);
+									program.attributes.push_back(a);
+								}
+							}
+						} else if (var.storage == spv::StorageClassUniformConstant && image.op == spv::OpTypeImage && image.dim == spv::DimSubpassData) {
+							resources[eSubpassInput].push_back(var_id);
+						} else if (var.storage == spv::StorageClassOutput) {
+							continue;
+						} else if (ptr.storage == spv::StorageClassUniform && base.block) {
+							resources[eUniformBuffer].push_back(var_id);
+						} else if ((ptr.storage == spv::StorageClassUniform && base.buffer_block) || ptr.storage == spv::StorageClassStorageBuffer) {
+							resources[eStorageBuffer].push_back(var_id);
+						} else if (ptr.storage == spv::StorageClassPushConstant) {
+							push_constants.push_back(var_id);
+						} else if (ptr.storage == spv::StorageClassUniformConstant) {
+							switch (base.op) {
+							case spv::OpTypeImage:
+								resources[base.sampled == 2 ? eStorageImage : eSeparateImage].push_back(var_id);
+								break;
+							case spv::OpTypeSampler:
+								resources[eSampler].push_back(var_id);
+								break;
+							case spv::OpTypeSampledImage:
+								resources[eSampledImage].push_back(var_id);
+								break;
+							case spv::OpTypeAccelerationStructureKHR:
+								resources[eAccelerationStructure].push_back(var_id);
+								break;
+							default:
+								break;
+							}
+						}
+					}
+
+					// opaque descriptors: non-arrays are -1, single element arrays are 0
+					auto opaque_array_size = [this](uint32_t type_id) {
+						auto arrays = array_info(type_id);
+						return arrays.dimensions == 1 ? (arrays.innermost == 1 ? 0u : arrays.innermost) : (unsigned)-1;
+					};
+
+					for (auto category = 0; category < eCount; category++) {
+						for (auto var_id : resources[category]) {
+							auto& var = get(var_id);
+							auto self = base_type(var.type);
+							auto& base = get(self);
+							Program::Binding b{};
+							b.binding = var.binding;
+							b.stage = stage;
+							switch (category) {
+							case eUniformBuffer: {
+								b.type = DescriptorType::eUniformBuffer;
+								b.non_writable = true;
+								b.name = block_name(var_id, false);
+								auto arrays = array_info(var.type);
+								b.array_size = arrays.dimensions > 0 ? arrays.innermost : 1;
+								reflect_members(self, b.members);
+								b.size = struct_size(base);
+								break;
+							}
+							case eStorageBuffer: {
+								b.type = DescriptorType::eStorageBuffer;
+								b.name = block_name(var_id, ssbo_instance_name);
+								auto arrays = array_info(var.type);
+								b.array_size = arrays.dimensions > 0 ? arrays.innermost : 1;
+								b.min_size = struct_size(base);
+								reflect_members(self, b.members);
+								b.is_hlsl_counter_buffer = var.hlsl_counter_buffer;
+								b.non_writable = var.non_writable;
+								b.non_readable = var.non_readable;
+								break;
+							}
+							case eSampledImage:
+								b.type = DescriptorType::eCombinedImageSampler;
+								b.non_writable = true;
+								b.name = to_identifier(var.name, false);
+								b.array_size = opaque_array_size(var.type);
+								b.shadow = get(base.type).depth;
+								break;
+							case eSampler:
+								b.type = DescriptorType::eSampler;
+								b.non_writable = true;
+								b.name = to_identifier(var.name, false);
+								b.array_size = opaque_array_size(var.type);
+								break;
+							case eSeparateImage:
+								b.type = DescriptorType::eSampledImage;
+								b.non_writable = true;
+								b.name = to_identifier(var.name, false);
+								b.array_size = opaque_array_size(var.type);
+								break;
+							case eStorageImage:
+								b.type = DescriptorType::eStorageImage;
+								b.name = to_identifier(var.name, false);
+								b.non_writable = var.non_writable;
+								b.non_readable = var.non_readable;
+								b.array_size = opaque_array_size(var.type);
+								break;
+							case eSubpassInput:
+								b.type = DescriptorType::eInputAttachment;
+								b.non_writable = true;
+								b.name = to_identifier(var.name, false);
+								break;
+							case eAccelerationStructure:
+								b.type = DescriptorType::eAccelerationStructureKHR;
+								b.non_writable = true;
+								b.name = to_identifier(var.name, false);
+								b.array_size = opaque_array_size(var.type);
+								break;
+							}
+							program.ensure_set(var.set).bindings.push_back(std::move(b));
+						}
+					}
+
+					for (auto sc_id : spec_constants) {
+						auto& sc = get(sc_id);
+						if (sc.has_spec_id) {
+							program.spec_constants.emplace_back(Program::SpecConstant{ sc.spec_id, to_type(sc.type), (VkShaderStageFlags)stage });
+						}
+					}
+
+					program.finalize();
+
+					for (auto var_id : push_constants) {
+						auto self = base_type(get(var_id).type);
+						Program::PushConstant pcr;
+						pcr.offset = 0;
+						pcr.size = (uint32_t)struct_size(get(self));
+						pcr.stageFlags = stage;
+						reflect_members(self, pcr.members);
+						program.push_constant_ranges.push_back(pcr);
+					}
+
+					if (stage == VK_SHADER_STAGE_COMPUTE_BIT || stage == VK_SHADER_STAGE_MESH_BIT_EXT || stage == VK_SHADER_STAGE_TASK_BIT_EXT) {
+						program.local_size = ep.local_size;
+					}
+
+					if (unsupported) {
+						return {};
+					}
+				}
+				return programs;
+			}
+		};
+	} // namespace detail
+
+	namespace {
+		bool same_members(const std::vector<Program::Member>& a, const std::vector<Program::Member>& b) {
+			if (a.size() != b.size()) {
+				return false;
+			}
+			for (size_t i = 0; i < a.size(); i++) {
+				auto& ma = a[i];
+				auto& mb = b[i];
+				if (ma.name != mb.name || ma.type_name != mb.type_name || ma.type != mb.type || ma.size != mb.size || ma.offset != mb.offset ||
+				    ma.array_size != mb.array_size || !same_members(ma.members, mb.members)) {
+					return false;
+				}
+			}
+			return true;
+		}
+	} // namespace
+
+	bool Program::same_reflection(const Program& a, const Program& b) {
+		if (a.entry_point != b.entry_point || a.stages != b.stages || a.attributes.size() != b.attributes.size() ||
+		    a.push_constant_ranges.size() != b.push_constant_ranges.size() || a.spec_constants.size() != b.spec_constants.size() ||
+		    a.sets.size() != b.sets.size()) {
+			return false;
+		}
+		if ((a.stages & (VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_MESH_BIT_EXT | VK_SHADER_STAGE_TASK_BIT_EXT)) && a.local_size != b.local_size) {
+			return false;
+		}
+		for (size_t i = 0; i < a.attributes.size(); i++) {
+			auto& aa = a.attributes[i];
+			auto& ab = b.attributes[i];
+			if (aa.name != ab.name || aa.location != ab.location || aa.type != ab.type) {
+				return false;
+			}
+		}
+		for (size_t i = 0; i < a.push_constant_ranges.size(); i++) {
+			auto& pa = a.push_constant_ranges[i];
+			auto& pb = b.push_constant_ranges[i];
+			if (pa.offset != pb.offset || pa.size != pb.size || pa.stageFlags != pb.stageFlags || !same_members(pa.members, pb.members)) {
+				return false;
+			}
+		}
+		for (size_t i = 0; i < a.spec_constants.size(); i++) {
+			auto& sa = a.spec_constants[i];
+			auto& sb = b.spec_constants[i];
+			if (sa.binding != sb.binding || sa.type != sb.type || sa.stage != sb.stage) {
+				return false;
+			}
+		}
+		for (size_t i = 0; i < a.sets.size(); i++) {
+			auto& sa = a.sets[i];
+			auto& sb = b.sets[i];
+			if (sa.has_value() != sb.has_value()) {
+				return false;
+			}
+			if (!sa) {
+				continue;
+			}
+			if (sa->highest_descriptor_binding != sb->highest_descriptor_binding || sa->bindings.size() != sb->bindings.size()) {
+				return false;
+			}
+			for (size_t j = 0; j < sa->bindings.size(); j++) {
+				auto& ba = sa->bindings[j];
+				auto& bb = sb->bindings[j];
+				if (ba.type != bb.type || ba.name != bb.name || ba.binding != bb.binding || ba.size != bb.size || ba.min_size != bb.min_size ||
+				    ba.array_size != bb.array_size || ba.is_hlsl_counter_buffer != bb.is_hlsl_counter_buffer || ba.shadow != bb.shadow ||
+				    ba.non_writable != bb.non_writable || ba.non_readable != bb.non_readable || ba.stage != bb.stage || !same_members(ba.members, bb.members)) {
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	std::optional<std::vector<Program>> Program::introspect_native(const uint32_t* ir, size_t word_count) {
+		detail::SpirvReflector reflector;
+		if (!reflector.parse(ir, word_count)) {
+			return {};
+		}
+		auto programs = reflector.reflect();
+		if (reflector.unsupported) {
+			return {};
+		}
+		return programs;
+	}
+
+	std::vector<Program> Program::introspect(const uint32_t* ir, size_t word_count) {
+		auto programs = introspect_native(ir, word_count);
+		if (!programs) {
+			return introspect_spirv_cross(ir, word_count);
+		}
+#if VUK_VALIDATE_REFLECTION
+		auto reference = introspect_spirv_cross(ir, word_count);
+		bool same = programs->size() == reference.size();
+		for (auto& program : *programs) {
+			auto it = std::find_if(reference.begin(), reference.end(), [&](const Program& r) { return r.entry_point == program.entry_point && r.stages == program.stages; });
+			same = same && it != reference.end() && same_reflection(program, *it);
+		}
+		if (!same) {
+			fprintf(stderr, "vuk: native SPIR-V reflection differs from spirv-cross (entry point: %s), using spirv-cross.\n", programs->empty() ? "" : (*programs)[0].entry_point.c_str());
+			return reference;
+		}
+#endif
+		return std::move(*programs);
+	}
+
+	void Program::finalize() {
+		// remove duplicated bindings (aliased bindings)
+		// TODO: we need to preserve this information somewhere
+		for (auto& set : sets) {
+			if (!set) {
+				continue;
+			}
+			unq(set->bindings);
+			std::sort(set->bindings.begin(), set->bindings.end(), [](auto& a, auto& b) { return a.binding < b.binding; });
+		}
+
+		std::sort(spec_constants.begin(), spec_constants.end(), binding_cmp);
+
+		for (auto& set : sets) {
+			if (!set) {
+				continue;
+			}
+			unsigned max_binding = 0;
+			for (auto& ub : set->bindings) {
+				max_binding = std::max(max_binding, ub.binding);
+			}
+			set->highest_descriptor_binding = max_binding;
+		}
+
+		flatten_bindings();
+	}
+
 	void Program::append(const Program& o) {
 		attributes.insert(attributes.end(), o.attributes.begin(), o.attributes.end());
 		push_constant_ranges.insert(push_constant_ranges.end(), o.push_constant_ranges.begin(), o.push_constant_ranges.end());
@@ -1,6 +1,12 @@
 #include <algorithm>
 #include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
 #include <mutex>
+#include <thread>
 
 #include "vuk/Exception.hpp"
 #include "vuk/ImageAttachment.hpp"
@@ -48,6 +54,122 @@ namespace {
 #undef VUK_X
 #undef VUK_Y
 	}
+
+	// entries writing element 0 of each binding from an array of DescriptorTemplateEntry indexed by binding, as the transient descriptor path does
+	// returns false if the layout has bindings that path can't write
+	bool build_descriptor_template_entries(const vuk::DescriptorSetLayoutCreateInfo& dslci, std::vector<VkDescriptorUpdateTemplateEntry>& entries, uint64_t& mask) {
+		using vuk::DescriptorType;
+		mask = 0;
+		for (size_t i = 0; i < dslci.bindings.size(); i++) {
+			auto& b = dslci.bindings[i];
+			if (dslci.flags.size() > i && (dslci.flags[i] & to_integral(vuk::DescriptorBindingFlagBits::eVariableDescriptorCount))) {
+				return false;
+			}
+			if (b.binding >= VUK_MAX_BINDINGS) {
+				return false;
+			}
+			switch ((DescriptorType)b.descriptorType) {
+			case DescriptorType::eUniformBuffer:
+			case DescriptorType::eStorageBuffer:
+			case DescriptorType::eSampledImage:
+			case DescriptorType::eSampler:
+			case DescriptorType::eCombinedImageSampler:
+			case DescriptorType::eStorageImage:
+			case DescriptorType::eAccelerationStructureKHR:
+				break;
+			default:
+				return false;
+			}
+			if (b.descriptorCount == 0) {
+				continue;
+			}
+			VkDescriptorUpdateTemplateEntry entry{};
+			entry.dstBinding = b.binding;
+			entry.dstArrayElement = 0;
+			entry.descriptorCount = 1;
+			entry.descriptorType = vuk::DescriptorBinding::vk_descriptor_type((DescriptorType)b.descriptorType);
+			entry.offset = b.binding * sizeof(vuk::DescriptorTemplateEntry);
+			entry.stride = sizeof(vuk::DescriptorTemplateEntry);
+			entries.push_back(entry);
+			mask |= 1ULL << b.binding;
+		}
+		return entries.size() > 0;
+	}
+
+	// the set to make a push descriptor set: it must be written by the transient path only (no binding flags, one descriptor per binding, not explicit)
+	// and fit into maxPushDescriptors - of these the highest set index is taken, as sets are conventionally ordered by update frequency
+	size_t select_push_descriptor_set(std::span<const vuk::DescriptorSetLayoutCreateInfo> dslcis,
+	                                  std::span<const vuk::DescriptorSetLayoutCreateInfo> explicit_set_layouts,
+	                                  uint32_t max_push_descriptors) {
+		size_t selected = (size_t)-1;
+		for (size_t i = 0; i < dslcis.size(); i++) {
+			auto& dsl = dslcis[i];
+			if (dsl.bindings.empty() || !dsl.flags.empty() || dsl.index >= VUK_MAX_SETS) {
+				continue;
+			}
+			if (std::any_of(explicit_set_layouts.begin(), explicit_set_layouts.end(), [&](auto& l) { return l.index == dsl.index; })) {
+				continue;
+			}
+			uint32_t descriptor_count = 0;
+			bool single = true;
+			for (auto& b : dsl.bindings) {
+				descriptor_count += b.descriptorCount;
+				single = single && b.descriptorCount <= 1;
+			}
+			if (!single || descriptor_count > max_push_descriptors) {
+				continue;
+			}
+			if (selected == (size_t)-1 || dsl.index > dslcis[selected].index) {
+				selected = i;
+			}
+		}
+		return selected;
+	}
+
+	// every (re)creation of the pipeline caches of any runtime gets a new generation, invalidating the thread-local shortcut below
+	std::atomic<uint64_t> pipeline_cache_generation_counter = 1;
+
+	struct ThreadPipelineCache {
+		uint64_t generation = 0;
+		VkPipelineCache cache = VK_NULL_HANDLE;
+		// cleared when the thread exits, so that the caches of exited threads can be merged and destroyed
+		std::shared_ptr<std::atomic<bool>> alive = std::make_shared<std::atomic<bool>>(true);
+
+		~ThreadPipelineCache() {
+			alive->store(false, std::memory_order_release);
+		}
+	};
+	thread_local ThreadPipelineCache thread_pipeline_cache;
+
+	bool is_pipeline_cache_compatible(std::span<const std::byte> data, const VkPhysicalDeviceProperties& properties) {
+		VkPipelineCacheHeaderVersionOne header;
+		if (data.size_bytes() < sizeof(header)) {
+			return false;
+		}
+		memcpy(&header, data.data(), sizeof(header));
+		return header.headerSize >= sizeof(header) && header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE && header.vendorID == properties.vendorID &&
+		       header.deviceID == properties.deviceID && memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+	}
+
+	// stages that can follow a given stage in a graphics shader object chain
+	VkShaderStageFlags shader_object_next_stages(VkShaderStageFlagBits stage) {
+		switch (stage) {
+		case VK_SHADER_STAGE_VERTEX_BIT:
+			return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT | VK_SHADER_STAGE_GEOMETRY_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+		case VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT:
+			return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+		case VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT:
+			return VK_SHADER_STAGE_GEOMETRY_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+		case VK_SHADER_STAGE_GEOMETRY_BIT:
+			return VK_SHADER_STAGE_FRAGMENT_BIT;
+		case VK_SHADER_STAGE_TASK_BIT_EXT:
+			return VK_SHADER_STAGE_MESH_BIT_EXT;
+		case VK_SHADER_STAGE_MESH_BIT_EXT:
+			return VK_SHADER_STAGE_FRAGMENT_BIT;
+		default:
+			return 0;
+		}
+	}
 } // namespace
 
 namespace vuk {
@@ -115,6 +237,9 @@ namespace vuk {
 
 		std::atomic<size_t> frame_counter = 0;
 		std::atomic<size_t> unique_handle_id_counter = 0;
+		// live allocations, indexed by AllocationKind * memory_usage_count + MemoryUsage
+		std::array<std::atomic<int64_t>, allocation_kind_count * memory_usage_count> allocation_counts = {};
+		std::array<std::atomic<int64_t>, allocation_kind_count * memory_usage_count> allocation_bytes = {};
 
 		std::mutex named_pipelines_lock;
 		robin_hood::unordered_flat_map<Name, PipelineBaseInfo*> named_pipelines;
@@ -128,6 +253,43 @@ namespace vuk {
 		std::mutex query_lock;
 		robin_hood::unordered_map<Query, uint64_t> timestamp_result_map;
 
+		PipelineCacheSettings pipeline_cache_settings;
+		std::mutex pipeline_cache_lock;
+		std::atomic<uint64_t> pipeline_cache_generation = 0;
+		// initial data for per-thread caches
+		std::vector<std::byte> pipeline_cache_seed;
+		struct ThreadPipelineCacheEntry {
+			VkPipelineCache cache = VK_NULL_HANDLE;
+			std::shared_ptr<std::atomic<bool>> alive;
+		};
+		robin_hood::unordered_flat_map<std::thread::id, ThreadPipelineCacheEntry> thread_pipeline_caches;
+		// periodic saves are written on a background thread, started on the first save
+		std::mutex pipeline_cache_save_lock;
+		std::condition_variable pipeline_cache_save_cv;
+		std::thread pipeline_cache_save_thread;
+		bool pipeline_cache_save_requested = false;
+		bool stop_pipeline_cache_saving = false;
+
+		void destroy_pipeline_caches(Runtime& ctx) {
+			for (auto& [tid, entry] : thread_pipeline_caches) {
+				ctx.vkDestroyPipelineCache(device, entry.cache, nullptr);
+			}
+			thread_pipeline_caches.clear();
+			ctx.vkDestroyPipelineCache(device, ctx.vk_pipeline_cache, nullptr);
+			ctx.vk_pipeline_cache = VK_NULL_HANDLE;
+		}
+
+		void recreate_pipeline_caches(Runtime& ctx, std::span<const std::byte> data) {
+			std::scoped_lock _(pipeline_cache_lock);
+			destroy_pipeline_caches(ctx);
+			if (pipeline_cache_settings.per_thread_caches) {
+				pipeline_cache_seed.assign(data.begin(), data.end());
+			}
+			VkPipelineCacheCreateInfo pcci{ .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO, .initialDataSize = data.size_bytes(), .pInitialData = data.data() };
+			ctx.vkCreatePipelineCache(device, &pcci, nullptr, &ctx.vk_pipeline_cache);
+			pipeline_cache_generation = pipeline_cache_generation_counter++;
+		}
+
 		void collect(uint64_t absolute_frame) {
 			// collect rarer resources
 			static constexpr uint32_t cache_collection_frequency = 16;
@@ -165,11 +327,17 @@ namespace vuk {
 	    FunctionPointers(params.pointers),
 	    instance(params.instance),
 	    device(params.device),
-	    physical_device(params.physical_device) {
+	    physical_device(params.physical_device),
+	    memory_budget_enabled(params.memory_budget_enabled),
+	    graphics_pipeline_library_enabled(params.graphics_pipeline_library_enabled),
+	    shader_object_enabled(params.shader_object_enabled),
+	    task_shader_enabled(params.task_shader_enabled),
+	    mesh_shader_enabled(params.mesh_shader_enabled) {
 		assert(check_pfns());
 
 		impl = new ContextImpl(*this);
 		impl->executors = std::move(params.executors);
+		impl->pipeline_cache_settings = std::move(params.pipeline_cache_settings);
 		for (auto& exe : impl->executors) {
 			if (exe->type == Executor::Type::eVulkanDeviceQueue) {
 				all_queue_families.push_back(static_cast<QueueExecutor*>(exe.get())->get_queue_family_index());
@@ -180,14 +348,55 @@ namespace vuk {
 		    std::max(physical_device_properties.limits.minUniformBufferOffsetAlignment, physical_device_properties.limits.minStorageBufferOffsetAlignment);
 		VkPhysicalDeviceProperties2 prop2{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2 };
 		if (this->vkCmdBuildAccelerationStructuresKHR) {
-			prop2.pNext = &rt_properties;
+			as_properties.pNext = prop2.pNext;
 			rt_properties.pNext = &as_properties;
+			prop2.pNext = &rt_properties;
+		}
+		if (this->vkCmdPushDescriptorSetKHR) {
+			push_descriptor_properties.pNext = prop2.pNext;
+			prop2.pNext = &push_descriptor_properties;
+		}
+		if (this->vkCmdBindDescriptorBuffersEXT) {
+			descriptor_buffer_properties.pNext = prop2.pNext;
+			prop2.pNext = &descriptor_buffer_properties;
 		}
 		this->vkGetPhysicalDeviceProperties2(physical_device, &prop2);
 		// if we haved push descriptors available, use it
 		if (params.pointers.vkCmdPushDescriptorSetKHR) {
 			default_descriptor_set_strategy = DescriptorSetStrategyFlagBits::ePushDescriptor;
 		}
+		supported_dynamic_state_flags = DynamicStateFlagBits::eViewport | DynamicStateFlagBits::eScissor | DynamicStateFlagBits::eLineWidth |
+		                                DynamicStateFlagBits::eDepthBias | DynamicStateFlagBits::eBlendConstants | DynamicStateFlagBits::eDepthBounds;
+		if (this->vkCmdSetCullModeEXT) {
+			supported_dynamic_state_flags |= DynamicStateFlagBits::eCullMode | DynamicStateFlagBits::eFrontFace | DynamicStateFlagBits::ePrimitiveTopology |
+			                                 DynamicStateFlagBits::eDepthTestEnable | DynamicStateFlagBits::eDepthWriteEnable |
+			                                 DynamicStateFlagBits::eDepthCompareOp | DynamicStateFlagBits::eStencilTestEnable | DynamicStateFlagBits::eStencilOp;
+		}
+		if (this->vkCmdSetRasterizerDiscardEnableEXT) {
+			supported_dynamic_state_flags |=
+			    DynamicStateFlagBits::eRasterizerDiscardEnable | DynamicStateFlagBits::eDepthBiasEnable | DynamicStateFlagBits::ePrimitiveRestartEnable;
+		}
+		if (this->vkCmdSetDepthClampEnableEXT) {
+			supported_dynamic_state_flags |= DynamicStateFlagBits::eDepthClampEnable;
+		}
+		if (this->vkCmdSetPolygonModeEXT) {
+			supported_dynamic_state_flags |= DynamicStateFlagBits::ePolygonMode;
+		}
+		if (this->vkCmdSetColorBlendEnableEXT) {
+			supported_dynamic_state_flags |= DynamicStateFlagBits::eColorBlendEnable;
+		}
+		if (this->vkCmdSetColorBlendEquationEXT) {
+			supported_dynamic_state_flags |= DynamicStateFlagBits::eColorBlendEquation;
+		}
+		if (this->vkCmdSetColorWriteMaskEXT) {
+			supported_dynamic_state_flags |= DynamicStateFlagBits::eColorWriteMask;
+		}
+		if (this->vkCmdSetVertexInputEXT) {
+			supported_dynamic_state_flags |= DynamicStateFlagBits::eVertexInput;
+		}
+		if (impl->pipeline_cache_settings.path.empty() || !load_pipeline_cache_from_file(impl->pipeline_cache_settings.path)) {
+			impl->recreate_pipeline_caches(*this, {});
+		}
 	}
 
 	Executor* Runtime::get_executor(ExecutorTag tag) {
@@ -360,6 +569,14 @@ namespace vuk {
 		}
 
 		std::vector<Program> programs = Program::introspect(spirv_ptr, size);
+		// shader objects are created from code rather than modules
+		std::vector<uint32_t> kept_spirv;
+		if (shader_object_enabled) {
+			if (spirv.empty()) {
+				spirv.assign(spirv_ptr, spirv_ptr + size);
+			}
+			kept_spirv = std::move(spirv);
+		}
 
 		VkShaderModuleCreateInfo moduleCreateInfo{ .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO };
 		moduleCreateInfo.codeSize = size * sizeof(uint32_t);
@@ -368,12 +585,14 @@ namespace vuk {
 		this->vkCreateShaderModule(device, &moduleCreateInfo, nullptr, &sm);
 		std::string name = "ShaderModule: " + cinfo.filename;
 		set_name(sm, Name(name));
-		return { sm, std::move(programs) };
+		return { sm, std::move(programs), std::move(kept_spirv) };
 	}
 
 	PipelineBaseInfo Runtime::create(const create_info_t<PipelineBaseInfo>& cinfo) {
 		std::vector<VkPipelineShaderStageCreateInfo> psscis;
 		std::vector<std::string> entry_point_names;
+		std::vector<const std::vector<uint32_t>*> spirvs;
+		std::vector<size_t> shader_hashes;
 
 		// accumulate descriptors from all stages
 		Program accumulated_reflection;
@@ -383,7 +602,8 @@ namespace vuk {
 			if (source.data_ptr == nullptr) {
 				continue;
 			}
-			auto& sm = impl->shader_modules.acquire({ source, cinfo.shader_paths[i], cinfo.defines, cinfo.compile_options });
+			ShaderModuleCreateInfo smci{ source, cinfo.shader_paths[i], cinfo.defines, cinfo.compile_options };
+			auto& sm = impl->shader_modules.acquire(smci);
 			VkPipelineShaderStageCreateInfo shader_stage{ .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO };
 			shader_stage.pSpecializationInfo = nullptr;
 			auto& entry_point_name = source.entry_point;
@@ -395,6 +615,14 @@ namespace vuk {
 			shader_stage.module = sm.shader_module;
 
 			psscis.push_back(shader_stage);
+			// the module cache key is the source and the defines
+			size_t shader_hash = 0;
+			hash_combine(shader_hash, smci.source);
+			for (auto& [name, value] : smci.defines) {
+				hash_combine(shader_hash, name, value);
+			}
+			shader_hashes.push_back(shader_hash);
+			spirvs.push_back(&sm.spirv);
 			accumulated_reflection.append(*it);
 			pipe_name += cinfo.shader_paths[i] + "+";
 		}
@@ -413,7 +641,18 @@ namespace vuk {
 		plci.plci.pPushConstantRanges = accumulated_reflection.push_constant_ranges.data();
 		std::array<DescriptorSetLayoutAllocInfo, VUK_MAX_SETS> dslai = {};
 		std::vector<VkDescriptorSetLayout> dsls;
-		bool use_pd = default_descriptor_set_strategy == DescriptorSetStrategyFlagBits::ePushDescriptor;
+		bool use_pd = (default_descriptor_set_strategy & DescriptorSetStrategyFlagBits::ePushDescriptor) && this->vkCmdPushDescriptorSetKHR;
+		// all set layouts of a pipeline using descriptor buffers must be descriptor buffer layouts
+		// explicit layouts may be shared with persistent descriptor sets and variable count bindings are not written by the transient path, so these keep sets
+		bool use_db = (default_descriptor_set_strategy & DescriptorSetStrategyFlagBits::eDescriptorBuffer) && this->vkCmdBindDescriptorBuffersEXT &&
+		              cinfo.explicit_set_layouts.empty();
+		for (auto& dsl : plci.dslcis) {
+			use_db = use_db && dsl.flags.empty();
+		}
+		size_t push_set = (size_t)-1;
+		if (use_pd && !use_db) {
+			push_set = select_push_descriptor_set(plci.dslcis, cinfo.explicit_set_layouts, push_descriptor_properties.maxPushDescriptors);
+		}
 		size_t index = 0;
 		for (auto& dsl : plci.dslcis) {
 			dsl.dslci.bindingCount = (uint32_t)dsl.bindings.size();
@@ -423,7 +662,9 @@ namespace vuk {
 				dslbfci.bindingCount = (uint32_t)dsl.bindings.size();
 				dslbfci.pBindingFlags = dsl.flags.data();
 				dsl.dslci.pNext = &dslbfci;
-			} else if (use_pd && (index == plci.dslcis.size() - 1)) {
+			} else if (use_db) {
+				dsl.dslci.flags |= VK_DESCRIPTOR_SET_LAYOUT_CREATE_DESCRIPTOR_BUFFER_BIT_EXT;
+			} else if (index == push_set) {
 				dsl.dslci.flags |= VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR;
 			}
 			auto descset_layout_alloc_info = impl->descriptor_set_layouts.acquire(dsl);
@@ -438,11 +679,77 @@ namespace vuk {
 		plci.plci.pSetLayouts = dsls.data();
 		plci.plci.setLayoutCount = (uint32_t)dsls.size();
 
+		std::vector<VkShaderEXT> shader_objects;
+		bool use_shader_objects = (cinfo.use_shader_objects || default_use_shader_objects) && cinfo.hit_groups.empty() && shader_object_enabled;
+		if (use_shader_objects) {
+			VkShaderStageFlags all_stages = 0;
+			for (auto& pssci : psscis) {
+				all_stages |= pssci.stage;
+			}
+			std::vector<VkShaderCreateInfoEXT> scis;
+			for (size_t i = 0; i < psscis.size(); i++) {
+				VkShaderCreateInfoEXT sci{ .sType = VK_STRUCTURE_TYPE_SHADER_CREATE_INFO_EXT };
+				// stages are linked so that the implementation can optimize across interfaces
+				sci.flags = psscis.size() > 1 ? VK_SHADER_CREATE_LINK_STAGE_BIT_EXT : 0;
+				sci.stage = psscis[i].stage;
+				sci.nextStage = shader_object_next_stages(psscis[i].stage) & all_stages;
+				sci.codeType = VK_SHADER_CODE_TYPE_SPIRV_EXT;
+				sci.codeSize = spirvs[i]->size() * sizeof(uint32_t);
+				sci.pCode = spirvs[i]->data();
+				sci.pName = entry_point_names[i].c_str();
+				sci.setLayoutCount = (uint32_t)dsls.size();
+				sci.pSetLayouts = dsls.data();
+				sci.pushConstantRangeCount = (uint32_t)accumulated_reflection.push_constant_ranges.size();
+				sci.pPushConstantRanges = accumulated_reflection.push_constant_ranges.data();
+				scis.push_back(sci);
+			}
+			shader_objects.resize(scis.size());
+			// on failure we fall back to pipelines
+			if (this->vkCreateShadersEXT(device, (uint32_t)scis.size(), scis.data(), nullptr, shader_objects.data()) != VK_SUCCESS) {
+				for (auto& so : shader_objects) {
+					if (so != VK_NULL_HANDLE) {
+						this->vkDestroyShaderEXT(device, so, nullptr);
+					}
+				}
+				shader_objects.clear();
+			}
+		}
+
 		PipelineBaseInfo pbi;
 		pbi.psscis = std::move(psscis);
 		pbi.entry_point_names = std::move(entry_point_names);
 		pbi.layout_info = dslai;
 		pbi.pipeline_layout = impl->pipeline_layouts.acquire(plci);
+		pbi.shader_hashes = std::move(shader_hashes);
+		pbi.pipeline_layout_hash = std::hash<PipelineLayoutCreateInfo>{}(plci);
+		// push descriptor templates are tied to the pipeline layout
+		if (this->vkCmdPushDescriptorSetWithTemplateKHR) {
+			VkPipelineBindPoint bind_point = VK_PIPELINE_BIND_POINT_GRAPHICS;
+			for (auto& pssci : pbi.psscis) {
+				if (pssci.stage == VK_SHADER_STAGE_COMPUTE_BIT) {
+					bind_point = VK_PIPELINE_BIND_POINT_COMPUTE;
+				} else if (pssci.stage == VK_SHADER_STAGE_RAYGEN_BIT_KHR) {
+					bind_point = VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR;
+				}
+			}
+			for (auto& dsl : plci.dslcis) {
+				auto& li = pbi.layout_info[dsl.index];
+				std::vector<VkDescriptorUpdateTemplateEntry> entries;
+				if (!li.push || !build_descriptor_template_entries(dsl, entries, li.template_bindings)) {
+					continue;
+				}
+				VkDescriptorUpdateTemplateCreateInfo dutci{ .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO };
+				dutci.descriptorUpdateEntryCount = (uint32_t)entries.size();
+				dutci.pDescriptorUpdateEntries = entries.data();
+				dutci.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_PUSH_DESCRIPTORS_KHR;
+				dutci.pipelineBindPoint = bind_point;
+				dutci.pipelineLayout = pbi.pipeline_layout;
+				dutci.set = (uint32_t)dsl.index;
+				if (this->vkCreateDescriptorUpdateTemplate(device, &dutci, nullptr, &li.update_template) != VK_SUCCESS) {
+					li.update_template = VK_NULL_HANDLE;
+				}
+			}
+		}
 		pbi.dslcis = std::move(plci.dslcis);
 		for (auto& dslci : pbi.dslcis) {
 			std::sort(dslci.bindings.begin(), dslci.bindings.end(), [](auto& a, auto& b) { return a.binding < b.binding; });
@@ -453,17 +760,39 @@ namespace vuk {
 		pbi.variable_count_max = cinfo.variable_count_max;
 		pbi.hit_groups = cinfo.hit_groups;
 		pbi.max_ray_recursion_depth = cinfo.max_ray_recursion_depth;
+		pbi.shader_objects = std::move(shader_objects);
 		return pbi;
 	}
 
 	bool Runtime::load_pipeline_cache(std::span<std::byte> data) {
-		VkPipelineCacheCreateInfo pcci{ .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO, .initialDataSize = data.size_bytes(), .pInitialData = data.data() };
-		this->vkDestroyPipelineCache(device, vk_pipeline_cache, nullptr);
-		this->vkCreatePipelineCache(device, &pcci, nullptr, &vk_pipeline_cache);
+		// drivers are expected to ignore incompatible data, but not all of them do
+		if (!is_pipeline_cache_compatible(data, physical_device_properties)) {
+			impl->recreate_pipeline_caches(*this, {});
+			return false;
+		}
+		impl->recreate_pipeline_caches(*this, data);
 		return true;
 	}
 
 	std::vector<std::byte> Runtime::save_pipeline_cache() {
+		std::scoped_lock _(impl->pipeline_cache_lock);
+		if (!impl->thread_pipeline_caches.empty()) {
+			std::vector<VkPipelineCache> src_caches;
+			src_caches.reserve(impl->thread_pipeline_caches.size());
+			for (auto& [tid, entry] : impl->thread_pipeline_caches) {
+				src_caches.push_back(entry.cache);
+			}
+			this->vkMergePipelineCaches(device, vk_pipeline_cache, (uint32_t)src_caches.size(), src_caches.data());
+			// the contents of exited threads now live in the main cache, so their caches can go
+			for (auto it = impl->thread_pipeline_caches.begin(); it != impl->thread_pipeline_caches.end();) {
+				if (!it->second.alive->load(std::memory_order_acquire)) {
+					this->vkDestroyPipelineCache(device, it->second.cache, nullptr);
+					it = impl->thread_pipeline_caches.erase(it);
+				} else {
+					++it;
+				}
+			}
+		}
 		size_t size;
 		std::vector<std::byte> data;
 		this->vkGetPipelineCacheData(device, vk_pipeline_cache, &size, nullptr);
@@ -472,6 +801,67 @@ namespace vuk {
 		return data;
 	}
 
+	bool Runtime::load_pipeline_cache_from_file(std::string_view path) {
+		std::ifstream file(std::filesystem::path(path), std::ios::binary | std::ios::ate);
+		if (!file) {
+			return false;
+		}
+		std::vector<std::byte> data((size_t)file.tellg());
+		file.seekg(0);
+		if (!file.read(reinterpret_cast<char*>(data.data()), data.size())) {
+			return false;
+		}
+		return load_pipeline_cache(data);
+	}
+
+	bool Runtime::save_pipeline_cache_to_file(std::string_view path) {
+		auto data = save_pipeline_cache();
+		std::filesystem::path target(path);
+		auto temp = target;
+		temp += ".tmp";
+		std::error_code ec;
+		{
+			std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+			file.write(reinterpret_cast<const char*>(data.data()), data.size());
+			file.close();
+			// never replace a good cache with a partially written one
+			if (!file.good()) {
+				std::filesystem::remove(temp, ec);
+				return false;
+			}
+		}
+		std::filesystem::rename(temp, target, ec);
+		if (ec) {
+			std::error_code remove_ec;
+			std::filesystem::remove(temp, remove_ec);
+			return false;
+		}
+		return true;
+	}
+
+	VkPipelineCache Runtime::get_thread_pipeline_cache() {
+		if (!impl->pipeline_cache_settings.per_thread_caches) {
+			return vk_pipeline_cache;
+		}
+		auto generation = impl->pipeline_cache_generation.load();
+		if (thread_pipeline_cache.generation == generation) {
+			return thread_pipeline_cache.cache;
+		}
+		std::scoped_lock _(impl->pipeline_cache_lock);
+		auto& entry = impl->thread_pipeline_caches[std::this_thread::get_id()];
+		if (entry.cache == VK_NULL_HANDLE) {
+			VkPipelineCacheCreateInfo pcci{ .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+				                              .initialDataSize = impl->pipeline_cache_seed.size(),
+				                              .pInitialData = impl->pipeline_cache_seed.data() };
+			this->vkCreatePipelineCache(device, &pcci, nullptr, &entry.cache);
+		}
+		// thread ids are reused: an entry left by an exited thread that has not been pruned yet is taken over
+		entry.alive = thread_pipeline_cache.alive;
+		thread_pipeline_cache.generation = generation;
+		thread_pipeline_cache.cache = entry.cache;
+		return entry.cache;
+	}
+
 	Query Runtime::create_timestamp_query() {
 		return { impl->query_id_counter++ };
 	}
@@ -500,6 +890,29 @@ namespace vuk {
 				ret.variable_count_binding_max_size = b.descriptorCount;
 			}
 		}
+		// descriptor buffer layouts are written with vkGetDescriptorEXT, they need the layout of the set in memory instead of a template
+		if (cinfo.dslci.flags & VK_DESCRIPTOR_SET_LAYOUT_CREATE_DESCRIPTOR_BUFFER_BIT_EXT) {
+			this->vkGetDescriptorSetLayoutSizeEXT(device, ret.layout, &ret.descriptor_buffer_size);
+			for (auto& b : cinfo_mod.bindings) {
+				assert(b.binding < VUK_MAX_BINDINGS);
+				this->vkGetDescriptorSetLayoutBindingOffsetEXT(device, ret.layout, b.binding, &ret.descriptor_buffer_offsets[b.binding]);
+			}
+			// an empty set still needs a valid offset
+			ret.descriptor_buffer_size = std::max(ret.descriptor_buffer_size, VkDeviceSize(1));
+			return ret;
+		}
+		// push layouts get their template with the pipeline layout
+		std::vector<VkDescriptorUpdateTemplateEntry> entries;
+		if (!(cinfo.dslci.flags & VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR) && build_descriptor_template_entries(cinfo, entries, ret.template_bindings)) {
+			VkDescriptorUpdateTemplateCreateInfo dutci{ .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO };
+			dutci.descriptorUpdateEntryCount = (uint32_t)entries.size();
+			dutci.pDescriptorUpdateEntries = entries.data();
+			dutci.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+			dutci.descriptorSetLayout = ret.layout;
+			if (this->vkCreateDescriptorUpdateTemplate(device, &dutci, nullptr, &ret.update_template) != VK_SUCCESS) {
+				ret.update_template = VK_NULL_HANDLE;
+			}
+		}
 		return ret;
 	}
 
@@ -563,6 +976,9 @@ namespace vuk {
 	}
 
 	void Runtime::destroy(const DescriptorSetLayoutAllocInfo& ds) {
+		if (ds.update_template) {
+			this->vkDestroyDescriptorUpdateTemplate(device, ds.update_template, nullptr);
+		}
 		this->vkDestroyDescriptorSetLayout(device, ds.layout, nullptr);
 	}
 
@@ -579,14 +995,33 @@ namespace vuk {
 	}
 
 	void Runtime::destroy(const PipelineBaseInfo& pbi) {
-		// no-op, we don't own device objects
+		// we don't own the modules and layouts, but shader objects and push descriptor templates are created per base
+		for (auto& so : pbi.shader_objects) {
+			this->vkDestroyShaderEXT(device, so, nullptr);
+		}
+		for (auto& li : pbi.layout_info) {
+			if (li.push && li.update_template) {
+				this->vkDestroyDescriptorUpdateTemplate(device, li.update_template, nullptr);
+			}
+		}
 	}
 
 	Runtime::~Runtime() {
 		if (impl) {
 			this->vkDeviceWaitIdle(device);
 
-			this->vkDestroyPipelineCache(device, vk_pipeline_cache, nullptr);
+			if (impl->pipeline_cache_save_thread.joinable()) {
+				{
+					std::scoped_lock _(impl->pipeline_cache_save_lock);
+					impl->stop_pipeline_cache_saving = true;
+				}
+				impl->pipeline_cache_save_cv.notify_one();
+				impl->pipeline_cache_save_thread.join();
+			}
+			if (!impl->pipeline_cache_settings.path.empty()) {
+				save_pipeline_cache_to_file(impl->pipeline_cache_settings.path);
+			}
+			impl->destroy_pipeline_caches(*this);
 
 			delete impl;
 		}
@@ -596,9 +1031,50 @@ namespace vuk {
 		return impl->unique_handle_id_counter++;
 	}
 
+	void Runtime::record_allocations(AllocationKind kind, MemoryUsage usage, int64_t count, int64_t bytes) noexcept {
+		auto index = (size_t)kind * memory_usage_count + (size_t)usage;
+		impl->allocation_counts[index].fetch_add(count, std::memory_order_relaxed);
+		impl->allocation_bytes[index].fetch_add(bytes, std::memory_order_relaxed);
+	}
+
+	MemoryStats Runtime::get_memory_stats() {
+		MemoryStats stats;
+		for (size_t kind = 0; kind < allocation_kind_count; kind++) {
+			for (size_t usage = 0; usage < memory_usage_count; usage++) {
+				auto index = kind * memory_usage_count + usage;
+				stats.allocations[kind][usage] = { (uint64_t)impl->allocation_counts[index].load(std::memory_order_relaxed),
+					                                 (uint64_t)impl->allocation_bytes[index].load(std::memory_order_relaxed) };
+			}
+		}
+		stats.heaps = impl->device_vk_resource->get_memory_heap_stats();
+		return stats;
+	}
+
 	void Runtime::next_frame() {
-		impl->frame_counter++;
-		collect(impl->frame_counter);
+		auto frame = ++impl->frame_counter;
+		collect(frame);
+		auto& pcs = impl->pipeline_cache_settings;
+		if (!pcs.path.empty() && pcs.save_interval > 0 && frame % pcs.save_interval == 0) {
+			// merging, serializing and writing happen off the frame thread; a save still in flight absorbs this request
+			std::scoped_lock _(impl->pipeline_cache_save_lock);
+			impl->pipeline_cache_save_requested = true;
+			if (!impl->pipeline_cache_save_thread.joinable()) {
+				impl->pipeline_cache_save_thread = std::thread([this] {
+					std::unique_lock lock(impl->pipeline_cache_save_lock);
+					while (true) {
+						impl->pipeline_cache_save_cv.wait(lock, [this] { return impl->stop_pipeline_cache_saving || impl->pipeline_cache_save_requested; });
+						if (impl->stop_pipeline_cache_saving) {
+							return;
+						}
+						impl->pipeline_cache_save_requested = false;
+						lock.unlock();
+						save_pipeline_cache_to_file(impl->pipeline_cache_settings.path);
+						lock.lock();
+					}
+				});
+			}
+			impl->pipeline_cache_save_cv.notify_one();
+		}
 	}
 
 	Result<void> Runtime::wait_idle() {
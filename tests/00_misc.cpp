@@ -3,6 +3,7 @@
 #include <source_location>
 
 #include "vuk/SourceLocation.hpp"
+#include "vuk/runtime/Cache.hpp"
 
 struct S {
 	std::source_location location;
@@ -52,4 +53,12 @@ TEST_CASE("source location") {
 	g(std::source_location::current());
 
 	h();
-}
\ No newline at end of file
+}
+TEST_CASE("sampler create info hash agrees with equality") {
+	vuk::SamplerCreateInfo a{ .mipLodBias = 0.f, .minLod = 0.f };
+	vuk::SamplerCreateInfo b{ .mipLodBias = -0.f, .minLod = -0.f };
+	REQUIRE(a == b);
+	CHECK(std::hash<vuk::SamplerCreateInfo>{}(a) == std::hash<vuk::SamplerCreateInfo>{}(b));
+	b.maxAnisotropy = 16.f;
+	CHECK(std::hash<vuk::SamplerCreateInfo>{}(a) != std::hash<vuk::SamplerCreateInfo>{}(b));
+}
@@ -1,7 +1,15 @@
 #include "TestContext.hpp"
 #include "vuk/runtime/vk/AllocatorHelpers.hpp"
 #include "vuk/vsl/Core.hpp"
+#include "vuk/vsl/FileUpload.hpp"
+#include "vuk/vsl/ReadbackRing.hpp"
+#include "vuk/vsl/StagingRing.hpp"
+#include "vuk/vsl/UploadBatch.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
 #include <doctest/doctest.h>
+#include <filesystem>
 #include <thread>
 
 using namespace vuk;
@@ -73,6 +81,112 @@ TEST_CASE("image upload/download") {
 	}
 }
 
+TEST_CASE("image upload with conversion") {
+	{
+		std::array<uint8_t, 12> data = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12 };
+		auto ia = ImageAttachment::from_preset(ImageAttachment::Preset::eGeneric2D, Format::eR8G8B8A8Unorm, { 2, 2, 1 }, Samples::e1);
+		auto uploaded = create_image_with_data(*test_context.allocator, DomainFlagBits::eAny, ia, Format::eB8G8R8Unorm, std::span(data));
+		REQUIRE(uploaded.holds_value());
+		auto& [img, fut] = *uploaded;
+
+		auto dst = *allocate_buffer(*test_context.allocator, BufferCreateInfo{ MemoryUsage::eCPUonly, 16, 4 });
+		auto res = download_buffer(copy(fut, discard_buf("dst", *dst))).get(*test_context.allocator, test_context.compiler);
+		std::array<uint8_t, 16> expected = { 3, 2, 1, 255, 6, 5, 4, 255, 9, 8, 7, 255, 12, 11, 10, 255 };
+		CHECK(std::span((uint8_t*)res->mapped_ptr, 16) == std::span(expected));
+	}
+	{
+		// integer texels can't be converted to 8 bit unorm
+		std::array<uint32_t, 4> data = { 1, 2, 3, 4 };
+		auto ia = ImageAttachment::from_preset(ImageAttachment::Preset::eGeneric2D, Format::eR8G8B8A8Unorm, { 2, 2, 1 }, Samples::e1);
+		auto uploaded = create_image_with_data(*test_context.allocator, DomainFlagBits::eAny, ia, Format::eR32Uint, std::span(data));
+		REQUIRE(!uploaded.holds_value());
+		CHECK(dynamic_cast<FormatConversionException*>(&uploaded.error()) != nullptr);
+	}
+}
+
+TEST_CASE("parallel texel conversion") {
+	// enough texels to be split into chunks
+	size_t texel_count = (1 << 20) + 3;
+	std::vector<uint8_t> src(texel_count * 3);
+	for (size_t i = 0; i < src.size(); i++) {
+		src[i] = (uint8_t)(i * 7);
+	}
+	std::vector<uint8_t> serial(texel_count * 4);
+	std::vector<uint8_t> parallel(texel_count * 4);
+	REQUIRE(convert_texels(Format::eB8G8R8Unorm, src.data(), Format::eR8G8B8A8Unorm, serial.data(), texel_count));
+	REQUIRE(convert_texels_parallel(Format::eB8G8R8Unorm, src.data(), Format::eR8G8B8A8Unorm, parallel.data(), texel_count, 4));
+	CHECK(serial == parallel);
+	CHECK(!convert_texels_parallel(Format::eR32Uint, src.data(), Format::eR8G8B8A8Unorm, parallel.data(), texel_count, 4));
+}
+
+TEST_CASE("batched upload") {
+	{
+		auto data = { 1u, 2u, 3u, 4u };
+		auto data2 = { 5u, 6u };
+		auto image_data = { 7u, 8u, 9u, 10u };
+		auto buf = allocate_buffer(*test_context.allocator, { .mem_usage = MemoryUsage::eGPUonly, .size = sizeof(uint32_t) * 4 });
+		auto buf2 = allocate_buffer(*test_context.allocator, { .mem_usage = MemoryUsage::eGPUonly, .size = sizeof(uint32_t) * 4 });
+		auto ia = ImageAttachment::from_preset(ImageAttachment::Preset::eGeneric2D, Format::eR32Uint, { 2, 2, 1 }, Samples::e1);
+		auto img = allocate_image(*test_context.allocator, ia);
+		ia.image = **img;
+
+		UploadBatch batch(*test_context.allocator);
+		auto first = batch.add(**buf, std::span(data));
+		auto second = batch.add(**buf2, std::span(data2));
+		// merged into the upload of buf2
+		CHECK(batch.add(**buf2, std::span(data2), sizeof(uint32_t) * 2) == second);
+		auto image = batch.add(ia, std::span(image_data));
+		auto uploads = batch.record();
+		REQUIRE(uploads.buffers.size() == 2);
+		REQUIRE(uploads.images.size() == 1);
+
+		auto res = download_buffer(uploads.buffers[first]).get(*test_context.allocator, test_context.compiler);
+		CHECK(std::span((uint32_t*)res->mapped_ptr, 4) == std::span(data));
+		res = download_buffer(uploads.buffers[second]).get(*test_context.allocator, test_context.compiler);
+		auto expected = { 5u, 6u, 5u, 6u };
+		CHECK(std::span((uint32_t*)res->mapped_ptr, 4) == std::span(expected));
+
+		auto dst = *allocate_buffer(*test_context.allocator, BufferCreateInfo{ MemoryUsage::eCPUonly, sizeof(uint32_t) * 4, 4 });
+		res = download_buffer(copy(uploads.images[image], discard_buf("dst", *dst))).get(*test_context.allocator, test_context.compiler);
+		CHECK(std::span((uint32_t*)res->mapped_ptr, 4) == std::span(image_data));
+	}
+}
+
+TEST_CASE("batched upload through a full staging ring") {
+	{
+		auto data = { 1u, 2u, 3u, 4u };
+		auto buf = allocate_buffer(*test_context.allocator, { .mem_usage = MemoryUsage::eGPUonly, .size = sizeof(uint32_t) * 4 });
+		StagingRing staging(*test_context.allocator, 8, 1);
+		staging.next_frame();
+
+		// the ring can't hold the batch, so the staging memory is allocated from the allocator of the ring
+		UploadBatch batch(staging);
+		auto index = batch.add(**buf, std::span(data));
+		auto uploads = batch.record();
+		auto res = download_buffer(uploads.buffers[index]).get(*test_context.allocator, test_context.compiler);
+		CHECK(std::span((uint32_t*)res->mapped_ptr, 4) == std::span(data));
+	}
+}
+
+TEST_CASE("file upload") {
+	{
+		auto data = { 1u, 2u, 3u, 4u, 5u, 6u };
+		std::string path = (std::filesystem::temp_directory_path() / "vuk_file_upload_test.bin").string();
+		auto file = fopen(path.c_str(), "wb");
+		fwrite(std::data(data), sizeof(uint32_t), data.size(), file);
+		fclose(file);
+
+		FileReader reader;
+		auto buf = allocate_buffer(*test_context.allocator, { .mem_usage = MemoryUsage::eGPUonly, .size = sizeof(uint32_t) * 4 });
+		FileRange ranges[] = { { 0, sizeof(uint32_t) * 2 }, { sizeof(uint32_t) * 4, sizeof(uint32_t) * 2 } };
+		auto fut = file_to_buffer(*test_context.allocator, reader, **buf, path, ranges);
+		auto res = download_buffer(fut).get(*test_context.allocator, test_context.compiler);
+		auto expected = { 1u, 2u, 5u, 6u };
+		CHECK(std::span((uint32_t*)res->mapped_ptr, 4) == std::span(expected));
+		std::remove(path.c_str());
+	}
+}
+
 TEST_CASE("image clear") {
 	{
 		auto data = { 1u, 2u, 3u, 4u };
@@ -147,6 +261,131 @@ TEST_CASE("poll wait") {
 	}
 }
 
+TEST_CASE("readback ring") {
+	{
+		auto data = { 1u, 2u, 3u, 4u };
+		auto [buf, fut] = create_buffer(*test_context.allocator, MemoryUsage::eGPUonly, DomainFlagBits::eAny, std::span(data));
+
+		ReadbackRing readbacks(*test_context.allocator, 1024);
+		auto readback = *readbacks.read(fut, sizeof(uint32_t) * 4);
+		bool called = false;
+		auto readback2 = *readbacks.read(std::move(fut), sizeof(uint32_t) * 2);
+		readbacks.on_ready(readback2, [&](std::span<const std::byte> result) {
+			called = true;
+			CHECK(std::span((const uint32_t*)result.data(), 2) == std::span(data).subspan(0, 2));
+		});
+		readbacks.submit(*test_context.allocator, test_context.compiler);
+		while (!*readbacks.ready(readback)) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+		auto result = readbacks.data(readback);
+		CHECK(std::span((const uint32_t*)result.data(), 4) == std::span(data));
+		readbacks.release(readback);
+		while (!called) {
+			readbacks.update();
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+		CHECK(readbacks.available() == 1024);
+	}
+}
+
+TEST_CASE("readback ring, concurrent updates") {
+	{
+		auto data = { 1u, 2u, 3u, 4u };
+		auto [buf, fut] = create_buffer(*test_context.allocator, MemoryUsage::eGPUonly, DomainFlagBits::eAny, std::span(data));
+
+		ReadbackRing readbacks(*test_context.allocator, 1024);
+		auto readback = *readbacks.read(std::move(fut), sizeof(uint32_t) * 4);
+		std::atomic<int> calls = 0;
+		readbacks.on_ready(readback, [&](std::span<const std::byte> result) { calls++; });
+		readbacks.submit(*test_context.allocator, test_context.compiler);
+		// every thread polls until the readback is reclaimed, the callback runs only once
+		auto poll = [&] {
+			while (readbacks.available() != 1024) {
+				readbacks.update();
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+		};
+		std::thread t1(poll), t2(poll);
+		t1.join();
+		t2.join();
+		CHECK(calls == 1);
+	}
+}
+
+TEST_CASE("staging ring") {
+	{
+		StagingRing staging(*test_context.allocator, 1024, 1);
+		staging.next_frame();
+		auto first = staging.allocate(10, 1);
+		REQUIRE(first.holds_value());
+		auto ring_start = first->offset;
+		// the offset into the VkBuffer is aligned, not the position in the ring
+		auto aligned = staging.allocate(16, 12);
+		REQUIRE(aligned.holds_value());
+		CHECK(aligned->offset % 12 == 0);
+		auto big = staging.allocate(600, 1);
+		REQUIRE(big.holds_value());
+		// the ring is full until the frames using it are reclaimed
+		auto full = staging.allocate(600, 1);
+		CHECK(!full.holds_value());
+		CHECK(!staging.allocate(2048, 1).holds_value());
+		staging.next_frame();
+		staging.next_frame();
+		CHECK(staging.available() == 1024);
+		// allocations that would cross the end of the ring start again from its beginning
+		auto wrapped = staging.allocate(600, 1);
+		REQUIRE(wrapped.holds_value());
+		CHECK(wrapped->offset == ring_start);
+	}
+}
+
+TEST_CASE("staging ring overflow") {
+	{
+		auto data = { 1u, 2u, 3u, 4u };
+		StagingRing staging(*test_context.allocator, 8, 1);
+		staging.next_frame();
+		// the ring is too small, so the staging memory comes from the allocator of the ring
+		auto buf = *allocate_buffer(*test_context.allocator, BufferCreateInfo{ MemoryUsage::eGPUonly, sizeof(uint32_t) * 4, 1 });
+		auto fut = host_data_to_buffer(staging, DomainFlagBits::eAny, *buf, std::span(data));
+		auto res = download_buffer(fut).get(*test_context.allocator, test_context.compiler);
+		CHECK(std::span((uint32_t*)res->mapped_ptr, 4) == std::span(data));
+
+		auto ia = ImageAttachment::from_preset(ImageAttachment::Preset::eGeneric2D, Format::eR32Uint, { 2, 2, 1 }, Samples::e1);
+		ia.level_count = 1;
+		auto img = allocate_image(*test_context.allocator, ia);
+		ia.image = **img;
+		auto image = host_data_to_image(staging, DomainFlagBits::eAny, ia, std::data(data));
+		auto dst = *allocate_buffer(*test_context.allocator, BufferCreateInfo{ MemoryUsage::eCPUonly, sizeof(uint32_t) * 4, 4 });
+		res = download_buffer(copy(image, discard_buf("dst", *dst))).get(*test_context.allocator, test_context.compiler);
+		CHECK(std::span((uint32_t*)res->mapped_ptr, 4) == std::span(data));
+	}
+}
+
+TEST_CASE("staging ring back-pressure") {
+	{
+		StagingRing staging(*test_context.allocator, 256, 1);
+		staging.next_frame();
+		REQUIRE(staging.allocate(100, 1).holds_value());
+		staging.next_frame();
+		staging.next_frame();
+		// a drained ring starts over, so an allocation that doesn't fit behind the last one still succeeds
+		REQUIRE(staging.allocate(200, 1).holds_value());
+		CHECK(!staging.allocate_blocking(512, 1).holds_value());
+
+		// a streaming thread waits for the frame thread to reclaim memory
+		std::atomic<bool> allocated = false;
+		std::thread streamer([&] {
+			auto res = staging.allocate_blocking(256, 1);
+			allocated = res.holds_value();
+		});
+		staging.next_frame();
+		staging.next_frame();
+		streamer.join();
+		CHECK(allocated);
+	}
+}
+
 TEST_CASE("buffers in same allocation") {
 	auto data = { 5u, 5u, 5u, 5u };
 	auto buf = *allocate_buffer(*test_context.allocator, BufferCreateInfo{ MemoryUsage::eCPUonly, 4 * sizeof(uint32_t), 1 });
@@ -160,4 +399,159 @@ TEST_CASE("buffers in same allocation") {
 	CHECK(std::span((uint32_t*)res->mapped_ptr, 4) == std::span(data));
 }
 
+TEST_CASE("redundant binds are skipped") {
+	auto data = { 1u, 2u, 3u };
+	auto [buf, buf0] = create_buffer(*test_context.allocator, MemoryUsage::eGPUonly, DomainFlagBits::eAny, std::span(data));
+	vuk::PipelineBaseCreateInfo pbci;
+	pbci.add_glsl(R"(#version 450
+#pragma shader_stage(compute)
+
+layout(std430, binding = 0) buffer coherent BufferIn {
+	uint data_in[];
+};
+
+layout (local_size_x = 1) in;
+
+void main() {
+	data_in[gl_GlobalInvocationID.x] = gl_GlobalInvocationID.x * 2;
+}
+)",
+	              "<>");
+	auto pipe = test_context.runtime->get_pipeline(pbci);
+	auto index_buf = *allocate_buffer(*test_context.allocator, BufferCreateInfo{ MemoryUsage::eGPUonly, sizeof(uint32_t) * 3, 4 });
+
+	uint64_t skipped_index = 0;
+	uint64_t skipped_total = 0;
+	// the dispatches write the same values, so recording them twice doesn't change the result
+	auto pass = make_pass("repeated binds", [&, pipe](CommandBuffer& cbuf, VUK_BA(Access::eComputeRW) buf) {
+		auto before = cbuf.get_skipped_redundant_calls();
+		cbuf.bind_index_buffer(**index_buf, IndexType::eUint32);
+		cbuf.bind_index_buffer(**index_buf, IndexType::eUint32);
+		skipped_index = cbuf.get_skipped_redundant_calls() - before;
+		for (int i = 0; i < 2; i++) {
+			cbuf.bind_compute_pipeline(pipe);
+			cbuf.bind_buffer(0, 0, buf);
+			cbuf.dispatch(3, 1, 1);
+		}
+		skipped_total = cbuf.get_skipped_redundant_calls() - before;
+		return buf;
+	});
+	auto res = download_buffer(pass(buf0)).get(*test_context.allocator, test_context.compiler);
+	auto test = { 0u, 2u, 4u };
+	CHECK(std::span((uint32_t*)res->mapped_ptr, 3) == std::span(test));
+	CHECK(skipped_index == 1);
+	// at least the second pipeline bind is skipped, the set is only skipped if the strategy binds sets
+	CHECK(skipped_total >= 2);
+}
+
+TEST_CASE("descriptor sets with the same bindings are reused within a frame") {
+	auto buf = *allocate_buffer(*test_context.allocator, BufferCreateInfo{ MemoryUsage::eGPUonly, sizeof(uint32_t) * 4, 4 });
+
+	DescriptorSetLayoutCreateInfo dslci;
+	dslci.index = 0;
+	dslci.bindings.push_back(VkDescriptorSetLayoutBinding{
+	    .binding = 0, .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .descriptorCount = 1, .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT });
+	dslci.dslci.bindingCount = (uint32_t)dslci.bindings.size();
+	dslci.dslci.pBindings = dslci.bindings.data();
+	dslci.used_bindings.set(0);
+	auto& dslai = test_context.runtime->acquire_descriptor_set_layout(dslci);
+
+	SetBinding sb;
+	sb.used.set(0);
+	sb.bindings[0].type = DescriptorType::eStorageBuffer;
+	sb.bindings[0].buffer = VkDescriptorBufferInfo{ buf->buffer, buf->offset, buf->size };
+	sb.layout_info = &dslai;
+	sb.compute_hash();
+
+	auto& frame = test_context.sfa_resource->get_next_frame();
+	DescriptorSet first, second;
+	REQUIRE(frame.allocate_descriptor_sets_with_value(std::span{ &first, 1 }, std::span{ &sb, 1 }, VUK_HERE_AND_NOW()));
+	REQUIRE(frame.allocate_descriptor_sets_with_value(std::span{ &second, 1 }, std::span{ &sb, 1 }, VUK_HERE_AND_NOW()));
+	CHECK(first.descriptor_set != VK_NULL_HANDLE);
+	CHECK(first.descriptor_set == second.descriptor_set);
+
+	// the previous frame is still in flight, so its sets can't be handed out again
+	auto& next_frame = test_context.sfa_resource->get_next_frame();
+	DescriptorSet third;
+	REQUIRE(next_frame.allocate_descriptor_sets_with_value(std::span{ &third, 1 }, std::span{ &sb, 1 }, VUK_HERE_AND_NOW()));
+	CHECK(third.descriptor_set != first.descriptor_set);
+}
+
+TEST_CASE("draw with descriptor buffers") {
+	if (!test_context.has_descriptor_buffer) {
+		return;
+	}
+	auto data = { 1u, 1u, 1u, 1u };
+	auto ia = ImageAttachment::from_preset(ImageAttachment::Preset::eGeneric2D, Format::eR32Uint, { 2, 2, 1 }, Samples::e1);
+	ia.level_count = 1;
+	auto [img, img_val] = create_image_with_data(*test_context.allocator, DomainFlagBits::eAny, ia, std::span(data));
+	auto cleared_img = clear_image(img_val, ClearColor(0u, 0u, 0u, 0u));
+	auto value = { 42u };
+	auto [buf, buf_val] = create_buffer(*test_context.allocator, MemoryUsage::eGPUonly, DomainFlagBits::eAny, std::span(value));
+
+	vuk::PipelineBaseCreateInfo pbci;
+	pbci.add_glsl(
+	    R"(#version 450
+			#pragma shader_stage(vertex)
+
+			vec2 positions[3] = vec2[](
+				vec2(-1.0, -1.0),
+				vec2( 3.0, -1.0),
+				vec2(-1.0,  3.0)
+			);
+
+			void main() {
+				gl_Position = vec4(positions[gl_VertexIndex], 0.0, 1.0);
+			}
+			)",
+	    "<vert>");
+	pbci.add_glsl(
+	    R"(#version 450
+			#pragma shader_stage(fragment)
+
+			layout(binding = 0, r32ui) uniform writeonly uimage2D outputImage;
+			layout(std430, binding = 1) readonly buffer Value {
+				uint value;
+			};
+
+			void main() {
+				ivec2 coord = ivec2(gl_FragCoord.xy);
+				imageStore(outputImage, coord, uvec4(value, 0, 0, 0));
+			}
+			)",
+	    "<frag>");
+	// the strategy is picked when the pipeline is created
+	auto strategy = test_context.runtime->default_descriptor_set_strategy;
+	test_context.runtime->default_descriptor_set_strategy = DescriptorSetStrategyFlagBits::eDescriptorBuffer;
+	auto pipe = test_context.runtime->get_pipeline(pbci);
+	test_context.runtime->default_descriptor_set_strategy = strategy;
+	REQUIRE(pipe->layout_info[0].descriptor_buffer_size > 0);
+
+	auto render_pass =
+	    make_pass("descriptor buffer pass", [pipe](CommandBuffer& cbuf, VUK_IA(Access::eFragmentWrite) output_img, VUK_BA(Access::eFragmentRead) value) {
+		    cbuf.set_attachmentless_framebuffer(Extent2D{ 2, 2 }, SampleCountFlagBits::e1);
+		    cbuf.bind_graphics_pipeline(pipe);
+		    cbuf.bind_image(0, 0, output_img);
+		    cbuf.bind_buffer(0, 1, value);
+		    cbuf.set_rasterization({});
+		    cbuf.broadcast_color_blend({});
+		    cbuf.set_viewport(0, Rect2D::framebuffer());
+		    cbuf.set_scissor(0, Rect2D::framebuffer());
+		    cbuf.draw(3, 1, 0, 0);
+
+		    return output_img;
+	    });
+
+	auto rendered_img = render_pass(cleared_img, buf_val);
+
+	size_t alignment = format_to_texel_block_size(rendered_img->format);
+	size_t size = compute_image_size(rendered_img->format, rendered_img->extent);
+	auto dst = *allocate_buffer(*test_context.allocator, BufferCreateInfo{ MemoryUsage::eCPUonly, size, alignment });
+	auto dst_buf = discard_buf("dst", *dst);
+
+	auto res = download_buffer(image2buf(rendered_img, dst_buf)).get(*test_context.allocator, test_context.compiler);
+	auto updata = std::span((uint32_t*)res->mapped_ptr, 4);
+	CHECK(std::all_of(updata.begin(), updata.end(), [](auto& elem) { return elem == 42; }));
+}
+
 // TEST TODOS: image2image copy, resolve
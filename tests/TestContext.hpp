@@ -20,6 +20,7 @@ namespace vuk {
 	struct TestContext {
 		Compiler compiler;
 		bool has_rt;
+		bool has_descriptor_buffer;
 		VkDevice device;
 		VkPhysicalDevice physical_device;
 		VkQueue graphics_queue;
@@ -80,6 +81,8 @@ namespace vuk {
 				vkbphysical_device = phys_ret.value();
 			}
 
+			has_descriptor_buffer = vkbphysical_device.enable_extension_if_present(VK_EXT_DESCRIPTOR_BUFFER_EXTENSION_NAME);
+
 			physical_device = vkbphysical_device.physical_device;
 			vkb::DeviceBuilder device_builder{ vkbphysical_device };
 			VkPhysicalDeviceVulkan12Features vk12features{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES };
@@ -105,10 +108,15 @@ namespace vuk {
 				                                                             .accelerationStructure = true };
 			VkPhysicalDeviceRayTracingPipelineFeaturesKHR rtPipelineFeature{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_TRACING_PIPELINE_FEATURES_KHR,
 				                                                               .rayTracingPipeline = true };
+			VkPhysicalDeviceDescriptorBufferFeaturesEXT descriptor_buffer_feature{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_BUFFER_FEATURES_EXT,
+				                                                                       .descriptorBuffer = true };
 			device_builder = device_builder.add_pNext(&vk12features).add_pNext(&vk11features).add_pNext(&sync_feat).add_pNext(&accelFeature).add_pNext(&vk10features);
 			if (has_rt) {
 				device_builder = device_builder.add_pNext(&rtPipelineFeature);
 			}
+			if (has_descriptor_buffer) {
+				device_builder = device_builder.add_pNext(&descriptor_buffer_feature);
+			}
 			auto dev_ret = device_builder.build();
 			if (!dev_ret) {
 				throw std::runtime_error("Couldn't create device");
@@ -0,0 +1,174 @@
+#include "TestContext.hpp"
+#include "vuk/ShaderSource.hpp"
+#include "vuk/runtime/vk/Program.hpp"
+#include <algorithm>
+#include <doctest/doctest.h>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+using namespace vuk;
+
+#if VUK_USE_SHADERC
+namespace vuk {
+	// defined in src/shader_compilers/shaderc.cpp
+	Result<std::vector<uint32_t>> compile_glsl(const ShaderModuleCreateInfo& cinfo, uint32_t shader_compiler_target_version);
+} // namespace vuk
+
+namespace {
+	// reflect with both parsers, returning false if the native parser falls back to spirv-cross
+	bool check_same_reflection(std::string_view source, std::string filename) {
+		ShaderModuleCreateInfo smci{ .source = ShaderSource::glsl(source, {}), .filename = std::move(filename) };
+		auto spirv = compile_glsl(smci, VK_API_VERSION_1_3);
+		REQUIRE(spirv);
+		auto native = Program::introspect_native(spirv->data(), spirv->size());
+		if (!native) {
+			return false;
+		}
+		auto reference = Program::introspect_spirv_cross(spirv->data(), spirv->size());
+		REQUIRE(native->size() == reference.size());
+		for (auto& program : *native) {
+			auto it = std::find_if(
+			    reference.begin(), reference.end(), [&](const Program& r) { return r.entry_point == program.entry_point && r.stages == program.stages; });
+			REQUIRE(it != reference.end());
+			CHECK(Program::same_reflection(program, *it));
+		}
+		return true;
+	}
+} // namespace
+
+TEST_CASE("native reflection, vertex inputs, uniform buffers and push constants") {
+	auto source = R"(#version 450
+#pragma shader_stage(vertex)
+struct Light {
+	vec3 position;
+	float radius;
+	mat4 transform;
+};
+
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec2 uv;
+layout(location = 3) in uvec4 joints;
+
+layout(set = 0, binding = 0) uniform Camera {
+	mat4 view;
+	mat4 projection;
+	vec4 planes[6];
+} camera;
+
+layout(set = 1, binding = 2) uniform Lights {
+	Light lights[4];
+	uint count;
+};
+
+layout(push_constant) uniform Push {
+	mat4 model;
+	uint material;
+} push;
+
+layout(constant_id = 0) const int light_limit = 4;
+layout(constant_id = 3) const float scale = 1.0;
+
+layout(location = 0) out vec2 out_uv;
+
+void main() {
+	vec4 p = push.model * vec4(position * scale, 1);
+	for (int i = 0; i < min(light_limit, int(count)); i++) {
+		p += lights[i].transform * vec4(lights[i].position, lights[i].radius);
+	}
+	out_uv = uv + vec2(joints.xy) + camera.planes[push.material].xy;
+	gl_Position = camera.projection * camera.view * p;
+}
+)";
+	REQUIRE(check_same_reflection(source, "reflection.vert"));
+}
+
+TEST_CASE("native reflection, images, samplers and texel buffers") {
+	auto source = R"(#version 450
+#pragma shader_stage(fragment)
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(set = 0, binding = 0) uniform sampler2D albedo;
+layout(set = 0, binding = 1) uniform sampler2DShadow shadow_map;
+layout(set = 0, binding = 2) uniform texture2D textures[8];
+layout(set = 0, binding = 3) uniform sampler samp;
+layout(set = 0, binding = 4, rgba8) uniform readonly image2D ro_image;
+layout(set = 0, binding = 5) uniform samplerBuffer texel_buffer;
+layout(set = 0, binding = 6, r32ui) uniform uimageBuffer storage_texel_buffer;
+layout(set = 1, binding = 0) uniform sampler2D bindless[];
+
+layout(location = 0) in vec2 uv;
+layout(location = 1) flat in uint index;
+layout(location = 0) out vec4 color;
+
+void main() {
+	color = texture(albedo, uv) * texture(shadow_map, vec3(uv, 0.5));
+	color += texture(sampler2D(textures[index % 8], samp), uv);
+	color += imageLoad(ro_image, ivec2(uv));
+	color += texelFetch(texel_buffer, int(index));
+	color += texture(bindless[nonuniformEXT(index)], uv);
+	imageAtomicAdd(storage_texel_buffer, int(index), 1u);
+}
+)";
+	REQUIRE(check_same_reflection(source, "reflection.frag"));
+}
+
+TEST_CASE("native reflection, storage buffers and compute") {
+	auto source = R"(#version 450
+#pragma shader_stage(compute)
+layout(local_size_x = 64, local_size_y = 2, local_size_z = 1) in;
+
+struct Particle {
+	vec4 position;
+	vec4 velocity;
+};
+
+layout(std430, set = 0, binding = 0) readonly buffer Input {
+	uint count;
+	Particle particles[];
+} src;
+
+layout(std430, set = 0, binding = 1) writeonly buffer Output {
+	Particle particles[];
+} dst;
+
+layout(std430, set = 0, binding = 2) buffer Counters {
+	uint values[16];
+} counters;
+
+layout(set = 0, binding = 3, rgba16f) uniform writeonly image2D target;
+
+void main() {
+	uint i = gl_GlobalInvocationID.x;
+	if (i >= src.count) {
+		return;
+	}
+	dst.particles[i].position = src.particles[i].position + src.particles[i].velocity;
+	dst.particles[i].velocity = src.particles[i].velocity;
+	atomicAdd(counters.values[i % 16], 1);
+	imageStore(target, ivec2(i, gl_GlobalInvocationID.y), src.particles[i].position);
+}
+)";
+	REQUIRE(check_same_reflection(source, "reflection.comp"));
+}
+
+TEST_CASE("native reflection, example shaders") {
+	auto examples = std::filesystem::path(VUK_TEST_PATH_ROOT) / "examples";
+	size_t checked = 0;
+	for (auto& entry : std::filesystem::directory_iterator(examples)) {
+		auto extension = entry.path().extension().string();
+		static constexpr const char* glsl_extensions[] = { ".vert", ".frag", ".comp", ".tesc", ".tese", ".mesh", ".task", ".rgen", ".rchit", ".rmiss" };
+		if (std::find(std::begin(glsl_extensions), std::end(glsl_extensions), extension) == std::end(glsl_extensions)) {
+			continue;
+		}
+		INFO(entry.path().string());
+		std::ifstream file(entry.path());
+		std::stringstream buffer;
+		buffer << file.rdbuf();
+		if (check_same_reflection(buffer.str(), entry.path().string())) {
+			checked++;
+		}
+	}
+	REQUIRE(checked > 0);
+}
+#endif